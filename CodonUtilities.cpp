@@ -0,0 +1,145 @@
+/*
+ * CodonUtilities.cpp
+ *
+ *  The CodonUtilities object is a container for operations that convert
+ *  nucleotide sequences into dense integer codon (trinucleotide) indexes.
+ *
+ *  Bases are encoded as A=0, C=1, G=2, T=3 and a codon index is
+ *  16 * base1 + 4 * base2 + base3, so the indexes 0..63 follow the
+ *  alphabetical order of the trinucleotides (AAA=0, AAC=1, ... TTT=63).
+ *  Any codon containing N or another ambiguity code is given the
+ *  unknownCodon index (64).
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "CodonUtilities.h"
+using namespace std;
+
+// const variable initialization
+// ==============================================
+const int CodonUtilities::numCodons = 64;
+const int CodonUtilities::numEmissionCodons = 65;
+const uint8_t CodonUtilities::unknownBase = 4;
+const uint8_t CodonUtilities::unknownCodon = 64;
+
+// Constuctors
+// ==============================================
+CodonUtilities::CodonUtilities() {
+}
+
+// Destructor
+// =============================================
+CodonUtilities::~CodonUtilities() {
+}
+
+// Public Class Methods
+// =============================================
+
+// uint8_t encodeBase(char base)
+//  Purpose:
+//		Returns the 2 bit code for base (A=0, C=1, G=2, T=3, either case)
+//		or unknownBase for any other character.
+uint8_t CodonUtilities::encodeBase(char base) {
+	switch (base) {
+		case 'A': case 'a': return 0;
+		case 'C': case 'c': return 1;
+		case 'G': case 'g': return 2;
+		case 'T': case 't': return 3;
+		default: return unknownBase;
+	}
+}
+
+// uint8_t codonIndex(const char* residue)
+//  Purpose:
+//		Returns the codon index for the three bases starting at residue or
+//		unknownCodon if any of them is not A, C, G or T.
+uint8_t CodonUtilities::codonIndex(const char* residue) {
+	uint8_t base1 = encodeBase(residue[0]);
+	uint8_t base2 = encodeBase(residue[1]);
+	uint8_t base3 = encodeBase(residue[2]);
+
+	if ((base1 | base2 | base3) & unknownBase)
+		return unknownCodon;
+
+	return (base1 << 4) | (base2 << 2) | base3;
+}
+
+// string codonString(int codon)
+//  Purpose:
+//		Returns the trinucleotide for a codon index ("NNN" for unknownCodon)
+string CodonUtilities::codonString(int codon) {
+	static const char bases[] = "ACGT";
+
+	if (codon >= numCodons)
+		return "NNN";
+
+	string residue(3, 'N');
+	residue[0] = bases[(codon >> 4) & 3];
+	residue[1] = bases[(codon >> 2) & 3];
+	residue[2] = bases[codon & 3];
+	return residue;
+}
+
+// encodeSequence(const string& sequence, vector<uint8_t>& codons)
+//  Purpose:
+//		Populates codons with the codon index of every trinucleotide in
+//		sequence (codon i starts at sequence[i]).
+//  Postconditions:
+//		codons - contains sequence.length() - 2 codon indexes
+void CodonUtilities::encodeSequence(const string& sequence, vector<uint8_t>& codons) {
+	codons.clear();
+	if (sequence.length() < 3)
+		return;
+
+	codons.resize(sequence.length() - 2);
+
+	// Roll the codon forward one base at a time. unknownRun counts the
+	// bases left before an unknown base drops out of the codon window.
+	int codon = 0;
+	int unknownRun = 0;
+	for (string::size_type i = 0; i < sequence.length(); i++) {
+		uint8_t base = encodeBase(sequence[i]);
+		if (base == unknownBase) {
+			unknownRun = 3;
+			base = 0;
+		}
+		codon = ((codon << 2) | base) & 63;
+
+		if (i >= 2)
+			codons[i - 2] = (unknownRun > 0) ? unknownCodon : codon;
+
+		if (unknownRun > 0)
+			unknownRun--;
+	}
+}
+
+// uint8_t reverseComplementCodon(uint8_t codon)
+//  Purpose:
+//		Returns the codon index of the reverse complement of codon (e.g.,
+//		CAT for ATG).  The unknown codon stays unknown.
+uint8_t CodonUtilities::reverseComplementCodon(uint8_t codon) {
+	if (codon >= numCodons)
+		return unknownCodon;
+
+	// The complement of a base is 3 - base (A <-> T, C <-> G)
+	int base1 = 3 - ((codon >> 4) & 3);
+	int base2 = 3 - ((codon >> 2) & 3);
+	int base3 = 3 - (codon & 3);
+	return (base3 << 4) | (base2 << 2) | base1;
+}
+
+// reverseComplementCodons(const uint8_t* codons, int numberOfCodons, vector<uint8_t>& reverseCodons)
+//  Purpose:
+//		Populates reverseCodons with the codons of the reverse complement
+//		of the sequence codons were encoded from, i.e. the same codons
+//		encodeSequence gives for the reverse complement sequence.
+//  Postconditions:
+//		reverseCodons - reverseCodons[i] is the reverse complement of
+//						codons[numberOfCodons - 1 - i]
+void CodonUtilities::reverseComplementCodons(const uint8_t* codons, int numberOfCodons, vector<uint8_t>& reverseCodons) {
+	reverseCodons.resize(numberOfCodons);
+	for (int i = 0; i < numberOfCodons; i++)
+		reverseCodons[i] = reverseComplementCodon(codons[numberOfCodons - 1 - i]);
+}
@@ -0,0 +1,88 @@
+/*
+ * CodonUtilities.h
+ *
+ *  The CodonUtilities object is a container for operations that convert
+ *  nucleotide sequences into dense integer codon (trinucleotide) indexes.
+ *
+ *  Bases are encoded as A=0, C=1, G=2, T=3 and a codon index is
+ *  16 * base1 + 4 * base2 + base3, so the indexes 0..63 follow the
+ *  alphabetical order of the trinucleotides (AAA=0, AAC=1, ... TTT=63).
+ *  Any codon containing N or another ambiguity code is given the
+ *  unknownCodon index (64).
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef CODONUTILITIES_H
+#define CODONUTILITIES_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+class CodonUtilities {
+public:
+
+	// Constuctors
+	// ==============================================
+	CodonUtilities();
+
+	// Destructor
+	// =============================================
+	virtual ~CodonUtilities();
+
+	// Public Class Attributes
+	// =============================================
+	static const int numCodons;				// 64 ACGT codons
+	static const int numEmissionCodons;		// numCodons + the unknown codon
+	static const uint8_t unknownBase;
+	static const uint8_t unknownCodon;
+
+	// Public Class Methods
+	// =============================================
+
+	// uint8_t encodeBase(char base)
+	//  Purpose:
+	//		Returns the 2 bit code for base (A=0, C=1, G=2, T=3, either case)
+	//		or unknownBase for any other character.
+	static uint8_t encodeBase(char base);
+
+	// uint8_t codonIndex(const char* residue)
+	//  Purpose:
+	//		Returns the codon index for the three bases starting at residue or
+	//		unknownCodon if any of them is not A, C, G or T.
+	static uint8_t codonIndex(const char* residue);
+
+	// string codonString(int codon)
+	//  Purpose:
+	//		Returns the trinucleotide for a codon index ("NNN" for unknownCodon)
+	static string codonString(int codon);
+
+	// encodeSequence(const string& sequence, vector<uint8_t>& codons)
+	//  Purpose:
+	//		Populates codons with the codon index of every trinucleotide in
+	//		sequence (codon i starts at sequence[i]).
+	//  Postconditions:
+	//		codons - contains sequence.length() - 2 codon indexes
+	static void encodeSequence(const string& sequence, vector<uint8_t>& codons);
+
+	// uint8_t reverseComplementCodon(uint8_t codon)
+	//  Purpose:
+	//		Returns the codon index of the reverse complement of codon (e.g.,
+	//		CAT for ATG).  The unknown codon stays unknown.
+	static uint8_t reverseComplementCodon(uint8_t codon);
+
+	// reverseComplementCodons(const uint8_t* codons, int numberOfCodons, vector<uint8_t>& reverseCodons)
+	//  Purpose:
+	//		Populates reverseCodons with the codons of the reverse complement
+	//		of the sequence codons were encoded from, i.e. the same codons
+	//		encodeSequence gives for the reverse complement sequence.
+	//  Postconditions:
+	//		reverseCodons - reverseCodons[i] is the reverse complement of
+	//						codons[numberOfCodons - 1 - i]
+	static void reverseComplementCodons(const uint8_t* codons, int numberOfCodons, vector<uint8_t>& reverseCodons);
+};
+
+#endif /* CODONUTILITIES_H */
@@ -5,20 +5,14 @@
  *  is a utility object designed to read in a Fasta File and keep the 
  *  information for the file in memory.
  *
- *  ************* WARNING ***********************************
- *  *  There is no error handling in place for this object! *
- *  *  This means that if the file does not exist or is     *
- *  *  formatted incorrectly, you will get an error and     *
- *  *  will not be able to use this object.                 *
- *  *                                                       *
- *  *  If this code gets moved to a production setting      *
- *  *  appropriate error handling should be implemented!    *
- *  *********************************************************
- *
  * Typical use for the file would be to use the FastaFile(pathName, fileName)
  * constructor to create the object.  This will automatically open the
  * Fasta File specified by the pathName and fileName, and read its contents
- * storing them in the firstLine, and sequence attributes.
+ * storing them in the firstLine, and sequence attributes.  Only the first
+ * record of the file is read and a runtime_error is thrown if the file can
+ * not be opened.  Multi-record files should be read with a FastaReader and
+ * each record wrapped with the FastaFile(fileName, header, sequence)
+ * constructor.
  *
  * buildGraphFile(graphFileName, wieghtFileName) is a convenience method that
  * will create a sequence graph file for the sequence.  See the method for
@@ -30,30 +24,44 @@
  */
 
 #include "FastaFile.h"
+#include "FastaReader.h"
+#include "GenomeCache.h"
 #include "StringUtilities.h"
+#include "HMMInstrumentation.h"
 #include <sstream>
 #include <iostream>
-#include <fstream>
 #include <map>
 using namespace std;
 
 // Constuctors
 // ==============================================
 FastaFile::FastaFile() {
+	dna = true;
+	reverseComplementCreated = false;
 }
 
 FastaFile::FastaFile(string name) {
 	dna = true;
+	reverseComplementCreated = false;
 	parseFileName(name);
 	populate();
 }
 
 FastaFile::FastaFile(string name, bool dnaBool) {
 	dna = dnaBool;
+	reverseComplementCreated = false;
 	parseFileName(name);
 	populate();
 }
 
+FastaFile::FastaFile(string name, const string& header, const string& aSequence) {
+	dna = true;
+	reverseComplementCreated = false;
+	parseFileName(name);
+	firstLine = ">" + header;
+	sequence = aSequence;
+}
+
 
 // Destructor
 // ==============================================
@@ -129,6 +137,18 @@ bool FastaFile::isDNA() {
 	return dna;
 }
 
+// writeGenomeCache(string cacheFileName, bool includeCodons)
+//  Purpose:
+//		Writes the sequence to a binary genome cache file that can be
+//		reopened with GenomeCache (see GenomeCache.h).  If includeCodons
+//		is true the codon index array is precomputed and stored as well.
+//  Preconditions:
+//		Fasta File has been read and sequence has been populated
+void FastaFile::writeGenomeCache(string cacheFileName, bool includeCodons) {
+	string header = firstLine.empty() ? firstLine : firstLine.substr(1);
+	GenomeCache::create(cacheFileName, header, sequence, includeCodons);
+}
+
 // Public Accessors
 // =============================================
 const int FastaFile::getSequenceLength() {
@@ -139,10 +159,26 @@ string& FastaFile::getFileName() {
 	return fileName;
 }
 
+string FastaFile::getSequenceName() {
+	size_t end = firstLine.find_first_of(" \t\r", 1);
+	string name = firstLine.empty() ? "" : firstLine.substr(1, (end == string::npos) ? string::npos : end - 1);
+
+	return name.empty() ? fileName : name;
+}
+
 string& FastaFile::getSequence() {
 	return sequence;
 }
 
+string& FastaFile::getReverseComplement() {
+	if (!reverseComplementCreated && isDNA()) {
+		createReverseComplement();
+		reverseComplementCreated = true;
+	}
+
+	return reverseComplement;
+}
+
 // Private Methods
 // =============================================
 
@@ -175,25 +211,15 @@ void FastaFile::parseFileName(string& aFileName) {
 //  Postconditions:
 //		firstLine - populated with first line from file
 //		sequence - populated with sequence from file
-//		reverseComplement - populated with reverse complement of sequence
 void FastaFile::populate() {
+	HMM_SCOPED_TIMER(fastaLoadTimer);
 
-	ifstream inputFile(filePath + "/" + fileName);
-	stringstream ss;
-	string line;
-
-	getline(inputFile, firstLine);
-		
-	while(getline(inputFile, line)) {
-		ss << line;
-	}
-
-	sequence = ss.str();
-
-	inputFile.close();
+	// Throws if the file can not be opened
+	FastaReader reader(filePath + "/" + fileName);
 
-	if (isDNA())
-		createReverseComplement();
+	string header;
+	if (reader.nextRecord(header, sequence))
+		firstLine = ">" + header;
 }
 
 // createReverseComplment()
@@ -205,16 +231,13 @@ void FastaFile::populate() {
 //  Postconditions:
 //		reverseComplement - populated with reverse complement of sequence
 void FastaFile::createReverseComplement() {
-	stringstream ss;
+	string::size_type length = sequence.length();
+	reverseComplement.resize(length);
 
-	// Append the complements in order
-	for (string::size_type i = 0; i < sequence.length(); i++) {
-			ss << complement(sequence[i]);
+	// Write the complements from the back of the string forward
+	for (string::size_type i = 0; i < length; i++) {
+		reverseComplement[length - 1 - i] = complement(sequence[i]);
 	}
-
-	// Reverse the string and set it to the reverseComplement attribute
-	string complement = ss.str();
-	reverseComplement = string(complement.rbegin(), complement.rend());
 }
 
 // char complement(char aChar)
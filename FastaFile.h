@@ -5,20 +5,14 @@
  *  is a utility object designed to read in a Fasta File and keep the 
  *  information for the file in memory.
  *
- *  ************* WARNING ***********************************
- *  *  There is no error handling in place for this object! *
- *  *  This means that if the file does not exist or is     *
- *  *  formatted incorrectly, you will get an error and     *
- *  *  will not be able to use this object.                 *
- *  *                                                       *
- *  *  If this code gets moved to a production setting      *
- *  *  appropriate error handling should be implemented!    *
- *  *********************************************************
- *
  * Typical use for the file would be to use the FastaFile(pathName, fileName)
  * constructor to create the object.  This will automatically open the
  * Fasta File specified by the pathName and fileName, and read its contents
- * storing them in the firstLine, and dnaSequence attributes.
+ * storing them in the firstLine, and dnaSequence attributes.  Only the first
+ * record of the file is read and a runtime_error is thrown if the file can
+ * not be opened.  Multi-record files should be read with a FastaReader and
+ * each record wrapped with the FastaFile(fileName, header, sequence)
+ * constructor.
  *
  * buildGraphFile(graphFileName, wieghtFileName) is a convenience method that
  * will create a sequence graph file for the dnaSequence.  See the method for
@@ -45,6 +39,7 @@ public:
 	FastaFile(); 
 	FastaFile(string fileName);  
 	FastaFile(string fileName, bool dnaBool);  
+	FastaFile(string fileName, const string& header, const string& aSequence);
 
 	// Destructor
 	// =============================================
@@ -85,11 +80,22 @@ public:
 	//		Returns true if the sequence is a DNA sequence
     bool isDNA();
 
+	// writeGenomeCache(string cacheFileName, bool includeCodons)
+	//  Purpose:
+	//		Writes the sequence to a binary genome cache file that can be
+	//		reopened with GenomeCache (see GenomeCache.h).  If includeCodons
+	//		is true the codon index array is precomputed and stored as well.
+	//  Preconditions:
+	//		Fasta File has been read and sequence has been populated
+	void writeGenomeCache(string cacheFileName, bool includeCodons);
+
 	// Public Accessors
 	// =============================================
 	const int getSequenceLength();  // length of dnaSequence
 	string& getFileName();
+	string getSequenceName();  // first word of the header (the file name without one)
 	string& getSequence();
+	string& getReverseComplement();  // created on first use
 
 private:
 	// Attributes
@@ -99,6 +105,7 @@ private:
     string firstLine;
     string sequence;
 	string reverseComplement;
+	bool reverseComplementCreated;
 	bool dna; // set to true if the sequence is a dna sequence
 
 	// Private Methods
@@ -120,7 +127,6 @@ private:
 	//  Postconditions:
 	//		firstLine - populated with first line from file
 	//		dnaSequence - populated with dnaSequence from file
-	//		reverseComplement - populated with reverse complement of dnaSequence
     void populate();
 
 	// createReverseComplment()
@@ -0,0 +1,228 @@
+/*
+ * FastaReader.cpp
+ *
+ *	This is the cpp file for the FastaReader object. The FastaReader
+ *  object streams the records of a Fasta file one at a time.  The file is
+ *  read in large blocks and sequence characters are normalized (upper
+ *  cased, whitespace and line breaks removed) in the same pass that copies
+ *  them out of the read buffer, so no intermediate copy of the file is made.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "FastaReader.h"
+#include <stdexcept>
+#include <cctype>
+using namespace std;
+
+// const variable initialization
+// ==============================================
+const size_t FastaReader::blockSize = 1 << 20;
+
+// Translation table used to normalize sequence characters.  Whitespace
+// maps to 0 (dropped), everything else is upper cased.  The table is a
+// function local static object, so it is built exactly once even when
+// readers are created on several threads at the same time.
+struct NormalizationTable {
+	char characters[256];
+
+	NormalizationTable() {
+		for (int i = 0; i < 256; i++) {
+			characters[i] = isspace(i) ? 0 : (char) toupper(i);
+		}
+	}
+};
+
+static const char* normalizationTable() {
+	static const NormalizationTable table;
+	return table.characters;
+}
+
+// Constuctors
+// ==============================================
+FastaReader::FastaReader() {
+	file = NULL;
+	ownsFile = false;
+	initialize();
+}
+
+FastaReader::FastaReader(string fileName) {
+	file = fopen(fileName.c_str(), "rb");
+	if (file == NULL)
+		throw runtime_error("Unable to open fasta file: " + fileName);
+
+	ownsFile = true;
+	initialize();
+}
+
+FastaReader::FastaReader(FILE* aFile) {
+	file = aFile;
+	ownsFile = false;
+	initialize();
+}
+
+// Destructor
+// ==============================================
+FastaReader::~FastaReader() {
+	if (ownsFile && file != NULL)
+		fclose(file);
+}
+
+// Public Methods
+// =============================================
+
+// bool nextRecord(string& header, string& sequence)
+//  Purpose:
+//		Reads the next record in the file.  Returns false when there are
+//		no more records.
+//  Postconditions:
+//		header - set to the header of the record (without the '>')
+//		sequence - set to the normalized sequence of the record
+bool FastaReader::nextRecord(string& header, string& sequence) {
+	if (!nextHeader(header))
+		return false;
+
+	sequence.clear();
+	while (readSequence(sequence, blockSize) > 0);
+
+	return true;
+}
+
+// bool nextHeader(string& header)
+//  Purpose:
+//		Skips any unread sequence in the current record and reads the
+//		header of the next record.  Returns false when there are no more
+//		records.
+//  Postconditions:
+//		header - set to the header of the record (without the '>')
+bool FastaReader::nextHeader(string& header) {
+	// Skip whatever is left of the current record
+	string unread;
+	while (inRecord) {
+		unread.clear();
+		readSequence(unread, blockSize);
+	}
+
+	skipBlankLines();
+	if (!fillBuffer())
+		return false;
+
+	header.clear();
+	inRecord = true;
+	atLineStart = true;
+
+	// No header on this record (only possible for the first record)
+	if (buffer[bufferPosition] != '>')
+		return true;
+
+	// Read the header line
+	bufferPosition++;
+	while (fillBuffer()) {
+		char* begin = &buffer[bufferPosition];
+		char* end = &buffer[0] + bufferLength;
+		char* lineEnd = begin;
+		while (lineEnd < end && *lineEnd != '\n')
+			lineEnd++;
+
+		header.append(begin, lineEnd);
+		bufferPosition += lineEnd - begin;
+
+		if (lineEnd < end) {
+			bufferPosition++;  // consume the line break
+			break;
+		}
+	}
+
+	// Strip a trailing carriage return
+	if (!header.empty() && header[header.length() - 1] == '\r')
+		header.erase(header.length() - 1);
+
+	return true;
+}
+
+// size_t readSequence(string& chunk, size_t maxLength)
+//  Purpose:
+//		Appends up to maxLength normalized sequence characters from the
+//		current record to chunk.  Returns the number of characters appended,
+//		which is 0 once the end of the record has been reached.
+size_t FastaReader::readSequence(string& chunk, size_t maxLength) {
+	if (!inRecord)
+		return 0;
+
+	const char* table = normalizationTable();
+	size_t appended = 0;
+
+	while (appended < maxLength) {
+		if (!fillBuffer()) {
+			inRecord = false;
+			break;
+		}
+
+		// The next record starts here
+		if (atLineStart && buffer[bufferPosition] == '>') {
+			inRecord = false;
+			break;
+		}
+
+		// Normalize the rest of the current line (or buffer) in one pass
+		const char* begin = &buffer[bufferPosition];
+		const char* end = &buffer[0] + bufferLength;
+		const char* current = begin;
+		while (current < end && appended < maxLength) {
+			char c = *current++;
+			if (c == '\n') {
+				atLineStart = true;
+				break;
+			}
+			atLineStart = false;
+
+			char normalized = table[(unsigned char) c];
+			if (normalized != 0) {
+				chunk.push_back(normalized);
+				appended++;
+			}
+		}
+		bufferPosition += current - begin;
+	}
+
+	return appended;
+}
+
+// Private Methods
+// =============================================
+
+// initialize()
+//  Purpose:
+//		Sets up the read buffer and parser state
+void FastaReader::initialize() {
+	buffer.resize(blockSize);
+	bufferPosition = 0;
+	bufferLength = 0;
+	atLineStart = true;
+	inRecord = false;
+}
+
+// bool fillBuffer()
+//  Purpose:
+//		Reads the next block of the file into the buffer if the buffer has
+//		been consumed.  Returns false at the end of the file.
+bool FastaReader::fillBuffer() {
+	if (bufferPosition < bufferLength)
+		return true;
+
+	if (file == NULL)
+		return false;
+
+	bufferLength = fread(&buffer[0], 1, buffer.size(), file);
+	bufferPosition = 0;
+	return bufferLength > 0;
+}
+
+// skipBlankLines()
+//  Purpose:
+//		Consumes line breaks and whitespace stored between records
+void FastaReader::skipBlankLines() {
+	while (fillBuffer() && isspace((unsigned char) buffer[bufferPosition]))
+		bufferPosition++;
+}
@@ -0,0 +1,121 @@
+/*
+ * FastaReader.h
+ *
+ *	This is the header file for the FastaReader object. The FastaReader
+ *  object streams the records of a Fasta file one at a time.  The file is
+ *  read in large blocks and sequence characters are normalized (upper
+ *  cased, whitespace and line breaks removed) in the same pass that copies
+ *  them out of the read buffer, so no intermediate copy of the file is made.
+ *
+ *  Typical use for reading whole records would be:
+ *
+ *		FastaReader reader(fileName);
+ *		string header, sequence;
+ *		while (reader.nextRecord(header, sequence)) {
+ *			...
+ *		}
+ *
+ *  To feed a consumer chunk by chunk without holding a whole record in
+ *  memory use nextHeader() and readSequence():
+ *
+ *		while (reader.nextHeader(header)) {
+ *			string chunk;
+ *			while (reader.readSequence(chunk, chunkSize) > 0) {
+ *				... consume chunk ...
+ *				chunk.clear();
+ *			}
+ *		}
+ *
+ *  Headers are returned without the leading '>'.  A file that does not start
+ *  with a header is read as a single record with an empty header.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef FASTAREADER_H
+#define FASTAREADER_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+using namespace std;
+
+class FastaReader {
+
+public:
+
+	// Constuctors
+	// ==============================================
+	FastaReader();
+	FastaReader(string fileName);
+	FastaReader(FILE* aFile);
+
+	// Destructor
+	// =============================================
+	virtual ~FastaReader();
+
+	// Public Class Attributes
+	// =============================================
+	static const size_t blockSize;
+
+	// Public Methods
+	// =============================================
+
+	// bool nextRecord(string& header, string& sequence)
+	//  Purpose:
+	//		Reads the next record in the file.  Returns false when there are
+	//		no more records.
+	//  Postconditions:
+	//		header - set to the header of the record (without the '>')
+	//		sequence - set to the normalized sequence of the record
+	bool nextRecord(string& header, string& sequence);
+
+	// bool nextHeader(string& header)
+	//  Purpose:
+	//		Skips any unread sequence in the current record and reads the
+	//		header of the next record.  Returns false when there are no more
+	//		records.
+	//  Postconditions:
+	//		header - set to the header of the record (without the '>')
+	bool nextHeader(string& header);
+
+	// size_t readSequence(string& chunk, size_t maxLength)
+	//  Purpose:
+	//		Appends up to maxLength normalized sequence characters from the
+	//		current record to chunk.  Returns the number of characters appended,
+	//		which is 0 once the end of the record has been reached.
+	size_t readSequence(string& chunk, size_t maxLength);
+
+private:
+	// Attributes
+	// =============================================
+	FILE* file;
+	bool ownsFile;
+	vector<char> buffer;
+	size_t bufferPosition;
+	size_t bufferLength;
+	bool atLineStart;
+	bool inRecord;
+
+	// Private Methods
+	// =============================================
+
+	// initialize()
+	//  Purpose:
+	//		Sets up the read buffer and parser state
+	void initialize();
+
+	// bool fillBuffer()
+	//  Purpose:
+	//		Reads the next block of the file into the buffer if the buffer has
+	//		been consumed.  Returns false at the end of the file.
+	bool fillBuffer();
+
+	// skipBlankLines()
+	//  Purpose:
+	//		Consumes line breaks and whitespace stored between records
+	void skipBlankLines();
+};
+
+#endif /* FASTAREADER_H */
@@ -0,0 +1,385 @@
+/*
+ * GenomeCache.cpp
+ *
+ *	This is the cpp file for the GenomeCache object. A GenomeCache is a
+ *  pre-encoded binary copy of the records of a Fasta file that can be
+ *  reopened through mmap.  Opening a cache does not parse or copy the
+ *  sequences; all accessors read straight out of the mapped file.
+ *
+ *  See GenomeCache.h for the layout of the file.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "GenomeCache.h"
+#include "CodonUtilities.h"
+#include <stdexcept>
+#include <cstring>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// const variable initialization
+// ==============================================
+const char GenomeCache::magic[8] = {'H', 'M', 'M', 'G', 'E', 'N', 'O', 'M'};
+const uint64_t GenomeCache::version = 1;
+const uint64_t GenomeCache::codonsFlag = 1;
+
+// Constuctors
+// ==============================================
+GenomeCache::GenomeCache(string aFileName) {
+	fileName = aFileName;
+	data = NULL;
+	dataLength = 0;
+	header = NULL;
+	records = NULL;
+	mapFile();
+}
+
+// Destructor
+// ==============================================
+GenomeCache::~GenomeCache() {
+#ifndef _WIN32
+	if (data != NULL && fileContents.empty())
+		munmap((void*) data, dataLength);
+#endif
+}
+
+// Public Class Methods
+// =============================================
+
+// create(string cacheFileName, FastaReader& reader, bool includeCodons)
+//  Purpose:
+//		Writes every remaining record of reader to a new cache file.  Records
+//		are read and written one at a time.  If includeCodons is true the
+//		codon index array of each record is stored as well.
+void GenomeCache::create(string cacheFileName, FastaReader& reader, bool includeCodons) {
+	uint64_t fileOffset;
+	FILE* file = openForWriting(cacheFileName, fileOffset);
+
+	vector<GenomeCacheRecord> recordTable;
+	string name, sequence;
+	while (reader.nextRecord(name, sequence)) {
+		GenomeCacheRecord record;
+		writeRecord(file, fileOffset, name, sequence, includeCodons, record);
+		recordTable.push_back(record);
+	}
+
+	finishWriting(file, fileOffset, recordTable, includeCodons);
+}
+
+// create(string cacheFileName, const string& header, const string& sequence, bool includeCodons)
+//  Purpose:
+//		Writes a cache file holding the single record header/sequence
+void GenomeCache::create(string cacheFileName, const string& header, const string& sequence, bool includeCodons) {
+	uint64_t fileOffset;
+	FILE* file = openForWriting(cacheFileName, fileOffset);
+
+	vector<GenomeCacheRecord> recordTable(1);
+	writeRecord(file, fileOffset, header, sequence, includeCodons, recordTable[0]);
+
+	finishWriting(file, fileOffset, recordTable, includeCodons);
+}
+
+// Public Methods
+// =============================================
+
+// bool hasCodons()
+//  Purpose:
+//		Returns true if the cache holds precomputed codon index arrays
+bool GenomeCache::hasCodons() {
+	return (header->flags & codonsFlag) != 0;
+}
+
+// const uint8_t* getCodons(int record)
+//  Purpose:
+//		Returns the precomputed codon index array for record (inside the
+//		mapped file) or NULL if the cache holds no codons.
+const uint8_t* GenomeCache::getCodons(int record) {
+	checkRecord(record);
+
+	if (records[record].codonsOffset == 0)
+		return NULL;
+
+	return data + records[record].codonsOffset;
+}
+
+// decodeCodons(int record, vector<uint8_t>& codons)
+//  Purpose:
+//		Populates codons with the codon index array of record from the
+//		packed bases.  Used when the cache holds no codons.
+void GenomeCache::decodeCodons(int record, vector<uint8_t>& codons) {
+	checkRecord(record);
+
+	const GenomeCacheRecord& entry = records[record];
+	const uint8_t* packed = data + entry.packedOffset;
+	const uint64_t* nRuns = (const uint64_t*) (data + entry.nRunsOffset);
+
+	codons.clear();
+	if (entry.sequenceLength < 3)
+		return;
+
+	codons.resize(entry.sequenceLength - 2);
+
+	// Same rolling encoding as CodonUtilities::encodeSequence, with the
+	// unknown bases taken from the N runs instead of the sequence
+	uint64_t nextRun = 0;
+	int codon = 0;
+	int unknownRun = 0;
+	for (uint64_t i = 0; i < entry.sequenceLength; i++) {
+		while (nextRun < entry.numNRuns && nRuns[2 * nextRun] + nRuns[2 * nextRun + 1] <= i)
+			nextRun++;
+
+		if (nextRun < entry.numNRuns && nRuns[2 * nextRun] <= i)
+			unknownRun = 3;
+
+		uint8_t base = (packed[i >> 2] >> ((i & 3) << 1)) & 3;
+		codon = ((codon << 2) | base) & 63;
+
+		if (i >= 2)
+			codons[i - 2] = (unknownRun > 0) ? CodonUtilities::unknownCodon : codon;
+
+		if (unknownRun > 0)
+			unknownRun--;
+	}
+}
+
+// decodeSequence(int record, string& sequence)
+//  Purpose:
+//		Populates sequence with the bases of record.  Positions in an N run
+//		are decoded as 'N'.
+void GenomeCache::decodeSequence(int record, string& sequence) {
+	static const char bases[] = "ACGT";
+
+	checkRecord(record);
+
+	const GenomeCacheRecord& entry = records[record];
+	const uint8_t* packed = data + entry.packedOffset;
+	const uint64_t* nRuns = (const uint64_t*) (data + entry.nRunsOffset);
+
+	sequence.resize(entry.sequenceLength);
+	for (uint64_t i = 0; i < entry.sequenceLength; i++)
+		sequence[i] = bases[(packed[i >> 2] >> ((i & 3) << 1)) & 3];
+
+	for (uint64_t run = 0; run < entry.numNRuns; run++)
+		sequence.replace(nRuns[2 * run], nRuns[2 * run + 1], nRuns[2 * run + 1], 'N');
+}
+
+// Public Accessors
+// =============================================
+int GenomeCache::getNumRecords() {
+	return header->numRecords;
+}
+
+string GenomeCache::getRecordName(int record) {
+	checkRecord(record);
+	return string((const char*) data + records[record].nameOffset, records[record].nameLength);
+}
+
+uint64_t GenomeCache::getSequenceLength(int record) {
+	checkRecord(record);
+	return records[record].sequenceLength;
+}
+
+int GenomeCache::getNumCodons(int record) {
+	checkRecord(record);
+	if (records[record].sequenceLength < 3)
+		return 0;
+
+	return records[record].sequenceLength - 2;
+}
+
+// Private Class Methods
+// =============================================
+
+// FILE* openForWriting(const string& cacheFileName, uint64_t& fileOffset)
+//  Purpose:
+//		Creates the cache file and reserves space for the header
+FILE* GenomeCache::openForWriting(const string& cacheFileName, uint64_t& fileOffset) {
+	FILE* file = fopen(cacheFileName.c_str(), "wb");
+	if (file == NULL)
+		throw runtime_error("Unable to create genome cache: " + cacheFileName);
+
+	// The header is rewritten once the record table offset is known
+	GenomeCacheHeader placeholder;
+	memset(&placeholder, 0, sizeof(placeholder));
+	fileOffset = 0;
+	writeSection(file, fileOffset, &placeholder, sizeof(placeholder));
+
+	return file;
+}
+
+// writeRecord(file, fileOffset, name, sequence, includeCodons, record)
+//  Purpose:
+//		Appends the sections for one record to file and fills in record
+//		with their offsets
+void GenomeCache::writeRecord(FILE* file, uint64_t& fileOffset, const string& name, const string& sequence, bool includeCodons, GenomeCacheRecord& record) {
+	memset(&record, 0, sizeof(record));
+	record.sequenceLength = sequence.length();
+
+	// Name
+	record.nameLength = name.length();
+	record.nameOffset = writeSection(file, fileOffset, name.data(), name.length());
+
+	// Pack the bases and collect the N runs in one pass
+	vector<uint8_t> packed((sequence.length() + 3) / 4, 0);
+	vector<uint64_t> nRuns;
+	for (string::size_type i = 0; i < sequence.length(); i++) {
+		uint8_t base = CodonUtilities::encodeBase(sequence[i]);
+		if (base == CodonUtilities::unknownBase) {
+			if (!nRuns.empty() && nRuns[nRuns.size() - 2] + nRuns[nRuns.size() - 1] == i) {
+				nRuns[nRuns.size() - 1]++;
+			}
+			else {
+				nRuns.push_back(i);
+				nRuns.push_back(1);
+			}
+			base = 0;
+		}
+		packed[i >> 2] |= base << ((i & 3) << 1);
+	}
+
+	record.packedOffset = writeSection(file, fileOffset, packed.empty() ? NULL : &packed[0], packed.size());
+	record.numNRuns = nRuns.size() / 2;
+	record.nRunsOffset = writeSection(file, fileOffset, nRuns.empty() ? NULL : &nRuns[0], nRuns.size() * sizeof(uint64_t));
+
+	// Codons
+	if (includeCodons) {
+		vector<uint8_t> codons;
+		CodonUtilities::encodeSequence(sequence, codons);
+		record.codonsOffset = writeSection(file, fileOffset, codons.empty() ? NULL : &codons[0], codons.size());
+	}
+}
+
+// finishWriting(file, fileOffset, recordTable, includeCodons)
+//  Purpose:
+//		Appends the record table to file, writes the header at the start
+//		of the file and closes it
+void GenomeCache::finishWriting(FILE* file, uint64_t& fileOffset, vector<GenomeCacheRecord>& recordTable, bool includeCodons) {
+	GenomeCacheHeader cacheHeader;
+	memset(&cacheHeader, 0, sizeof(cacheHeader));
+	memcpy(cacheHeader.magic, magic, sizeof(magic));
+	cacheHeader.version = version;
+	cacheHeader.numRecords = recordTable.size();
+	cacheHeader.flags = includeCodons ? codonsFlag : 0;
+	cacheHeader.recordTableOffset = writeSection(
+		file,
+		fileOffset,
+		recordTable.empty() ? NULL : &recordTable[0],
+		recordTable.size() * sizeof(GenomeCacheRecord));
+
+	bool written =
+		fseek(file, 0, SEEK_SET) == 0 &&
+		fwrite(&cacheHeader, sizeof(cacheHeader), 1, file) == 1;
+
+	if (fclose(file) != 0 || !written)
+		throw runtime_error("Unable to write genome cache");
+}
+
+// uint64_t writeSection(FILE* file, uint64_t& fileOffset, const void* bytes, size_t length)
+//  Purpose:
+//		Writes bytes at fileOffset (the 8 byte aligned end of file), pads the
+//		file to the next 8 byte boundary and returns the offset the bytes
+//		were written at.
+uint64_t GenomeCache::writeSection(FILE* file, uint64_t& fileOffset, const void* bytes, size_t length) {
+	static const char padding[8] = {0};
+
+	uint64_t sectionOffset = fileOffset;
+	size_t paddingLength = (8 - (length & 7)) & 7;
+
+	if ((length > 0 && fwrite(bytes, 1, length, file) != length) ||
+		(paddingLength > 0 && fwrite(padding, 1, paddingLength, file) != paddingLength)) {
+		fclose(file);
+		throw runtime_error("Unable to write genome cache");
+	}
+
+	fileOffset += length + paddingLength;
+	return sectionOffset;
+}
+
+// Private Methods
+// =============================================
+
+// mapFile()
+//  Purpose:
+//		Maps the cache file into memory and validates its header and
+//		record table
+void GenomeCache::mapFile() {
+#ifndef _WIN32
+	int descriptor = open(fileName.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		throw runtime_error("Unable to open genome cache: " + fileName);
+
+	struct stat fileStatus;
+	if (fstat(descriptor, &fileStatus) != 0 || fileStatus.st_size < (off_t) sizeof(GenomeCacheHeader)) {
+		close(descriptor);
+		throw runtime_error("Invalid genome cache: " + fileName);
+	}
+
+	dataLength = fileStatus.st_size;
+	void* mapped = mmap(NULL, dataLength, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+
+	if (mapped == MAP_FAILED)
+		throw runtime_error("Unable to map genome cache: " + fileName);
+
+	data = (const uint8_t*) mapped;
+#else
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (file == NULL)
+		throw runtime_error("Unable to open genome cache: " + fileName);
+
+	fseek(file, 0, SEEK_END);
+	dataLength = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	fileContents.resize(dataLength > 0 ? dataLength : 1);
+	dataLength = fread(&fileContents[0], 1, dataLength, file);
+	fclose(file);
+
+	data = &fileContents[0];
+	if (dataLength < sizeof(GenomeCacheHeader))
+		throw runtime_error("Invalid genome cache: " + fileName);
+#endif
+
+	// Validate the header and make sure every section is inside the file
+	header = (const GenomeCacheHeader*) data;
+	records = (const GenomeCacheRecord*) (data + header->recordTableOffset);
+
+	bool valid =
+		memcmp(header->magic, magic, sizeof(magic)) == 0 &&
+		header->version == version &&
+		header->recordTableOffset <= dataLength &&
+		header->numRecords <= (dataLength - header->recordTableOffset) / sizeof(GenomeCacheRecord);
+
+	for (uint64_t record = 0; valid && record < header->numRecords; record++) {
+		const GenomeCacheRecord& entry = records[record];
+		uint64_t numCodons = entry.sequenceLength < 3 ? 0 : entry.sequenceLength - 2;
+
+		valid =
+			entry.nameOffset + entry.nameLength <= dataLength &&
+			entry.packedOffset + (entry.sequenceLength + 3) / 4 <= dataLength &&
+			entry.nRunsOffset + entry.numNRuns * 2 * sizeof(uint64_t) <= dataLength &&
+			(entry.codonsOffset == 0 || entry.codonsOffset + numCodons <= dataLength);
+	}
+
+	if (!valid) {
+#ifndef _WIN32
+		munmap((void*) data, dataLength);
+#endif
+		data = NULL;
+		throw runtime_error("Invalid genome cache: " + fileName);
+	}
+}
+
+// checkRecord(int record)
+//  Purpose:
+//		Throws an out_of_range error if record is not in the cache
+void GenomeCache::checkRecord(int record) {
+	if (record < 0 || (uint64_t) record >= header->numRecords)
+		throw out_of_range("Genome cache record out of range");
+}
@@ -0,0 +1,192 @@
+/*
+ * GenomeCache.h
+ *
+ *	This is the header file for the GenomeCache object. A GenomeCache is a
+ *  pre-encoded binary copy of the records of a Fasta file that can be
+ *  reopened through mmap.  Opening a cache does not parse or copy the
+ *  sequences; all accessors read straight out of the mapped file.
+ *
+ *  Each record in the cache holds:
+ *		name - the header line of the record (without the '>')
+ *		packed bases - 2 bits per base (A=0, C=1, G=2, T=3, see CodonUtilities),
+ *					   four bases per byte with the first base in the low bits
+ *		N runs - (start, length) pairs of the positions that are not A, C, G
+ *				 or T.  These positions are stored as A in the packed bases.
+ *		codons - optional precomputed codon index array (see CodonUtilities)
+ *				 that HiddenMarkovModel can use without any encoding
+ *
+ *  File layout (all integers are 64 bit, host byte order, and every section
+ *  starts on an 8 byte boundary):
+ *		GenomeCacheHeader
+ *		sections for record 1 (name, packed bases, N runs, codons)
+ *		...
+ *		sections for record N
+ *		GenomeCacheRecord table (numRecords entries)
+ *
+ *  Typical use:
+ *
+ *		GenomeCache::create(cacheFileName, fastaReader, true);
+ *		...
+ *		GenomeCache cache(cacheFileName);
+ *		HiddenMarkovModel hmm(cache.getCodons(0), cache.getNumCodons(0));
+ *
+ *  A runtime_error is thrown if a cache can not be written, opened, or is
+ *  not a valid cache file.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef GENOMECACHE_H
+#define GENOMECACHE_H
+
+#include "FastaReader.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+using namespace std;
+
+struct GenomeCacheHeader {
+	char magic[8];
+	uint64_t version;
+	uint64_t numRecords;
+	uint64_t flags;
+	uint64_t recordTableOffset;
+	uint64_t reserved[3];
+};
+
+struct GenomeCacheRecord {
+	uint64_t nameOffset;
+	uint64_t nameLength;
+	uint64_t sequenceLength;
+	uint64_t packedOffset;
+	uint64_t nRunsOffset;
+	uint64_t numNRuns;
+	uint64_t codonsOffset;		// 0 if the cache has no codons
+	uint64_t reserved;
+};
+
+class GenomeCache {
+
+public:
+
+	// Constuctors
+	// ==============================================
+	GenomeCache(string fileName);
+
+	// Destructor
+	// =============================================
+	virtual ~GenomeCache();
+
+	// Public Class Attributes
+	// =============================================
+	static const char magic[8];
+	static const uint64_t version;
+	static const uint64_t codonsFlag;
+
+	// Public Class Methods
+	// =============================================
+
+	// create(string cacheFileName, FastaReader& reader, bool includeCodons)
+	//  Purpose:
+	//		Writes every remaining record of reader to a new cache file.  Records
+	//		are read and written one at a time.  If includeCodons is true the
+	//		codon index array of each record is stored as well.
+	static void create(string cacheFileName, FastaReader& reader, bool includeCodons);
+
+	// create(string cacheFileName, const string& header, const string& sequence, bool includeCodons)
+	//  Purpose:
+	//		Writes a cache file holding the single record header/sequence
+	static void create(string cacheFileName, const string& header, const string& sequence, bool includeCodons);
+
+	// Public Methods
+	// =============================================
+
+	// bool hasCodons()
+	//  Purpose:
+	//		Returns true if the cache holds precomputed codon index arrays
+	bool hasCodons();
+
+	// const uint8_t* getCodons(int record)
+	//  Purpose:
+	//		Returns the precomputed codon index array for record (inside the
+	//		mapped file) or NULL if the cache holds no codons.
+	const uint8_t* getCodons(int record);
+
+	// decodeCodons(int record, vector<uint8_t>& codons)
+	//  Purpose:
+	//		Populates codons with the codon index array of record from the
+	//		packed bases.  Used when the cache holds no codons.
+	void decodeCodons(int record, vector<uint8_t>& codons);
+
+	// decodeSequence(int record, string& sequence)
+	//  Purpose:
+	//		Populates sequence with the bases of record.  Positions in an N run
+	//		are decoded as 'N'.
+	void decodeSequence(int record, string& sequence);
+
+	// Public Accessors
+	// =============================================
+	int getNumRecords();
+	string getRecordName(int record);
+	uint64_t getSequenceLength(int record);
+	int getNumCodons(int record);		// sequence length - 2 (0 if shorter than a codon)
+
+private:
+	// Attributes
+	// =============================================
+	string fileName;
+	const uint8_t* data;
+	size_t dataLength;
+	const GenomeCacheHeader* header;
+	const GenomeCacheRecord* records;
+	vector<uint8_t> fileContents;	// only used when mmap is not available
+
+	// The mapping is owned by the object so it can not be copied
+	GenomeCache(const GenomeCache&);
+	GenomeCache& operator=(const GenomeCache&);
+
+	// Private Class Methods
+	// =============================================
+
+	// FILE* openForWriting(const string& cacheFileName, uint64_t& fileOffset)
+	//  Purpose:
+	//		Creates the cache file and reserves space for the header
+	static FILE* openForWriting(const string& cacheFileName, uint64_t& fileOffset);
+
+	// writeRecord(file, fileOffset, name, sequence, includeCodons, record)
+	//  Purpose:
+	//		Appends the sections for one record to file and fills in record
+	//		with their offsets
+	static void writeRecord(FILE* file, uint64_t& fileOffset, const string& name, const string& sequence, bool includeCodons, GenomeCacheRecord& record);
+
+	// finishWriting(file, fileOffset, recordTable, includeCodons)
+	//  Purpose:
+	//		Appends the record table to file, writes the header at the start
+	//		of the file and closes it
+	static void finishWriting(FILE* file, uint64_t& fileOffset, vector<GenomeCacheRecord>& recordTable, bool includeCodons);
+
+	// uint64_t writeSection(FILE* file, uint64_t& fileOffset, const void* bytes, size_t length)
+	//  Purpose:
+	//		Writes bytes at fileOffset (the 8 byte aligned end of file), pads the
+	//		file to the next 8 byte boundary and returns the offset the bytes
+	//		were written at.
+	static uint64_t writeSection(FILE* file, uint64_t& fileOffset, const void* bytes, size_t length);
+
+	// Private Methods
+	// =============================================
+
+	// mapFile()
+	//  Purpose:
+	//		Maps the cache file into memory and validates its header and
+	//		record table
+	void mapFile();
+
+	// checkRecord(int record)
+	//  Purpose:
+	//		Throws an out_of_range error if record is not in the cache
+	void checkRecord(int record);
+};
+
+#endif /* GENOMECACHE_H */
@@ -0,0 +1,326 @@
+/*
+ * HMMAnnotationPipeline.cpp
+ *
+ *	This is the cpp file for the HMMAnnotationPipeline object.
+ *  HMMAnnotationPipeline annotates the records of any number of Fasta
+ *  files with trained models, overlapping reading, decoding and writing.
+ *
+ *  See HMMAnnotationPipeline.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMAnnotationPipeline.h"
+#include "HMMViterbiKernel.h"
+#include "FastaReader.h"
+#include <functional>
+#include <stdexcept>
+#include <cstdio>
+#include <fcntl.h>
+
+// const variable initialization
+// ==============================================
+const size_t HMMAnnotationPipeline::defaultMaxQueuedBases = 256 * 1024 * 1024;
+const int HMMAnnotationPipeline::recordsPerDecoder = 4;
+
+// Constuctors
+// ==============================================
+HMMAnnotationPipeline::HMMAnnotationPipeline(int numberOfDecoders) {
+	numDecoders = numberOfDecoders;
+	if (numDecoders <= 0)
+		numDecoders = thread::hardware_concurrency();
+	if (numDecoders <= 0)
+		numDecoders = 1;
+
+	maxQueuedBases = defaultMaxQueuedBases;
+	maxQueuedRecords = numDecoders * recordsPerDecoder;
+	outputFormat = HMMGeneWriter::xmlFormat;
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+	numRecords = 0;
+	numReaderWaits = 0;
+	numWriterWaits = 0;
+
+	inFlightBases = 0;
+	readingDone = false;
+	stopping = false;
+}
+
+// Destructor
+// =============================================
+HMMAnnotationPipeline::~HMMAnnotationPipeline() {
+}
+
+// Public Methods
+// =============================================
+
+// addModel(string name, HMMProbabilities* someProbabilities)
+//  Purpose:
+//		Keeps a copy of someProbabilities under name.  The first model
+//		added is used for records that do not name one.
+void HMMAnnotationPipeline::addModel(string name, HMMProbabilities* someProbabilities) {
+	models.addModel(name, someProbabilities);
+}
+
+// run(const vector<string>& fileNames, int outputDescriptor)
+//  Purpose:
+//		Annotates every record of the Fasta files fileNames and writes the
+//		results to the file descriptor outputDescriptor in input order
+//		(see the header comment).  Throws a runtime_error if the output
+//		can not be written.
+//  Preconditions:
+//		at least one model has been added
+void HMMAnnotationPipeline::run(const vector<string>& fileNames, int outputDescriptor) {
+	if (models.getNumModels() == 0)
+		throw logic_error("No models have been added to the annotation pipeline");
+
+	inFlightBases = 0;
+	readingDone = false;
+	stopping = false;
+	readError = exception_ptr();
+	numRecords = 0;
+	numReaderWaits = 0;
+	numWriterWaits = 0;
+
+	vector<thread> threads;
+	threads.push_back(thread(&HMMAnnotationPipeline::readerLoop, this, cref(fileNames)));
+	for (int decoder = 0; decoder < numDecoders; decoder++)
+		threads.push_back(thread(&HMMAnnotationPipeline::decoderLoop, this));
+
+	try {
+		writerLoop(outputDescriptor);
+	}
+	catch (...) {
+		stop(threads);
+		throw;
+	}
+	stop(threads);
+
+	if (readError)
+		rethrow_exception(readError);
+}
+
+// Public Accessors
+// =============================================
+int HMMAnnotationPipeline::getNumDecoders() {
+	return numDecoders;
+}
+
+int HMMAnnotationPipeline::getNumModels() {
+	return models.getNumModels();
+}
+
+// Private Methods
+// =============================================
+
+// readerLoop(const vector<string>& fileNames)
+//  Purpose:
+//		Body of the reader thread; queues the records of fileNames in
+//		order, waiting while the pipeline is full
+void HMMAnnotationPipeline::readerLoop(const vector<string>& fileNames) {
+	try {
+		for (const string& fileName : fileNames) {
+			if (!readFile(fileName))
+				break;
+		}
+	}
+	catch (...) {
+		lock_guard<mutex> lock(pipelineLock);
+		readError = current_exception();
+	}
+
+	{
+		lock_guard<mutex> lock(pipelineLock);
+		readingDone = true;
+	}
+	recordQueued.notify_all();
+	recordDecoded.notify_all();
+}
+
+// readFile(const string& fileName)
+//  Purpose:
+//		Queues the records of one file (or an error record if it can not
+//		be opened).  Returns false if the pipeline is stopping.
+bool HMMAnnotationPipeline::readFile(const string& fileName) {
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (file == NULL) {
+		Record* record = new Record();
+		record->name = fileName;
+		record->error = "Unable to open fasta file: " + fileName;
+		record->numBases = 0;
+		record->decoded = true;
+		return queueRecord(record);
+	}
+
+	// The file is read front to back, let the kernel read ahead of the
+	// reader while it waits on the pipeline
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	FastaReader reader(file);
+	string header;
+	bool queued = true;
+	while (queued) {
+		Record* record = new Record();
+		bool haveRecord;
+		try {
+			haveRecord = reader.nextRecord(header, record->sequence);
+		}
+		catch (...) {
+			delete record;
+			fclose(file);
+			throw;
+		}
+		if (!haveRecord) {
+			delete record;
+			break;
+		}
+
+		HMMModelSet::parseHeader(header, *record);
+		record->numBases = record->sequence.length();
+		record->decoded = false;
+		queued = queueRecord(record);
+	}
+	fclose(file);
+
+	return queued;
+}
+
+// bool queueRecord(Record* record)
+//  Purpose:
+//		Waits for room in the pipeline and queues record for decoding.
+//		Returns false (and deletes record) if the pipeline is stopping.
+bool HMMAnnotationPipeline::queueRecord(Record* record) {
+	unique_lock<mutex> lock(pipelineLock);
+
+	// A record is always let into an empty pipeline, however long it is
+	function<bool()> hasRoom = [this, record] {
+		return inFlight.empty() ||
+			((int) inFlight.size() < maxQueuedRecords && inFlightBases + record->numBases <= maxQueuedBases);
+	};
+	if (!stopping && !hasRoom()) {
+		numReaderWaits++;
+		recordWritten.wait(lock, [this, &hasRoom] { return stopping || hasRoom(); });
+	}
+	if (stopping) {
+		delete record;
+		return false;
+	}
+
+	inFlight.push_back(record);
+	inFlightBases += record->numBases;
+	if (record->decoded) {
+		recordDecoded.notify_one();
+	}
+	else {
+		decodeQueue.push_back(record);
+		recordQueued.notify_one();
+	}
+
+	return true;
+}
+
+// decoderLoop()
+//  Purpose:
+//		Body of every decoder thread; annotates queued records until the
+//		reader is done and the queue is empty
+void HMMAnnotationPipeline::decoderLoop() {
+	while (true) {
+		Record* record;
+		{
+			unique_lock<mutex> lock(pipelineLock);
+			recordQueued.wait(lock, [this] { return stopping || readingDone || !decodeQueue.empty(); });
+			if (stopping || decodeQueue.empty())
+				return;
+
+			record = decodeQueue.front();
+			decodeQueue.pop_front();
+		}
+
+		// Only this decoder touches the record until it is marked decoded
+		models.annotateRecord(*record, viterbiPrecision);
+
+		{
+			lock_guard<mutex> lock(pipelineLock);
+			record->decoded = true;
+		}
+		recordDecoded.notify_one();
+	}
+}
+
+// writerLoop(int outputDescriptor)
+//  Purpose:
+//		Writes the in flight records in order as they are decoded until
+//		the reader is done and every record has been written
+void HMMAnnotationPipeline::writerLoop(int outputDescriptor) {
+	HMMGeneWriter writer(outputDescriptor, outputFormat);
+	function<bool()> canWrite = [this] {
+		return (!inFlight.empty() && inFlight.front()->decoded) || (readingDone && inFlight.empty());
+	};
+
+	while (true) {
+		Record* record;
+		{
+			unique_lock<mutex> lock(pipelineLock);
+			if (!canWrite()) {
+				// Hand what is written so far to the output while waiting
+				lock.unlock();
+				writer.flush();
+				lock.lock();
+				if (!canWrite()) {
+					numWriterWaits++;
+					recordDecoded.wait(lock, canWrite);
+				}
+			}
+			if (inFlight.empty())
+				break;
+
+			record = inFlight.front();
+		}
+
+		// A decoded record is not changed by the other stages
+		if (!record->error.empty()) {
+			writer.writeError(record->name, record->error);
+		}
+		else {
+			writer.beginSequence(record->name, models.modelName(*record));
+			for (HMMViterbiResults::Gene& gene : record->genes)
+				writer.writeGene(gene.start, gene.end, gene.isTopStrand);
+			writer.endSequence();
+		}
+		numRecords++;
+
+		{
+			lock_guard<mutex> lock(pipelineLock);
+			inFlight.pop_front();
+			inFlightBases -= record->numBases;
+		}
+		recordWritten.notify_one();
+		delete record;
+	}
+
+	writer.flush();
+}
+
+// stop(vector<thread>& threads)
+//  Purpose:
+//		Wakes every stage so it can finish, joins threads and deletes the
+//		records still in flight
+void HMMAnnotationPipeline::stop(vector<thread>& threads) {
+	{
+		lock_guard<mutex> lock(pipelineLock);
+		stopping = true;
+	}
+	recordQueued.notify_all();
+	recordDecoded.notify_all();
+	recordWritten.notify_all();
+
+	for (thread& stage : threads)
+		stage.join();
+
+	for (Record* record : inFlight)
+		delete record;
+	inFlight.clear();
+	decodeQueue.clear();
+}
@@ -0,0 +1,186 @@
+/*
+ * HMMAnnotationPipeline.h
+ *
+ *	This is the header file for the HMMAnnotationPipeline object.
+ *  HMMAnnotationPipeline annotates the records of any number of Fasta
+ *  files with trained models, overlapping reading, decoding and writing
+ *  so that none of them waits for the others to finish a whole file.
+ *
+ *  The work is split into three stages connected by queues:
+ *
+ *		reader - one thread that streams the records of the files in order
+ *				 (see FastaReader, the files are opened for sequential
+ *				 read ahead) and queues them for decoding
+ *		decoders - numDecoders threads that each take the next queued
+ *				   record and decode it with its model, one
+ *				   HiddenMarkovModel per record
+ *		writer - the calling thread, which writes the genes of the records
+ *				 in input order through an HMMGeneWriter as soon as the
+ *				 next one in order is decoded (flushing whenever it has to
+ *				 wait for one)
+ *
+ *  Backpressure:
+ *	  A record is in flight from the time it is read until its genes have
+ *    been written.  The reader waits before queueing a record while
+ *    maxQueuedRecords records or maxQueuedBases bases are in flight, so a
+ *    slow decoder or a slow output holds the reader back instead of the
+ *    input piling up in memory.  Memory is therefore bounded by
+ *    maxQueuedBases plus one record (a record longer than maxQueuedBases
+ *    is let through once nothing else is in flight), however large the
+ *    input.  numReaderWaits and numWriterWaits count how often the reader
+ *    was held back and how often the writer waited on a decoder, which
+ *    tells which side of the pipeline is the bottleneck.
+ *
+ *  Records name their model with a model=<name> word in their header and
+ *  are written as the results of the first word of their header, just as
+ *  in HMMAnnotationServer (see HMMModelSet, and HMMAnnotationServer for
+ *  the xml format).  A record that
+ *  can not be annotated (an unknown model, or a sequence its model can
+ *  not generate, see HMMTrellis::checkHighestWeightPath) and a file that
+ *  can not be opened are written as errors and the pipeline continues
+ *  with the next one.  A failure of one record never ends a decoder.  An
+ *  error writing the output stops the pipeline and is thrown from run.
+ *
+ *  Typical use would be:
+ *
+ *		HMMAnnotationPipeline pipeline(numDecoders)
+ *		pipeline.addModel("ecoli", trainedProbabilities)
+ *		pipeline.run(fileNames, STDOUT_FILENO)
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMANNOTATIONPIPELINE_H
+#define HMMANNOTATIONPIPELINE_H
+#include "HMMProbabilities.h"
+#include "HMMViterbiResults.h"
+#include "HMMGeneWriter.h"
+#include "HMMModelSet.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+using namespace std;
+
+class HMMAnnotationPipeline
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMAnnotationPipeline(int numberOfDecoders);	// 0 uses one decoder per core
+
+	// Destructor
+	// =============================================
+	~HMMAnnotationPipeline();
+
+	// Public Class Attributes
+	// =============================================
+	static const size_t defaultMaxQueuedBases;
+	static const int recordsPerDecoder;			// default maxQueuedRecords per decoder
+
+	// Public Attributes
+	// =============================================
+	size_t maxQueuedBases;		// bases in flight before the reader waits
+	int maxQueuedRecords;		// records in flight before the reader waits
+	HMMGeneWriter::Format outputFormat;		// xml unless set
+	int viterbiPrecision;		// HMMViterbiKernel precision (long double unless set)
+	long numRecords;			// records written by the last run
+	long numReaderWaits;		// times the reader waited for records to be written
+	long numWriterWaits;		// times the writer waited for a record to be decoded
+
+	// Public Methods
+	// =============================================
+
+	// addModel(string name, HMMProbabilities* someProbabilities)
+	//  Purpose:
+	//		Keeps a copy of someProbabilities under name.  The first model
+	//		added is used for records that do not name one.
+	void addModel(string name, HMMProbabilities* someProbabilities);
+
+	// run(const vector<string>& fileNames, int outputDescriptor)
+	//  Purpose:
+	//		Annotates every record of the Fasta files fileNames and writes the
+	//		results to the file descriptor outputDescriptor in input order
+	//		(see the header comment).  Throws a runtime_error if the output
+	//		can not be written.
+	//  Preconditions:
+	//		at least one model has been added
+	void run(const vector<string>& fileNames, int outputDescriptor);
+
+	// Public Accessors
+	// =============================================
+	int getNumDecoders();
+	int getNumModels();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	struct Record : HMMModelSet::Record {
+		size_t numBases;
+		bool decoded;
+	};
+
+	int numDecoders;
+	HMMModelSet models;
+
+	// State shared by the stages of a run (guarded by pipelineLock)
+	mutex pipelineLock;
+	condition_variable recordQueued;		// decoders wait on it
+	condition_variable recordDecoded;		// the writer waits on it
+	condition_variable recordWritten;		// the reader waits on it
+	deque<Record*> inFlight;				// read but not yet written, in input order
+	deque<Record*> decodeQueue;				// read but not yet taken by a decoder
+	size_t inFlightBases;
+	bool readingDone;
+	bool stopping;
+	exception_ptr readError;
+
+	// Private Methods
+	// =============================================
+
+	// readerLoop(const vector<string>& fileNames)
+	//  Purpose:
+	//		Body of the reader thread; queues the records of fileNames in
+	//		order, waiting while the pipeline is full
+	void readerLoop(const vector<string>& fileNames);
+
+	// readFile(const string& fileName)
+	//  Purpose:
+	//		Queues the records of one file (or an error record if it can not
+	//		be opened).  Returns false if the pipeline is stopping.
+	bool readFile(const string& fileName);
+
+	// bool queueRecord(Record* record)
+	//  Purpose:
+	//		Waits for room in the pipeline and queues record for decoding.
+	//		Returns false (and deletes record) if the pipeline is stopping.
+	bool queueRecord(Record* record);
+
+	// decoderLoop()
+	//  Purpose:
+	//		Body of every decoder thread; annotates queued records until the
+	//		reader is done and the queue is empty
+	void decoderLoop();
+
+	// writerLoop(int outputDescriptor)
+	//  Purpose:
+	//		Writes the in flight records in order as they are decoded until
+	//		the reader is done and every record has been written
+	void writerLoop(int outputDescriptor);
+
+	// stop(vector<thread>& threads)
+	//  Purpose:
+	//		Wakes every stage so it can finish, joins threads and deletes the
+	//		records still in flight
+	void stop(vector<thread>& threads);
+
+	HMMAnnotationPipeline(const HMMAnnotationPipeline&);
+	HMMAnnotationPipeline& operator=(const HMMAnnotationPipeline&);
+};
+
+#endif // HMMANNOTATIONPIPELINE_H
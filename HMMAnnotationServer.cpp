@@ -0,0 +1,270 @@
+/*
+ * HMMAnnotationServer.cpp
+ *
+ *	This is the cpp file for the HMMAnnotationServer object.
+ *  HMMAnnotationServer keeps a handful of trained parameter sets resident
+ *  and annotates a stream of incoming sequences with them.
+ *
+ *  See HMMAnnotationServer.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMAnnotationServer.h"
+#include "HMMViterbiKernel.h"
+#include "HMMBatchDecoder.h"
+#include "FastaReader.h"
+#include "CodonUtilities.h"
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// const variable initialization
+// ==============================================
+const size_t HMMAnnotationServer::defaultBatchBases = 64 * 1024 * 1024;
+const int HMMAnnotationServer::batchedRecordsPerTask = 16;
+const int HMMAnnotationServer::connectionTimeoutSeconds = 60;
+
+// Constuctors
+// ==============================================
+HMMAnnotationServer::HMMAnnotationServer(int numberOfThreads, int aBatchSize)
+	: pool(numberOfThreads) {
+	batchSize = (aBatchSize > 0) ? aBatchSize : pool.getNumThreads();
+	batchBases = defaultBatchBases;
+	numBatches = 0;
+	numRecords = 0;
+	outputFormat = HMMGeneWriter::xmlFormat;
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+	maxBatchedBases = 0;
+}
+
+// Destructor
+// =============================================
+HMMAnnotationServer::~HMMAnnotationServer() {
+}
+
+// Public Methods
+// =============================================
+
+// addModel(string name, HMMProbabilities* someProbabilities)
+//  Purpose:
+//		Keeps a copy of someProbabilities resident under name.  The first
+//		model added is used for records that do not name one.
+void HMMAnnotationServer::addModel(string name, HMMProbabilities* someProbabilities) {
+	models.addModel(name, someProbabilities);
+}
+
+// serve(FILE* input, int outputDescriptor)
+//  Purpose:
+//		Reads Fasta records from input until its end, annotates them in
+//		micro batches and writes the results of every batch to the file
+//		descriptor outputDescriptor in input order (see the header
+//		comment for the format)
+//  Preconditions:
+//		at least one model has been added
+void HMMAnnotationServer::serve(FILE* input, int outputDescriptor) {
+	if (models.getNumModels() == 0)
+		throw logic_error("No models have been added to the annotation server");
+
+	FastaReader reader(input);
+	HMMGeneWriter writer(outputDescriptor, outputFormat);
+	vector<Record> batch;
+	size_t bases = 0;
+	string header;
+
+	batch.reserve(batchSize);
+	while (true) {
+		Record record;
+		bool haveRecord = reader.nextRecord(header, record.sequence);
+		if (haveRecord) {
+			HMMModelSet::parseHeader(header, record);
+			bases += record.sequence.length();
+			batch.push_back(std::move(record));
+		}
+
+		// Decode the batch once it is full (or the input has ended)
+		if (!batch.empty() && (!haveRecord || (int) batch.size() >= batchSize || bases >= batchBases)) {
+			annotateBatch(batch, writer);
+			batch.clear();
+			bases = 0;
+		}
+
+		if (!haveRecord)
+			break;
+	}
+}
+
+// serveSocket(string socketPath)
+//  Purpose:
+//		Listens on a unix domain socket at socketPath (replacing any
+//		socket file already there) and serves one connection at a time
+//		(see serve, every connection decodes on the same threads) until
+//		listening fails, which is thrown as a runtime_error.  Does not
+//		return otherwise.  Waiting clients queue in the listen backlog;
+//		a connection that sends nothing for connectionTimeoutSeconds is
+//		treated as ended, so a stalled client can not hold the others up.
+//		Any exception thrown while serving a connection only
+//		ends that connection.
+//  Preconditions:
+//		at least one model has been added
+void HMMAnnotationServer::serveSocket(string socketPath) {
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.length() >= sizeof(address.sun_path))
+		throw invalid_argument("Socket path is too long: " + socketPath);
+	strcpy(address.sun_path, socketPath.c_str());
+
+	// A client that goes away early must not take the server down with it
+	signal(SIGPIPE, SIG_IGN);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0)
+		throw runtime_error("Unable to create socket: " + string(strerror(errno)));
+	unlink(socketPath.c_str());
+	if (bind(listener, (sockaddr*) &address, sizeof(address)) < 0 || listen(listener, 16) < 0) {
+		string error = strerror(errno);
+		close(listener);
+		throw runtime_error("Unable to listen on " + socketPath + ": " + error);
+	}
+
+	while (true) {
+		int connection = accept(listener, NULL, NULL);
+		if (connection < 0) {
+			if (errno == EINTR)
+				continue;
+			string error = strerror(errno);
+			close(listener);
+			throw runtime_error("Unable to accept a connection: " + error);
+		}
+
+		// A stalled client only ends its own connection
+		timeval timeout;
+		timeout.tv_sec = connectionTimeoutSeconds;
+		timeout.tv_usec = 0;
+		setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		// A client that goes away (or any failure serving it) only ends its
+		// own connection
+		FILE* input = fdopen(connection, "rb");
+		if (input == NULL) {
+			close(connection);
+			continue;
+		}
+		try {
+			serve(input, connection);
+		}
+		catch (...) {
+		}
+		fclose(input);
+	}
+}
+
+// Public Accessors
+// =============================================
+int HMMAnnotationServer::getNumModels() {
+	return models.getNumModels();
+}
+
+// Private Methods
+// =============================================
+
+// annotateBatch(vector<Record>& batch, HMMGeneWriter& writer)
+//  Purpose:
+//		Annotates the records of batch in parallel and writes their results
+//		to writer in order
+void HMMAnnotationServer::annotateBatch(vector<Record>& batch, HMMGeneWriter& writer) {
+	// HMMBatchDecoder only decodes in double precision
+	if (maxBatchedBases > 0 && viterbiPrecision == HMMViterbiKernel::doublePrecision) {
+		annotateBatchedRecords(batch);
+	}
+	else {
+		pool.run(batch.size(), [&](int record) {
+			models.annotateRecord(batch[record], viterbiPrecision);
+		});
+	}
+
+	for (Record& record : batch) {
+		if (!record.error.empty()) {
+			writer.writeError(record.name, record.error);
+			continue;
+		}
+
+		writer.beginSequence(record.name, models.modelName(record));
+		for (HMMViterbiResults::Gene& gene : record.genes)
+			writer.writeGene(gene.start, gene.end, gene.isTopStrand);
+		writer.endSequence();
+	}
+	writer.flush();
+
+	numBatches++;
+	numRecords += batch.size();
+}
+
+// annotateBatchedRecords(vector<Record>& batch)
+//  Purpose:
+//		Annotates the records of batch in parallel, decoding those of at
+//		most maxBatchedBases with an HMMBatchDecoder per model and task
+void HMMAnnotationServer::annotateBatchedRecords(vector<Record>& batch) {
+	// A task is one long record or up to batchedRecordsPerTask short
+	// records of one model
+	vector<vector<int> > tasks;
+	vector<vector<int> > modelRecords(models.getNumModels());
+	for (unsigned int record = 0; record < batch.size(); record++) {
+		if (batch[record].sequence.length() > maxBatchedBases) {
+			tasks.push_back(vector<int>(1, record));
+			continue;
+		}
+
+		try {
+			modelRecords[models.modelIndex(batch[record])].push_back(record);
+		}
+		catch (exception& e) {
+			batch[record].error = e.what();
+		}
+	}
+	for (vector<int>& records : modelRecords) {
+		for (unsigned int first = 0; first < records.size(); first += batchedRecordsPerTask) {
+			unsigned int last = min((unsigned int) records.size(), first + batchedRecordsPerTask);
+			tasks.push_back(vector<int>(records.begin() + first, records.begin() + last));
+		}
+	}
+
+	pool.run(tasks.size(), [&](int task) {
+		vector<int>& records = tasks[task];
+		if (batch[records[0]].sequence.length() > maxBatchedBases) {
+			models.annotateRecord(batch[records[0]], viterbiPrecision);
+			return;
+		}
+
+		vector<vector<uint8_t> > codons(records.size());
+		HMMBatchDecoder decoder;
+		for (unsigned int i = 0; i < records.size(); i++) {
+			Record& record = batch[records[i]];
+			CodonUtilities::encodeSequence(record.sequence, codons[i]);
+			string().swap(record.sequence);
+			decoder.addSequence(codons[i].empty() ? NULL : &codons[i][0], codons[i].size());
+		}
+
+		vector<HMMViterbiResults*> results;
+		decoder.decode(models.getModel(models.modelIndex(batch[records[0]])), results);
+		for (unsigned int i = 0; i < records.size(); i++) {
+			Record& record = batch[records[i]];
+			if (results[i] == NULL) {
+				record.error = decoder.errors[i];
+				continue;
+			}
+			for (HMMViterbiResults::Gene* gene : results[i]->genes)
+				record.genes.push_back(*gene);
+		}
+	});
+}
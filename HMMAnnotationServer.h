@@ -0,0 +1,157 @@
+/*
+ * HMMAnnotationServer.h
+ *
+ *	This is the header file for the HMMAnnotationServer object.
+ *  HMMAnnotationServer keeps a handful of trained parameter sets resident
+ *  and annotates a stream of incoming sequences with them, so repeat
+ *  annotation jobs pay neither the process start nor the training cost.
+ *
+ *  Sequences are read as Fasta records from a stream (a pipe, stdin or a
+ *  connection to a unix domain socket).  The records are gathered into
+ *  micro batches of at most batchSize records (or batchBases bases) that
+ *  are decoded in parallel on a thread pool (see HMMThreadPool), one
+ *  HiddenMarkovModel per record.  When maxBatchedBases is set and the
+ *  viterbiPrecision is HMMViterbiKernel::doublePrecision (the only one
+ *  HMMBatchDecoder decodes at, the others could call different genes on
+ *  ties), the records of a batch that are at most that long (e.g., the
+ *  contigs of a metagenomic bin) are instead decoded together, one record
+ *  of the same model per SIMD lane (see HMMBatchDecoder).  The gene calls
+ *  of a batch are streamed back in input order through an HMMGeneWriter
+ *  (xml, gff3 or bed) and flushed as soon as the batch is done, while the
+ *  following records are still being read.
+ *
+ *  A record is annotated with the model named by a model=<name> word in
+ *  its header or with the first model added when there is none (see
+ *  HMMModelSet).  The genes of every record are written as the records of
+ *  the first word of its header, or an error is written when the record
+ *  could not be annotated (e.g., unknown model).  In xml format the results are
+ *
+ *		<result type="sequence" name="<<first word of the header>>" model="<<model name>>">
+ *			<<HMMViterbiResults::geneResultsString()>>
+ *		</result>
+ *		<result type="error" name="<<first word of the header>>"><<message>></result>
+ *
+ *  A Fasta record only ends at the next header, so a client of the
+ *  socket sends its records and closes its side of the connection
+ *  (shutdown(SHUT_WR)) before reading the results.  Connections are
+ *  served one at a time (see serveSocket).
+ *
+ *  Typical use would be:
+ *
+ *		HMMAnnotationServer server(numThreads, batchSize)
+ *		server.addModel("ecoli", trainedProbabilities)
+ *		server.serve(stdin, STDOUT_FILENO)
+ *			or
+ *		server.serveSocket("/tmp/hmm.socket")
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMANNOTATIONSERVER_H
+#define HMMANNOTATIONSERVER_H
+#include "HMMProbabilities.h"
+#include "HMMThreadPool.h"
+#include "HMMGeneWriter.h"
+#include "HMMModelSet.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+using namespace std;
+
+class HMMAnnotationServer
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMAnnotationServer(int numberOfThreads, int aBatchSize);	// 0 threads uses one thread per core
+
+	// Destructor
+	// =============================================
+	~HMMAnnotationServer();
+
+	// Public Class Attributes
+	// =============================================
+	static const size_t defaultBatchBases;
+	static const int connectionTimeoutSeconds;
+
+	// Public Attributes
+	// =============================================
+	int batchSize;				// records decoded together
+	size_t batchBases;			// a batch is also ended once it holds this many bases
+	int numBatches;				// batches annotated so far
+	int numRecords;				// records annotated so far
+	HMMGeneWriter::Format outputFormat;		// xml unless set
+	int viterbiPrecision;		// HMMViterbiKernel precision (long double unless set)
+	size_t maxBatchedBases;		// records up to this long are decoded in SIMD lanes (0, the default, never;
+								// only at HMMViterbiKernel::doublePrecision)
+
+	// Public Methods
+	// =============================================
+
+	// addModel(string name, HMMProbabilities* someProbabilities)
+	//  Purpose:
+	//		Keeps a copy of someProbabilities resident under name.  The first
+	//		model added is used for records that do not name one.
+	void addModel(string name, HMMProbabilities* someProbabilities);
+
+	// serve(FILE* input, int outputDescriptor)
+	//  Purpose:
+	//		Reads Fasta records from input until its end, annotates them in
+	//		micro batches and writes the results of every batch to the file
+	//		descriptor outputDescriptor in input order (see the header
+	//		comment for the format)
+	//  Preconditions:
+	//		at least one model has been added
+	void serve(FILE* input, int outputDescriptor);
+
+	// serveSocket(string socketPath)
+	//  Purpose:
+	//		Listens on a unix domain socket at socketPath (replacing any
+	//		socket file already there) and serves one connection at a time
+	//		(see serve, every connection decodes on the same threads) until
+	//		listening fails, which is thrown as a runtime_error.  Does not
+	//		return otherwise.  Waiting clients queue in the listen backlog;
+	//		a connection that sends nothing for connectionTimeoutSeconds is
+	//		treated as ended, so a stalled client can not hold the others up.
+	//		Any exception thrown while serving a connection only
+	//		ends that connection.
+	//  Preconditions:
+	//		at least one model has been added
+	void serveSocket(string socketPath);
+
+	// Public Accessors
+	// =============================================
+	int getNumModels();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	static const int batchedRecordsPerTask;
+
+	typedef HMMModelSet::Record Record;
+
+	HMMThreadPool pool;
+	HMMModelSet models;
+
+	// Private Methods
+	// =============================================
+
+	// annotateBatch(vector<Record>& batch, HMMGeneWriter& writer)
+	//  Purpose:
+	//		Annotates the records of batch in parallel and writes their results
+	//		to writer in order
+	void annotateBatch(vector<Record>& batch, HMMGeneWriter& writer);
+
+	// annotateBatchedRecords(vector<Record>& batch)
+	//  Purpose:
+	//		Annotates the records of batch in parallel, decoding those of at
+	//		most maxBatchedBases with an HMMBatchDecoder per model and task
+	void annotateBatchedRecords(vector<Record>& batch);
+
+	HMMAnnotationServer(const HMMAnnotationServer&);
+	HMMAnnotationServer& operator=(const HMMAnnotationServer&);
+};
+
+#endif // HMMANNOTATIONSERVER_H
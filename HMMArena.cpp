@@ -0,0 +1,108 @@
+/*
+ * HMMArena.cpp
+ *
+ *	This is the cpp file for the HMMArena object. HMMArena is a bump
+ *  (region) allocator for the objects that live as long as one training
+ *  run or one iteration.
+ *
+ *  See HMMArena.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMArena.h"
+#include <algorithm>
+
+// const variable initialization
+// ==============================================
+const size_t HMMArena::defaultBlockSize = 64 * 1024;
+
+// Constuctors
+// ==============================================
+HMMArena::HMMArena() {
+	blockSize = defaultBlockSize;
+	blockOffset = 0;
+	bytesAllocated = 0;
+}
+
+HMMArena::HMMArena(size_t aBlockSize) {
+	blockSize = max(aBlockSize, (size_t) 64);
+	blockOffset = 0;
+	bytesAllocated = 0;
+}
+
+// Destructor
+// =============================================
+HMMArena::~HMMArena() {
+	release();
+	for (Block& block : blocks)
+		::operator delete(block.memory);
+}
+
+// Public Methods
+// =============================================
+
+// void* allocate(size_t size, size_t alignment)
+//  Purpose:
+//		Returns size bytes of memory aligned to alignment (a power of two
+//		no larger than alignof(max_align_t)) that stays valid until the
+//		arena is released
+void* HMMArena::allocate(size_t size, size_t alignment) {
+	// Blocks come from operator new, so they start max_align_t aligned
+	size_t offset = (blockOffset + alignment - 1) & ~(alignment - 1);
+	if (blocks.empty() || offset + size > blocks.back().size) {
+		addBlock(size);
+		offset = 0;
+	}
+
+	blockOffset = offset + size;
+	bytesAllocated += size;
+	return blocks.back().memory + offset;
+}
+
+// release()
+//  Purpose:
+//		Runs the destructors of the objects created in the arena (most
+//		recently created first) and frees everything allocated from it
+//  Postconditions:
+//		the arena is empty and keeps (at most) its first block
+void HMMArena::release() {
+	for (vector<Finalizer>::reverse_iterator finalizer = finalizers.rbegin(); finalizer != finalizers.rend(); finalizer++)
+		finalizer->destroy(finalizer->object);
+	finalizers.clear();
+
+	for (unsigned int i = 1; i < blocks.size(); i++)
+		::operator delete(blocks[i].memory);
+	if (blocks.size() > 1)
+		blocks.resize(1);
+
+	blockOffset = 0;
+	bytesAllocated = 0;
+}
+
+// Public Accessors
+// =============================================
+size_t HMMArena::getBytesAllocated() {
+	return bytesAllocated;
+}
+
+size_t HMMArena::getBytesReserved() {
+	size_t bytesReserved = 0;
+	for (Block& block : blocks)
+		bytesReserved += block.size;
+	return bytesReserved;
+}
+
+// Private Methods
+// =============================================
+
+// addBlock(size_t minimumSize)
+//  Purpose:
+//		Adds a block of at least minimumSize bytes to the end of blocks
+void HMMArena::addBlock(size_t minimumSize) {
+	Block block;
+	block.size = max(blockSize, minimumSize);
+	block.memory = static_cast<char*>(::operator new(block.size));
+	blocks.push_back(block);
+}
@@ -0,0 +1,134 @@
+/*
+ * HMMArena.h
+ *
+ *	This is the header file for the HMMArena object. HMMArena is a bump
+ *  (region) allocator for the objects that live as long as one training
+ *  run or one iteration: the viterbi results, their genes and the
+ *  probabilities calculated from them.
+ *
+ *  Memory is taken from large blocks by moving an offset forward, so an
+ *  allocation is a few instructions and the objects of a run sit next to
+ *  each other.  Nothing is freed one object at a time.  release() runs
+ *  the destructors of the objects that have one (most recently created
+ *  first) and rewinds the arena in one step; the first block is kept so
+ *  an arena that is released after every run stays the same size.
+ *  Objects without a destructor (e.g., HMMViterbiResults::Gene) are
+ *  released in O(1).  The destructor of the arena calls release().
+ *
+ *  Pointers into the arena must not be used after it is released.  An
+ *  arena must only be used by one thread at a time.
+ *
+ *  Typical use would be:
+ *
+ *		HMMArena arena
+ *		HMMViterbiResults* results = arena.create<HMMViterbiResults>(iteration, numStates)
+ *		...
+ *		arena.release()
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMARENA_H
+#define HMMARENA_H
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+using namespace std;
+
+class HMMArena
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMArena();
+	HMMArena(size_t aBlockSize);
+
+	// Destructor
+	// =============================================
+	~HMMArena();
+
+	// Public Class Attributes
+	// =============================================
+	static const size_t defaultBlockSize;
+
+	// Public Methods
+	// =============================================
+
+	// void* allocate(size_t size, size_t alignment)
+	//  Purpose:
+	//		Returns size bytes of memory aligned to alignment (a power of two
+	//		no larger than alignof(max_align_t)) that stays valid until the
+	//		arena is released
+	void* allocate(size_t size, size_t alignment);
+
+	// T* create<T>(arguments...)
+	//  Purpose:
+	//		Constructs a T from arguments in the arena and returns it.  Its
+	//		destructor (if it has one) is run when the arena is released.
+	template <class T, class... Arguments>
+	T* create(Arguments&&... arguments) {
+		T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Arguments>(arguments)...);
+		if (!is_trivially_destructible<T>::value) {
+			Finalizer finalizer = { &destroy<T>, object };
+			finalizers.push_back(finalizer);
+		}
+		return object;
+	}
+
+	// release()
+	//  Purpose:
+	//		Runs the destructors of the objects created in the arena (most
+	//		recently created first) and frees everything allocated from it
+	//  Postconditions:
+	//		the arena is empty and keeps (at most) its first block
+	void release();
+
+	// Public Accessors
+	// =============================================
+	size_t getBytesAllocated();		// handed out since the last release
+	size_t getBytesReserved();		// held in blocks
+
+private:
+
+	// Private Attributes
+	// =============================================
+	struct Block {
+		char* memory;
+		size_t size;
+	};
+
+	struct Finalizer {
+		void (*destroy)(void*);
+		void* object;
+	};
+
+	size_t blockSize;
+	vector<Block> blocks;
+	size_t blockOffset;				// next free byte of the last block
+	size_t bytesAllocated;
+	vector<Finalizer> finalizers;
+
+	// Private Methods
+	// =============================================
+
+	// destroy<T>(void* object)
+	//  Purpose:
+	//		Runs the destructor of the T at object
+	template <class T>
+	static void destroy(void* object) {
+		static_cast<T*>(object)->~T();
+	}
+
+	// addBlock(size_t minimumSize)
+	//  Purpose:
+	//		Adds a block of at least minimumSize bytes to the end of blocks
+	void addBlock(size_t minimumSize);
+
+	HMMArena(const HMMArena&);
+	HMMArena& operator=(const HMMArena&);
+};
+
+#endif // HMMARENA_H
@@ -0,0 +1,332 @@
+/*
+ * HMMBatchDecoder.cpp
+ *
+ *	This is the cpp file for the HMMBatchDecoder object.
+ *  HMMBatchDecoder decodes many short sequences with one model at once,
+ *  one sequence per SIMD lane.
+ *
+ *  See HMMBatchDecoder.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMBatchDecoder.h"
+#include "HMMTopology.h"
+#include "HMMTrellis.h"
+#include "HMMViterbiKernel.h"
+#include "HMMInstrumentation.h"
+#include "CodonUtilities.h"
+#include "MathUtilities.h"
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HMM_BATCH_DECODER_AVX2
+#include <immintrin.h>
+#endif
+
+// const variable initialization
+// ==============================================
+const int HMMBatchDecoder::numLanes = 4;
+
+// Constuctors
+// ==============================================
+HMMBatchDecoder::HMMBatchDecoder() {
+	instructionSet = HMMViterbiKernel::bestInstructionSet();
+	numStates = 0;
+}
+
+// Destructor
+// =============================================
+HMMBatchDecoder::~HMMBatchDecoder() {
+}
+
+// Public Methods
+// =============================================
+
+// addSequence(const uint8_t* codons, int numberOfCodons)
+//  Purpose:
+//		Adds an encoded sequence (see CodonUtilities::encodeSequence) to be
+//		decoded.  codons is not copied and must stay valid until decode.
+void HMMBatchDecoder::addSequence(const uint8_t* codons, int numberOfCodons) {
+	Sequence sequence;
+	sequence.codons = codons;
+	sequence.numPositions = numberOfCodons;
+	sequences.push_back(sequence);
+}
+
+// clear()
+//  Purpose:
+//		Removes the sequences added so far
+void HMMBatchDecoder::clear() {
+	sequences.clear();
+	errors.clear();
+}
+
+// decode(HMMProbabilities* probabilities, vector<HMMViterbiResults*>& results)
+//  Purpose:
+//		Decodes every sequence added with probabilities and sets
+//		results[i] to the counts gathered along the viterbi path of the
+//		i'th sequence (their probabilities are not calculated, see
+//		HiddenMarkovModel::viterbiIteration).  The results are owned by
+//		the decoder and stay valid until the next decode.
+//  Postconditions:
+//		errors[i] - the reason results[i] is NULL (e.g., the sequence can
+//					not be generated or its path ends inside of a gene)
+void HMMBatchDecoder::decode(HMMProbabilities* probabilities, vector<HMMViterbiResults*>& results) {
+	resultsArena.release();
+	results.assign(sequences.size(), NULL);
+	errors.assign(sequences.size(), string());
+	if (sequences.empty())
+		return;
+
+	buildTables(probabilities);
+
+	// Longest sequences first, so the lanes of a group are about as long
+	vector<int> order(sequences.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+	stable_sort(order.begin(), order.end(), [&](int a, int b) {
+		return sequences[a].numPositions > sequences[b].numPositions;
+	});
+
+	for (unsigned int first = 0; first < order.size(); first += numLanes) {
+		int groupSize = min((int) (order.size() - first), numLanes);
+		decodeGroup(probabilities, &order[first], groupSize, results);
+	}
+
+	// The work space of a long group is not kept between decodes
+	vector<uint8_t>().swap(previousStates);
+}
+
+// Public Accessors
+// =============================================
+int HMMBatchDecoder::getNumSequences() {
+	return sequences.size();
+}
+
+// Private Methods
+// =============================================
+
+// buildTables(HMMProbabilities* probabilities)
+//  Purpose:
+//		Builds the emission and transition tables shared by every group
+void HMMBatchDecoder::buildTables(HMMProbabilities* probabilities) {
+	double minusInfinity = -numeric_limits<double>::infinity();
+	numStates = probabilities->getNumStates();
+
+	// Emissions (codon major, log zero is -infinity)
+	const long double* logEmissions = probabilities->logEmissionProbabilityTable();
+	emissions.assign(CodonUtilities::numEmissionCodons * numStates, minusInfinity);
+	for (int codon = 0; codon < CodonUtilities::numEmissionCodons; codon++) {
+		for (int state = 1; state < numStates; state++) {
+			long double logEmission = logEmissions[state * CodonUtilities::numEmissionCodons + codon];
+			if (!MathUtilities::isNaN(logEmission))
+				emissions[codon * numStates + state] = (double) logEmission;
+		}
+	}
+
+	// Incoming transitions (in ascending predecessor order)
+	HMMTopology topology(probabilities, numStates);
+	predecessorOffsets = topology.predecessorOffsets;
+	predecessors = topology.predecessors;
+	transitions.resize(predecessors.size());
+	predecessorStates.resize(predecessors.size());
+	for (unsigned int arc = 0; arc < predecessors.size(); arc++) {
+		transitions[arc] = (double) topology.predecessorLogProbabilities[arc];
+		predecessorStates[arc] = predecessors[arc];
+	}
+
+	columns.assign(2 * numStates * numLanes, minusInfinity);
+	finalWeights.assign(numLanes * numStates, minusInfinity);
+}
+
+// decodeGroup(HMMProbabilities* probabilities, const int* group, int groupSize, vector<HMMViterbiResults*>& results)
+//  Purpose:
+//		Decodes the groupSize (at most numLanes) sequences whose indexes
+//		are group[0..groupSize - 1] together and sets their results
+void HMMBatchDecoder::decodeGroup(HMMProbabilities* probabilities, const int* group, int groupSize, vector<HMMViterbiResults*>& results) {
+	double minusInfinity = -numeric_limits<double>::infinity();
+	int columnSize = numStates * numLanes;
+
+	// Lanes past groupSize are empty
+	int lanePositions[numLanes];
+	const uint8_t* laneCodons[numLanes];
+	for (int lane = 0; lane < numLanes; lane++) {
+		lanePositions[lane] = (lane < groupSize) ? sequences[group[lane]].numPositions : 0;
+		laneCodons[lane] = (lane < groupSize) ? sequences[group[lane]].codons : NULL;
+	}
+	int numPositions = lanePositions[0];
+
+	if (numPositions > 0) {
+		HMM_SCOPED_TIMER(viterbiTimer);
+		long lanePositionSum = 0;
+		for (int lane = 0; lane < groupSize; lane++)
+			lanePositionSum += lanePositions[lane];
+		HMM_COUNT(positionsCounter, lanePositionSum);
+		HMM_COUNT(arcsEvaluatedCounter, lanePositionSum * (long) predecessors.size());
+
+		previousStates.assign((size_t) numPositions * columnSize, HMMTrellis::noPreviousState);
+		fill(finalWeights.begin(), finalWeights.end(), minusInfinity);
+
+		// The first position can only be entered from the start state
+		const long double* logEmissions = probabilities->logEmissionProbabilityTable();
+		double* current = &columns[0];
+		for (int state = 0; state < numStates; state++) {
+			for (int lane = 0; lane < numLanes; lane++) {
+				current[state * numLanes + lane] = minusInfinity;
+				if (state == 0 || lanePositions[lane] == 0)
+					continue;
+
+				long double score =
+					MathUtilities::elnprod(
+						probabilities->logInitiationProbability(state),	// initiation probability
+						logEmissions[state * CodonUtilities::numEmissionCodons + laneCodons[lane][0]]	// emission probablity
+					);
+				if (!MathUtilities::isNaN(score)) {
+					current[state * numLanes + lane] = (double) score;
+					previousStates[state * numLanes + lane] = 0;
+				}
+			}
+		}
+
+		for (int position = 1; position <= numPositions; position++) {
+			current = &columns[((position - 1) % 2) * columnSize];
+
+			if (position > 1) {
+				// Ended lanes are masked: they are advanced on a padding codon
+				int32_t codonOffsets[numLanes];
+				for (int lane = 0; lane < numLanes; lane++) {
+					int codon = (position <= lanePositions[lane])
+						? laneCodons[lane][position - 1]
+						: CodonUtilities::unknownCodon;
+					codonOffsets[lane] = codon * numStates;
+				}
+
+				const double* previous = &columns[(position % 2) * columnSize];
+				uint8_t* currentStates = &previousStates[(size_t) (position - 1) * columnSize];
+				if (instructionSet == HMMViterbiKernel::avx2InstructionSet)
+					calculateColumnAVX2(codonOffsets, previous, current, currentStates);
+				else
+					calculateColumnScalar(codonOffsets, previous, current, currentStates);
+			}
+
+			// Capture the last column of the lanes ending here
+			for (int lane = 0; lane < groupSize; lane++) {
+				if (lanePositions[lane] != position)
+					continue;
+				for (int state = 0; state < numStates; state++)
+					finalWeights[lane * numStates + state] = current[state * numLanes + lane];
+			}
+		}
+	}
+
+	// Walk the path of every lane backward
+	HMM_SCOPED_TIMER(tracebackTimer);
+	for (int lane = 0; lane < groupSize; lane++) {
+		int sequence = group[lane];
+		HMMViterbiResults* laneResults = resultsArena.create<HMMViterbiResults>(1, numStates);
+
+		try {
+			int position = lanePositions[lane];
+			int state = 0;
+			if (position > 0) {
+				// Highest scoring state (ties to the lowest numbered state)
+				const double* weights = &finalWeights[lane * numStates];
+				state = 1;
+				for (int candidate = 2; candidate < numStates; candidate++) {
+					if (weights[candidate] > weights[state])
+						state = candidate;
+				}
+				if (!(weights[state] > -numeric_limits<double>::infinity()))
+					throw runtime_error(HMMTrellis::noPathError);
+			}
+
+			while (state != 0 && state != HMMTrellis::noPreviousState && position > 0) {
+				laneResults->addPathPosition(position, state, laneCodons[lane][position - 1]);
+				state = previousStates[((size_t) (position - 1) * numStates + state) * numLanes + lane];
+				position--;
+			}
+			laneResults->endPath();
+			results[sequence] = laneResults;
+		}
+		catch (exception& e) {
+			errors[sequence] = e.what();
+		}
+	}
+}
+
+// calculateColumnScalar(const int32_t* codonOffsets, const double* previous, double* current, uint8_t* currentStates)
+//  Purpose:
+//		Calculates the weights (current) and previous states
+//		(currentStates) of a column of every lane from the previous column
+//		of every lane.  codonOffsets[lane] is the codon emitted in lane
+//		times numStates.
+void HMMBatchDecoder::calculateColumnScalar(const int32_t* codonOffsets, const double* previous, double* current, uint8_t* currentStates) {
+	for (int lane = 0; lane < numLanes; lane++)
+		current[lane] = -numeric_limits<double>::infinity();
+
+	for (int state = 1; state < numStates; state++) {
+		for (int lane = 0; lane < numLanes; lane++) {
+			double emission = emissions[codonOffsets[lane] + state];
+			double best = -numeric_limits<double>::infinity();
+			uint8_t bestState = HMMTrellis::noPreviousState;
+
+			for (int arc = predecessorOffsets[state]; arc < predecessorOffsets[state + 1]; arc++) {
+				double score = previous[predecessors[arc] * numLanes + lane] + (transitions[arc] + emission);
+				if (score > best) {
+					best = score;
+					bestState = predecessors[arc];
+				}
+			}
+
+			current[state * numLanes + lane] = best;
+			currentStates[state * numLanes + lane] = bestState;
+		}
+	}
+}
+
+// calculateColumnAVX2(const int32_t* codonOffsets, const double* previous, double* current, uint8_t* currentStates)
+//  Purpose:
+//		Calculates the weights (current) and previous states
+//		(currentStates) of a column of every lane from the previous column
+//		of every lane (one state of every lane per instruction)
+#if defined(HMM_BATCH_DECODER_AVX2)
+__attribute__((target("avx2")))
+void HMMBatchDecoder::calculateColumnAVX2(const int32_t* codonOffsets, const double* previous, double* current, uint8_t* currentStates) {
+	__m256d minusInfinity = _mm256_set1_pd(-numeric_limits<double>::infinity());
+	__m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+	__m128i offsets = _mm_loadu_si128((const __m128i*) codonOffsets);
+	_mm256_storeu_pd(current, minusInfinity);
+
+	for (int state = 1; state < numStates; state++) {
+		__m256d emission = _mm256_mask_i32gather_pd(minusInfinity, &emissions[state], offsets, allLanes, 8);
+		__m256d best = minusInfinity;
+		__m256d bestState = _mm256_set1_pd(HMMTrellis::noPreviousState);
+
+		for (int arc = predecessorOffsets[state]; arc < predecessorOffsets[state + 1]; arc++) {
+			__m256d score =
+				_mm256_add_pd(
+					_mm256_loadu_pd(previous + predecessors[arc] * numLanes),
+					_mm256_add_pd(_mm256_set1_pd(transitions[arc]), emission)
+				);
+			__m256d higher = _mm256_cmp_pd(score, best, _CMP_GT_OQ);
+			best = _mm256_blendv_pd(best, score, higher);
+			bestState = _mm256_blendv_pd(bestState, _mm256_set1_pd(predecessorStates[arc]), higher);
+		}
+
+		_mm256_storeu_pd(current + state * numLanes, best);
+		__m128i laneStates = _mm256_cvtpd_epi32(bestState);
+		currentStates[state * numLanes] = (uint8_t) _mm_extract_epi32(laneStates, 0);
+		currentStates[state * numLanes + 1] = (uint8_t) _mm_extract_epi32(laneStates, 1);
+		currentStates[state * numLanes + 2] = (uint8_t) _mm_extract_epi32(laneStates, 2);
+		currentStates[state * numLanes + 3] = (uint8_t) _mm_extract_epi32(laneStates, 3);
+	}
+}
+#else
+void HMMBatchDecoder::calculateColumnAVX2(const int32_t* codonOffsets, const double* previous, double* current, uint8_t* currentStates) {
+	calculateColumnScalar(codonOffsets, previous, current, currentStates);
+}
+#endif
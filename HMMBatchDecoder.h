@@ -0,0 +1,157 @@
+/*
+ * HMMBatchDecoder.h
+ *
+ *	This is the header file for the HMMBatchDecoder object.
+ *  HMMBatchDecoder decodes many short sequences (e.g., the contigs of a
+ *  metagenomic bin) with one model at once.  A HiddenMarkovModel per
+ *  sequence pays its setup (topology, kernel tables, trellis) for every
+ *  contig and vectorizes over the states of a single column, of which the
+ *  gene model only has twelve.  The batch decoder builds the tables once
+ *  per decode and instead puts one sequence in every SIMD lane, so a
+ *  vector instruction advances numLanes sequences by one position.
+ *
+ *  The sequences are sorted by length and packed numLanes at a time into
+ *  groups whose columns are kept in structure of arrays form:
+ *
+ *		column[state * numLanes + lane] - viterbi weight of state in lane
+ *
+ *  so the weights of one predecessor in every lane are one contiguous
+ *  load and only the emissions (one codon per lane) are gathered.  Lanes
+ *  are ragged: a lane whose sequence has ended is masked (it keeps being
+ *  advanced on a padding codon, but its previous states are never walked)
+ *  and its last column is captured at its own length.
+ *
+ *  The column update is that of HMMViterbiKernel at doublePrecision
+ *  (previous + (transition + emission) in double, ascending predecessors,
+ *  ties to the lowest numbered previous state), so every sequence gets
+ *  the same path as a HiddenMarkovModel decoding it with
+ *  setViterbiPrecision(HMMViterbiKernel::doublePrecision).  The runs of
+ *  unknown codons are not collapsed (see HMMPositionMap); short contigs
+ *  rarely have any long enough to matter.
+ *
+ *  Typical use would be:
+ *
+ *		HMMBatchDecoder decoder
+ *		decoder.addSequence(codons, numCodons)		// for every sequence
+ *		vector<HMMViterbiResults*> results
+ *		decoder.decode(probabilities, results)
+ *		results[i]->genes							// or errors[i] if results[i] is NULL
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMBATCHDECODER_H
+#define HMMBATCHDECODER_H
+#include "HMMProbabilities.h"
+#include "HMMViterbiResults.h"
+#include "HMMArena.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+class HMMBatchDecoder
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMBatchDecoder();
+
+	// Destructor
+	// =============================================
+	~HMMBatchDecoder();
+
+	// Public Class Attributes
+	// =============================================
+	static const int numLanes;			// sequences advanced together
+
+	// Public Attributes
+	// =============================================
+	vector<string> errors;		// per sequence, empty unless it could not be decoded
+	int instructionSet;			// HMMViterbiKernel instruction set (the best one unless set)
+
+	// Public Methods
+	// =============================================
+
+	// addSequence(const uint8_t* codons, int numberOfCodons)
+	//  Purpose:
+	//		Adds an encoded sequence (see CodonUtilities::encodeSequence) to be
+	//		decoded.  codons is not copied and must stay valid until decode.
+	void addSequence(const uint8_t* codons, int numberOfCodons);
+
+	// clear()
+	//  Purpose:
+	//		Removes the sequences added so far
+	void clear();
+
+	// decode(HMMProbabilities* probabilities, vector<HMMViterbiResults*>& results)
+	//  Purpose:
+	//		Decodes every sequence added with probabilities and sets
+	//		results[i] to the counts gathered along the viterbi path of the
+	//		i'th sequence (their probabilities are not calculated, see
+	//		HiddenMarkovModel::viterbiIteration).  The results are owned by
+	//		the decoder and stay valid until the next decode.
+	//  Postconditions:
+	//		errors[i] - the reason results[i] is NULL (e.g., the sequence can
+	//					not be generated or its path ends inside of a gene)
+	void decode(HMMProbabilities* probabilities, vector<HMMViterbiResults*>& results);
+
+	// Public Accessors
+	// =============================================
+	int getNumSequences();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	struct Sequence {
+		const uint8_t* codons;
+		int numPositions;
+	};
+
+	vector<Sequence> sequences;
+	HMMArena resultsArena;
+	int numStates;
+
+	// Tables (built by decode)
+	vector<double> emissions;			// [codon * numStates + state], log zero is -infinity
+	vector<int> predecessorOffsets;		// see HMMTopology
+	vector<uint8_t> predecessors;
+	vector<double> transitions;			// log probability of every arc
+	vector<double> predecessorStates;	// predecessors as doubles (for blending)
+
+	// Work space of one group
+	vector<double> columns;				// two columns in structure of arrays form
+	vector<double> finalWeights;		// [lane * numStates + state], last column of every lane
+	vector<uint8_t> previousStates;		// [((position - 1) * numStates + state) * numLanes + lane]
+
+	// Private Methods
+	// =============================================
+
+	// buildTables(HMMProbabilities* probabilities)
+	//  Purpose:
+	//		Builds the emission and transition tables shared by every group
+	void buildTables(HMMProbabilities* probabilities);
+
+	// decodeGroup(HMMProbabilities* probabilities, const int* group, int groupSize, vector<HMMViterbiResults*>& results)
+	//  Purpose:
+	//		Decodes the groupSize (at most numLanes) sequences whose indexes
+	//		are group[0..groupSize - 1] together and sets their results
+	void decodeGroup(HMMProbabilities* probabilities, const int* group, int groupSize, vector<HMMViterbiResults*>& results);
+
+	// calculateColumnScalar(const int32_t* codonOffsets, const double* previous, double* current, uint8_t* currentStates)
+	// calculateColumnAVX2(const int32_t* codonOffsets, const double* previous, double* current, uint8_t* currentStates)
+	//  Purpose:
+	//		Calculates the weights (current) and previous states
+	//		(currentStates) of a column of every lane from the previous column
+	//		of every lane.  codonOffsets[lane] is the codon emitted in lane
+	//		times numStates.
+	void calculateColumnScalar(const int32_t* codonOffsets, const double* previous, double* current, uint8_t* currentStates);
+	void calculateColumnAVX2(const int32_t* codonOffsets, const double* previous, double* current, uint8_t* currentStates);
+
+	HMMBatchDecoder(const HMMBatchDecoder&);
+	HMMBatchDecoder& operator=(const HMMBatchDecoder&);
+};
+
+#endif // HMMBATCHDECODER_H
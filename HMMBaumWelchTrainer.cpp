@@ -0,0 +1,183 @@
+/*
+ * HMMBaumWelchTrainer.cpp
+ *
+ *	This is the cpp file for the HMMBaumWelchTrainer object.
+ *  HMMBaumWelchTrainer trains one set of probabilities with Baum-Welch
+ *  (forward-backward) training across a collection of sequences.
+ *
+ *  See HMMBaumWelchTrainer.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMBaumWelchTrainer.h"
+#include "HMMGeneTopology.h"
+#include <sstream>
+#include <iostream>
+#include <cmath>
+
+// const variable initialization
+// ==============================================
+const int HMMBaumWelchTrainer::numStates = HMMGeneTopology::numStates;
+
+// Constuctors
+// ==============================================
+HMMBaumWelchTrainer::HMMBaumWelchTrainer(int numberOfThreads)
+	: pool(numberOfThreads) {
+	probabilities = HMMProbabilities::initialProbabilities();
+	iterations = 0;
+	logLikelihood = 0;
+	scaledForwardBackward = false;
+	orfPruning = true;
+	orfMinimumLength = 0;
+}
+
+// Destructor
+// =============================================
+HMMBaumWelchTrainer::~HMMBaumWelchTrainer() {
+	for (HiddenMarkovModel* model : models)
+		delete model;
+	delete probabilities;
+}
+
+// Public Methods
+// =============================================
+
+// addSequence(FastaFile* aFastaFile)
+//  Purpose:
+//		Adds the sequence of aFastaFile to the training set
+void HMMBaumWelchTrainer::addSequence(FastaFile* aFastaFile) {
+	HiddenMarkovModel* model = new HiddenMarkovModel(aFastaFile);
+	model->setScaledForwardBackward(scaledForwardBackward);
+	model->setOrfPruning(orfPruning, orfMinimumLength);
+	models.push_back(model);
+}
+
+// addSequence(const uint8_t* someCodons, int numberOfCodons)
+//  Purpose:
+//		Adds an already encoded sequence (e.g., from a GenomeCache) to the
+//		training set
+void HMMBaumWelchTrainer::addSequence(const uint8_t* someCodons, int numberOfCodons) {
+	HiddenMarkovModel* model = new HiddenMarkovModel(someCodons, numberOfCodons);
+	model->setScaledForwardBackward(scaledForwardBackward);
+	model->setOrfPruning(orfPruning, orfMinimumLength);
+	models.push_back(model);
+}
+
+// setScaledForwardBackward(bool scaled)
+//  Purpose:
+//		Selects the forward-backward backend of every sequence's model (see
+//		HiddenMarkovModel::setScaledForwardBackward)
+void HMMBaumWelchTrainer::setScaledForwardBackward(bool scaled) {
+	scaledForwardBackward = scaled;
+	for (HiddenMarkovModel* model : models)
+		model->setScaledForwardBackward(scaled);
+}
+
+// setOrfPruning(bool prune, int minimumOrfLength)
+//  Purpose:
+//		Selects the ORF pruning of every sequence's model (see
+//		HiddenMarkovModel::setOrfPruning)
+void HMMBaumWelchTrainer::setOrfPruning(bool prune, int minimumOrfLength) {
+	orfPruning = prune;
+	orfMinimumLength = minimumOrfLength;
+	for (HiddenMarkovModel* model : models)
+		model->setOrfPruning(prune, minimumOrfLength);
+}
+
+// baumWelchTraining()
+//  Purpose:
+//		Use the Baum-Welch (forward-backward) algorithm to estimate
+//		the paramters for the model from all of the sequences.  Training
+//		stops when the summed log likelihood changes by less than 0.1.
+//
+//		Each iteration consists of the following steps
+//			1. Gather the expected counts of every sequence in parallel
+//			2. Add the counts together in sequence order
+//			3. Re-estimate the initiation and transition probabilities
+//			   from the combined counts
+//
+//  Postconditions:
+//		probabilities - set to the trained probabilities
+//		iterations - number of iterations run
+//		logLikelihood - summed log likelihood of the last iteration
+void HMMBaumWelchTrainer::baumWelchTraining() {
+	int numSequences = models.size();
+	vector<HMMExpectedCounts*> sequenceCounts(numSequences, (HMMExpectedCounts*) NULL);
+
+	bool trainingDone = false;
+	double previousLogLikelihood = 0;
+	while (!trainingDone) {
+		// Expectation: every task writes only its own accumulator
+		HMMProbabilities* iterationProbabilities = probabilities;
+		pool.run(numSequences, [&](int sequence) {
+			sequenceCounts[sequence] = models[sequence]->baumWelchExpectation(iterationProbabilities);
+		});
+
+		// Reduce the accumulators in sequence order
+		HMMExpectedCounts counts(numStates);
+		for (int sequence = 0; sequence < numSequences; sequence++) {
+			counts.addCounts(sequenceCounts[sequence]);
+			delete sequenceCounts[sequence];
+			sequenceCounts[sequence] = NULL;
+		}
+
+		// Maximization (emission probabilities are held steady)
+		counts.updateProbabilities(probabilities, false);
+
+		// Check if done
+		double currentLogLikelihood = counts.logLikelihood;
+		if (abs(previousLogLikelihood - currentLogLikelihood) < 0.1)
+			trainingDone = true;
+
+		// Set values for next iteration
+		previousLogLikelihood = currentLogLikelihood;
+		iterations++;
+		cout
+			<< "Iteration: " << iterations
+			<< "  Likelihood: " << currentLogLikelihood
+			<< "\n";
+	}
+
+	logLikelihood = previousLogLikelihood;
+}
+
+// string baumWelchResultsString()
+//  Purpose:
+//		Returns a string with the results of the training in the same
+//		format as HiddenMarkovModel::baumWelchTraining
+//  Preconditions:
+//		baumWelchTraining has been run
+string HMMBaumWelchTrainer::baumWelchResultsString() {
+	stringstream ss;
+
+	// EM Result header
+	ss << "    <result type=\"EM_result\">\n";
+
+	// Iterations
+	ss
+		<< "      <result type=\"iterations\">"
+		<< iterations
+		<< "</result>\n";
+
+	// Log Likelihood
+	ss
+		<< "      <result type=\"log_likelihood\">"
+		<< logLikelihood
+		<< "</result>\n";
+
+	// Probabilities
+	ss << probabilities->probabilitiesResultsString();
+
+	// EM Result footer
+	ss << "    </result>\n";
+
+	return ss.str();
+}
+
+// Public Accessors
+// =============================================
+int HMMBaumWelchTrainer::getNumSequences() {
+	return models.size();
+}
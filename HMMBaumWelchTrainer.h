@@ -0,0 +1,128 @@
+/*
+ * HMMBaumWelchTrainer.h
+ *
+ *	This is the header file for the HMMBaumWelchTrainer object.
+ *  HMMBaumWelchTrainer trains one set of probabilities with Baum-Welch
+ *  (forward-backward) training across a collection of sequences.
+ *
+ *  The expectation step of each iteration runs the forward, backward and
+ *  expected count pass of every sequence in parallel on a work stealing
+ *  thread pool (see HMMThreadPool).  Each sequence is gathered into its own
+ *  flat HMMExpectedCounts accumulator, so the threads share nothing but
+ *  the (read only) probabilities.  The accumulators are added together in
+ *  sequence order, which keeps the results the same for any number of
+ *  threads, and the maximization step is done once on the combined counts.
+ *  Training on a single sequence gives the same results as
+ *  HiddenMarkovModel::baumWelchTraining.
+ *
+ *  Typical use would be:
+ *
+ *		HMMBaumWelchTrainer trainer(numThreads)
+ *		trainer.addSequence(fastaFile1)
+ *		trainer.addSequence(fastaFile2)
+ *		...
+ *		trainer.baumWelchTraining()
+ *		trainer.baumWelchResultsString()
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMBAUMWELCHTRAINER_H
+#define HMMBAUMWELCHTRAINER_H
+#include "FastaFile.h"
+#include "HiddenMarkovModel.h"
+#include "HMMProbabilities.h"
+#include "HMMExpectedCounts.h"
+#include "HMMThreadPool.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+class HMMBaumWelchTrainer
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMBaumWelchTrainer(int numberOfThreads);		// 0 uses one thread per core
+
+	// Destructor
+	// =============================================
+	~HMMBaumWelchTrainer();
+
+	// Public Attributes
+	// =============================================
+	HMMProbabilities* probabilities;
+	int iterations;
+	double logLikelihood;
+
+	// Public Methods
+	// =============================================
+
+	// addSequence(FastaFile* aFastaFile)
+	//  Purpose:
+	//		Adds the sequence of aFastaFile to the training set
+	void addSequence(FastaFile* aFastaFile);
+
+	// addSequence(const uint8_t* someCodons, int numberOfCodons)
+	//  Purpose:
+	//		Adds an already encoded sequence (e.g., from a GenomeCache) to the
+	//		training set
+	void addSequence(const uint8_t* someCodons, int numberOfCodons);
+
+	// setScaledForwardBackward(bool scaled)
+	//  Purpose:
+	//		Selects the forward-backward backend of every sequence's model (see
+	//		HiddenMarkovModel::setScaledForwardBackward)
+	void setScaledForwardBackward(bool scaled);
+
+	// setOrfPruning(bool prune, int minimumOrfLength)
+	//  Purpose:
+	//		Selects the ORF pruning of every sequence's model (see
+	//		HiddenMarkovModel::setOrfPruning)
+	void setOrfPruning(bool prune, int minimumOrfLength);
+
+	// baumWelchTraining()
+	//  Purpose:
+	//		Use the Baum-Welch (forward-backward) algorithm to estimate
+	//		the paramters for the model from all of the sequences.  Training
+	//		stops when the summed log likelihood changes by less than 0.1.
+	//
+	//		Each iteration consists of the following steps
+	//			1. Gather the expected counts of every sequence in parallel
+	//			2. Add the counts together in sequence order
+	//			3. Re-estimate the initiation and transition probabilities
+	//			   from the combined counts
+	//
+	//  Postconditions:
+	//		probabilities - set to the trained probabilities
+	//		iterations - number of iterations run
+	//		logLikelihood - summed log likelihood of the last iteration
+	void baumWelchTraining();
+
+	// string baumWelchResultsString()
+	//  Purpose:
+	//		Returns a string with the results of the training in the same
+	//		format as HiddenMarkovModel::baumWelchTraining
+	//  Preconditions:
+	//		baumWelchTraining has been run
+	string baumWelchResultsString();
+
+	// Public Accessors
+	// =============================================
+	int getNumSequences();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	static const int numStates;
+	HMMThreadPool pool;
+	vector<HiddenMarkovModel*> models;
+	bool scaledForwardBackward;
+	bool orfPruning;
+	int orfMinimumLength;
+};
+
+#endif // HMMBAUMWELCHTRAINER_H
@@ -0,0 +1,250 @@
+/*
+ * HMMBenchmark.cpp
+ *
+ *	This is the cpp file for the HMMBenchmark object. HMMBenchmark
+ *  measures the decoding and training hot paths on synthetic sequences.
+ *
+ *  See HMMBenchmark.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMBenchmark.h"
+#include "HMMSequenceGenerator.h"
+#include "HMMTrellis.h"
+#include "HMMTopology.h"
+#include "HMMViterbiResults.h"
+#include "HMMViterbiKernel.h"
+#include "HMMExpectedCounts.h"
+#include "HiddenMarkovModel.h"
+#include "CodonUtilities.h"
+#include "HMMInstrumentation.h"
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <cstdlib>
+
+// Constuctors
+// ==============================================
+HMMBenchmark::HMMBenchmark() {
+	sizes = {10000, 100000, 1000000};
+	repetitions = 3;
+	seed = 540;
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+	checkpointInterval = 0;
+	maxForwardBackwardBases = 1000000;
+	probabilities = HMMProbabilities::initialProbabilities();
+}
+
+// Destructor
+// =============================================
+HMMBenchmark::~HMMBenchmark() {
+	delete probabilities;
+}
+
+// Public Class Methods
+// =============================================
+
+// long parseSize(string text)
+//  Purpose:
+//		Returns the number of bases in text, a number optionally followed
+//		by k, M or G (e.g., "10k", "100M").  Throws an invalid_argument
+//		exception if text is not a size.
+long HMMBenchmark::parseSize(string text) {
+	char* end = NULL;
+	double value = strtod(text.c_str(), &end);
+	string suffix = end;
+
+	if (suffix == "k" || suffix == "K")
+		value *= 1e3;
+	else if (suffix == "M" || suffix == "m")
+		value *= 1e6;
+	else if (suffix == "G" || suffix == "g")
+		value *= 1e9;
+	else if (!suffix.empty())
+		throw invalid_argument("Invalid size: " + text);
+
+	if (end == text.c_str() || value < 3)
+		throw invalid_argument("Invalid size: " + text);
+
+	return (long) value;
+}
+
+// vector<long> parseSizes(string text)
+//  Purpose:
+//		Returns the comma separated sizes in text (see parseSize)
+vector<long> HMMBenchmark::parseSizes(string text) {
+	vector<long> parsedSizes;
+	stringstream ss(text);
+	string size;
+	while (getline(ss, size, ','))
+		parsedSizes.push_back(parseSize(size));
+
+	return parsedSizes;
+}
+
+// Public Methods
+// =============================================
+
+// run(ostream& output)
+//  Purpose:
+//		Runs every phase for every size and writes one line of JSON per
+//		phase to output (see the header comment)
+void HMMBenchmark::run(ostream& output) {
+	int numStates = probabilities->getNumStates();
+
+	for (long size : sizes) {
+		string sequence;
+		vector<uint8_t> codons;
+		HMMTopology topology;
+
+		Timing generateTiming = timeWork([&]() {
+			HMMSequenceGenerator generator(probabilities, seed);
+			generator.generate(size, sequence, NULL);
+		});
+		long bases = sequence.length();
+		long positions = bases - 2;
+		writePhase(output, "generate", bases, positions, generateTiming);
+
+		measure(output, "build", bases, positions, [&]() {
+			CodonUtilities::encodeSequence(sequence, codons);
+			topology = HMMTopology(probabilities, numStates);
+		});
+		string().swap(sequence);
+
+		// Viterbi
+		HMMTrellis trellis(&codons[0], positions, numStates);
+		trellis.setCheckpointInterval(checkpointInterval);
+		trellis.setViterbiPrecision(viterbiPrecision);
+		measure(output, "viterbi_columns", bases, positions, [&]() {
+			trellis.calculateHighestWeightPaths(probabilities, &topology);
+		});
+
+		measure(output, "traceback", bases, positions, [&]() {
+			HMMViterbiResults results(1, numStates);
+			int position = positions;
+			int state = trellis.highestScoringState(position);
+			while (state != 0 && position > 0) {
+				results.addPathPosition(position, state, codons[position - 1]);
+				state = trellis.previousState(position, state);
+				position--;
+			}
+			results.endPath();
+			results.calculateProbabilities(probabilities);
+		});
+		trellis.releaseHighestWeightPaths();
+
+		measure(output, "viterbi_iteration", bases, positions, [&]() {
+			HiddenMarkovModel hmm(&codons[0], positions);
+			hmm.setViterbiCheckpointInterval(checkpointInterval);
+			hmm.setViterbiPrecision(viterbiPrecision);
+			hmm.setKeepViterbiPath(false);
+			hmm.viterbiIteration(probabilities, 1);
+		});
+
+		// Forward-backward
+		if (size > maxForwardBackwardBases)
+			continue;
+
+		measure(output, "forward", bases, positions, [&]() {
+			trellis.calculateLogForwardProbabilities(probabilities, &topology);
+		});
+
+		measure(output, "backward", bases, positions, [&]() {
+			trellis.calculateLogBackwardProbabilities(probabilities, &topology);
+		});
+
+		measure(output, "reestimation", bases, positions, [&]() {
+			HMMExpectedCounts counts(numStates);
+			trellis.accumulateExpectedCounts(probabilities, &topology, counts);
+			HMMProbabilities reestimated;
+			reestimated.copyFrom(probabilities);
+			counts.updateProbabilities(&reestimated, true);
+		});
+		trellis.releaseForwardBackwardProbabilities();
+	}
+}
+
+// Private Methods
+// =============================================
+
+// measure(ostream& output, string phase, long bases, long positions, const function<void()>& work)
+//  Purpose:
+//		Runs work repetitions times and writes the JSON line of phase
+//		(see timeWork and writePhase)
+void HMMBenchmark::measure(ostream& output, string phase, long bases, long positions, const function<void()>& work) {
+	writePhase(output, phase, bases, positions, timeWork(work));
+}
+
+// Timing timeWork(const function<void()>& work)
+//  Purpose:
+//		Runs work repetitions times and returns how long it took
+HMMBenchmark::Timing HMMBenchmark::timeWork(const function<void()>& work) {
+	Timing timing;
+	timing.repetitions = (repetitions > 0) ? repetitions : 1;
+	timing.fastestSeconds = 0;
+	timing.allocations = 0;
+	timing.allocatedBytes = 0;
+
+	double totalSeconds = 0;
+	for (int repetition = 0; repetition < timing.repetitions; repetition++) {
+		long startAllocations = HMMInstrumentation::allocationCount();
+		long startBytes = HMMInstrumentation::allocatedBytes();
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		work();
+
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		timing.allocations = HMMInstrumentation::allocationCount() - startAllocations;
+		timing.allocatedBytes = HMMInstrumentation::allocatedBytes() - startBytes;
+		totalSeconds += seconds;
+		if (repetition == 0 || seconds < timing.fastestSeconds)
+			timing.fastestSeconds = seconds;
+	}
+	timing.meanSeconds = totalSeconds / timing.repetitions;
+
+	return timing;
+}
+
+// writePhase(ostream& output, string phase, long bases, long positions, const Timing& timing)
+//  Purpose:
+//		Writes the JSON line of phase (see the header comment)
+void HMMBenchmark::writePhase(ostream& output, string phase, long bases, long positions, const Timing& timing) {
+	string instructionSet = "reference";
+	if (viterbiPrecision != HMMViterbiKernel::longDoublePrecision)
+		instructionSet = HMMViterbiKernel::instructionSetName(HMMViterbiKernel::bestInstructionSet());
+
+	// Read in this order (not inside the stream expression) so the peak
+	// includes the current size
+	long residentKilobytes = HMMInstrumentation::residentKilobytes();
+	long peakResidentKilobytes = HMMInstrumentation::peakResidentKilobytes();
+
+	stringstream ss;
+	ss << "{\"phase\":\"" << phase << "\""
+		<< ",\"bases\":" << bases
+		<< ",\"positions\":" << positions
+		<< ",\"states\":" << probabilities->getNumStates()
+		<< ",\"precision\":\"" << HMMViterbiKernel::precisionName(viterbiPrecision) << "\""
+		<< ",\"instruction_set\":\"" << instructionSet << "\""
+		<< ",\"checkpoint_interval\":" << checkpointInterval
+		<< ",\"repetitions\":" << timing.repetitions
+		<< ",\"seconds\":" << timing.fastestSeconds
+		<< ",\"mean_seconds\":" << timing.meanSeconds
+		<< ",\"positions_per_second\":" << ((timing.fastestSeconds > 0) ? positions / timing.fastestSeconds : 0);
+	if (HMMInstrumentation::isEnabled()) {
+		ss << ",\"instrumented\":true"
+			<< ",\"allocations\":" << timing.allocations
+			<< ",\"allocated_bytes\":" << timing.allocatedBytes;
+	}
+	else {
+		ss << ",\"instrumented\":false,\"allocations\":null,\"allocated_bytes\":null";
+	}
+	ss << ",\"rss_kb\":" << residentKilobytes
+		<< ",\"peak_rss_kb\":" << peakResidentKilobytes
+		<< "}\n";
+
+	output << ss.str();
+	output.flush();
+}
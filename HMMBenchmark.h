@@ -0,0 +1,147 @@
+/*
+ * HMMBenchmark.h
+ *
+ *	This is the header file for the HMMBenchmark object. HMMBenchmark
+ *  measures the decoding and training hot paths on synthetic sequences
+ *  sampled from the initial probabilities (see HMMSequenceGenerator), so
+ *  the effect of a change can be tracked from run to run.
+ *
+ *  For every sequence size the phases are run repetitions times each:
+ *
+ *		generate - sample the sequence
+ *		build - encode the codons and compile the topology
+ *		viterbi_columns - HMMTrellis::calculateHighestWeightPaths
+ *		traceback - walk the path into an HMMViterbiResults and calculate
+ *					its probabilities (HiddenMarkovModel::gatherViterbiResults)
+ *		viterbi_iteration - HiddenMarkovModel::viterbiIteration (build,
+ *							columns and traceback together)
+ *		forward - HMMTrellis::calculateLogForwardProbabilities
+ *		backward - HMMTrellis::calculateLogBackwardProbabilities
+ *		reestimation - accumulate the expected counts and update the
+ *					   probabilities (one Baum-Welch step after forward and
+ *					   backward)
+ *
+ *  The forward-backward phases keep three long double values per state
+ *  and position, so they are skipped for sizes above
+ *  maxForwardBackwardBases.
+ *
+ *  Every phase writes one line of JSON to the output:
+ *
+ *		{"phase":"viterbi_columns","bases":<<bases>>,"positions":<<positions>>,
+ *		 "states":12,"precision":"long","instruction_set":"avx2",
+ *		 "checkpoint_interval":0,"repetitions":<<repetitions>>,
+ *		 "seconds":<<fastest repetition>>,"mean_seconds":<<mean>>,
+ *		 "positions_per_second":<<positions / seconds>>,
+ *		 "instrumented":true,"allocations":<<allocations of one repetition>>,
+ *		 "allocated_bytes":<<bytes allocated by one repetition>>,
+ *		 "rss_kb":<<resident set size>>,"peak_rss_kb":<<peak resident set size>>}
+ *
+ *  bases and positions are those of the generated sequence (the generator
+ *  samples at least the size, so there can be a few more).
+ *  Allocations are those counted by HMMInstrumentation (the global
+ *  operator new of an instrumented build; memory allocated with malloc
+ *  directly is not counted).  Without instrumentation they are not
+ *  counted, so "instrumented" is false and both counts are null.
+ *  The peak resident set size is that of the whole process so far.
+ *
+ *  Typical use would be:
+ *
+ *		HMMBenchmark benchmark
+ *		benchmark.sizes = {10000, 1000000}
+ *		benchmark.run(cout)
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMBENCHMARK_H
+#define HMMBENCHMARK_H
+#include "HMMProbabilities.h"
+#include <vector>
+#include <string>
+#include <ostream>
+#include <functional>
+using namespace std;
+
+class HMMBenchmark
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMBenchmark();
+
+	// Destructor
+	// =============================================
+	~HMMBenchmark();
+
+	// Public Attributes
+	// =============================================
+	vector<long> sizes;				// bases of every sequence benchmarked
+	int repetitions;				// of every phase
+	unsigned long seed;				// of the sequence generator
+	int viterbiPrecision;			// see HMMViterbiKernel
+	int checkpointInterval;			// see HMMTrellis::setCheckpointInterval
+	long maxForwardBackwardBases;	// larger sizes skip forward-backward
+
+	// Public Class Methods
+	// =============================================
+
+	// long parseSize(string text)
+	//  Purpose:
+	//		Returns the number of bases in text, a number optionally followed
+	//		by k, M or G (e.g., "10k", "100M").  Throws an invalid_argument
+	//		exception if text is not a size.
+	static long parseSize(string text);
+
+	// vector<long> parseSizes(string text)
+	//  Purpose:
+	//		Returns the comma separated sizes in text (see parseSize)
+	static vector<long> parseSizes(string text);
+
+	// Public Methods
+	// =============================================
+
+	// run(ostream& output)
+	//  Purpose:
+	//		Runs every phase for every size and writes one line of JSON per
+	//		phase to output (see the header comment)
+	void run(ostream& output);
+
+private:
+
+	// Private Attributes
+	// =============================================
+	struct Timing {
+		int repetitions;
+		double fastestSeconds;
+		double meanSeconds;
+		long allocations;			// of one repetition (instrumented builds)
+		long allocatedBytes;
+	};
+
+	HMMProbabilities* probabilities;
+
+	// Private Methods
+	// =============================================
+
+	// measure(ostream& output, string phase, long bases, long positions, const function<void()>& work)
+	//  Purpose:
+	//		Runs work repetitions times and writes the JSON line of phase
+	//		(see timeWork and writePhase)
+	void measure(ostream& output, string phase, long bases, long positions, const function<void()>& work);
+
+	// Timing timeWork(const function<void()>& work)
+	//  Purpose:
+	//		Runs work repetitions times and returns how long it took
+	Timing timeWork(const function<void()>& work);
+
+	// writePhase(ostream& output, string phase, long bases, long positions, const Timing& timing)
+	//  Purpose:
+	//		Writes the JSON line of phase (see the header comment)
+	void writePhase(ostream& output, string phase, long bases, long positions, const Timing& timing);
+
+	HMMBenchmark(const HMMBenchmark&);
+	HMMBenchmark& operator=(const HMMBenchmark&);
+};
+
+#endif // HMMBENCHMARK_H
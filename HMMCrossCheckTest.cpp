@@ -0,0 +1,238 @@
+/*
+ * HMMCrossCheckTest.cpp
+ *
+ *	This is the cpp file of the hmm-cross-check test program (run by
+ *  ctest, one test per check).  It decodes a sequence sampled from the
+ *  initial probabilities (see HMMSequenceGenerator) with a pair of
+ *  backends that must agree and fails if they do not (the models decode
+ *  with the initial probabilities they are constructed with).  The checks
+ *  are:
+ *
+ *		forward-backward - the log space and the scaled backends give the
+ *						   same log likelihood and expected counts (see
+ *						   HiddenMarkovModel::crossCheckForwardBackward)
+ *		checkpoints - the checkpointed viterbi decode calls the same genes
+ *					  as the full trellis
+ *		vectorized - the vectorized double precision viterbi columns find
+ *					 the same highest path weight as the long double
+ *					 reference (the paths themselves may differ between
+ *					 tied genes, see HMMViterbiKernel)
+ *		orf - with a minimum ORF length no gene on either strand is called
+ *			  shorter than it (see HiddenMarkovModel::setOrfPruning)
+ *		windowed - the windowed decode calls the same genes as the serial
+ *				   decode near all but (rarely) a few window boundaries, at
+ *				   most one in boundariesPerDifference (see
+ *				   HiddenMarkovModel::crossCheckWindowedViterbi)
+ *
+ *  Usage:
+ *
+ *		hmm-cross-check check|all [numberOfBases [seed]]
+ *
+ *  Returns 0 when the check (or with all, every check) passes, 1 when it
+ *  fails and 2 for an unknown check.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HiddenMarkovModel.h"
+#include "HMMProbabilities.h"
+#include "HMMSequenceGenerator.h"
+#include "HMMViterbiResults.h"
+#include "HMMTrellis.h"
+#include "HMMTopology.h"
+#include "HMMViterbiKernel.h"
+#include "CodonUtilities.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <exception>
+#include <cstdlib>
+#include <cmath>
+#include <stdint.h>
+using namespace std;
+
+// const variable initialization
+// ==============================================
+static const long defaultNumBases = 20000;
+static const unsigned long defaultSeed = 540;
+static const double forwardBackwardTolerance = 1e-6;	// relative difference
+static const double viterbiTolerance = 1e-9;			// relative difference
+static const int windowLength = 5000;
+static const int windowOverlap = 1000;
+static const int boundariesPerDifference = 4;		// windowed boundaries allowed per difference
+static const int minimumOrfLength = 300;			// bases
+
+// check(bool passed, const string& name, const string& details)
+//  Purpose:
+//		Writes the outcome of the check name and returns passed
+static bool check(bool passed, const string& name, const string& details) {
+	cout << (passed ? "ok   " : "FAIL ") << name;
+	if (!details.empty())
+		cout << " (" << details << ")";
+	cout << endl;
+	return passed;
+}
+
+// vector<HMMViterbiResults::Gene> viterbiGenes(const vector<uint8_t>& codons, HMMProbabilities* probabilities, int checkpointInterval)
+//  Purpose:
+//		Returns the genes of one viterbi decode of codons with
+//		checkpointInterval (see HiddenMarkovModel::setViterbiCheckpointInterval)
+static vector<HMMViterbiResults::Gene> viterbiGenes(const vector<uint8_t>& codons, HMMProbabilities* probabilities, int checkpointInterval) {
+	HiddenMarkovModel hmm(&codons[0], codons.size());
+	hmm.setKeepViterbiPath(false);
+	hmm.setViterbiCheckpointInterval(checkpointInterval);
+	HMMViterbiResults* results = hmm.viterbiIteration(probabilities, 1);
+
+	vector<HMMViterbiResults::Gene> genes;
+	for (HMMViterbiResults::Gene* gene : results->genes)
+		genes.push_back(*gene);
+	return genes;
+}
+
+// double viterbiWeight(const vector<uint8_t>& codons, HMMProbabilities* probabilities, int precision)
+//  Purpose:
+//		Returns the weight of the viterbi path of codons calculated with
+//		precision (see HMMTrellis::setViterbiPrecision)
+static double viterbiWeight(const vector<uint8_t>& codons, HMMProbabilities* probabilities, int precision) {
+	int numPositions = codons.size();
+	HMMTopology topology(probabilities, probabilities->getNumStates());
+	HMMTrellis trellis(&codons[0], numPositions, probabilities->getNumStates());
+	trellis.setViterbiPrecision(precision);
+	trellis.calculateHighestWeightPaths(probabilities, &topology);
+
+	return trellis.highestWeight(numPositions, trellis.highestScoringState(numPositions));
+}
+
+// bool sameGenes(const vector<HMMViterbiResults::Gene>& genes, const vector<HMMViterbiResults::Gene>& otherGenes)
+//  Purpose:
+//		Returns true if genes and otherGenes are the same genes in the same
+//		order
+static bool sameGenes(const vector<HMMViterbiResults::Gene>& genes, const vector<HMMViterbiResults::Gene>& otherGenes) {
+	if (genes.size() != otherGenes.size())
+		return false;
+
+	for (size_t index = 0; index < genes.size(); index++) {
+		if (genes[index].start != otherGenes[index].start ||
+			genes[index].end != otherGenes[index].end ||
+			genes[index].isTopStrand != otherGenes[index].isTopStrand)
+			return false;
+	}
+	return true;
+}
+
+// bool checkForwardBackward(const vector<uint8_t>& codons, HMMProbabilities* probabilities)
+//  Purpose:
+//		Runs the forward-backward check (see the header comment)
+static bool checkForwardBackward(const vector<uint8_t>& codons, HMMProbabilities* probabilities) {
+	HiddenMarkovModel hmm(&codons[0], codons.size());
+	double difference = hmm.crossCheckForwardBackward();
+
+	stringstream details;
+	details << "largest relative difference " << scientific << difference;
+	return check(difference <= forwardBackwardTolerance, "forward-backward", details.str());
+}
+
+// bool checkCheckpoints(const vector<uint8_t>& codons, HMMProbabilities* probabilities)
+//  Purpose:
+//		Runs the checkpoints check (see the header comment)
+static bool checkCheckpoints(const vector<uint8_t>& codons, HMMProbabilities* probabilities) {
+	vector<HMMViterbiResults::Gene> genes = viterbiGenes(codons, probabilities, 0);
+	vector<HMMViterbiResults::Gene> checkpointedGenes =
+		viterbiGenes(codons, probabilities, HMMTrellis::automaticCheckpointInterval);
+
+	return check(sameGenes(genes, checkpointedGenes), "checkpoints",
+		to_string(genes.size()) + " genes, " + to_string(checkpointedGenes.size()) + " checkpointed");
+}
+
+// bool checkVectorized(const vector<uint8_t>& codons, HMMProbabilities* probabilities)
+//  Purpose:
+//		Runs the vectorized check (see the header comment)
+static bool checkVectorized(const vector<uint8_t>& codons, HMMProbabilities* probabilities) {
+	double referenceWeight = viterbiWeight(codons, probabilities, HMMViterbiKernel::longDoublePrecision);
+	double vectorizedWeight = viterbiWeight(codons, probabilities, HMMViterbiKernel::doublePrecision);
+	double weightDifference = fabs(referenceWeight - vectorizedWeight) / fabs(referenceWeight);
+
+	return check(weightDifference <= viterbiTolerance, "vectorized",
+		"weights " + to_string(referenceWeight) + " and " + to_string(vectorizedWeight));
+}
+
+// bool checkWindowed(const vector<uint8_t>& codons, HMMProbabilities* probabilities)
+//  Purpose:
+//		Runs the windowed check (see the header comment)
+static bool checkWindowed(const vector<uint8_t>& codons, HMMProbabilities* probabilities) {
+	HiddenMarkovModel hmm(&codons[0], codons.size());
+	hmm.setWindowedViterbi(windowLength, windowOverlap, 0);
+	vector<int> boundaries = hmm.crossCheckWindowedViterbi();
+	int numBoundaries = (codons.size() - 1) / windowLength;
+
+	return check((int) boundaries.size() * boundariesPerDifference <= numBoundaries, "windowed",
+		to_string(boundaries.size()) + " of " + to_string(numBoundaries) + " boundaries differ");
+}
+
+// bool checkOrf(const vector<uint8_t>& codons, HMMProbabilities* probabilities)
+//  Purpose:
+//		Runs the orf check (see the header comment)
+static bool checkOrf(const vector<uint8_t>& codons, HMMProbabilities* probabilities) {
+	HiddenMarkovModel hmm(&codons[0], codons.size());
+	hmm.setKeepViterbiPath(false);
+	hmm.setOrfPruning(true, minimumOrfLength);
+	HMMViterbiResults* results = hmm.viterbiIteration(probabilities, 1);
+
+	int numShortGenes[2] = { 0, 0 };		// top, bottom strand
+	for (HMMViterbiResults::Gene* gene : results->genes) {
+		if (gene->end - gene->start + 1 < minimumOrfLength)
+			numShortGenes[gene->isTopStrand ? 0 : 1]++;
+	}
+
+	return check(numShortGenes[0] == 0 && numShortGenes[1] == 0, "orf",
+		to_string(results->genes.size()) + " genes, " + to_string(numShortGenes[0]) + " top and " +
+		to_string(numShortGenes[1]) + " bottom strand genes shorter than " + to_string(minimumOrfLength));
+}
+
+int main(int argc, char* argv[]) {
+	typedef bool (*Check)(const vector<uint8_t>&, HMMProbabilities*);
+	map<string, Check> checks;
+	checks["forward-backward"] = checkForwardBackward;
+	checks["checkpoints"] = checkCheckpoints;
+	checks["vectorized"] = checkVectorized;
+	checks["orf"] = checkOrf;
+	checks["windowed"] = checkWindowed;
+
+	string checkName = (argc > 1) ? argv[1] : "";
+	if (checkName != "all" && checks.count(checkName) == 0) {
+		cerr << "Usage: hmm-cross-check check|all [numberOfBases [seed]]" << endl;
+		cerr << "  checks:";
+		for (auto& entry : checks)
+			cerr << " " << entry.first;
+		cerr << endl;
+		return 2;
+	}
+	long numBases = (argc > 2) ? atol(argv[2]) : defaultNumBases;
+	unsigned long seed = (argc > 3) ? strtoul(argv[3], NULL, 10) : defaultSeed;
+	bool passed = true;
+
+	HMMProbabilities* probabilities = HMMProbabilities::initialProbabilities();
+	try {
+		string sequence;
+		HMMSequenceGenerator generator(probabilities, seed);
+		generator.generate(numBases, sequence, NULL);
+
+		vector<uint8_t> codons;
+		CodonUtilities::encodeSequence(sequence, codons);
+		cout << "sequence of " << sequence.length() << " bases (seed " << seed << ")" << endl;
+
+		for (auto& entry : checks) {
+			if (checkName == "all" || checkName == entry.first)
+				passed &= entry.second(codons, probabilities);
+		}
+	}
+	catch (exception& e) {
+		passed = check(false, checkName, e.what());
+	}
+	delete probabilities;
+
+	return passed ? 0 : 1;
+}
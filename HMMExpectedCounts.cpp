@@ -0,0 +1,169 @@
+/*
+ * HMMExpectedCounts.cpp
+ *
+ *	This is the cpp file for the HMMExpectedCounts object.
+ *  HMMExpectedCounts is the flat accumulator for the expected counts
+ *  gathered by the expectation step of Baum-Welch training.
+ *
+ *  See HMMExpectedCounts.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+#include "HMMExpectedCounts.h"
+#include "CodonUtilities.h"
+#include "MathUtilities.h"
+#include "HMMInstrumentation.h"
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+// double relativeDifference(long double logX, long double logY)
+//  Purpose:
+//		Returns |x - y| / max(x, y) for two log space counts (0 if both are 0)
+static double relativeDifference(long double logX, long double logY) {
+	double x = MathUtilities::eexp(logX);
+	double y = MathUtilities::eexp(logY);
+	double largest = max(fabs(x), fabs(y));
+	if (largest == 0)
+		return 0;
+
+	return fabs(x - y) / largest;
+}
+
+// Constuctors
+// ==============================================
+HMMExpectedCounts::HMMExpectedCounts() {
+	numStates = 0;
+	numSequences = 0;
+	logLikelihood = 0;
+}
+
+HMMExpectedCounts::HMMExpectedCounts(int numberOfStates) {
+	long double logZero = std::numeric_limits<double>::quiet_NaN();
+
+	numStates = numberOfStates;
+	numSequences = 0;
+	logLikelihood = 0;
+	logInitiationCounts.assign(numStates, logZero);
+	logStateCounts.assign(numStates, logZero);
+	logTransitionCounts.assign(numStates * numStates, logZero);
+	logEmissionCounts.assign(numStates * CodonUtilities::numEmissionCodons, logZero);
+	logEmissionStateCounts.assign(numStates, logZero);
+}
+
+// Destructor
+// =============================================
+HMMExpectedCounts::~HMMExpectedCounts() {
+}
+
+// Public Methods
+// =============================================
+
+// addCounts(HMMExpectedCounts* otherCounts)
+//  Purpose:
+//		Adds (in log space) the counts of otherCounts to the counts in this
+//		object
+void HMMExpectedCounts::addCounts(HMMExpectedCounts* otherCounts) {
+	numSequences += otherCounts->numSequences;
+	logLikelihood += otherCounts->logLikelihood;
+
+	for (int state = 0; state < numStates; state++) {
+		logInitiationCounts[state] = MathUtilities::elnsum(logInitiationCounts[state], otherCounts->logInitiationCounts[state]);
+		logStateCounts[state] = MathUtilities::elnsum(logStateCounts[state], otherCounts->logStateCounts[state]);
+		logEmissionStateCounts[state] = MathUtilities::elnsum(logEmissionStateCounts[state], otherCounts->logEmissionStateCounts[state]);
+	}
+
+	for (unsigned int i = 0; i < logTransitionCounts.size(); i++)
+		logTransitionCounts[i] = MathUtilities::elnsum(logTransitionCounts[i], otherCounts->logTransitionCounts[i]);
+
+	for (unsigned int i = 0; i < logEmissionCounts.size(); i++)
+		logEmissionCounts[i] = MathUtilities::elnsum(logEmissionCounts[i], otherCounts->logEmissionCounts[i]);
+}
+
+// updateProbabilities(HMMProbabilities* probabilities, bool updateEmissions)
+//  Purpose:
+//		Re-estimates the probabilities from the expected counts (the
+//		maximization step of Baum-Welch training).
+//
+//		initiation - initiation count / number of sequences
+//		transition - transition count / state count of the begin state
+//		emission - emission count / emission state count (only when
+//				   updateEmissions is true, the unknown codon is not
+//				   re-estimated)
+//	Postconditions:
+//		probabilities - set to the re-estimated probabilities
+void HMMExpectedCounts::updateProbabilities(HMMProbabilities* probabilities, bool updateEmissions) {
+	HMM_SCOPED_TIMER(reestimationTimer);
+	long double* initiation = probabilities->initiationProbabilityValues();
+	long double* emission = probabilities->emissionProbabilityValues();
+	long double* transition = probabilities->transitionProbabilityValues();
+
+	// Emission probabilities
+	if (updateEmissions) {
+		for (int state = 1; state < numStates; state++) {
+			for (int codon = 0; codon < CodonUtilities::numCodons; codon++) {
+				emission[state * CodonUtilities::numEmissionCodons + codon] =
+					MathUtilities::eexp(
+						MathUtilities::elnprod(
+							logEmissionCounts[state * CodonUtilities::numEmissionCodons + codon],
+							-logEmissionStateCounts[state]
+						)
+					);
+			}
+		}
+	}
+
+	// Initiation probabilities
+	long double logNumSequences = MathUtilities::eln(numSequences > 0 ? numSequences : 1);
+	for (int state = 1; state < numStates; state++) {
+		initiation[state] =
+			MathUtilities::eexp(
+				MathUtilities::elnprod(
+					logInitiationCounts[state],
+					-logNumSequences
+				)
+			);
+	}
+
+	// Transition probabilities
+	for (int i = 0; i < numStates; i++) {
+		for (int j = 0; j < numStates; j++) {
+			transition[i * numStates + j] =
+				MathUtilities::eexp(
+					MathUtilities::elnprod(
+						logTransitionCounts[i * numStates + j],
+						-logStateCounts[i]
+					)
+				);
+		}
+	}
+	probabilities->calculateLogProbabilities();
+}
+
+// double maximumRelativeDifference(HMMExpectedCounts* otherCounts)
+//  Purpose:
+//		Returns the largest relative difference between the (non-log)
+//		counts or the log likelihoods of this object and otherCounts.  Used
+//		to cross check the log space and scaled forward-backward results.
+double HMMExpectedCounts::maximumRelativeDifference(HMMExpectedCounts* otherCounts) {
+	double difference = 0;
+
+	double largestLikelihood = max(fabs(logLikelihood), fabs(otherCounts->logLikelihood));
+	if (largestLikelihood > 0)
+		difference = fabs(logLikelihood - otherCounts->logLikelihood) / largestLikelihood;
+
+	for (int state = 0; state < numStates; state++) {
+		difference = max(difference, relativeDifference(logInitiationCounts[state], otherCounts->logInitiationCounts[state]));
+		difference = max(difference, relativeDifference(logStateCounts[state], otherCounts->logStateCounts[state]));
+		difference = max(difference, relativeDifference(logEmissionStateCounts[state], otherCounts->logEmissionStateCounts[state]));
+	}
+
+	for (unsigned int i = 0; i < logTransitionCounts.size(); i++)
+		difference = max(difference, relativeDifference(logTransitionCounts[i], otherCounts->logTransitionCounts[i]));
+
+	for (unsigned int i = 0; i < logEmissionCounts.size(); i++)
+		difference = max(difference, relativeDifference(logEmissionCounts[i], otherCounts->logEmissionCounts[i]));
+
+	return difference;
+}
@@ -0,0 +1,93 @@
+/*
+ * HMMExpectedCounts.h
+ *
+ *	This is the header file for the HMMExpectedCounts object.
+ *  HMMExpectedCounts is the flat accumulator for the expected counts
+ *  gathered by the expectation step of Baum-Welch training.  All of the
+ *  counts are kept in log space (NaN is a count of zero, see
+ *  MathUtilities) in flat arrays:
+ *
+ *		logInitiationCounts[state] - conditional probability of state at the
+ *									 first position
+ *		logStateCounts[state] - conditional probability of state summed over
+ *								every position that has a next position
+ *		logTransitionCounts[beginState * numStates + endState] - conditional
+ *								probability of the transition summed over
+ *								every pair of adjacent positions
+ *		logEmissionCounts[state * CodonUtilities::numEmissionCodons + codon]
+ *								- conditional probability of state summed over
+ *								  every position emitting codon
+ *		logEmissionStateCounts[state] - conditional probability of state summed
+ *										over every position
+ *
+ *  One HMMExpectedCounts is filled per sequence (see
+ *  HMMTrellis::accumulateExpectedCounts) so sequences can be processed on
+ *  separate threads without sharing anything.  The counts are then added
+ *  together with addCounts and the maximization step is done once with
+ *  updateProbabilities.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMEXPECTEDCOUNTS_H
+#define HMMEXPECTEDCOUNTS_H
+#include "HMMProbabilities.h"
+#include <vector>
+using namespace std;
+
+class HMMExpectedCounts
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMExpectedCounts();
+	HMMExpectedCounts(int numberOfStates);
+
+	// Destructor
+	// =============================================
+	~HMMExpectedCounts();
+
+	// Public Attributes
+	// =============================================
+	int numStates;
+	int numSequences;
+	double logLikelihood;	// log (base 2) likelihood summed over the sequences
+	vector<long double> logInitiationCounts;
+	vector<long double> logStateCounts;
+	vector<long double> logTransitionCounts;
+	vector<long double> logEmissionCounts;
+	vector<long double> logEmissionStateCounts;
+
+	// Public Methods
+	// =============================================
+
+	// addCounts(HMMExpectedCounts* otherCounts)
+	//  Purpose:
+	//		Adds (in log space) the counts of otherCounts to the counts in this
+	//		object
+	void addCounts(HMMExpectedCounts* otherCounts);
+
+	// updateProbabilities(HMMProbabilities* probabilities, bool updateEmissions)
+	//  Purpose:
+	//		Re-estimates the probabilities from the expected counts (the
+	//		maximization step of Baum-Welch training).
+	//
+	//		initiation - initiation count / number of sequences
+	//		transition - transition count / state count of the begin state
+	//		emission - emission count / emission state count (only when
+	//				   updateEmissions is true, the unknown codon is not
+	//				   re-estimated)
+	//	Postconditions:
+	//		probabilities - set to the re-estimated probabilities
+	void updateProbabilities(HMMProbabilities* probabilities, bool updateEmissions);
+
+	// double maximumRelativeDifference(HMMExpectedCounts* otherCounts)
+	//  Purpose:
+	//		Returns the largest relative difference between the (non-log)
+	//		counts or the log likelihoods of this object and otherCounts.  Used
+	//		to cross check the log space and scaled forward-backward results.
+	double maximumRelativeDifference(HMMExpectedCounts* otherCounts);
+};
+
+#endif // HMMEXPECTEDCOUNTS_H
@@ -0,0 +1,217 @@
+/*
+ * HMMForwardScorer.cpp
+ *
+ *	This is the cpp file for the HMMForwardScorer object.
+ *  HMMForwardScorer calculates the log likelihood of a sequence under
+ *  several models at once, streaming the sequence through two forward
+ *  columns per model.
+ *
+ *  See HMMForwardScorer.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMForwardScorer.h"
+#include "CodonUtilities.h"
+#include "HMMInstrumentation.h"
+#include <cmath>
+#include <limits>
+
+// const variable initialization
+// ==============================================
+const size_t HMMForwardScorer::chunkLength = 1 << 16;
+
+// Constuctors
+// ==============================================
+HMMForwardScorer::HMMForwardScorer() {
+	numPositions = 0;
+	numBases = 0;
+	previousBases[0] = previousBases[1] = CodonUtilities::unknownBase;
+}
+
+// Destructor
+// =============================================
+HMMForwardScorer::~HMMForwardScorer() {
+	for (Model* model : models)
+		delete model;
+}
+
+// Public Methods
+// =============================================
+
+// int addModel(HMMProbabilities* probabilities)
+//  Purpose:
+//		Adds a model to score the sequences with and returns its index.
+//		The tables of probabilities are copied into the scorer, so
+//		probabilities is not used afterwards.
+int HMMForwardScorer::addModel(HMMProbabilities* probabilities) {
+	Model* model = new Model();
+	model->numStates = probabilities->getNumStates();
+	model->topology = HMMTopology(probabilities, model->numStates);
+
+	model->initiation.assign(model->numStates, 0);
+	for (int state = 1; state < model->numStates; state++)
+		model->initiation[state] = probabilities->initiationProbability(state);
+
+	// Codon major, so the emissions of one position are contiguous
+	const long double* emissionTable = probabilities->emissionProbabilityTable();
+	model->emissions.assign(CodonUtilities::numEmissionCodons * model->numStates, 0);
+	for (int codon = 0; codon < CodonUtilities::numEmissionCodons; codon++) {
+		for (int state = 1; state < model->numStates; state++)
+			model->emissions[codon * model->numStates + state] = emissionTable[state * CodonUtilities::numEmissionCodons + codon];
+	}
+
+	model->columns.assign(2 * model->numStates, 0);
+	model->logScaleSum = 0;
+	model->possible = true;
+
+	models.push_back(model);
+	return models.size() - 1;
+}
+
+// beginSequence()
+//  Purpose:
+//		Starts scoring a new sequence with every model
+void HMMForwardScorer::beginSequence() {
+	numPositions = 0;
+	numBases = 0;
+	for (Model* model : models) {
+		model->logScaleSum = 0;
+		model->possible = true;
+	}
+}
+
+// addBases(const char* bases, size_t length)
+//  Purpose:
+//		Adds the next length bases of the sequence.  Every base after the
+//		second completes a codon and advances every model one position.
+void HMMForwardScorer::addBases(const char* bases, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		uint8_t base = CodonUtilities::encodeBase(bases[i]);
+
+		if (numBases == 2) {
+			uint8_t codon = CodonUtilities::unknownCodon;
+			if (!((previousBases[0] | previousBases[1] | base) & CodonUtilities::unknownBase))
+				codon = (previousBases[0] << 4) | (previousBases[1] << 2) | base;
+			addCodon(codon);
+		}
+		else {
+			numBases++;
+		}
+
+		previousBases[0] = previousBases[1];
+		previousBases[1] = base;
+	}
+}
+
+// addCodon(uint8_t codon)
+//  Purpose:
+//		Advances every model one position emitting codon (a codon index,
+//		see CodonUtilities)
+void HMMForwardScorer::addCodon(uint8_t codon) {
+	numPositions++;
+	for (Model* model : models) {
+		if (model->possible)
+			advance(model, codon);
+	}
+}
+
+// bool scoreNextRecord(FastaReader& reader, string& header)
+//  Purpose:
+//		Scores the next record of reader with every model, reading its
+//		sequence a chunk at a time.  Returns false when there are no more
+//		records.
+//  Postconditions:
+//		header - set to the header of the record (without the '>')
+bool HMMForwardScorer::scoreNextRecord(FastaReader& reader, string& header) {
+	if (!reader.nextHeader(header))
+		return false;
+
+	HMM_SCOPED_TIMER(forwardTimer);
+	beginSequence();
+	string chunk;
+	chunk.reserve(chunkLength);
+	while (reader.readSequence(chunk, chunkLength) > 0) {
+		addBases(chunk.data(), chunk.length());
+		chunk.clear();
+	}
+	HMM_COUNT(positionsCounter, numPositions * (long) models.size());
+
+	return true;
+}
+
+// double logLikelihood(int model)
+//  Purpose:
+//		Returns the log (base 2) likelihood of the sequence so far under
+//		model (-infinity if the model can not generate it)
+double HMMForwardScorer::logLikelihood(int model) {
+	if (!models[model]->possible)
+		return -numeric_limits<double>::infinity();
+
+	return models[model]->logScaleSum / log(2);
+}
+
+// int bestModel()
+//  Purpose:
+//		Returns the model with the highest log likelihood (the lowest
+//		numbered one on ties, -1 without models)
+int HMMForwardScorer::bestModel() {
+	int best = -1;
+	for (int model = 0; model < (int) models.size(); model++) {
+		if (best < 0 || logLikelihood(model) > logLikelihood(best))
+			best = model;
+	}
+
+	return best;
+}
+
+// Public Accessors
+// =============================================
+int HMMForwardScorer::getNumModels() {
+	return models.size();
+}
+
+// Private Methods
+// =============================================
+
+// advance(Model* model, uint8_t codon)
+//  Purpose:
+//		Calculates the next forward column of model from its previous one
+void HMMForwardScorer::advance(Model* model, uint8_t codon) {
+	int numStates = model->numStates;
+	HMMTopology& topology = model->topology;
+	const double* emissions = &model->emissions[codon * numStates];
+	double* previousForward = &model->columns[((numPositions - 1) % 2) * numStates];
+	double* forward = &model->columns[(numPositions % 2) * numStates];
+
+	double scale = 0;
+	for (int state = 1; state < numStates; state++) {
+		double alpha = 0;
+
+		// The first position can only be entered from the start state
+		if (numPositions == 1) {
+			alpha = model->initiation[state];
+		}
+		else {
+			for (int arc = topology.predecessorOffsets[state]; arc < topology.predecessorOffsets[state + 1]; arc++) {
+				alpha += previousForward[topology.predecessors[arc]] * topology.predecessorProbabilities[arc];
+			}
+		}
+
+		forward[state] = alpha * emissions[state];
+		scale += forward[state];
+	}
+
+	if (scale <= 0) {
+		model->possible = false;
+		return;
+	}
+
+	// Normalize the column
+	double inverseScale = 1.0 / scale;
+	for (int state = 1; state < numStates; state++) {
+		forward[state] *= inverseScale;
+	}
+	model->logScaleSum += log(scale);
+}
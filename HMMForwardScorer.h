@@ -0,0 +1,149 @@
+/*
+ * HMMForwardScorer.h
+ *
+ *	This is the header file for the HMMForwardScorer object.
+ *  HMMForwardScorer calculates the log likelihood of a sequence under
+ *  several models at once with the scaled forward algorithm, for
+ *  workflows that only need to know which model fits a sequence best
+ *  (e.g., contamination screening or model selection) and never the
+ *  genes.
+ *
+ *  Nothing is kept per position.  The bases are streamed in (straight
+ *  from a FastaReader, a chunk at a time, see scoreNextRecord) and every
+ *  codon advances the forward column of every model by one position, so
+ *  each model holds only its previous and current column and the sum of
+ *  the logs of its scale factors.  Memory does not depend on the length
+ *  of the sequence and a long sequence is read from the file only once
+ *  for every model.
+ *
+ *  The arithmetic is that of HMMTrellis::calculateScaledForwardProbabilities,
+ *  so logLikelihood gives the same value as HMMTrellis::scaledLogLikelihood.
+ *  A model that can not generate the sequence (a column sums to zero) is
+ *  given a log likelihood of -infinity and is not advanced any further.
+ *
+ *  Typical use would be:
+ *
+ *		HMMForwardScorer scorer
+ *		scorer.addModel(probabilities)		// for every model
+ *		FastaReader reader(fileName)
+ *		while (scorer.scoreNextRecord(reader, header)) {
+ *			scorer.logLikelihood(model)		// for every model
+ *			scorer.bestModel()
+ *		}
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMFORWARDSCORER_H
+#define HMMFORWARDSCORER_H
+#include "HMMProbabilities.h"
+#include "HMMTopology.h"
+#include "FastaReader.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+class HMMForwardScorer
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMForwardScorer();
+
+	// Destructor
+	// =============================================
+	~HMMForwardScorer();
+
+	// Public Class Attributes
+	// =============================================
+	static const size_t chunkLength;	// bases read from a FastaReader at a time
+
+	// Public Attributes
+	// =============================================
+	long numPositions;		// codons scored in the current sequence
+
+	// Public Methods
+	// =============================================
+
+	// int addModel(HMMProbabilities* probabilities)
+	//  Purpose:
+	//		Adds a model to score the sequences with and returns its index.
+	//		The tables of probabilities are copied into the scorer, so
+	//		probabilities is not used afterwards.
+	int addModel(HMMProbabilities* probabilities);
+
+	// beginSequence()
+	//  Purpose:
+	//		Starts scoring a new sequence with every model
+	void beginSequence();
+
+	// addBases(const char* bases, size_t length)
+	//  Purpose:
+	//		Adds the next length bases of the sequence.  Every base after the
+	//		second completes a codon and advances every model one position.
+	void addBases(const char* bases, size_t length);
+
+	// addCodon(uint8_t codon)
+	//  Purpose:
+	//		Advances every model one position emitting codon (a codon index,
+	//		see CodonUtilities)
+	void addCodon(uint8_t codon);
+
+	// bool scoreNextRecord(FastaReader& reader, string& header)
+	//  Purpose:
+	//		Scores the next record of reader with every model, reading its
+	//		sequence a chunk at a time.  Returns false when there are no more
+	//		records.
+	//  Postconditions:
+	//		header - set to the header of the record (without the '>')
+	bool scoreNextRecord(FastaReader& reader, string& header);
+
+	// double logLikelihood(int model)
+	//  Purpose:
+	//		Returns the log (base 2) likelihood of the sequence so far under
+	//		model (-infinity if the model can not generate it)
+	double logLikelihood(int model);
+
+	// int bestModel()
+	//  Purpose:
+	//		Returns the model with the highest log likelihood (the lowest
+	//		numbered one on ties, -1 without models)
+	int bestModel();
+
+	// Public Accessors
+	// =============================================
+	int getNumModels();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	struct Model {
+		int numStates;
+		HMMTopology topology;
+		vector<double> initiation;		// [state]
+		vector<double> emissions;		// [codon * numStates + state]
+		vector<double> columns;			// previous and current forward column
+		double logScaleSum;				// natural log of the likelihood so far
+		bool possible;					// false once a column summed to zero
+	};
+
+	vector<Model*> models;
+	uint8_t previousBases[2];		// 2 bit codes of the last two bases added
+	int numBases;					// bases added, up to 2
+
+	// Private Methods
+	// =============================================
+
+	// advance(Model* model, uint8_t codon)
+	//  Purpose:
+	//		Calculates the next forward column of model from its previous one
+	void advance(Model* model, uint8_t codon);
+
+	HMMForwardScorer(const HMMForwardScorer&);
+	HMMForwardScorer& operator=(const HMMForwardScorer&);
+};
+
+#endif // HMMFORWARDSCORER_H
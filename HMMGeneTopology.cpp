@@ -0,0 +1,54 @@
+/*
+ * HMMGeneTopology.cpp
+ *
+ *	This is the cpp file for the HMMGeneTopology description.
+ *  HMMGeneTopology is the compile time (constexpr) description of the 12
+ *  state gene finding model (and HMMSingleStrandTopology of its single
+ *  strand model).
+ *
+ *  See HMMGeneTopology.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+#include "HMMGeneTopology.h"
+
+// bool predecessorsAreArcs<Topology>(int state, int k, int count)
+//  Purpose:
+//		Returns true if every entry of the predecessor lists is an arc and
+//		the lists hold every arc
+template <class Topology>
+static constexpr bool predecessorsAreArcs(int state = 1, int k = 0, int count = 0) {
+	return (state == Topology::numStates)
+		? (count == Topology::numArcs)
+		: (k == Topology::numPredecessors[state])
+			? predecessorsAreArcs<Topology>(state + 1, 0, count)
+			: Topology::isArc(Topology::predecessors[state][k], state) &&
+			  (k == 0 || Topology::predecessors[state][k - 1] < Topology::predecessors[state][k]) &&
+			  predecessorsAreArcs<Topology>(state, k + 1, count + 1);
+}
+
+static_assert(predecessorsAreArcs<HMMGeneTopology>(), "HMMGeneTopology predecessor lists do not match its arcs");
+static_assert(predecessorsAreArcs<HMMSingleStrandTopology>(), "HMMSingleStrandTopology predecessor lists do not match its arcs");
+
+// const variable initialization
+// ==============================================
+constexpr int HMMGeneTopology::numStates;
+constexpr int HMMGeneTopology::initialState;
+constexpr int HMMGeneTopology::numArcs;
+constexpr int HMMGeneTopology::maxPredecessors;
+constexpr int HMMGeneTopology::arcStartStates[];
+constexpr int HMMGeneTopology::arcEndStates[];
+constexpr double HMMGeneTopology::arcProbabilities[];
+constexpr int HMMGeneTopology::numPredecessors[];
+constexpr int HMMGeneTopology::predecessors[][HMMGeneTopology::maxPredecessors];
+
+constexpr int HMMSingleStrandTopology::numStates;
+constexpr int HMMSingleStrandTopology::initialState;
+constexpr int HMMSingleStrandTopology::numArcs;
+constexpr int HMMSingleStrandTopology::maxPredecessors;
+constexpr int HMMSingleStrandTopology::arcStartStates[];
+constexpr int HMMSingleStrandTopology::arcEndStates[];
+constexpr int HMMSingleStrandTopology::numPredecessors[];
+constexpr int HMMSingleStrandTopology::predecessors[][HMMSingleStrandTopology::maxPredecessors];
+constexpr int HMMSingleStrandTopology::bottomStrandStates[];
@@ -0,0 +1,116 @@
+/*
+ * HMMGeneTopology.h
+ *
+ *	This is the header file for the HMMGeneTopology description.
+ *  HMMGeneTopology is the compile time (constexpr) description of the 12
+ *  state gene finding model built by HMMProbabilities::initialProbabilities:
+ *
+ *		0 - start state
+ *		1 - start codon (top strand)
+ *		2, 3, 4 - codon positions (top strand)
+ *		5 - stop codon (top strand)
+ *		6 - intergenic
+ *		7 - start codon (bottom strand, read backward)
+ *		8, 9, 10 - codon positions (bottom strand)
+ *		11 - stop codon (bottom strand, read backward)
+ *
+ *  The arcs (with their initial transition probabilities) and the same
+ *  arcs grouped by end state (predecessor lists in ascending order, as in
+ *  HMMTopology) are constant expressions, so they can be used as template
+ *  arguments to generate code specialized to the model (see
+ *  HMMUnrolledKernel).  Training only changes the probabilities of these
+ *  arcs, never the arcs themselves.
+ *
+ *  HMMSingleStrandTopology is the same description of the single strand
+ *  model used to decode each strand separately (see HMMStrandDecoder): the
+ *  top strand states 0 - 6 and their arcs.  A top strand gene found on the
+ *  reverse complement is a bottom strand gene of the forward sequence;
+ *  bottomStrandStates gives the bottom strand state each single strand
+ *  state becomes (the path is read in the opposite direction, so the codon
+ *  positions 3 and 4 swap places).
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMGENETOPOLOGY_H
+#define HMMGENETOPOLOGY_H
+
+struct HMMGeneTopology
+{
+	static constexpr int numStates = 12;
+	static constexpr int initialState = 6;		// the only state with an initiation probability
+	static constexpr int numArcs = 15;
+	static constexpr int maxPredecessors = 3;
+
+	// Arcs
+	static constexpr int arcStartStates[numArcs] = { 1, 2, 3, 4, 4, 5, 6, 6, 6, 7, 8, 9, 10, 10, 11 };
+	static constexpr int arcEndStates[numArcs] = { 3, 3, 4, 2, 5, 6, 1, 6, 11, 6, 9, 10, 7, 8, 9 };
+	static constexpr double arcProbabilities[numArcs] = {
+		1.0, 1.0, 1.0, 0.99, 0.01, 1.0, 0.1, 0.8, 0.1, 1.0, 1.0, 1.0, 0.01, 0.99, 1.0
+	};
+
+	// Arcs grouped by end state
+	static constexpr int numPredecessors[numStates] = { 0, 1, 1, 2, 1, 1, 3, 1, 1, 2, 1, 1 };
+	static constexpr int predecessors[numStates][maxPredecessors] = {
+		{ 0, 0, 0 },		// 0
+		{ 6, 0, 0 },		// 1
+		{ 4, 0, 0 },		// 2
+		{ 1, 2, 0 },		// 3
+		{ 3, 0, 0 },		// 4
+		{ 4, 0, 0 },		// 5
+		{ 5, 6, 7 },		// 6
+		{ 10, 0, 0 },		// 7
+		{ 10, 0, 0 },		// 8
+		{ 8, 11, 0 },		// 9
+		{ 9, 0, 0 },		// 10
+		{ 6, 0, 0 }			// 11
+	};
+
+	// bool isArc(int startState, int endState, int arc = 0)
+	//  Purpose:
+	//		Returns true if startState -> endState is one of the arcs
+	static constexpr bool isArc(int startState, int endState, int arc = 0) {
+		return (arc < numArcs) &&
+			((arcStartStates[arc] == startState && arcEndStates[arc] == endState) ||
+			 isArc(startState, endState, arc + 1));
+	}
+};
+
+struct HMMSingleStrandTopology
+{
+	static constexpr int numStates = 7;
+	static constexpr int initialState = 6;
+	static constexpr int numArcs = 8;
+	static constexpr int maxPredecessors = 2;
+
+	// Arcs
+	static constexpr int arcStartStates[numArcs] = { 1, 2, 3, 4, 4, 5, 6, 6 };
+	static constexpr int arcEndStates[numArcs] = { 3, 3, 4, 2, 5, 6, 1, 6 };
+
+	// Arcs grouped by end state
+	static constexpr int numPredecessors[numStates] = { 0, 1, 1, 2, 1, 1, 2 };
+	static constexpr int predecessors[numStates][maxPredecessors] = {
+		{ 0, 0 },		// 0
+		{ 6, 0 },		// 1
+		{ 4, 0 },		// 2
+		{ 1, 2 },		// 3
+		{ 3, 0 },		// 4
+		{ 4, 0 },		// 5
+		{ 5, 6 }		// 6
+	};
+
+	// Bottom strand state of the 12 state gene model for every state
+	static constexpr int bottomStrandStates[numStates] = { 0, 7, 8, 10, 9, 11, 6 };
+
+	// bool isArc(int startState, int endState, int arc = 0)
+	//  Purpose:
+	//		Returns true if startState -> endState is one of the arcs
+	static constexpr bool isArc(int startState, int endState, int arc = 0) {
+		return (arc < numArcs) &&
+			((arcStartStates[arc] == startState && arcEndStates[arc] == endState) ||
+			 isArc(startState, endState, arc + 1));
+	}
+};
+
+#endif // HMMGENETOPOLOGY_H
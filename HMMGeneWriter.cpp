@@ -0,0 +1,321 @@
+/*
+ * HMMGeneWriter.cpp
+ *
+ *	This is the cpp file for the HMMGeneWriter object. HMMGeneWriter
+ *  streams gene calls (and optionally the viterbi scores) to a file
+ *  descriptor as they are produced.
+ *
+ *  See HMMGeneWriter.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMGeneWriter.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+// const variable initialization
+// ==============================================
+const size_t HMMGeneWriter::bufferSize = 64 * 1024;
+
+// Constuctors
+// ==============================================
+HMMGeneWriter::HMMGeneWriter(int aFileDescriptor, Format aFormat) {
+	fileDescriptor = aFileDescriptor;
+	ownsFileDescriptor = false;
+	format = aFormat;
+	initialize();
+}
+
+HMMGeneWriter::HMMGeneWriter(string fileName, Format aFormat) {
+	fileDescriptor = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fileDescriptor < 0)
+		throw runtime_error("Unable to create output file: " + fileName);
+
+	ownsFileDescriptor = true;
+	format = aFormat;
+	initialize();
+}
+
+// Destructor
+// =============================================
+HMMGeneWriter::~HMMGeneWriter() {
+	try {
+		flush();
+	}
+	catch (exception&) {
+		// Nothing can be reported from a destructor, call flush() first to
+		// find out whether everything was written
+	}
+
+	if (ownsFileDescriptor)
+		close(fileDescriptor);
+}
+
+// Public Class Methods
+// =============================================
+
+// Format parseFormat(string name)
+//  Purpose:
+//		Returns the format named name ("xml", "gff3" or "bed").  Throws an
+//		invalid_argument exception for any other name.
+HMMGeneWriter::Format HMMGeneWriter::parseFormat(string name) {
+	if (name == "xml")
+		return xmlFormat;
+	if (name == "gff3" || name == "gff")
+		return gff3Format;
+	if (name == "bed")
+		return bedFormat;
+
+	throw invalid_argument("Unknown output format: " + name);
+}
+
+// Public Methods
+// =============================================
+
+// beginSequence(const string& name, const string& modelName)
+//  Purpose:
+//		Starts the records of the sequence name.  modelName (may be empty)
+//		is written as the model of the xml result and the source of the
+//		gff3 features.
+void HMMGeneWriter::beginSequence(const string& name, const string& modelName) {
+	sequenceName = name;
+	sequenceModelName = modelName;
+	sequenceGeneCount = 0;
+	geneListOpen = false;
+	geneListWritten = false;
+
+	switch (format) {
+	case xmlFormat:
+		append("    <result type=\"sequence\" name=\"");
+		append(name);
+		if (!modelName.empty()) {
+			append("\" model=\"");
+			append(modelName);
+		}
+		append("\">\n");
+		break;
+
+	case gff3Format:
+		if (!headerWritten) {
+			append("##gff-version 3\n");
+			headerWritten = true;
+		}
+		break;
+
+	case bedFormat:
+		break;
+	}
+}
+
+// writeGene(int start, int end, bool isTopStrand)
+//  Purpose:
+//		Writes one gene of the current sequence
+void HMMGeneWriter::writeGene(int start, int end, bool isTopStrand) {
+	sequenceGeneCount++;
+
+	switch (format) {
+	case xmlFormat:
+		if (!geneListOpen) {
+			append("    <result type=\"gene_list\">");
+			geneListOpen = true;
+			geneListWritten = true;
+		}
+		append("(");
+		append((long) start);
+		append(",");
+		append((long) end);
+		append(isTopStrand ? ",top)," : ",bottom),");
+		if (sequenceGeneCount % 5 == 0)
+			append("\n");
+		break;
+
+	case gff3Format:
+		append(sequenceName);
+		append("\t");
+		append(sequenceModelName.empty() ? "hmm" : sequenceModelName);
+		append("\tgene\t");
+		append((long) start);
+		append("\t");
+		append((long) end);
+		append(isTopStrand ? "\t.\t+\t.\tID=" : "\t.\t-\t.\tID=");
+		append(sequenceName);
+		append(".gene");
+		append((long) sequenceGeneCount);
+		append("\n");
+		break;
+
+	case bedFormat:
+		append(sequenceName);
+		append("\t");
+		append((long) start - 1);
+		append("\t");
+		append((long) end);
+		append("\t");
+		append(sequenceName);
+		append(".gene");
+		append((long) sequenceGeneCount);
+		append(isTopStrand ? "\t0\t+\n" : "\t0\t-\n");
+		break;
+	}
+}
+
+// writeGenes(HMMViterbiResults* results)
+//  Purpose:
+//		Writes every gene of results in increasing order
+void HMMGeneWriter::writeGenes(HMMViterbiResults* results) {
+	for (HMMViterbiResults::Gene* gene : results->genes)
+		writeGene(gene->start, gene->end, gene->isTopStrand);
+}
+
+// writeScores(int position, const double* weights, int numberOfStates)
+//  Purpose:
+//		Writes the viterbi weights of states 0..numberOfStates-1 at
+//		position (only state 0 at position 0)
+void HMMGeneWriter::writeScores(int position, const double* weights, int numberOfStates) {
+	int firstState = (position == 0) ? 0 : 1;
+	int lastState = (position == 0) ? 0 : numberOfStates - 1;
+
+	if (format == xmlFormat) {
+		if (geneListOpen) {
+			append("</result>\n");
+			geneListOpen = false;
+		}
+		append("Position: ");
+		append((long) position);
+		append("\n");
+		for (int state = firstState; state <= lastState; state++) {
+			append("  Node: (");
+			append((long) state);
+			append(", ");
+			append(weights[state]);
+			append(")\n");
+		}
+		return;
+	}
+
+	append("#score\t");
+	append(sequenceName);
+	append("\t");
+	append((long) position);
+	for (int state = firstState; state <= lastState; state++) {
+		append("\t");
+		append(weights[state]);
+	}
+	append("\n");
+}
+
+// endSequence()
+//  Purpose:
+//		Ends the records of the current sequence
+void HMMGeneWriter::endSequence() {
+	if (format != xmlFormat)
+		return;
+
+	if (geneListOpen)
+		append("</result>\n");
+	else if (!geneListWritten)
+		append("    <result type=\"gene_list\"></result>\n");
+	append("    </result>\n");
+	geneListOpen = false;
+}
+
+// writeError(const string& name, const string& message)
+//  Purpose:
+//		Writes that the sequence name could not be annotated
+void HMMGeneWriter::writeError(const string& name, const string& message) {
+	if (format == xmlFormat) {
+		append("    <result type=\"error\" name=\"");
+		append(name);
+		append("\">");
+		append(message);
+		append("</result>\n");
+	}
+	else {
+		append("#error\t");
+		append(name);
+		append("\t");
+		append(message);
+		append("\n");
+	}
+}
+
+// flush()
+//  Purpose:
+//		Writes out everything buffered so far
+void HMMGeneWriter::flush() {
+	size_t written = 0;
+	while (written < bufferLength) {
+		ssize_t count = write(fileDescriptor, &buffer[written], bufferLength - written);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0) {
+			bufferLength = 0;
+			throw runtime_error("Unable to write output: " + string(strerror(errno)));
+		}
+		written += count;
+	}
+	bufferLength = 0;
+}
+
+// Public Accessors
+// =============================================
+HMMGeneWriter::Format HMMGeneWriter::getFormat() {
+	return format;
+}
+
+// Private Methods
+// =============================================
+
+// initialize()
+//  Purpose:
+//		Sets up the buffer and the record state
+void HMMGeneWriter::initialize() {
+	buffer.resize(bufferSize);
+	bufferLength = 0;
+	headerWritten = false;
+	sequenceGeneCount = 0;
+	geneListOpen = false;
+	geneListWritten = false;
+}
+
+// append(const char* text, size_t length)
+//  Purpose:
+//		Appends text to the buffer, writing the buffer out when it fills
+void HMMGeneWriter::append(const char* text, size_t length) {
+	while (length > 0) {
+		if (bufferLength == buffer.size())
+			flush();
+
+		size_t count = min(length, buffer.size() - bufferLength);
+		memcpy(&buffer[bufferLength], text, count);
+		bufferLength += count;
+		text += count;
+		length -= count;
+	}
+}
+
+void HMMGeneWriter::append(const string& text) {
+	append(text.data(), text.length());
+}
+
+void HMMGeneWriter::append(const char* text) {
+	append(text, strlen(text));
+}
+
+void HMMGeneWriter::append(long value) {
+	char digits[24];
+	append(digits, snprintf(digits, sizeof(digits), "%ld", value));
+}
+
+void HMMGeneWriter::append(double value) {
+	// Same as the default precision of a stringstream
+	char digits[32];
+	append(digits, snprintf(digits, sizeof(digits), "%g", value));
+}
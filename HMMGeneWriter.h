@@ -0,0 +1,159 @@
+/*
+ * HMMGeneWriter.h
+ *
+ *	This is the header file for the HMMGeneWriter object. HMMGeneWriter
+ *  streams gene calls (and optionally the viterbi score of every state at
+ *  every position) to a file descriptor as they are produced instead of
+ *  building the whole output as one string.  Records are encoded straight
+ *  into a fixed size buffer that is written out whenever it fills, so the
+ *  memory used does not grow with the size of the output.
+ *
+ *  Formats:
+ *		xmlFormat - the format of HMMViterbiResults::geneResultsString
+ *					wrapped in a sequence result:
+ *						<result type="sequence" name="<<name>>">
+ *						<result type="gene_list">(start,end,strand),...</result>
+ *						</result>
+ *		gff3Format - one "gene" feature per gene (1 based, end inclusive)
+ *					 with the ID <<name>>.gene<<n>>
+ *		bedFormat - one 6 column line per gene (0 based start, end
+ *					exclusive) named <<name>>.gene<<n>>
+ *
+ *  Gene positions are those of HMMViterbiResults::Gene (the end is the
+ *  last base of the stop codon) and are expected in increasing order of
+ *  their starts.  Scores are written in the layout of
+ *  HiddenMarkovModel::allScoresResultsString in xml and as
+ *  "#score <<name>> <<position>> <<weights>>" comment lines otherwise.
+ *
+ *  Typical use would be:
+ *
+ *		HMMGeneWriter writer(STDOUT_FILENO, HMMGeneWriter::gff3Format)
+ *		writer.beginSequence(name, modelName)
+ *		writer.writeGene(start, end, isTopStrand)
+ *		...
+ *		writer.endSequence()
+ *		writer.flush()
+ *
+ *  A runtime_error is thrown if the output can not be opened or written.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMGENEWRITER_H
+#define HMMGENEWRITER_H
+#include "HMMViterbiResults.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+class HMMGeneWriter
+{
+public:
+	enum Format { xmlFormat, gff3Format, bedFormat };
+
+	// Constuctors
+	// ==============================================
+	HMMGeneWriter(int aFileDescriptor, Format aFormat);		// not closed by the writer
+	HMMGeneWriter(string fileName, Format aFormat);
+
+	// Destructor
+	// =============================================
+	~HMMGeneWriter();
+
+	// Public Class Attributes
+	// =============================================
+	static const size_t bufferSize;
+
+	// Public Class Methods
+	// =============================================
+
+	// Format parseFormat(string name)
+	//  Purpose:
+	//		Returns the format named name ("xml", "gff3" or "bed").  Throws an
+	//		invalid_argument exception for any other name.
+	static Format parseFormat(string name);
+
+	// Public Methods
+	// =============================================
+
+	// beginSequence(const string& name, const string& modelName)
+	//  Purpose:
+	//		Starts the records of the sequence name.  modelName (may be empty)
+	//		is written as the model of the xml result and the source of the
+	//		gff3 features.
+	void beginSequence(const string& name, const string& modelName);
+
+	// writeGene(int start, int end, bool isTopStrand)
+	//  Purpose:
+	//		Writes one gene of the current sequence
+	void writeGene(int start, int end, bool isTopStrand);
+
+	// writeGenes(HMMViterbiResults* results)
+	//  Purpose:
+	//		Writes every gene of results in increasing order
+	void writeGenes(HMMViterbiResults* results);
+
+	// writeScores(int position, const double* weights, int numberOfStates)
+	//  Purpose:
+	//		Writes the viterbi weights of states 0..numberOfStates-1 at
+	//		position (only state 0 at position 0)
+	void writeScores(int position, const double* weights, int numberOfStates);
+
+	// endSequence()
+	//  Purpose:
+	//		Ends the records of the current sequence
+	void endSequence();
+
+	// writeError(const string& name, const string& message)
+	//  Purpose:
+	//		Writes that the sequence name could not be annotated
+	void writeError(const string& name, const string& message);
+
+	// flush()
+	//  Purpose:
+	//		Writes out everything buffered so far
+	void flush();
+
+	// Public Accessors
+	// =============================================
+	Format getFormat();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	int fileDescriptor;
+	bool ownsFileDescriptor;
+	Format format;
+	vector<char> buffer;
+	size_t bufferLength;
+	bool headerWritten;			// gff3 version line
+	string sequenceName;
+	string sequenceModelName;
+	int sequenceGeneCount;
+	bool geneListOpen;			// xml gene list of the current sequence
+	bool geneListWritten;
+
+	// Private Methods
+	// =============================================
+
+	// initialize()
+	//  Purpose:
+	//		Sets up the buffer and the record state
+	void initialize();
+
+	// append(const char* text, size_t length)
+	//  Purpose:
+	//		Appends text to the buffer, writing the buffer out when it fills
+	void append(const char* text, size_t length);
+	void append(const string& text);
+	void append(const char* text);
+	void append(long value);
+	void append(double value);
+
+	HMMGeneWriter(const HMMGeneWriter&);
+	HMMGeneWriter& operator=(const HMMGeneWriter&);
+};
+
+#endif // HMMGENEWRITER_H
@@ -0,0 +1,367 @@
+/*
+ * HMMInstrumentation.cpp
+ *
+ *	This is the cpp file for the HMMInstrumentation object.
+ *  HMMInstrumentation collects the per phase timers and counters of a
+ *  run.
+ *
+ *  See HMMInstrumentation.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMInstrumentation.h"
+#include <atomic>
+#include <sstream>
+#include <fstream>
+#include <cstdlib>
+#include <new>
+#include <limits>
+#include <sys/resource.h>
+
+// Totals
+// =============================================
+static atomic<long> timerNanoseconds[HMMInstrumentation::numTimers];
+static atomic<long> timerCallCounts[HMMInstrumentation::numTimers];
+static atomic<long> counterValues[HMMInstrumentation::numCounters];
+
+// Allocation counting
+// =============================================
+static atomic<long> instrumentationAllocations(0);
+static atomic<long> instrumentationAllocatedBytes(0);
+
+// Highest resident set size reported so far
+// =============================================
+static atomic<long> highestResidentKilobytes(0);
+
+// The global allocation functions are only replaced in instrumented
+// builds, so a program linking the library otherwise allocates through
+// the standard ones at no extra cost.  Every form of new is counted and
+// every form of delete is replaced with it, so memory from one pair is
+// never released by the other (C++11 has no aligned forms).
+#ifdef HMM_INSTRUMENTATION
+static void* countedAllocation(size_t size) {
+	instrumentationAllocations.fetch_add(1, memory_order_relaxed);
+	instrumentationAllocatedBytes.fetch_add(size, memory_order_relaxed);
+	return malloc(size > 0 ? size : 1);
+}
+
+void* operator new(size_t size) {
+	void* memory = countedAllocation(size);
+	if (memory == NULL)
+		throw bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size) {
+	void* memory = countedAllocation(size);
+	if (memory == NULL)
+		throw bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+	return countedAllocation(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+	return countedAllocation(size);
+}
+
+void operator delete(void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete(void* memory, const nothrow_t&) noexcept {
+	free(memory);
+}
+
+void operator delete[](void* memory, const nothrow_t&) noexcept {
+	free(memory);
+}
+#endif
+
+// Public Class Methods
+// =============================================
+
+// bool isEnabled()
+//  Purpose:
+//		Returns true if the instrumentation was compiled in
+//		(HMM_INSTRUMENTATION)
+bool HMMInstrumentation::isEnabled() {
+#ifdef HMM_INSTRUMENTATION
+	return true;
+#else
+	return false;
+#endif
+}
+
+// addTime(Timer timer, long nanoseconds)
+//  Purpose:
+//		Adds one call taking nanoseconds to timer
+void HMMInstrumentation::addTime(Timer timer, long nanoseconds) {
+	timerNanoseconds[timer].fetch_add(nanoseconds, memory_order_relaxed);
+	timerCallCounts[timer].fetch_add(1, memory_order_relaxed);
+}
+
+// addCount(Counter counter, long value)
+//  Purpose:
+//		Adds value to counter
+void HMMInstrumentation::addCount(Counter counter, long value) {
+	counterValues[counter].fetch_add(value, memory_order_relaxed);
+}
+
+// double timerSeconds(Timer timer)
+// long timerCalls(Timer timer)
+// long counterValue(Counter counter)
+//  Purpose:
+//		Return the totals collected so far
+double HMMInstrumentation::timerSeconds(Timer timer) {
+	return timerNanoseconds[timer].load(memory_order_relaxed) / 1e9;
+}
+
+long HMMInstrumentation::timerCalls(Timer timer) {
+	return timerCallCounts[timer].load(memory_order_relaxed);
+}
+
+long HMMInstrumentation::counterValue(Counter counter) {
+	return counterValues[counter].load(memory_order_relaxed);
+}
+
+// string timerName(Timer timer)
+// string counterName(Counter counter)
+//  Purpose:
+//		Return the name timer or counter is exported under (e.g.,
+//		"fasta_load", "arcs_evaluated")
+string HMMInstrumentation::timerName(Timer timer) {
+	switch (timer) {
+	case fastaLoadTimer:		return "fasta_load";
+	case modelBuildTimer:		return "model_build";
+	case viterbiTimer:			return "viterbi";
+	case forwardTimer:			return "forward";
+	case backwardTimer:			return "backward";
+	case tracebackTimer:		return "traceback";
+	case expectedCountsTimer:	return "expected_counts";
+	case reestimationTimer:		return "reestimation";
+	default:					return "unknown";
+	}
+}
+
+string HMMInstrumentation::counterName(Counter counter) {
+	switch (counter) {
+	case arcsEvaluatedCounter:	return "arcs_evaluated";
+	case nanPrunedArcsCounter:	return "nan_pruned_arcs";
+	case positionsCounter:		return "positions";
+	case orfPrunedCellsCounter:	return "orf_pruned_cells";
+	default:					return "unknown";
+	}
+}
+
+// reset()
+//  Purpose:
+//		Sets every timer and counter (not the allocation counts) to zero
+void HMMInstrumentation::reset() {
+	for (int timer = 0; timer < numTimers; timer++) {
+		timerNanoseconds[timer].store(0, memory_order_relaxed);
+		timerCallCounts[timer].store(0, memory_order_relaxed);
+	}
+	for (int counter = 0; counter < numCounters; counter++)
+		counterValues[counter].store(0, memory_order_relaxed);
+}
+
+// long allocationCount()
+//  Purpose:
+//		Returns the number of calls to the global operator new so far
+//		(0 without HMM_INSTRUMENTATION)
+long HMMInstrumentation::allocationCount() {
+	return instrumentationAllocations.load(memory_order_relaxed);
+}
+
+// long allocatedBytes()
+//  Purpose:
+//		Returns the number of bytes requested from the global operator
+//		new so far
+long HMMInstrumentation::allocatedBytes() {
+	return instrumentationAllocatedBytes.load(memory_order_relaxed);
+}
+
+// long residentKilobytes()
+//  Purpose:
+//		Returns the current resident set size of the process (0 if it
+//		can not be read)
+long HMMInstrumentation::residentKilobytes() {
+	long kilobytes = processStatusKilobytes("VmRSS:");
+	notePeakResident(kilobytes);
+	return kilobytes;
+}
+
+// long peakResidentKilobytes()
+//  Purpose:
+//		Returns the peak resident set size of the process (from the same
+//		source as residentKilobytes and never below a size it returned)
+long HMMInstrumentation::peakResidentKilobytes() {
+	long kilobytes = processStatusKilobytes("VmHWM:");
+	if (kilobytes == 0) {
+		// No /proc, the kernel's own peak
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		kilobytes = usage.ru_maxrss;
+	}
+
+	// The kernel updates its high water mark lazily, so it can lag a
+	// current size read before it
+	notePeakResident(kilobytes);
+	return highestResidentKilobytes.load(memory_order_relaxed);
+}
+
+// string jsonResultsString()
+//  Purpose:
+//		Returns the metrics as one JSON object
+//
+//		format:
+//			{"instrumentation":<<true|false>>,
+//			 "timers":{"<<timer>>":{"calls":<<calls>>,"seconds":<<seconds>>},...},
+//			 "counters":{"<<counter>>":<<value>>,...},
+//			 "allocations":<<allocations>>,"allocated_bytes":<<bytes>>,
+//			 "resident_bytes":<<bytes>>,"peak_resident_bytes":<<bytes>>}
+//
+//		The allocations are only counted in an instrumented build, they
+//		are null otherwise.
+string HMMInstrumentation::jsonResultsString() {
+	long residentBytes = residentKilobytes() * 1024;
+	long peakResidentBytes = peakResidentKilobytes() * 1024;
+	stringstream ss;
+
+	ss << "{\"instrumentation\":" << (isEnabled() ? "true" : "false");
+
+	ss << ",\"timers\":{";
+	for (int timer = 0; timer < numTimers; timer++) {
+		ss << ((timer > 0) ? "," : "")
+			<< "\"" << timerName((Timer) timer) << "\":{"
+			<< "\"calls\":" << timerCalls((Timer) timer)
+			<< ",\"seconds\":" << timerSeconds((Timer) timer) << "}";
+	}
+	ss << "}";
+
+	ss << ",\"counters\":{";
+	for (int counter = 0; counter < numCounters; counter++) {
+		ss << ((counter > 0) ? "," : "")
+			<< "\"" << counterName((Counter) counter) << "\":" << counterValue((Counter) counter);
+	}
+	ss << "}";
+
+	if (isEnabled())
+		ss << ",\"allocations\":" << allocationCount() << ",\"allocated_bytes\":" << allocatedBytes();
+	else
+		ss << ",\"allocations\":null,\"allocated_bytes\":null";
+	ss << ",\"resident_bytes\":" << residentBytes
+		<< ",\"peak_resident_bytes\":" << peakResidentBytes
+		<< "}\n";
+
+	return ss.str();
+}
+
+// string prometheusResultsString()
+//  Purpose:
+//		Returns the metrics in the Prometheus text exposition format
+//
+//		format:
+//			hmm_phase_seconds_total{phase="<<timer>>"} <<seconds>>
+//			hmm_phase_calls_total{phase="<<timer>>"} <<calls>>
+//			hmm_<<counter>>_total <<value>>
+//			hmm_allocations_total <<allocations>>
+//			hmm_allocated_bytes_total <<bytes>>
+//			hmm_resident_bytes <<bytes>>
+//			hmm_peak_resident_bytes <<bytes>>
+//
+//		The allocations are only counted in an instrumented build, they
+//		are left out otherwise.
+string HMMInstrumentation::prometheusResultsString() {
+	long residentBytes = residentKilobytes() * 1024;
+	long peakResidentBytes = peakResidentKilobytes() * 1024;
+	stringstream ss;
+
+	ss << "# HELP hmm_phase_seconds_total Time spent in each phase.\n"
+		<< "# TYPE hmm_phase_seconds_total counter\n";
+	for (int timer = 0; timer < numTimers; timer++)
+		ss << "hmm_phase_seconds_total{phase=\"" << timerName((Timer) timer) << "\"} " << timerSeconds((Timer) timer) << "\n";
+
+	ss << "# HELP hmm_phase_calls_total Number of times each phase ran.\n"
+		<< "# TYPE hmm_phase_calls_total counter\n";
+	for (int timer = 0; timer < numTimers; timer++)
+		ss << "hmm_phase_calls_total{phase=\"" << timerName((Timer) timer) << "\"} " << timerCalls((Timer) timer) << "\n";
+
+	for (int counter = 0; counter < numCounters; counter++) {
+		string name = "hmm_" + counterName((Counter) counter) + "_total";
+		ss << "# TYPE " << name << " counter\n"
+			<< name << " " << counterValue((Counter) counter) << "\n";
+	}
+
+	if (isEnabled()) {
+		ss << "# TYPE hmm_allocations_total counter\n"
+			<< "hmm_allocations_total " << allocationCount() << "\n"
+			<< "# TYPE hmm_allocated_bytes_total counter\n"
+			<< "hmm_allocated_bytes_total " << allocatedBytes() << "\n";
+	}
+	ss << "# TYPE hmm_resident_bytes gauge\n"
+		<< "hmm_resident_bytes " << residentBytes << "\n"
+		<< "# TYPE hmm_peak_resident_bytes gauge\n"
+		<< "hmm_peak_resident_bytes " << peakResidentBytes << "\n";
+
+	return ss.str();
+}
+
+// Private Class Methods
+// =============================================
+
+// long processStatusKilobytes(const string& field)
+//  Purpose:
+//		Returns the value in kB of field (e.g., "VmRSS:") of
+//		/proc/self/status, or 0 if it can not be read.  The current and
+//		the peak resident set size are both read from there, so they are
+//		counted the same way and the peak is never below the current size.
+long HMMInstrumentation::processStatusKilobytes(const string& field) {
+	ifstream status("/proc/self/status");
+	string name;
+	while (status >> name) {
+		if (name == field) {
+			long kilobytes = 0;
+			status >> kilobytes;
+			return kilobytes;
+		}
+		status.ignore(numeric_limits<streamsize>::max(), '\n');
+	}
+
+	return 0;
+}
+
+// notePeakResident(long kilobytes)
+//  Purpose:
+//		Raises the highest resident set size reported so far to kilobytes
+void HMMInstrumentation::notePeakResident(long kilobytes) {
+	long highest = highestResidentKilobytes.load(memory_order_relaxed);
+	while (kilobytes > highest && !highestResidentKilobytes.compare_exchange_weak(highest, kilobytes, memory_order_relaxed)) {
+	}
+}
+
+// HMMScopedTimer
+// =============================================
+
+// Constuctors
+// ==============================================
+HMMScopedTimer::HMMScopedTimer(HMMInstrumentation::Timer aTimer) {
+	timer = aTimer;
+	start = chrono::steady_clock::now();
+}
+
+// Destructor
+// =============================================
+HMMScopedTimer::~HMMScopedTimer() {
+	long nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+	HMMInstrumentation::addTime(timer, nanoseconds);
+}
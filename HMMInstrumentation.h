@@ -0,0 +1,229 @@
+/*
+ * HMMInstrumentation.h
+ *
+ *	This is the header file for the HMMInstrumentation object.
+ *  HMMInstrumentation collects the time spent in every phase of a
+ *  training or annotation run (FASTA load, model build, the viterbi,
+ *  forward and backward passes, traceback, expected counts and
+ *  probability re-estimation) and counters of the work done in them, so
+ *  production runs can show where their time goes.
+ *
+ *  The hot paths are instrumented through macros that only compile to
+ *  code when HMM_INSTRUMENTATION is defined (e.g., -DHMM_INSTRUMENTATION):
+ *
+ *		HMM_SCOPED_TIMER(timer) - adds the time until the end of the
+ *								  enclosing scope to timer (one call)
+ *		HMM_COUNT(counter, value) - adds value to counter
+ *		HMM_INSTRUMENT(statement) - statement (e.g., a call that calculates
+ *								    a counter)
+ *
+ *  Without HMM_INSTRUMENTATION the macros expand to nothing (the values
+ *  are not evaluated), so the instrumentation costs nothing and the
+ *  timers and counters stay at zero.  The timers and counters are atomic
+ *  so the threads of HMMThreadPool add to the same totals.
+ *
+ *  Instrumented builds also replace the global operator new and delete
+ *  (every form) to count the allocations made through them (HMMBenchmark
+ *  reports them as well); without HMM_INSTRUMENTATION the standard ones
+ *  are used, nothing is counted and the exporters write the allocations
+ *  as null (JSON) or leave them out (Prometheus).  The resident set
+ *  size is read from the process when the metrics are exported.
+ *
+ *  Counters:
+ *		arcs_evaluated - legal arcs visited by the viterbi, forward and
+ *						 backward passes (positions * arcs per pass)
+ *		nan_pruned_arcs - the arcs among them into a state that can not
+ *						  emit the codon at that position (log zero, NaN),
+ *						  which every backend discards
+ *		positions - positions calculated by the viterbi passes
+ *		orf_pruned_cells - coding state positions ruled out by the ORF index
+ *						   (see HMMOrfIndex) for the passes that use it
+ *
+ *  The metrics are exported as JSON (jsonResultsString) or in the
+ *  Prometheus text format (prometheusResultsString).
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMINSTRUMENTATION_H
+#define HMMINSTRUMENTATION_H
+#include <string>
+#include <chrono>
+using namespace std;
+
+class HMMInstrumentation
+{
+public:
+	enum Timer {
+		fastaLoadTimer,
+		modelBuildTimer,
+		viterbiTimer,
+		forwardTimer,
+		backwardTimer,
+		tracebackTimer,
+		expectedCountsTimer,
+		reestimationTimer,
+		numTimers
+	};
+
+	enum Counter {
+		arcsEvaluatedCounter,
+		nanPrunedArcsCounter,
+		positionsCounter,
+		orfPrunedCellsCounter,
+		numCounters
+	};
+
+	// Public Class Methods
+	// =============================================
+
+	// bool isEnabled()
+	//  Purpose:
+	//		Returns true if the instrumentation was compiled in
+	//		(HMM_INSTRUMENTATION)
+	static bool isEnabled();
+
+	// addTime(Timer timer, long nanoseconds)
+	//  Purpose:
+	//		Adds one call taking nanoseconds to timer
+	static void addTime(Timer timer, long nanoseconds);
+
+	// addCount(Counter counter, long value)
+	//  Purpose:
+	//		Adds value to counter
+	static void addCount(Counter counter, long value);
+
+	// double timerSeconds(Timer timer)
+	// long timerCalls(Timer timer)
+	// long counterValue(Counter counter)
+	//  Purpose:
+	//		Return the totals collected so far
+	static double timerSeconds(Timer timer);
+	static long timerCalls(Timer timer);
+	static long counterValue(Counter counter);
+
+	// string timerName(Timer timer)
+	// string counterName(Counter counter)
+	//  Purpose:
+	//		Return the name timer or counter is exported under (e.g.,
+	//		"fasta_load", "arcs_evaluated")
+	static string timerName(Timer timer);
+	static string counterName(Counter counter);
+
+	// reset()
+	//  Purpose:
+	//		Sets every timer and counter (not the allocation counts) to zero
+	static void reset();
+
+	// long allocationCount()
+	//  Purpose:
+	//		Returns the number of calls to the global operator new so far
+	//		(0 without HMM_INSTRUMENTATION)
+	static long allocationCount();
+
+	// long allocatedBytes()
+	//  Purpose:
+	//		Returns the number of bytes requested from the global operator
+	//		new so far
+	static long allocatedBytes();
+
+	// long residentKilobytes()
+	//  Purpose:
+	//		Returns the current resident set size of the process (0 if it
+	//		can not be read)
+	static long residentKilobytes();
+
+	// long peakResidentKilobytes()
+	//  Purpose:
+	//		Returns the peak resident set size of the process (from the same
+	//		source as residentKilobytes and never below a size it returned)
+	static long peakResidentKilobytes();
+
+	// string jsonResultsString()
+	//  Purpose:
+	//		Returns the metrics as one JSON object
+	//
+	//		format:
+	//			{"instrumentation":<<true|false>>,
+	//			 "timers":{"<<timer>>":{"calls":<<calls>>,"seconds":<<seconds>>},...},
+	//			 "counters":{"<<counter>>":<<value>>,...},
+	//			 "allocations":<<allocations>>,"allocated_bytes":<<bytes>>,
+	//			 "resident_bytes":<<bytes>>,"peak_resident_bytes":<<bytes>>}
+	//
+	//		The allocations are only counted in an instrumented build, they
+	//		are null otherwise.
+	static string jsonResultsString();
+
+	// string prometheusResultsString()
+	//  Purpose:
+	//		Returns the metrics in the Prometheus text exposition format
+	//
+	//		format:
+	//			hmm_phase_seconds_total{phase="<<timer>>"} <<seconds>>
+	//			hmm_phase_calls_total{phase="<<timer>>"} <<calls>>
+	//			hmm_<<counter>>_total <<value>>
+	//			hmm_allocations_total <<allocations>>
+	//			hmm_allocated_bytes_total <<bytes>>
+	//			hmm_resident_bytes <<bytes>>
+	//			hmm_peak_resident_bytes <<bytes>>
+	//
+	//		The allocations are only counted in an instrumented build, they
+	//		are left out otherwise.
+	static string prometheusResultsString();
+
+private:
+
+	// Private Class Methods
+	// =============================================
+
+	// long processStatusKilobytes(const string& field)
+	//  Purpose:
+	//		Returns the value in kB of field (e.g., "VmRSS:") of
+	//		/proc/self/status, or 0 if it can not be read
+	static long processStatusKilobytes(const string& field);
+
+	// notePeakResident(long kilobytes)
+	//  Purpose:
+	//		Raises the highest resident set size reported so far to kilobytes
+	static void notePeakResident(long kilobytes);
+};
+
+class HMMScopedTimer
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMScopedTimer(HMMInstrumentation::Timer aTimer);
+
+	// Destructor
+	// =============================================
+	~HMMScopedTimer();		// adds the time since construction to the timer
+
+private:
+
+	// Private Attributes
+	// =============================================
+	HMMInstrumentation::Timer timer;
+	chrono::steady_clock::time_point start;
+
+	HMMScopedTimer(const HMMScopedTimer&);
+	HMMScopedTimer& operator=(const HMMScopedTimer&);
+};
+
+#define HMM_INSTRUMENTATION_CONCATENATE_NAME(name, line) name##line
+#define HMM_INSTRUMENTATION_NAME(name, line) HMM_INSTRUMENTATION_CONCATENATE_NAME(name, line)
+
+#ifdef HMM_INSTRUMENTATION
+#define HMM_SCOPED_TIMER(timer) \
+	HMMScopedTimer HMM_INSTRUMENTATION_NAME(hmmScopedTimer, __LINE__)(HMMInstrumentation::timer)
+#define HMM_COUNT(counter, value) \
+	HMMInstrumentation::addCount(HMMInstrumentation::counter, (value))
+#define HMM_INSTRUMENT(statement) statement
+#else
+#define HMM_SCOPED_TIMER(timer)
+#define HMM_COUNT(counter, value)
+#define HMM_INSTRUMENT(statement)
+#endif
+
+#endif // HMMINSTRUMENTATION_H
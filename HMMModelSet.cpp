@@ -0,0 +1,130 @@
+/*
+ * HMMModelSet.cpp
+ *
+ *	This is the cpp file for the HMMModelSet object.  HMMModelSet keeps
+ *  the trained models of an annotation run under their names and
+ *  annotates one Fasta record at a time with them.
+ *
+ *  See HMMModelSet.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMModelSet.h"
+#include "HiddenMarkovModel.h"
+#include "CodonUtilities.h"
+#include <sstream>
+#include <stdexcept>
+
+// Constuctors
+// ==============================================
+HMMModelSet::HMMModelSet() {
+}
+
+// Destructor
+// =============================================
+HMMModelSet::~HMMModelSet() {
+	for (HMMProbabilities* probabilities : models)
+		delete probabilities;
+}
+
+// Public Class Methods
+// =============================================
+
+// parseHeader(const string& header, Record& record)
+//  Purpose:
+//		Sets the name and the model name of record from a Fasta header
+void HMMModelSet::parseHeader(const string& header, Record& record) {
+	stringstream ss(header);
+	string word;
+
+	ss >> record.name;
+	while (ss >> word) {
+		if (word.compare(0, 6, "model=") == 0)
+			record.modelName = word.substr(6);
+	}
+}
+
+// Public Methods
+// =============================================
+
+// addModel(string name, HMMProbabilities* someProbabilities)
+//  Purpose:
+//		Keeps a copy of someProbabilities under name.  The first model
+//		added is used for records that do not name one.  Throws an
+//		invalid_argument exception if name has already been added.
+void HMMModelSet::addModel(string name, HMMProbabilities* someProbabilities) {
+	if (modelIndexes.count(name) > 0)
+		throw invalid_argument("Model already added: " + name);
+
+	modelIndexes[name] = models.size();
+	modelNames.push_back(name);
+	HMMProbabilities* model = new HMMProbabilities();
+	model->copyFrom(someProbabilities);
+	models.push_back(model);
+}
+
+// annotateRecord(Record& record, int viterbiPrecision)
+//  Purpose:
+//		Decodes record with its model at viterbiPrecision (see
+//		HMMViterbiKernel) and sets record.genes (in increasing order) or
+//		record.error (every failure is caught).  The sequence is
+//		released once it has been encoded.
+//  Preconditions:
+//		at least one model has been added
+void HMMModelSet::annotateRecord(Record& record, int viterbiPrecision) {
+	try {
+		int model = modelIndex(record);
+		vector<uint8_t> codons;
+		CodonUtilities::encodeSequence(record.sequence, codons);
+		string().swap(record.sequence);
+
+		if (!codons.empty()) {
+			HiddenMarkovModel hmm(&codons[0], codons.size());
+			hmm.setKeepViterbiPath(false);
+			hmm.setViterbiPrecision(viterbiPrecision);
+			HMMViterbiResults* results = hmm.viterbiIteration(models[model], 1);
+
+			for (HMMViterbiResults::Gene* gene : results->genes)
+				record.genes.push_back(*gene);
+		}
+	}
+	catch (exception& e) {
+		record.error = e.what();
+	}
+	catch (...) {
+		record.error = "Unable to annotate the record";
+	}
+}
+
+// int modelIndex(const Record& record)
+//  Purpose:
+//		Returns the index of the model of record.  Throws an
+//		invalid_argument exception if there is no such model.
+int HMMModelSet::modelIndex(const Record& record) {
+	map<string, int>::iterator model = record.modelName.empty()
+		? modelIndexes.find(modelNames[0])
+		: modelIndexes.find(record.modelName);
+	if (model == modelIndexes.end())
+		throw invalid_argument("Unknown model: " + record.modelName);
+
+	return model->second;
+}
+
+// string modelName(const Record& record)
+//  Purpose:
+//		Returns the name of the model record is annotated with
+string HMMModelSet::modelName(const Record& record) {
+	return record.modelName.empty() ? modelNames[0] : record.modelName;
+}
+
+// Public Accessors
+// =============================================
+int HMMModelSet::getNumModels() {
+	return models.size();
+}
+
+HMMProbabilities* HMMModelSet::getModel(int index) {
+	return models[index];
+}
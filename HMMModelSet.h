@@ -0,0 +1,118 @@
+/*
+ * HMMModelSet.h
+ *
+ *	This is the header file for the HMMModelSet object.
+ *  HMMModelSet keeps the trained models of an annotation run (see
+ *  HMMAnnotationServer and HMMAnnotationPipeline) under their names and
+ *  annotates one Fasta record at a time with them.
+ *
+ *  A record names its model with a model=<name> word in its header and
+ *  is annotated with the first model added when there is none.  The
+ *  results of a record are named by the first word of its header.  A
+ *  record that can not be annotated (an unknown model, or a sequence its
+ *  model can not generate, see HMMTrellis::checkHighestWeightPath) gets
+ *  an error instead of genes; annotateRecord never throws.
+ *
+ *  The models are only read once they have been added, so any number of
+ *  threads may annotate records at the same time.
+ *
+ *  Typical use would be:
+ *
+ *		HMMModelSet models
+ *		models.addModel("ecoli", trainedProbabilities)
+ *		HMMModelSet::Record record
+ *		HMMModelSet::parseHeader(header, record)
+ *		record.sequence = sequence
+ *		models.annotateRecord(record, HMMViterbiKernel::longDoublePrecision)
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMMODELSET_H
+#define HMMMODELSET_H
+#include "HMMProbabilities.h"
+#include "HMMViterbiResults.h"
+#include <vector>
+#include <map>
+#include <string>
+using namespace std;
+
+class HMMModelSet
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMModelSet();
+
+	// Destructor
+	// =============================================
+	~HMMModelSet();
+
+	// Public Attributes
+	// =============================================
+	struct Record {
+		string name;			// first word of the header
+		string modelName;		// empty for the first model
+		string sequence;		// released once annotated
+		vector<HMMViterbiResults::Gene> genes;	// set by annotateRecord
+		string error;			// set by annotateRecord if it failed
+	};
+
+	// Public Class Methods
+	// =============================================
+
+	// parseHeader(const string& header, Record& record)
+	//  Purpose:
+	//		Sets the name and the model name of record from a Fasta header
+	static void parseHeader(const string& header, Record& record);
+
+	// Public Methods
+	// =============================================
+
+	// addModel(string name, HMMProbabilities* someProbabilities)
+	//  Purpose:
+	//		Keeps a copy of someProbabilities under name.  The first model
+	//		added is used for records that do not name one.  Throws an
+	//		invalid_argument exception if name has already been added.
+	void addModel(string name, HMMProbabilities* someProbabilities);
+
+	// annotateRecord(Record& record, int viterbiPrecision)
+	//  Purpose:
+	//		Decodes record with its model at viterbiPrecision (see
+	//		HMMViterbiKernel) and sets record.genes (in increasing order) or
+	//		record.error (every failure is caught).  The sequence is
+	//		released once it has been encoded.
+	//  Preconditions:
+	//		at least one model has been added
+	void annotateRecord(Record& record, int viterbiPrecision);
+
+	// int modelIndex(const Record& record)
+	//  Purpose:
+	//		Returns the index of the model of record.  Throws an
+	//		invalid_argument exception if there is no such model.
+	int modelIndex(const Record& record);
+
+	// string modelName(const Record& record)
+	//  Purpose:
+	//		Returns the name of the model record is annotated with
+	string modelName(const Record& record);
+
+	// Public Accessors
+	// =============================================
+	int getNumModels();
+	HMMProbabilities* getModel(int index);
+
+private:
+
+	// Private Attributes
+	// =============================================
+	vector<string> modelNames;
+	vector<HMMProbabilities*> models;
+	map<string, int> modelIndexes;
+
+	HMMModelSet(const HMMModelSet&);
+	HMMModelSet& operator=(const HMMModelSet&);
+};
+
+#endif // HMMMODELSET_H
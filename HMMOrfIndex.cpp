@@ -0,0 +1,193 @@
+/*
+ * HMMOrfIndex.cpp
+ *
+ *	This is the cpp file for the HMMOrfIndex object.  HMMOrfIndex marks
+ *  the states of the gene model every position of a sequence can possibly
+ *  be in from the open reading frames of the sequence.
+ *
+ *  See HMMOrfIndex.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMOrfIndex.h"
+#include "HMMGeneTopology.h"
+#include "HMMUnrolledKernel.h"
+#include "CodonUtilities.h"
+#include <climits>
+
+// const variable initialization
+// ==============================================
+const int HMMOrfIndex::numStrands = 2;
+const int HMMOrfIndex::openStates[] = { 1, 11 };
+const int HMMOrfIndex::continueStates[] = { 2, 8 };
+const int HMMOrfIndex::closeStates[] = { 5, 7 };
+const int HMMOrfIndex::secondStates[] = { 3, 9 };
+const int HMMOrfIndex::thirdStates[] = { 4, 10 };
+const int HMMOrfIndex::numCodingStates = 10;
+
+// Constuctors
+// ==============================================
+HMMOrfIndex::HMMOrfIndex() {
+	numPrunedCells = 0;
+	minimumLength = 0;
+	numPositions = 0;
+}
+
+// Destructor
+// =============================================
+HMMOrfIndex::~HMMOrfIndex() {
+}
+
+// Public Class Methods
+// =============================================
+
+// bool supports(HMMProbabilities* probabilities, HMMTopology* topology)
+//  Purpose:
+//		Returns true if the model is (a subset of) the 12 state gene model
+//		entered only through the intergenic state, so it can be indexed
+bool HMMOrfIndex::supports(HMMProbabilities* probabilities, HMMTopology* topology) {
+	if (!HMMUnrolledKernel<HMMGeneTopology>::supports(probabilities, topology))
+		return false;
+
+	for (int state = 1; state < HMMGeneTopology::numStates; state++) {
+		if (state != HMMGeneTopology::initialState && probabilities->initiationProbability(state) > 0)
+			return false;
+	}
+	return true;
+}
+
+// Public Methods
+// =============================================
+
+// bool build(probabilities, topology, codons, numberOfCodons, minimumOrfLength)
+//  Purpose:
+//		Builds the state masks of codons (see CodonUtilities::encodeSequence)
+//		for probabilities and returns true, or returns false and clears
+//		the masks if the model is not supported.  minimumOrfLength (in
+//		bases, 0 keeps every reading frame) rules out the starts of the
+//		shorter reading frames.
+//  Postconditions:
+//		stateMasks - set for positions 0..numberOfCodons
+//		numPrunedCells - set to the coding states ruled out
+bool HMMOrfIndex::build(
+	HMMProbabilities* probabilities,
+	HMMTopology* topology,
+	const uint8_t* codons,
+	int numberOfCodons,
+	int minimumOrfLength) {
+
+	numPositions = numberOfCodons;
+	minimumLength = minimumOrfLength;
+	numPrunedCells = 0;
+	if (!supports(probabilities, topology)) {
+		stateMasks.clear();
+		return false;
+	}
+
+	// Which of the open, continue and close states of each strand can emit
+	// every codon (bit strand * 3, + 1 and + 2)
+	const long double* emissionTable = probabilities->emissionProbabilityTable();
+	uint8_t codonClasses[CodonUtilities::numEmissionCodons];
+	for (int codon = 0; codon < CodonUtilities::numEmissionCodons; codon++) {
+		codonClasses[codon] = 0;
+		for (int strand = 0; strand < numStrands; strand++) {
+			if (emissionTable[openStates[strand] * CodonUtilities::numEmissionCodons + codon] > 0)
+				codonClasses[codon] |= 1 << (strand * 3);
+			if (emissionTable[continueStates[strand] * CodonUtilities::numEmissionCodons + codon] > 0)
+				codonClasses[codon] |= 1 << (strand * 3 + 1);
+			if (emissionTable[closeStates[strand] * CodonUtilities::numEmissionCodons + codon] > 0)
+				codonClasses[codon] |= 1 << (strand * 3 + 2);
+		}
+	}
+
+	// The starts of reading frames that are too short (walking backward,
+	// the first in frame codon that ends the reading frame of every frame)
+	vector<uint8_t> shortStarts;
+	if (minimumLength > 0) {
+		shortStarts.assign(numPositions + 1, 0);
+		int frameEnds[2][3] = { { INT_MAX, INT_MAX, INT_MAX }, { INT_MAX, INT_MAX, INT_MAX } };
+		for (int position = numPositions; position >= 1; position--) {
+			int frame = position % 3;
+			uint8_t codonClass = codonClasses[codons[position - 1]];
+			for (int strand = 0; strand < numStrands; strand++) {
+				int end = frameEnds[strand][frame];
+				if (end != INT_MAX && end - position + 3 < minimumLength)
+					shortStarts[position] |= 1 << strand;
+				if (!(codonClass & (1 << (strand * 3 + 1))))
+					frameEnds[strand][frame] = position;
+			}
+		}
+	}
+
+	// Walk the positions forward keeping A(q - 1), A(q - 2) and A(q - 3)
+	// of every strand (indexed by frame)
+	stateMasks.assign(numPositions + 1, 1 << HMMGeneTopology::initialState);
+	stateMasks[0] = 1;
+	bool open[2][3] = { { false, false, false }, { false, false, false } };
+	int frameStarts[3] = { INT_MIN, INT_MIN, INT_MIN };	// bottom strand, see below
+	long allowedCells = 0;
+	for (int position = 1; position <= numPositions; position++) {
+		int frame = position % 3;
+		uint8_t codonClass = codonClasses[codons[position - 1]];
+		uint16_t mask = 1 << HMMGeneTopology::initialState;
+
+		for (int strand = 0; strand < numStrands; strand++) {
+			bool previousOpen = open[strand][frame];
+			bool canOpen =
+				position > 1 &&
+				(codonClass & (1 << (strand * 3))) &&
+				!(minimumLength > 0 && (shortStarts[position] & (1 << strand)));
+			bool canContinue = previousOpen && (codonClass & (1 << (strand * 3 + 1)));
+
+			if (canOpen)
+				mask |= 1 << openStates[strand];
+			if (canContinue)
+				mask |= 1 << continueStates[strand];
+
+			// A bottom strand gene is read backward, so its start codon is
+			// the close state: it is ruled out if the gene from the in frame
+			// codon that began its reading frame (state 11) is too short
+			bool canClose = previousOpen && (codonClass & (1 << (strand * 3 + 2)));
+			if (canClose && strand == 1 && minimumLength > 0 &&
+				frameStarts[frame] != INT_MIN && position - frameStarts[frame] + 3 < minimumLength)
+				canClose = false;
+
+			if (canClose)
+				mask |= 1 << closeStates[strand];
+			if (open[strand][(position + 2) % 3])		// A(q - 1)
+				mask |= 1 << secondStates[strand];
+			if (open[strand][(position + 1) % 3])		// A(q - 2)
+				mask |= 1 << thirdStates[strand];
+
+			open[strand][frame] = canOpen || canContinue;
+		}
+		if (!(codonClass & (1 << (1 * 3 + 1))))		// bottom strand state 8 can not emit it
+			frameStarts[frame] = position;
+
+		stateMasks[position] = mask;
+		allowedCells += __builtin_popcount(mask) - 1;
+	}
+	numPrunedCells = (long) numPositions * numCodingStates - allowedCells;
+
+	return true;
+}
+
+// bool isExact()
+//  Purpose:
+//		Returns true if only the states that can not be reached were ruled
+//		out (no minimum ORF length)
+bool HMMOrfIndex::isExact() {
+	return minimumLength <= 0;
+}
+
+// double prunedFraction()
+//  Purpose:
+//		Returns the fraction of the coding state positions ruled out
+double HMMOrfIndex::prunedFraction() {
+	if (numPositions == 0)
+		return 0;
+
+	return numPrunedCells / (double) ((long) numPositions * numCodingStates);
+}
@@ -0,0 +1,157 @@
+/*
+ * HMMOrfIndex.h
+ *
+ *	This is the header file for the HMMOrfIndex object.
+ *  HMMOrfIndex marks, for every position of an encoded sequence, the
+ *  states of the 12 state gene model (see HMMGeneTopology) that the
+ *  position can possibly be in, so the recursions of HMMTrellis can skip
+ *  the coding states of the positions that lie outside of every open
+ *  reading frame.
+ *
+ *  A top strand gene is a path 6 -> 1 -> 3 -> 4 -> 2 -> 3 -> 4 ... 2 ->
+ *  3 -> 4 -> 5 -> 6: a start codon (state 1) at position s, the codons
+ *  in frame with it (positions s + 3k, state 2) and at last a stop codon
+ *  (state 5, in frame as well).  Every in frame codon must be one that
+ *  state 2 can emit, so the gene can not reach past the first in frame
+ *  codon state 2 can not emit (a stop codon).  Writing A(q) for "a gene
+ *  can be in state 1 or 2 at position q":
+ *
+ *		A(q) = canStart(q) or (A(q - 3) and state 2 can emit codon q)
+ *
+ *  and a position q can only be in
+ *
+ *		state 1 if canStart(q)
+ *		state 2 if A(q - 3) and state 2 can emit codon q
+ *		state 5 if A(q - 3) and state 5 can emit codon q
+ *		state 3 if A(q - 1)
+ *		state 4 if A(q - 2)
+ *
+ *  canStart(q) is "state 1 can emit codon q" after the first position
+ *  (which is entered from the start state, whose only initiation is the
+ *  intergenic state).  The bottom strand is the same with the gene read
+ *  backward: state 11 opens it, state 8 continues it, state 7 closes it
+ *  and states 9 and 10 are the codon positions after states 11 and 8.
+ *  The intergenic state is always possible.  The recurrence is one linear
+ *  scan with a 3 position window per strand, looking up which states can
+ *  emit each codon in a table built from the emission probabilities.
+ *
+ *  The emissions that can not be emitted are read from the probabilities
+ *  (so a trained model is indexed with its own stop codons) and the
+ *  codon positions 3, 4, 9 and 10 are assumed to emit every codon.  A
+ *  state ruled out at a position therefore has a forward probability of
+ *  zero there (and a viterbi weight of -DBL_MAX): skipping it leaves every
+ *  viterbi weight, forward, backward and posterior probability that is
+ *  used exactly the same.
+ *
+ *  Gene lengths:
+ *	  With a minimum ORF length above 0 the genes shorter than that many
+ *    bases, from the first base of their start codon to the last base of
+ *    their stop codon, are ruled out as well.  On the top strand the start
+ *    (state 1) is ruled out if its reading frame, up to the first in frame
+ *    codon that ends it, is too short.  A bottom strand gene is read
+ *    backward from its stop codon (state 11) to its start codon (state 7),
+ *    so state 7 is ruled out if the gene from the in frame codon that
+ *    began its reading frame is too short (state 11 is ruled out with a
+ *    reading frame that is too short as well).  Reading frames that run
+ *    off an end of the sequence are kept.  The model would otherwise allow
+ *    a gene to be called in them, so this is a filter that can change the
+ *    genes called and the likelihood.
+ *
+ *  Typical use would be:
+ *
+ *		HMMOrfIndex index
+ *		if (index.build(probabilities, topology, codons, numCodons, 0))
+ *			trellis.setOrfIndex(&index)
+ *
+ *  Important Attributes:
+ *		stateMasks - bit state is set if the position can be in state
+ *					 ([position], position 0 only state 0)
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMORFINDEX_H
+#define HMMORFINDEX_H
+#include "HMMProbabilities.h"
+#include "HMMTopology.h"
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+class HMMOrfIndex
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMOrfIndex();
+
+	// Destructor
+	// =============================================
+	~HMMOrfIndex();
+
+	// Public Attributes
+	// =============================================
+	vector<uint16_t> stateMasks;
+	long numPrunedCells;		// coding state positions ruled out
+
+	// Public Class Methods
+	// =============================================
+
+	// bool supports(HMMProbabilities* probabilities, HMMTopology* topology)
+	//  Purpose:
+	//		Returns true if the model is (a subset of) the 12 state gene model
+	//		entered only through the intergenic state, so it can be indexed
+	static bool supports(HMMProbabilities* probabilities, HMMTopology* topology);
+
+	// Public Methods
+	// =============================================
+
+	// bool build(probabilities, topology, codons, numberOfCodons, minimumOrfLength)
+	//  Purpose:
+	//		Builds the state masks of codons (see CodonUtilities::encodeSequence)
+	//		for probabilities and returns true, or returns false and clears
+	//		the masks if the model is not supported.  minimumOrfLength (in
+	//		bases, 0 keeps every reading frame) rules out the starts of the
+	//		shorter reading frames.
+	//  Postconditions:
+	//		stateMasks - set for positions 0..numberOfCodons
+	//		numPrunedCells - set to the coding states ruled out
+	bool build(
+		HMMProbabilities* probabilities,
+		HMMTopology* topology,
+		const uint8_t* codons,
+		int numberOfCodons,
+		int minimumOrfLength);
+
+	// bool isExact()
+	//  Purpose:
+	//		Returns true if only the states that can not be reached were ruled
+	//		out (no minimum ORF length)
+	bool isExact();
+
+	// double prunedFraction()
+	//  Purpose:
+	//		Returns the fraction of the coding state positions ruled out
+	double prunedFraction();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	static const int numStrands;
+	static const int openStates[];			// start a reading frame (1, 11)
+	static const int continueStates[];		// in frame codons inside it (2, 8)
+	static const int closeStates[];			// end it (5, 7)
+	static const int secondStates[];		// codon position after open or continue (3, 9)
+	static const int thirdStates[];			// codon position after second (4, 10)
+	static const int numCodingStates;
+
+	int minimumLength;
+	int numPositions;
+
+	HMMOrfIndex(const HMMOrfIndex&);
+	HMMOrfIndex& operator=(const HMMOrfIndex&);
+};
+
+#endif // HMMORFINDEX_H
@@ -0,0 +1,137 @@
+/*
+ * HMMPositionMap.cpp
+ *
+ *	This is the cpp file for the HMMPositionMap object.  HMMPositionMap
+ *  collapses the long runs of unknown codons of an encoded sequence and
+ *  maps the collapsed positions back to the sequence.
+ *
+ *  See HMMPositionMap.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMPositionMap.h"
+#include "CodonUtilities.h"
+#include <algorithm>
+
+// const variable initialization
+// ==============================================
+const int HMMPositionMap::defaultMinimumRunLength = 100;
+
+// Constuctors
+// ==============================================
+HMMPositionMap::HMMPositionMap() {
+	numSequencePositions = 0;
+	numPositions = 0;
+}
+
+// Destructor
+// =============================================
+HMMPositionMap::~HMMPositionMap() {
+}
+
+// Public Methods
+// =============================================
+
+// collapse(const uint8_t* codons, int numberOfCodons, int minimumRunLength, vector<uint8_t>& collapsedCodons)
+//  Purpose:
+//		Maps the runs of at least minimumRunLength unknown codons in codons
+//		and sets collapsedCodons to codons with every run collapsed into
+//		one unknown codon.  collapsedCodons is left empty when no run is
+//		found (the codons are used as they are).
+//  Postconditions:
+//		runPositions, runLengths - set to the runs collapsed
+void HMMPositionMap::collapse(const uint8_t* codons, int numberOfCodons, int minimumRunLength, vector<uint8_t>& collapsedCodons) {
+	numSequencePositions = numberOfCodons;
+	numPositions = numberOfCodons;
+	runPositions.clear();
+	runLengths.clear();
+	runOffsets.clear();
+	runSequencePositions.clear();
+	collapsedCodons.clear();
+
+	// Find the runs (sequence positions are 1 based)
+	int removed = 0;
+	for (int i = 0; minimumRunLength > 0 && i < numberOfCodons; i++) {
+		if (codons[i] != CodonUtilities::unknownCodon)
+			continue;
+
+		int runEnd = i;
+		while (runEnd < numberOfCodons && codons[runEnd] == CodonUtilities::unknownCodon)
+			runEnd++;
+
+		int length = runEnd - i;
+		if (length >= minimumRunLength && length > 1) {
+			runSequencePositions.push_back(i + 1);
+			runPositions.push_back(i + 1 - removed);
+			runLengths.push_back(length);
+			removed += length - 1;
+			runOffsets.push_back(removed);
+		}
+		i = runEnd - 1;
+	}
+
+	if (runPositions.empty())
+		return;
+
+	// Copy the codons between the runs
+	numPositions = numberOfCodons - removed;
+	collapsedCodons.reserve(numPositions);
+	int next = 0;
+	for (unsigned int run = 0; run < runPositions.size(); run++) {
+		int runStart = runSequencePositions[run] - 1;
+		collapsedCodons.insert(collapsedCodons.end(), codons + next, codons + runStart);
+		collapsedCodons.push_back(CodonUtilities::unknownCodon);
+		next = runStart + runLengths[run];
+	}
+	collapsedCodons.insert(collapsedCodons.end(), codons + next, codons + numberOfCodons);
+}
+
+// int numRuns()
+//  Purpose:
+//		Returns the number of runs collapsed
+int HMMPositionMap::numRuns() {
+	return runPositions.size();
+}
+
+// int sequencePosition(int position)
+//  Purpose:
+//		Returns the sequence position of a collapsed position (the first
+//		position of the run for a collapsed run)
+int HMMPositionMap::sequencePosition(int position) {
+	// Runs before position
+	int runsBefore = lower_bound(runPositions.begin(), runPositions.end(), position) - runPositions.begin();
+	return (runsBefore > 0) ? position + runOffsets[runsBefore - 1] : position;
+}
+
+// int collapsedPosition(int sequencePosition)
+//  Purpose:
+//		Returns the collapsed position of a sequence position (the
+//		collapsed position of the run for every position of a run)
+int HMMPositionMap::collapsedPosition(int sequencePosition) {
+	// Runs starting at or before sequencePosition
+	int runsBefore =
+		upper_bound(runSequencePositions.begin(), runSequencePositions.end(), sequencePosition) -
+		runSequencePositions.begin();
+	if (runsBefore == 0)
+		return sequencePosition;
+
+	int run = runsBefore - 1;
+	if (sequencePosition < runSequencePositions[run] + runLengths[run])
+		return runPositions[run];
+
+	return sequencePosition - runOffsets[run];
+}
+
+// int positionLength(int position)
+//  Purpose:
+//		Returns the number of sequence positions the collapsed position
+//		stands for (1 unless it is a collapsed run)
+int HMMPositionMap::positionLength(int position) {
+	vector<int>::iterator run = lower_bound(runPositions.begin(), runPositions.end(), position);
+	if (run != runPositions.end() && *run == position)
+		return runLengths[run - runPositions.begin()];
+
+	return 1;
+}
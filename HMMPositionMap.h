@@ -0,0 +1,111 @@
+/*
+ * HMMPositionMap.h
+ *
+ *	This is the header file for the HMMPositionMap object.
+ *  HMMPositionMap collapses every long run of unknown codons (the N runs
+ *  and other ambiguity codes of draft assemblies, see CodonUtilities) in
+ *  an encoded sequence into a single unknown codon position, so the
+ *  trellis is never expanded across the gap, and maps the positions of
+ *  the collapsed sequence back to the positions of the sequence.
+ *
+ *  The unknown codon can only be emitted by the intergenic state (see
+ *  HMMProbabilities::initialProbabilities, training holds its emission
+ *  probabilities steady), so every path stays in the intergenic state
+ *  across a run and collapsing the run changes the weight of every path
+ *  by the same amount: the viterbi path is unchanged.  The collapsed
+ *  position stands for every position of its run, which stays in the
+ *  state of the collapsed position with a self transition from each
+ *  position to the next (see HiddenMarkovModel, which adds those
+ *  positions to the counts of training).
+ *
+ *  Runs shorter than the minimum run length are kept as they are.  For
+ *  example, with a minimum run length of 3:
+ *
+ *		sequence codons:	A A U U U U B		(U = unknown codon)
+ *		positions:			1 2 3 4 5 6 7
+ *		collapsed codons:	A A U B
+ *		positions:			1 2 3 4
+ *		sequence position:	1 2 3 7
+ *		position length:	1 1 4 1
+ *
+ *  Important Attributes:
+ *		runPositions - collapsed position of every run (in increasing order)
+ *		runLengths - number of sequence positions of every run
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMPOSITIONMAP_H
+#define HMMPOSITIONMAP_H
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+class HMMPositionMap
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMPositionMap();
+
+	// Destructor
+	// =============================================
+	~HMMPositionMap();
+
+	// Public Class Attributes
+	// =============================================
+	static const int defaultMinimumRunLength;	// positions
+
+	// Public Attributes
+	// =============================================
+	int numSequencePositions;
+	int numPositions;				// of the collapsed sequence
+	vector<int> runPositions;
+	vector<int> runLengths;
+
+	// Public Methods
+	// =============================================
+
+	// collapse(const uint8_t* codons, int numberOfCodons, int minimumRunLength, vector<uint8_t>& collapsedCodons)
+	//  Purpose:
+	//		Maps the runs of at least minimumRunLength unknown codons in codons
+	//		and sets collapsedCodons to codons with every run collapsed into
+	//		one unknown codon.  collapsedCodons is left empty when no run is
+	//		found (the codons are used as they are).
+	//  Postconditions:
+	//		runPositions, runLengths - set to the runs collapsed
+	void collapse(const uint8_t* codons, int numberOfCodons, int minimumRunLength, vector<uint8_t>& collapsedCodons);
+
+	// int numRuns()
+	//  Purpose:
+	//		Returns the number of runs collapsed
+	int numRuns();
+
+	// int sequencePosition(int position)
+	//  Purpose:
+	//		Returns the sequence position of a collapsed position (the first
+	//		position of the run for a collapsed run)
+	int sequencePosition(int position);
+
+	// int collapsedPosition(int sequencePosition)
+	//  Purpose:
+	//		Returns the collapsed position of a sequence position (the
+	//		collapsed position of the run for every position of a run)
+	int collapsedPosition(int sequencePosition);
+
+	// int positionLength(int position)
+	//  Purpose:
+	//		Returns the number of sequence positions the collapsed position
+	//		stands for (1 unless it is a collapsed run)
+	int positionLength(int position);
+
+private:
+
+	// Private Attributes
+	// =============================================
+	vector<int> runOffsets;				// positions removed up to and including every run
+	vector<int> runSequencePositions;	// first sequence position of every run
+};
+
+#endif // HMMPOSITIONMAP_H
@@ -0,0 +1,210 @@
+/*
+ * HMMPosteriorResults.cpp
+ *
+ *	This is the cpp file for the HMMPosteriorResults object.
+ *  HMMPosteriorResults holds the genes of a posterior decode and their
+ *  posterior confidence.
+ *
+ *  See HMMPosteriorResults.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMPosteriorResults.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+// const variable initialization
+// ==============================================
+const int HMMPosteriorResults::intergenic = 0;
+const int HMMPosteriorResults::topStrand = 1;
+const int HMMPosteriorResults::bottomStrand = 2;
+
+// Constuctors
+// ==============================================
+HMMPosteriorResults::HMMPosteriorResults() {
+	numStates = 0;
+	posteriorGenes = false;
+	logLikelihood = 0;
+	nextGene = -1;
+	runClass = intergenic;
+}
+
+HMMPosteriorResults::HMMPosteriorResults(int numberOfStates, bool posteriorDecoding) {
+	numStates = numberOfStates;
+	posteriorGenes = posteriorDecoding;
+	logLikelihood = 0;
+	nextGene = -1;
+	runClass = intergenic;
+}
+
+// Destructor
+// =============================================
+HMMPosteriorResults::~HMMPosteriorResults() {
+}
+
+// Public Methods
+// =============================================
+
+// addGene(int start, int end, bool isTopStrand)
+//  Purpose:
+//		Adds a viterbi gene whose confidence is to be calculated.  Genes
+//		are added in increasing order before the posterior probabilities
+//		are reduced (viterbi decoding only).
+void HMMPosteriorResults::addGene(int start, int end, bool isTopStrand) {
+	Gene gene;
+	gene.start = start;
+	gene.end = end;
+	gene.isTopStrand = isTopStrand;
+	gene.posteriorSum = 0;
+	gene.minimumPosterior = 1;
+	genes.push_back(gene);
+
+	// The positions are added from the last gene to the first
+	nextGene = genes.size() - 1;
+}
+
+// addPosteriorColumn(int position, const double* posteriors)
+//  Purpose:
+//		Reduces the posterior probability of every state at position
+//		(posteriors[state]) into the sums of the gene holding position.
+//		Positions are added from the last to the first.
+void HMMPosteriorResults::addPosteriorColumn(int position, const double* posteriors) {
+	double classPosteriors[3] = {0, 0, 0};
+	for (int state = 1; state < numStates; state++) {
+		classPosteriors[stateClass(state)] += posteriors[state];
+	}
+
+	Gene* gene = NULL;
+	if (!posteriorGenes) {
+		// The viterbi gene holding position (if any)
+		while (nextGene >= 0 && genes[nextGene].start > position)
+			nextGene--;
+		if (nextGene >= 0 && position <= genes[nextGene].end - 2)
+			gene = &genes[nextGene];
+	}
+	else {
+		// The strand with the highest posterior (intergenic on ties)
+		int positionClass = intergenic;
+		if (classPosteriors[topStrand] > classPosteriors[intergenic] &&
+			classPosteriors[topStrand] >= classPosteriors[bottomStrand])
+			positionClass = topStrand;
+		else if (classPosteriors[bottomStrand] > classPosteriors[intergenic] &&
+			classPosteriors[bottomStrand] > classPosteriors[topStrand])
+			positionClass = bottomStrand;
+
+		// A change of strand ends the run after position
+		if (positionClass != runClass) {
+			endRun(position + 1);
+			runClass = positionClass;
+			run.end = position + 2;
+			run.isTopStrand = (positionClass == topStrand);
+			run.posteriorSum = 0;
+			run.minimumPosterior = 1;
+		}
+		if (runClass != intergenic)
+			gene = &run;
+	}
+
+	if (gene != NULL) {
+		double posterior = classPosteriors[gene->isTopStrand ? topStrand : bottomStrand];
+		gene->posteriorSum += posterior;
+		gene->minimumPosterior = min(gene->minimumPosterior, posterior);
+	}
+}
+
+// endColumns()
+//  Purpose:
+//		Finishes the positions added with addPosteriorColumn
+//  Postconditions:
+//		genes - in increasing order
+void HMMPosteriorResults::endColumns() {
+	if (!posteriorGenes)
+		return;
+
+	endRun(1);
+	runClass = intergenic;
+
+	// The runs were found walking the positions backward
+	reverse(genes.begin(), genes.end());
+}
+
+// double confidence(const Gene& gene)
+//  Purpose:
+//		Returns the mean posterior probability of the strand of gene over
+//		its positions
+double HMMPosteriorResults::confidence(const Gene& gene) {
+	int numPositions = gene.end - gene.start - 1;
+	return (numPositions > 0) ? gene.posteriorSum / numPositions : 0;
+}
+
+// string resultsString()
+//  Purpose:
+//		Returns a string representing the genes and their confidence
+//
+//		format:
+//			<result type="posterior_genes" decoding="<<viterbi|posterior>>" genes="<<genes>>" log_likelihood="<<log likelihood>>">
+//				(<<start>>,<<end>>,<<strand>>,<<confidence>>,<<minimum posterior>>),...
+//			</result>
+string HMMPosteriorResults::resultsString() {
+	stringstream ss;
+
+	ss << "    <result type=\"posterior_genes\" decoding=\"" << (posteriorGenes ? "posterior" : "viterbi")
+		<< "\" genes=\"" << genes.size()
+		<< "\" log_likelihood=\"" << logLikelihood << "\">\n";
+
+	ss << fixed << setprecision(4);
+	int counter = 0;
+	for (Gene& gene : genes) {
+		if (counter % 5 == 0)
+			ss << "      ";
+		ss
+			<< "("
+			<< gene.start
+			<< ","
+			<< gene.end
+			<< ","
+			<< (gene.isTopStrand ? "top" : "bottom")
+			<< ","
+			<< confidence(gene)
+			<< ","
+			<< gene.minimumPosterior
+			<< "),";
+
+		counter++;
+		if (counter % 5 == 0 || counter == (int) genes.size())
+			ss << "\n";
+	}
+	ss << "    </result>\n";
+
+	return ss.str();
+}
+
+// Private Methods
+// =============================================
+
+// int stateClass(int state)
+//  Purpose:
+//		Returns topStrand, bottomStrand or intergenic for state (see the
+//		header comment)
+int HMMPosteriorResults::stateClass(int state) {
+	if (state >= 1 && state <= 5)
+		return topStrand;
+	if (state >= 7 && state <= 11)
+		return bottomStrand;
+	return intergenic;
+}
+
+// endRun(int start)
+//  Purpose:
+//		Adds the run being gathered as a gene starting at start if it is
+//		on a strand (posterior decoding)
+void HMMPosteriorResults::endRun(int start) {
+	if (runClass == intergenic)
+		return;
+
+	run.start = start;
+	genes.push_back(run);
+}
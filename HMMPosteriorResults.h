@@ -0,0 +1,145 @@
+/*
+ * HMMPosteriorResults.h
+ *
+ *	This is the header file for the HMMPosteriorResults object.
+ *  HMMPosteriorResults holds the genes of a posterior decode and the
+ *  posterior (forward-backward) probability of every gene, reduced to a
+ *  few sums per gene while the posterior probabilities are calculated one
+ *  position at a time (see HMMTrellis::accumulatePosteriorGenes).  The
+ *  posterior probabilities of the positions themselves are never kept.
+ *
+ *  The posterior probability of a position being inside of a gene is the
+ *  summed posterior probability of the states of its strand:
+ *
+ *		top strand - states 1 through 5 (start codon, codon positions and
+ *					 stop codon)
+ *		bottom strand - states 7 through 11
+ *		intergenic - every other state
+ *
+ *  Decodings:
+ *		viterbi - the genes are those called by the viterbi path (added with
+ *				  addGene before the posterior probabilities are reduced) and
+ *				  only their confidence is calculated
+ *		posterior - the genes are the runs of positions at which the posterior
+ *					probability of one strand is higher than that of the other
+ *					strand and of intergenic alike (posterior-max decoding).
+ *					They are not guaranteed to begin with a start codon or
+ *					end with a stop codon.
+ *
+ *	The confidence of a gene is the mean posterior probability of its
+ *  strand over the positions of the gene (start through end - 2, as the
+ *  last position of a gene emits its last three bases).
+ *
+ *  Typical use would be:
+ *
+ *		HMMPosteriorResults results(numStates, false)
+ *		results.addGene(start, end, isTopStrand)	// for every viterbi gene
+ *		trellis.accumulatePosteriorGenes(probabilities, &topology, results)
+ *		results.resultsString()
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMPOSTERIORRESULTS_H
+#define HMMPOSTERIORRESULTS_H
+#include <vector>
+#include <string>
+using namespace std;
+
+class HMMPosteriorResults
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMPosteriorResults();
+	HMMPosteriorResults(int numberOfStates, bool posteriorDecoding);
+
+	// Destructor
+	// =============================================
+	~HMMPosteriorResults();
+
+	// Public Attributes
+	// =============================================
+	struct Gene {
+		int start;
+		int end;
+		bool isTopStrand;
+		double posteriorSum;		// posterior of the strand summed over the gene
+		double minimumPosterior;	// lowest posterior of the strand in the gene
+	};
+
+	int numStates;
+	bool posteriorGenes;		// true when the genes are the posterior-max runs
+	vector<Gene> genes;			// in increasing order
+	double logLikelihood;		// log (base 2) likelihood of the sequence
+
+	// Public Methods
+	// =============================================
+
+	// addGene(int start, int end, bool isTopStrand)
+	//  Purpose:
+	//		Adds a viterbi gene whose confidence is to be calculated.  Genes
+	//		are added in increasing order before the posterior probabilities
+	//		are reduced (viterbi decoding only).
+	void addGene(int start, int end, bool isTopStrand);
+
+	// addPosteriorColumn(int position, const double* posteriors)
+	//  Purpose:
+	//		Reduces the posterior probability of every state at position
+	//		(posteriors[state]) into the sums of the gene holding position.
+	//		Positions are added from the last to the first.
+	void addPosteriorColumn(int position, const double* posteriors);
+
+	// endColumns()
+	//  Purpose:
+	//		Finishes the positions added with addPosteriorColumn
+	//  Postconditions:
+	//		genes - in increasing order
+	void endColumns();
+
+	// double confidence(const Gene& gene)
+	//  Purpose:
+	//		Returns the mean posterior probability of the strand of gene over
+	//		its positions
+	double confidence(const Gene& gene);
+
+	// string resultsString()
+	//  Purpose:
+	//		Returns a string representing the genes and their confidence
+	//
+	//		format:
+	//			<result type="posterior_genes" decoding="<<viterbi|posterior>>" genes="<<genes>>" log_likelihood="<<log likelihood>>">
+	//				(<<start>>,<<end>>,<<strand>>,<<confidence>>,<<minimum posterior>>),...
+	//			</result>
+	string resultsString();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	static const int intergenic;
+	static const int topStrand;
+	static const int bottomStrand;
+
+	int nextGene;			// viterbi gene the last position added could be in
+	int runClass;			// strand of the run being gathered (posterior decoding)
+	Gene run;				// gene being gathered (posterior decoding)
+
+	// Private Methods
+	// =============================================
+
+	// int stateClass(int state)
+	//  Purpose:
+	//		Returns topStrand, bottomStrand or intergenic for state (see the
+	//		header comment)
+	int stateClass(int state);
+
+	// endRun(int start)
+	//  Purpose:
+	//		Adds the run being gathered as a gene starting at start if it is
+	//		on a strand (posterior decoding)
+	void endRun(int start);
+};
+
+#endif // HMMPOSTERIORRESULTS_H
@@ -7,35 +7,61 @@
  *	convenience methods for setting and retriving probabilties as well as
  *  the log value of each probabilty.
  *
+ *  Emission probabilities are stored in flat [state][codon] tables indexed
+ *  by the dense codon indexes from CodonUtilities.  The last column of each
+ *  table holds the emission probability of the unknown codon (any codon
+ *  containing N or another ambiguity code).  The string based methods are
+ *  thin wrappers that convert the residue to its codon index.
+ *
+ *  The tables are sized by the number of states passed to the
+ *  constructor.  initialProbabilities builds the 12 state gene model from
+ *  HMMGeneTopology.
+ *
  *  Created on: 2-15-13
  *      Author: tomkolar
  */
 #include "HMMProbabilities.h"
+#include "HMMGeneTopology.h"
 #include <cmath>
 #include <sstream>
 #include <string>
 #include <limits>
+#include <algorithm>
+#include <utility>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+// const variable initialization
+// ==============================================
+const char HMMProbabilities::fileMagic[8] = {'H', 'M', 'M', 'P', 'R', 'O', 'B', 'S'};
+const uint64_t HMMProbabilities::fileVersion = 2;
+const int HMMProbabilities::fileValueBytes = 10;
+const int HMMProbabilities::fileValueDigits = 64;
+const map<string, int> HMMProbabilities::emissionResidueMap = HMMProbabilities::createEmissionResidueMap();
 
 // Constuctors
 // ==============================================
 HMMProbabilities::HMMProbabilities() {
+	numStates = 0;
 }
 
 HMMProbabilities::HMMProbabilities(int numOfStates) {
 	numStates = numOfStates;
-	createEmissionResidueMap();
 
-	// Initialize all probabilities to zero
-	for (int i = 0; i < numStates; i++) {
-		setInitiationProbability(i, 0);
-		for (int j = 0; j < numStates; j++) {
-			setTransitionProbability(i, j, 0);
-		}
-		for (pair<string, int> mapPair : emissionResidueMap) {
-			string& residue = mapPair.first;
-			setEmissionProbability(i, residue, 0);
-		}
-	}
+	// Initialize all probabilities to zero (whose log is NaN)
+	long double logZero = logProbability(0);
+	emissionProbabilities.assign(numStates * CodonUtilities::numEmissionCodons, 0);
+	logEmissionProbabilities.assign(numStates * CodonUtilities::numEmissionCodons, logZero);
+	transitionProbabilities.assign(numStates * numStates, 0);
+	logTransitionProbabilities.assign(numStates * numStates, logZero);
+	initiationProbabilities.assign(numStates, 0);
+	logInitiationProbabilities.assign(numStates, logZero);
+}
+
+HMMProbabilities::HMMProbabilities(HMMProbabilities&& otherProbabilities) {
+	numStates = 0;
+	*this = std::move(otherProbabilities);
 }
 
 
@@ -53,27 +79,18 @@ HMMProbabilities::~HMMProbabilities() {
 //		probabilites required by genome540 homework #7	
 HMMProbabilities* HMMProbabilities::initialProbabilities() {
 
-	HMMProbabilities* probs = new HMMProbabilities(12);
+	HMMProbabilities* probs = new HMMProbabilities(HMMGeneTopology::numStates);
 
 	// initiation probabilties
-	probs->setInitiationProbability(6, 1.0);
+	probs->setInitiationProbability(HMMGeneTopology::initialState, 1.0);
 
 	// transition probabilities
-	probs->setTransitionProbability(1, 3, 1.0);
-	probs->setTransitionProbability(2, 3, 1.0);
-	probs->setTransitionProbability(3, 4, 1.0);
-	probs->setTransitionProbability(4, 2, 0.99);
-	probs->setTransitionProbability(4, 5, 0.01);
-	probs->setTransitionProbability(5, 6, 1.0);
-	probs->setTransitionProbability(6, 1, 0.1);
-	probs->setTransitionProbability(6, 6, 0.8);
-	probs->setTransitionProbability(6, 11, 0.1);
-	probs->setTransitionProbability(7, 6, 1.0);
-	probs->setTransitionProbability(8, 9, 1.0);
-	probs->setTransitionProbability(9, 10, 1.0);
-	probs->setTransitionProbability(10, 7, 0.01);
-	probs->setTransitionProbability(10, 8, 0.99);
-	probs->setTransitionProbability(11, 9, 1.0);
+	for (int arc = 0; arc < HMMGeneTopology::numArcs; arc++) {
+		probs->setTransitionProbability(
+			HMMGeneTopology::arcStartStates[arc],
+			HMMGeneTopology::arcEndStates[arc],
+			HMMGeneTopology::arcProbabilities[arc]);
+	}
 
 	// emission probabilities
 	// State 1 (Top-strand Start Codon)
@@ -119,6 +136,10 @@ HMMProbabilities* HMMProbabilities::initialProbabilities() {
 		string& residue = mapPair.first;
 		probs->setEmissionProbability(6, residue, state6DefaultValue);
 	}
+
+	// Unknown codons (containing N or other ambiguity codes) can only
+	// be intergenic
+	probs->setUnknownEmissionProbability(6, 1.0);
 	
 	// State 7 (Bottom-strand Start Codon)
 	double state7DefaultValue = 1/(double)4;
@@ -161,14 +182,132 @@ HMMProbabilities* HMMProbabilities::initialProbabilities() {
 
 }
 
+// HMMProbabilities* load(string fileName)
+//  Purpose: 
+//		Returns the probabilities saved in fileName (see save)
+HMMProbabilities* HMMProbabilities::load(string fileName) {
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (file == NULL)
+		throw runtime_error("Unable to open probabilities file: " + fileName);
+
+	// The whole file (a model is small) is read and then decoded
+	vector<uint8_t> bytes;
+	uint8_t buffer[4096];
+	size_t numRead;
+	while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + numRead);
+	bool valid = !ferror(file);
+	fclose(file);
+
+	HMMProbabilitiesFileHeader header;
+	valid = valid && bytes.size() >= sizeof(header);
+	if (valid) {
+		memcpy(header.magic, &bytes[0], sizeof(header.magic));
+		uint64_t* fields[] = { &header.version, &header.numStates, &header.numEmissionCodons,
+			&header.valueSize, &header.valueDigits, &header.reserved[0], &header.reserved[1] };
+		for (unsigned int field = 0; field < sizeof(fields) / sizeof(fields[0]); field++)
+			*fields[field] = fileInteger(&bytes[sizeof(header.magic) + field * 8], 8);
+
+		valid =
+			memcmp(header.magic, fileMagic, sizeof(fileMagic)) == 0 &&
+			header.version == fileVersion &&
+			header.numStates > 0 && header.numStates <= 256 &&
+			header.numEmissionCodons == (uint64_t) CodonUtilities::numEmissionCodons &&
+			header.valueSize == (uint64_t) fileValueBytes &&
+			header.valueDigits == (uint64_t) fileValueDigits;
+	}
+
+	// The tables are read as they are, so no log is recalculated
+	HMMProbabilities* probs = valid ? new HMMProbabilities(header.numStates) : NULL;
+	if (valid) {
+		size_t numValues = 0;
+		for (vector<long double>* table : probs->fileTables())
+			numValues += table->size();
+		valid = bytes.size() == sizeof(header) + numValues * fileValueBytes;
+	}
+	if (valid) {
+		const uint8_t* value = &bytes[sizeof(header)];
+		for (vector<long double>* table : probs->fileTables()) {
+			for (long double& entry : *table) {
+				entry = fileValue(value);
+				value += fileValueBytes;
+			}
+		}
+	}
+
+	if (!valid) {
+		delete probs;
+		throw runtime_error("Invalid probabilities file: " + fileName);
+	}
+
+	return probs;
+}
+
+// bool isProbabilitiesFile(string fileName)
+//  Purpose: 
+//		Returns true if fileName starts with the header of a saved
+//		probabilities file
+bool HMMProbabilities::isProbabilitiesFile(string fileName) {
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (file == NULL)
+		return false;
+
+	char magic[sizeof(fileMagic)];
+	bool matches =
+		fread(magic, sizeof(magic), 1, file) == 1 &&
+		memcmp(magic, fileMagic, sizeof(fileMagic)) == 0;
+	fclose(file);
+
+	return matches;
+}
+
 // Public Methods
 // =============================================
 
+// HMMProbabilities& operator=(HMMProbabilities&& otherProbabilities)
+//  Purpose: 
+//		Moves the tables of otherProbabilities into this object, leaving
+//		otherProbabilities without states
+HMMProbabilities& HMMProbabilities::operator=(HMMProbabilities&& otherProbabilities) {
+	if (this == &otherProbabilities)
+		return *this;
+
+	numStates = otherProbabilities.numStates;
+	emissionProbabilities.swap(otherProbabilities.emissionProbabilities);
+	logEmissionProbabilities.swap(otherProbabilities.logEmissionProbabilities);
+	transitionProbabilities.swap(otherProbabilities.transitionProbabilities);
+	logTransitionProbabilities.swap(otherProbabilities.logTransitionProbabilities);
+	initiationProbabilities.swap(otherProbabilities.initiationProbabilities);
+	logInitiationProbabilities.swap(otherProbabilities.logInitiationProbabilities);
+
+	otherProbabilities.numStates = 0;
+	for (vector<long double>* table : otherProbabilities.fileTables())
+		table->clear();
+
+	return *this;
+}
+
+// copyFrom(HMMProbabilities* otherProbabilities)
+//  Purpose: 
+//		Sets every probability and log value of this object to those of
+//		otherProbabilities.  Nothing is allocated when both have the same
+//		number of states.
+void HMMProbabilities::copyFrom(HMMProbabilities* otherProbabilities) {
+	if (this == otherProbabilities)
+		return;
+
+	numStates = otherProbabilities->numStates;
+	vector<vector<long double>*> tables = fileTables();
+	vector<vector<long double>*> otherTables = otherProbabilities->fileTables();
+	for (unsigned int table = 0; table < tables.size(); table++)
+		tables[table]->assign(otherTables[table]->begin(), otherTables[table]->end());
+}
+
 // double emissionProbability(int state, char residue)
 //  Purpose: 
 //		Returns the emission probability for the state and residue
 long double HMMProbabilities::emissionProbability(int state, string residue) {
-	return emissionProbabilities.at(state).at(getEmissionResidueIndex(residue));
+	return emissionProbabilities[state * CodonUtilities::numEmissionCodons + getEmissionResidueIndex(residue)];
 }
 
 // double initiationProbability(int state)
@@ -183,14 +322,55 @@ long double HMMProbabilities::initiationProbability(int state) {
 //		Returns the transition probability for transition from beginState
 //		to endState
 long double HMMProbabilities::transitionProbability(int beginState, int endState) {
-	return transitionProbabilities[beginState][endState];
+	return transitionProbabilities[beginState * numStates + endState];
 }
 
 // double logEmissionProbability(int state, char residue)
 //  Purpose: 
 //		Returns the log of the emission probability for the state and residue
 long double HMMProbabilities::logEmissionProbability(int state, string residue) {
-	return logEmissionProbabilities.at(state).at(getEmissionResidueIndex(residue));
+	return logEmissionProbabilities[state * CodonUtilities::numEmissionCodons + getEmissionResidueIndex(residue)];
+}
+
+// double logEmissionProbability(int state, int codon)
+//  Purpose: 
+//		Returns the log of the emission probability for the state and codon
+//		index
+long double HMMProbabilities::logEmissionProbability(int state, int codon) {
+	return logEmissionProbabilities[state * CodonUtilities::numEmissionCodons + codon];
+}
+
+// const long double* logEmissionProbabilityTable()
+//  Purpose: 
+//		Returns the flat log emission table.  The log emission probability
+//		for a state and codon index is at
+//			[state * CodonUtilities::numEmissionCodons + codon]
+const long double* HMMProbabilities::logEmissionProbabilityTable() {
+	return &logEmissionProbabilities[0];
+}
+
+// const long double* emissionProbabilityTable()
+//  Purpose: 
+//		Returns the flat emission table (same layout as
+//		logEmissionProbabilityTable)
+const long double* HMMProbabilities::emissionProbabilityTable() {
+	return &emissionProbabilities[0];
+}
+
+// double unknownEmissionProbability(int state)
+//  Purpose: 
+//		Returns the emission probability of the unknown codon for the state
+long double HMMProbabilities::unknownEmissionProbability(int state) {
+	return emissionProbabilities[state * CodonUtilities::numEmissionCodons + CodonUtilities::unknownCodon];
+}
+
+// const long double* logTransitionProbabilityTable()
+//  Purpose: 
+//		Returns the flat log transition table.  The log transition
+//		probability from beginState to endState is at
+//			[beginState * numStates + endState]
+const long double* HMMProbabilities::logTransitionProbabilityTable() {
+	return &logTransitionProbabilities[0];
 }
 
 // double logInitiationProbability(int state)
@@ -205,7 +385,44 @@ long double HMMProbabilities::logInitiationProbability(int state) {
 //		Returns the log of the transition probability for transition from
 //		beginState to endState
 long double HMMProbabilities::logTransitionProbability(int beginState, int endState) {
-	return logTransitionProbabilities[beginState][endState];
+	return logTransitionProbabilities[beginState * numStates + endState];
+}
+
+// long double* initiationProbabilityValues()
+// long double* transitionProbabilityValues()
+// long double* emissionProbabilityValues()
+//  Purpose: 
+//		Return the flat initiation, transition and emission tables (same
+//		layouts as the log tables) to be updated in place.  The log values
+//		are not updated until calculateLogProbabilities is called.
+long double* HMMProbabilities::initiationProbabilityValues() {
+	return &initiationProbabilities[0];
+}
+
+long double* HMMProbabilities::transitionProbabilityValues() {
+	return &transitionProbabilities[0];
+}
+
+long double* HMMProbabilities::emissionProbabilityValues() {
+	return &emissionProbabilities[0];
+}
+
+// calculateLogProbabilities()
+//  Purpose: 
+//		Recalculates every log value from the tables in one pass (see
+//		initiationProbabilityValues)
+//	Postconditions:
+//		logInitiationProbabilites, logTransitionProbabilites,
+//		logEmissionProbabilites - set from the probabilities
+void HMMProbabilities::calculateLogProbabilities() {
+	for (unsigned int i = 0; i < initiationProbabilities.size(); i++)
+		logInitiationProbabilities[i] = logProbability(initiationProbabilities[i]);
+
+	for (unsigned int i = 0; i < transitionProbabilities.size(); i++)
+		logTransitionProbabilities[i] = logProbability(transitionProbabilities[i]);
+
+	for (unsigned int i = 0; i < emissionProbabilities.size(); i++)
+		logEmissionProbabilities[i] = logProbability(emissionProbabilities[i]);
 }
 
 // setEmissionProbability(int state, char residue, double value)
@@ -215,13 +432,29 @@ long double HMMProbabilities::logTransitionProbability(int beginState, int endSt
 //		emissionProbabilites - value set for state/residue
 //		logEmissionProbabilites - value set for state/residue
 void HMMProbabilities::setEmissionProbability(int state, string residue, long double value) {
-	emissionProbabilities[state][getEmissionResidueIndex(residue)] = value;
-	double logVal;
-	if (value == 0)
-		logVal = std::numeric_limits<double>::quiet_NaN();
-	else
-		logVal = log(value);
-	logEmissionProbabilities[state][getEmissionResidueIndex(residue)] = logVal;
+	setEmissionProbability(state, getEmissionResidueIndex(residue), value);
+}
+
+// setEmissionProbability(int state, int codon, double value)
+//  Purpose: 
+//		Sets the emission probability for the state and codon index to value
+//	Postconditions:
+//		emissionProbabilites - value set for state/codon
+//		logEmissionProbabilites - value set for state/codon
+void HMMProbabilities::setEmissionProbability(int state, int codon, long double value) {
+	emissionProbabilities[state * CodonUtilities::numEmissionCodons + codon] = value;
+	logEmissionProbabilities[state * CodonUtilities::numEmissionCodons + codon] = logProbability(value);
+}
+
+// setUnknownEmissionProbability(int state, double value)
+//  Purpose: 
+//		Sets the emission probability of the unknown codon for the state
+//		to value
+//	Postconditions:
+//		emissionProbabilites - value set for state/unknown codon
+//		logEmissionProbabilites - value set for state/unknown codon
+void HMMProbabilities::setUnknownEmissionProbability(int state, long double value) {
+	setEmissionProbability(state, CodonUtilities::unknownCodon, value);
 }
 
 // setInitiationProbability(int state, double value)
@@ -232,12 +465,7 @@ void HMMProbabilities::setEmissionProbability(int state, string residue, long do
 //		logInitiationProbabilites - value set for state
 void HMMProbabilities::setInitiationProbability(int state, long double value) {
 	initiationProbabilities[state] = value;
-	double logVal;
-	if (value == 0)
-		logVal = std::numeric_limits<double>::quiet_NaN();
-	else
-		logVal = log(value);
-	logInitiationProbabilities[state] = logVal;
+	logInitiationProbabilities[state] = logProbability(value);
 }
 
 // setTransitionProbability(int beginState, int endState, double value)
@@ -248,13 +476,55 @@ void HMMProbabilities::setInitiationProbability(int state, long double value) {
 //		transitionProbabilites - value set for beginState to endState
 //		logTransitionProbabilites - value set for beginState to endState
 void HMMProbabilities::setTransitionProbability(int beginState, int endState, long double value) {
-	transitionProbabilities[beginState][endState] = value;
-	double logVal;
-	if (value == 0)
-		logVal = std::numeric_limits<double>::quiet_NaN();
-	else
-		logVal = log(value);
-	logTransitionProbabilities[beginState][endState] = logVal;
+	transitionProbabilities[beginState * numStates + endState] = value;
+	logTransitionProbabilities[beginState * numStates + endState] = logProbability(value);
+}
+
+// long double maximumDifference(HMMProbabilities* otherProbabilities)
+//  Purpose: 
+//		Returns the largest absolute difference between any initiation,
+//		transition or emission probability of this object and
+//		otherProbabilities (which must have the same number of states)
+long double HMMProbabilities::maximumDifference(HMMProbabilities* otherProbabilities) {
+	long double difference = 0;
+
+	for (unsigned int i = 0; i < initiationProbabilities.size(); i++)
+		difference = max(difference, fabsl(initiationProbabilities[i] - otherProbabilities->initiationProbabilities[i]));
+
+	for (unsigned int i = 0; i < transitionProbabilities.size(); i++)
+		difference = max(difference, fabsl(transitionProbabilities[i] - otherProbabilities->transitionProbabilities[i]));
+
+	for (unsigned int i = 0; i < emissionProbabilities.size(); i++)
+		difference = max(difference, fabsl(emissionProbabilities[i] - otherProbabilities->emissionProbabilities[i]));
+
+	return difference;
+}
+
+// save(string fileName)
+//  Purpose: 
+//		Writes the probabilities and their log values to fileName in the
+//		binary format described above
+void HMMProbabilities::save(string fileName) {
+	FILE* file = fopen(fileName.c_str(), "wb");
+	if (file == NULL)
+		throw runtime_error("Unable to create probabilities file: " + fileName);
+
+	vector<uint8_t> bytes(fileMagic, fileMagic + sizeof(fileMagic));
+	appendFileInteger(bytes, fileVersion, 8);
+	appendFileInteger(bytes, numStates, 8);
+	appendFileInteger(bytes, CodonUtilities::numEmissionCodons, 8);
+	appendFileInteger(bytes, fileValueBytes, 8);
+	appendFileInteger(bytes, fileValueDigits, 8);
+	appendFileInteger(bytes, 0, 8);		// reserved
+	appendFileInteger(bytes, 0, 8);
+	for (vector<long double>* table : fileTables()) {
+		for (long double value : *table)
+			appendFileValue(bytes, value);
+	}
+
+	bool written = fwrite(&bytes[0], 1, bytes.size(), file) == bytes.size();
+	if (fclose(file) != 0 || !written)
+		throw runtime_error("Unable to write probabilities file: " + fileName);
 }
 
 // string probabilitiesResultsString()
@@ -409,81 +679,140 @@ string HMMProbabilities::emissionProbablitiesResultsString(int state) {
 	return ss.str();
 }
 
+// Public Accessors
+// =============================================
+int HMMProbabilities::getNumStates() {
+	return numStates;
+}
+
 // map<string, int> createEmissionMap()
 //  Purpose: 
 //		Creates a map of the index location for a trinucleotide emission
 //		in the emission probabilities array
-void HMMProbabilities::createEmissionResidueMap() {
-
-	emissionResidueMap["AAA"]= 0;
-	emissionResidueMap["AAC"]= 1;
-	emissionResidueMap["AAG"]= 2;
-	emissionResidueMap["AAT"]= 3;
-	emissionResidueMap["ACA"]= 4;
-	emissionResidueMap["ACC"]= 5;
-	emissionResidueMap["ACG"]= 6;
-	emissionResidueMap["ACT"]= 7;
-	emissionResidueMap["AGA"]= 8;
-	emissionResidueMap["AGC"]= 9;
-	emissionResidueMap["AGG"]= 10;
-	emissionResidueMap["AGT"]= 11;
-	emissionResidueMap["ATA"]= 12;
-	emissionResidueMap["ATC"]= 13;
-	emissionResidueMap["ATG"]= 14;
-	emissionResidueMap["ATT"]= 15;
-	emissionResidueMap["CAA"]= 16;
-	emissionResidueMap["CAC"]= 17;
-	emissionResidueMap["CAG"]= 18;
-	emissionResidueMap["CAT"]= 19;
-	emissionResidueMap["CCA"]= 20;
-	emissionResidueMap["CCC"]= 21;
-	emissionResidueMap["CCG"]= 22;
-	emissionResidueMap["CCT"]= 23;
-	emissionResidueMap["CGA"]= 24;
-	emissionResidueMap["CGC"]= 25;
-	emissionResidueMap["CGG"]= 26;
-	emissionResidueMap["CGT"]= 27;
-	emissionResidueMap["CTA"]= 28;
-	emissionResidueMap["CTC"]= 29;
-	emissionResidueMap["CTG"]= 30;
-	emissionResidueMap["CTT"]= 31;
-	emissionResidueMap["GAA"]= 32;
-	emissionResidueMap["GAC"]= 33;
-	emissionResidueMap["GAG"]= 34;
-	emissionResidueMap["GAT"]= 35;
-	emissionResidueMap["GCA"]= 36;
-	emissionResidueMap["GCC"]= 37;
-	emissionResidueMap["GCG"]= 38;
-	emissionResidueMap["GCT"]= 39;
-	emissionResidueMap["GGA"]= 40;
-	emissionResidueMap["GGC"]= 41;
-	emissionResidueMap["GGG"]= 42;
-	emissionResidueMap["GGT"]= 43;
-	emissionResidueMap["GTA"]= 44;
-	emissionResidueMap["GTC"]= 45;
-	emissionResidueMap["GTG"]= 46;
-	emissionResidueMap["GTT"]= 47;
-	emissionResidueMap["TAA"]= 48;
-	emissionResidueMap["TAC"]= 49;
-	emissionResidueMap["TAG"]= 50;
-	emissionResidueMap["TAT"]= 51;
-	emissionResidueMap["TCA"]= 52;
-	emissionResidueMap["TCC"]= 53;
-	emissionResidueMap["TCG"]= 54;
-	emissionResidueMap["TCT"]= 55;
-	emissionResidueMap["TGA"]= 56;
-	emissionResidueMap["TGC"]= 57;
-	emissionResidueMap["TGG"]= 58;
-	emissionResidueMap["TGT"]= 59;
-	emissionResidueMap["TTA"]= 60;
-	emissionResidueMap["TTC"]= 61;
-	emissionResidueMap["TTG"]= 62;
-	emissionResidueMap["TTT"]= 63;
-}
-
-// int getIndex(char residue)
+map<string, int> HMMProbabilities::createEmissionResidueMap() {
+	map<string, int> residueMap;
+	for (int codon = 0; codon < CodonUtilities::numCodons; codon++) {
+		residueMap[CodonUtilities::codonString(codon)] = codon;
+	}
+	return residueMap;
+}
+
+// int getEmissionResidueIndex(const string& residue)
 //  Purpose: 
 //	  Returns the index in the emission probabilities for the residue
-int HMMProbabilities::getEmissionResidueIndex(string residue) {
-	return emissionResidueMap.at(residue);
+int HMMProbabilities::getEmissionResidueIndex(const string& residue) {
+	if (residue.length() < 3)
+		return CodonUtilities::unknownCodon;
+
+	return CodonUtilities::codonIndex(residue.c_str());
+}
+
+// long double logProbability(long double value)
+//  Purpose: 
+//		Returns the log of value as it is stored in the log tables (NaN
+//		for zero)
+long double HMMProbabilities::logProbability(long double value) {
+	double logVal;
+	if (value == 0)
+		logVal = std::numeric_limits<double>::quiet_NaN();
+	else
+		logVal = log(value);
+	return logVal;
+}
+
+// vector<vector<long double>*> fileTables()
+//  Purpose: 
+//		Returns the tables in the order they are stored in a file
+vector<vector<long double>*> HMMProbabilities::fileTables() {
+	vector<vector<long double>*> tables;
+	tables.push_back(&initiationProbabilities);
+	tables.push_back(&logInitiationProbabilities);
+	tables.push_back(&transitionProbabilities);
+	tables.push_back(&logTransitionProbabilities);
+	tables.push_back(&emissionProbabilities);
+	tables.push_back(&logEmissionProbabilities);
+	return tables;
+}
+
+// appendFileInteger(vector<uint8_t>& bytes, uint64_t value, int numberOfBytes)
+//  Purpose: 
+//		Appends the low numberOfBytes bytes of value to bytes, least
+//		significant first
+void HMMProbabilities::appendFileInteger(vector<uint8_t>& bytes, uint64_t value, int numberOfBytes) {
+	for (int byte = 0; byte < numberOfBytes; byte++)
+		bytes.push_back((uint8_t) (value >> (byte * 8)));
+}
+
+// uint64_t fileInteger(const uint8_t* bytes, int numberOfBytes)
+//  Purpose: 
+//		Returns the integer of numberOfBytes bytes at bytes, least
+//		significant first
+uint64_t HMMProbabilities::fileInteger(const uint8_t* bytes, int numberOfBytes) {
+	uint64_t value = 0;
+	for (int byte = 0; byte < numberOfBytes; byte++)
+		value |= (uint64_t) bytes[byte] << (byte * 8);
+	return value;
+}
+
+// appendFileValue(vector<uint8_t>& bytes, long double value)
+//  Purpose: 
+//		Appends value to bytes as an 80 bit extended precision number (see
+//		the header comment)
+void HMMProbabilities::appendFileValue(vector<uint8_t>& bytes, long double value) {
+	const int exponentBias = 16383;
+	const int maximumExponent = 0x7FFF;		// infinity and NaN
+	uint64_t significand = 0;
+	int exponent = 0;
+
+	if (std::isnan(value)) {
+		significand = (uint64_t) 3 << 62;
+		exponent = maximumExponent;
+	}
+	else if (std::isinf(value)) {
+		significand = (uint64_t) 1 << 63;
+		exponent = maximumExponent;
+	}
+	else if (value != 0) {
+		// fraction is in [0.5, 1), so significand has its top bit set
+		int binaryExponent;
+		long double fraction = frexpl(fabsl(value), &binaryExponent);
+		significand = (uint64_t) ldexpl(fraction, fileValueDigits);
+		exponent = binaryExponent - 1 + exponentBias;
+		if (exponent < 1) {
+			// Denormal
+			significand = (1 - exponent < 64) ? significand >> (1 - exponent) : 0;
+			exponent = 0;
+		}
+		else if (exponent >= maximumExponent) {
+			significand = (uint64_t) 1 << 63;
+			exponent = maximumExponent;
+		}
+	}
+
+	appendFileInteger(bytes, significand, 8);
+	appendFileInteger(bytes, (signbit(value) ? 0x8000 : 0) | exponent, 2);
+}
+
+// long double fileValue(const uint8_t* bytes)
+//  Purpose: 
+//		Returns the 80 bit extended precision number at bytes (see
+//		appendFileValue)
+long double HMMProbabilities::fileValue(const uint8_t* bytes) {
+	const int exponentBias = 16383;
+	const int maximumExponent = 0x7FFF;
+	uint64_t significand = fileInteger(bytes, 8);
+	int signExponent = (int) fileInteger(bytes + 8, 2);
+	int exponent = signExponent & maximumExponent;
+
+	long double value;
+	if (exponent == maximumExponent) {
+		value = (significand == (uint64_t) 1 << 63)
+			? numeric_limits<long double>::infinity()
+			: numeric_limits<long double>::quiet_NaN();
+	}
+	else {
+		value = ldexpl((long double) significand, max(exponent, 1) - exponentBias - (fileValueDigits - 1));
+	}
+
+	return (signExponent & 0x8000) ? -value : value;
 }
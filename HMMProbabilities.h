@@ -7,16 +7,70 @@
  *	convenience methods for setting and retriving probabilties as well as
  *  the log value of each probabilty.
  *
+ *  Emission probabilities are stored in flat [state][codon] tables indexed
+ *  by the dense codon indexes from CodonUtilities.  The last column of each
+ *  table holds the emission probability of the unknown codon (any codon
+ *  containing N or another ambiguity code).  The string based methods are
+ *  thin wrappers that convert the residue to its codon index.
+ *
+ *  All tables are flat and sized by the number of states passed to the
+ *  constructor, so models other than the 12 state gene model (see
+ *  HMMGeneTopology) can be built:
+ *		emission - [state * CodonUtilities::numEmissionCodons + codon]
+ *		transition - [beginState * numStates + endState]
+ *
+ *  Re-estimation updates the tables in place (see emissionProbabilityValues
+ *  and friends) and recalculates every log value in one pass afterwards
+ *  (calculateLogProbabilities) instead of a log per setter call.  The
+ *  residue index of the string based methods (emissionResidueMap) is
+ *  built once and shared by every object.
+ *
+ *  The tables of a model are large, so the probabilities are moved rather
+ *  than copied.  A deep copy is only made on purpose, with copyFrom (which
+ *  reuses the tables of the copy when it has the same number of states).
+ *
+ *  The probabilities can be saved to and loaded from a binary file, so
+ *  trained probabilities can be used again without retraining:
+ *		HMMProbabilitiesFileHeader
+ *		initiation, log initiation (numStates values each)
+ *		transition, log transition (numStates * numStates values each)
+ *		emission, log emission (numStates * numEmissionCodons values each)
+ *  Every field is written little endian whatever the host byte order.
+ *  The header fields are 8 byte unsigned integers after the magic.  The
+ *  values are 80 bit extended precision numbers (fileValueBytes each): the
+ *  64 bit significand with its explicit integer bit followed by the sign
+ *  and the 15 bit exponent biased by 16383, the x87 long double layout
+ *  without its padding.  They are converted to and from the long doubles
+ *  of the tables arithmetically, so a file is the same on every ABI (and
+ *  the same for the same model), the values round trip exactly where a
+ *  long double has a 64 bit significand and the log values are not
+ *  recalculated when the file is loaded.  A runtime_error is thrown if a
+ *  file can not be written, opened, or was written with a different
+ *  version or value format.
+ *
  *  Created on: 2-15-13
  *      Author: tomkolar
  */
 
 #ifndef HMMPROBABILITIES_H
 #define HMMPROBABILITIES_H
+#include "CodonUtilities.h"
 #include <map>
 #include <string>
+#include <vector>
+#include <stdint.h>
 using namespace std;
 
+struct HMMProbabilitiesFileHeader {
+	char magic[8];
+	uint64_t version;
+	uint64_t numStates;
+	uint64_t numEmissionCodons;
+	uint64_t valueSize;			// bytes of a value (fileValueBytes)
+	uint64_t valueDigits;		// significand bits of a value (fileValueDigits)
+	uint64_t reserved[2];
+};
+
 // Create the trinucleotide enum
 /*
 enum class trinucleotide{
@@ -46,14 +100,19 @@ public:
 	// ==============================================
 	HMMProbabilities();
 	HMMProbabilities(int numOfStates);
+	HMMProbabilities(HMMProbabilities&& otherProbabilities);
 
 	// Destructor
 	// =============================================
 	~HMMProbabilities();
 
-	// Public Attributes
+	// Public Class Attributes
 	// =============================================
-	map<string, int> emissionResidueMap;
+	static const map<string, int> emissionResidueMap;	// residue to codon index
+	static const char fileMagic[8];
+	static const uint64_t fileVersion;
+	static const int fileValueBytes;
+	static const int fileValueDigits;
 
 	// Public Class Methods
 	// =============================================
@@ -64,9 +123,33 @@ public:
 	//		probabilites required by genome540 homework #5	
 	static HMMProbabilities* initialProbabilities();
 
+	// HMMProbabilities* load(string fileName)
+	//  Purpose: 
+	//		Returns the probabilities saved in fileName (see save)
+	static HMMProbabilities* load(string fileName);
+
+	// bool isProbabilitiesFile(string fileName)
+	//  Purpose: 
+	//		Returns true if fileName starts with the header of a saved
+	//		probabilities file
+	static bool isProbabilitiesFile(string fileName);
+
 	// Public Methods
 	// =============================================
 
+	// HMMProbabilities& operator=(HMMProbabilities&& otherProbabilities)
+	//  Purpose: 
+	//		Moves the tables of otherProbabilities into this object, leaving
+	//		otherProbabilities without states
+	HMMProbabilities& operator=(HMMProbabilities&& otherProbabilities);
+
+	// copyFrom(HMMProbabilities* otherProbabilities)
+	//  Purpose: 
+	//		Sets every probability and log value of this object to those of
+	//		otherProbabilities.  Nothing is allocated when both have the same
+	//		number of states.
+	void copyFrom(HMMProbabilities* otherProbabilities);
+
 	// double emissionProbability(int state, string residue)
 	//  Purpose: 
 	//		Returns the emission probability for the state and residue
@@ -88,6 +171,30 @@ public:
 	//		Returns the log of the emission probability for the state and residue
 	long  double logEmissionProbability(int state, string residue);
 
+	// double logEmissionProbability(int state, int codon)
+	//  Purpose: 
+	//		Returns the log of the emission probability for the state and codon
+	//		index
+	long double logEmissionProbability(int state, int codon);
+
+	// const long double* logEmissionProbabilityTable()
+	//  Purpose: 
+	//		Returns the flat log emission table.  The log emission probability
+	//		for a state and codon index is at
+	//			[state * CodonUtilities::numEmissionCodons + codon]
+	const long double* logEmissionProbabilityTable();
+
+	// const long double* emissionProbabilityTable()
+	//  Purpose: 
+	//		Returns the flat emission table (same layout as
+	//		logEmissionProbabilityTable)
+	const long double* emissionProbabilityTable();
+
+	// double unknownEmissionProbability(int state)
+	//  Purpose: 
+	//		Returns the emission probability of the unknown codon for the state
+	long double unknownEmissionProbability(int state);
+
 	// double logInitiationProbability(int state)
 	//  Purpose: 
 	//		Returns the log of the initiation probability for the state
@@ -98,7 +205,34 @@ public:
 	//		Returns the log of the transition probability for transition from
 	//		beginState to endState
 	long double logTransitionProbability(int beginState, int endState);
+
+	// const long double* logTransitionProbabilityTable()
+	//  Purpose: 
+	//		Returns the flat log transition table.  The log transition
+	//		probability from beginState to endState is at
+	//			[beginState * numStates + endState]
+	const long double* logTransitionProbabilityTable();
 	
+	// long double* initiationProbabilityValues()
+	// long double* transitionProbabilityValues()
+	// long double* emissionProbabilityValues()
+	//  Purpose: 
+	//		Return the flat initiation, transition and emission tables (same
+	//		layouts as the log tables) to be updated in place.  The log values
+	//		are not updated until calculateLogProbabilities is called.
+	long double* initiationProbabilityValues();
+	long double* transitionProbabilityValues();
+	long double* emissionProbabilityValues();
+
+	// calculateLogProbabilities()
+	//  Purpose: 
+	//		Recalculates every log value from the tables in one pass (see
+	//		initiationProbabilityValues)
+	//	Postconditions:
+	//		logInitiationProbabilites, logTransitionProbabilites,
+	//		logEmissionProbabilites - set from the probabilities
+	void calculateLogProbabilities();
+
 	// setEmissionProbability(int state, char residue, double value)
 	//  Purpose: 
 	//		Sets the emission probability for the state and residue to value
@@ -107,6 +241,23 @@ public:
 	//		logEmissionProbabilites - value set for state/residue
 	void setEmissionProbability(int state, string residue, long double value);
 
+	// setEmissionProbability(int state, int codon, double value)
+	//  Purpose: 
+	//		Sets the emission probability for the state and codon index to value
+	//	Postconditions:
+	//		emissionProbabilites - value set for state/codon
+	//		logEmissionProbabilites - value set for state/codon
+	void setEmissionProbability(int state, int codon, long double value);
+
+	// setUnknownEmissionProbability(int state, double value)
+	//  Purpose: 
+	//		Sets the emission probability of the unknown codon for the state
+	//		to value
+	//	Postconditions:
+	//		emissionProbabilites - value set for state/unknown codon
+	//		logEmissionProbabilites - value set for state/unknown codon
+	void setUnknownEmissionProbability(int state, long double value);
+
 	// setInitiationProbability(int state, double value)
 	//  Purpose: 
 	//		Sets the initiation probability for the state to value
@@ -124,6 +275,19 @@ public:
 	//		logTransitionProbabilites - value set for beginState to endState
 	void setTransitionProbability(int beginState, int endState, long double value);
 
+	// long double maximumDifference(HMMProbabilities* otherProbabilities)
+	//  Purpose: 
+	//		Returns the largest absolute difference between any initiation,
+	//		transition or emission probability of this object and
+	//		otherProbabilities (which must have the same number of states)
+	long double maximumDifference(HMMProbabilities* otherProbabilities);
+
+	// save(string fileName)
+	//  Purpose: 
+	//		Writes the probabilities and their log values to fileName in the
+	//		binary format described above
+	void save(string fileName);
+
 	// string probabilitiesResultsString()
 	//  Purpose:
 	//		Returns a string representing the probabilites
@@ -177,22 +341,63 @@ public:
 	//			</result>
 	string emissionProbablitiesResultsString(int state);
 
+	// Public Accessors
+	// =============================================
+	int getNumStates();
+
 private:
 
 	// Private Attributes
 	// =============================================
 	int numStates;
-	map<int, map<int, long double>> emissionProbabilities;
-	map<int, map<int, long double>> logEmissionProbabilities;
-	long double transitionProbabilities[12][12];
-	long double logTransitionProbabilities[12][12];
-	long double initiationProbabilities[12];
-	long double logInitiationProbabilities[12];
+	vector<long double> emissionProbabilities;
+	vector<long double> logEmissionProbabilities;
+	vector<long double> transitionProbabilities;
+	vector<long double> logTransitionProbabilities;
+	vector<long double> initiationProbabilities;
+	vector<long double> logInitiationProbabilities;
 
 	// Private Methods
-	void createEmissionResidueMap();
-	int getEmissionResidueIndex(string residue);
+	static map<string, int> createEmissionResidueMap();
+	int getEmissionResidueIndex(const string& residue);
+
+	// long double logProbability(long double value)
+	//  Purpose: 
+	//		Returns the log of value as it is stored in the log tables (NaN
+	//		for zero)
+	static long double logProbability(long double value);
+
+	// vector<vector<long double>*> fileTables()
+	//  Purpose: 
+	//		Returns the tables in the order they are stored in a file
+	vector<vector<long double>*> fileTables();
+
+	// appendFileInteger(vector<uint8_t>& bytes, uint64_t value, int numberOfBytes)
+	//  Purpose: 
+	//		Appends the low numberOfBytes bytes of value to bytes, least
+	//		significant first
+	static void appendFileInteger(vector<uint8_t>& bytes, uint64_t value, int numberOfBytes);
+
+	// uint64_t fileInteger(const uint8_t* bytes, int numberOfBytes)
+	//  Purpose: 
+	//		Returns the integer of numberOfBytes bytes at bytes, least
+	//		significant first
+	static uint64_t fileInteger(const uint8_t* bytes, int numberOfBytes);
+
+	// appendFileValue(vector<uint8_t>& bytes, long double value)
+	//  Purpose: 
+	//		Appends value to bytes as an 80 bit extended precision number (see
+	//		the header comment)
+	static void appendFileValue(vector<uint8_t>& bytes, long double value);
+
+	// long double fileValue(const uint8_t* bytes)
+	//  Purpose: 
+	//		Returns the 80 bit extended precision number at bytes (see
+	//		appendFileValue)
+	static long double fileValue(const uint8_t* bytes);
 
+	HMMProbabilities(const HMMProbabilities&);
+	HMMProbabilities& operator=(const HMMProbabilities&);
 };
 
 #endif // HMMPROBABILITIES_H
@@ -0,0 +1,146 @@
+/*
+ * HMMSequenceGenerator.cpp
+ *
+ *	This is the cpp file for the HMMSequenceGenerator object.
+ *  HMMSequenceGenerator samples synthetic sequences from an
+ *  HMMProbabilities object.
+ *
+ *  See HMMSequenceGenerator.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMSequenceGenerator.h"
+#include "CodonUtilities.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Constuctors
+// ==============================================
+HMMSequenceGenerator::HMMSequenceGenerator(HMMProbabilities* someProbabilities, unsigned long seed)
+	: random(seed) {
+	numStates = someProbabilities->getNumStates();
+	const long double* emissions = someProbabilities->emissionProbabilityTable();
+
+	// The third base of codons 0..3 is every base in index order
+	for (int base = 0; base < 4; base++)
+		bases += CodonUtilities::codonString(base)[2];
+
+	// First position: initiation * emission of a whole codon
+	initialWeights.assign(numStates * CodonUtilities::numCodons, 0);
+	double total = 0;
+	for (int state = 1; state < numStates; state++) {
+		for (int codon = 0; codon < CodonUtilities::numCodons; codon++) {
+			total +=
+				someProbabilities->initiationProbability(state) *
+				emissions[state * CodonUtilities::numEmissionCodons + codon];
+			initialWeights[state * CodonUtilities::numCodons + codon] = total;
+		}
+	}
+
+	// Following positions: transition * emission of the new base after
+	// the previous two bases
+	int stepSize = numStates * 4;
+	stepWeights.assign(numStates * 16 * stepSize, 0);
+	for (int previousState = 1; previousState < numStates; previousState++) {
+		for (int previousBases = 0; previousBases < 16; previousBases++) {
+			double* weights = &stepWeights[(previousState * 16 + previousBases) * stepSize];
+			total = 0;
+			for (int state = 1; state < numStates; state++) {
+				long double transition = someProbabilities->transitionProbability(previousState, state);
+				for (int base = 0; base < 4; base++) {
+					int codon = (previousBases << 2) | base;
+					total += transition * emissions[state * CodonUtilities::numEmissionCodons + codon];
+					weights[state * 4 + base] = total;
+				}
+			}
+		}
+	}
+
+	endStates.assign(numStates, false);
+	for (int state = 1; state < numStates; state++)
+		endStates[state] = someProbabilities->initiationProbability(state) > 0;
+}
+
+// Destructor
+// =============================================
+HMMSequenceGenerator::~HMMSequenceGenerator() {
+}
+
+// Public Methods
+// =============================================
+
+// generate(long numberOfBases, string& sequence, vector<uint8_t>* path)
+//  Purpose:
+//		Sets sequence to at least numberOfBases sampled bases (see the
+//		header comment).  When path is not NULL it is set to the state
+//		of every position (sequence.length() - 2 states, path[i] emits
+//		the trinucleotide starting at sequence[i]).  Throws a
+//		runtime_error if the model can not be sampled (no initiation
+//		probability, or a state that can not emit a base after the bases
+//		already generated).
+void HMMSequenceGenerator::generate(long numberOfBases, string& sequence, vector<uint8_t>* path) {
+	sequence.clear();
+	sequence.reserve(max(numberOfBases, 3L));
+	if (path != NULL) {
+		path->clear();
+		path->reserve(max(numberOfBases - 2, 1L));
+	}
+
+	int sampled = sample(&initialWeights[0], initialWeights.size());
+	if (sampled < 0)
+		throw runtime_error("The model has no initiation probability to generate a sequence from");
+
+	int state = sampled / CodonUtilities::numCodons;
+	int codon = sampled % CodonUtilities::numCodons;
+	sequence += bases[codon >> 4];
+	sequence += bases[(codon >> 2) & 3];
+	sequence += bases[codon & 3];
+	if (path != NULL)
+		path->push_back(state);
+
+	int stepSize = numStates * 4;
+	while ((long) sequence.length() < numberOfBases || !endStates[state]) {
+		int previousBases = codon & 15;
+		sampled = sample(&stepWeights[(state * 16 + previousBases) * stepSize], stepSize);
+		if (sampled < 0)
+			throw runtime_error("The model can not continue the sequence from state " + to_string(state));
+
+		state = sampled / 4;
+		codon = (previousBases << 2) | (sampled % 4);
+		sequence += bases[codon & 3];
+		if (path != NULL)
+			path->push_back(state);
+	}
+}
+
+// Public Accessors
+// =============================================
+int HMMSequenceGenerator::getNumStates() {
+	return numStates;
+}
+
+// Private Methods
+// =============================================
+
+// int sample(const double* cumulativeWeights, int numberOfWeights)
+//  Purpose:
+//		Returns the index of a weight sampled in proportion to the
+//		weights, or -1 if they are all zero
+int HMMSequenceGenerator::sample(const double* cumulativeWeights, int numberOfWeights) {
+	double total = cumulativeWeights[numberOfWeights - 1];
+	if (!(total > 0))
+		return -1;
+
+	// The first cumulative weight above the sample (zero weights are never
+	// chosen since their cumulative weight equals the one before)
+	double target = uniform_real_distribution<double>(0, total)(random);
+	const double* chosen = upper_bound(cumulativeWeights, cumulativeWeights + numberOfWeights, target);
+	if (chosen == cumulativeWeights + numberOfWeights)
+		chosen--;
+	while (chosen > cumulativeWeights && *chosen == *(chosen - 1))
+		chosen--;
+
+	return chosen - cumulativeWeights;
+}
@@ -0,0 +1,101 @@
+/*
+ * HMMSequenceGenerator.h
+ *
+ *	This is the header file for the HMMSequenceGenerator object.
+ *  HMMSequenceGenerator samples synthetic sequences (and the state path
+ *  that generated them) from an HMMProbabilities object, e.g., the
+ *  initial probabilities, so the decoding and training code can be
+ *  measured on sequences of any length (see HMMBenchmark).
+ *
+ *  Every position of the model emits the trinucleotide starting at that
+ *  base, so neighbouring emissions share two bases.  The first position
+ *  samples its state from the initiation probabilities and a whole
+ *  trinucleotide from the emissions of that state.  Every following
+ *  position samples its state and the one new base together, weighted by
+ *
+ *		transition(previous state, state) * emission(state, previous two bases + base)
+ *
+ *  so a state is only entered when the bases already generated allow it
+ *  (e.g., a stop codon state only after "TA" or "TG").  The weights are
+ *  compiled into cumulative tables when the generator is created.
+ *
+ *  Once the requested number of bases has been generated the sequence is
+ *  extended until the path reaches a state with an initiation
+ *  probability (intergenic for the gene model), so it never ends inside
+ *  a gene.  Only A, C, G and T are generated.
+ *
+ *  The same seed always generates the same sequence.
+ *
+ *  Typical use would be:
+ *
+ *		HMMSequenceGenerator generator(HMMProbabilities::initialProbabilities(), seed)
+ *		generator.generate(1000000, sequence, NULL)
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMSEQUENCEGENERATOR_H
+#define HMMSEQUENCEGENERATOR_H
+#include "HMMProbabilities.h"
+#include <vector>
+#include <string>
+#include <random>
+#include <stdint.h>
+using namespace std;
+
+class HMMSequenceGenerator
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMSequenceGenerator(HMMProbabilities* someProbabilities, unsigned long seed);
+
+	// Destructor
+	// =============================================
+	~HMMSequenceGenerator();
+
+	// Public Methods
+	// =============================================
+
+	// generate(long numberOfBases, string& sequence, vector<uint8_t>* path)
+	//  Purpose:
+	//		Sets sequence to at least numberOfBases sampled bases (see the
+	//		header comment).  When path is not NULL it is set to the state
+	//		of every position (sequence.length() - 2 states, path[i] emits
+	//		the trinucleotide starting at sequence[i]).  Throws a
+	//		runtime_error if the model can not be sampled (no initiation
+	//		probability, or a state that can not emit a base after the bases
+	//		already generated).
+	void generate(long numberOfBases, string& sequence, vector<uint8_t>* path);
+
+	// Public Accessors
+	// =============================================
+	int getNumStates();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	int numStates;
+	mt19937_64 random;
+	string bases;						// base character of every base index
+	vector<double> initialWeights;		// cumulative over [state * numCodons + codon]
+	vector<double> stepWeights;			// cumulative over [state * 4 + base] for every
+										// [previous state * 16 + previous two bases]
+	vector<bool> endStates;				// states with an initiation probability
+
+	// Private Methods
+	// =============================================
+
+	// int sample(const double* cumulativeWeights, int numberOfWeights)
+	//  Purpose:
+	//		Returns the index of a weight sampled in proportion to the
+	//		weights, or -1 if they are all zero
+	int sample(const double* cumulativeWeights, int numberOfWeights);
+
+	HMMSequenceGenerator(const HMMSequenceGenerator&);
+	HMMSequenceGenerator& operator=(const HMMSequenceGenerator&);
+};
+
+#endif // HMMSEQUENCEGENERATOR_H
@@ -0,0 +1,284 @@
+/*
+ * HMMStrandDecoder.cpp
+ *
+ *	This is the cpp file for the HMMStrandDecoder object.
+ *  HMMStrandDecoder finds the genes of both strands of a sequence by
+ *  decoding the forward and reverse complement sequences separately with
+ *  the single strand model.
+ *
+ *  See HMMStrandDecoder.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMStrandDecoder.h"
+#include "HMMGeneTopology.h"
+#include "CodonUtilities.h"
+#include "MathUtilities.h"
+#include <algorithm>
+#include <limits>
+
+// const variable initialization
+// ==============================================
+const int HMMStrandDecoder::forwardStrand = 0;
+const int HMMStrandDecoder::reverseStrand = 1;
+
+// Constuctors
+// ==============================================
+HMMStrandDecoder::HMMStrandDecoder(const uint8_t* forwardCodons, const uint8_t* reverseCodons, int numberOfCodons)
+	: pool(2) {
+	codons[forwardStrand] = forwardCodons;
+	codons[reverseStrand] = reverseCodons;
+	numCodons = numberOfCodons;
+	numConflicts = 0;
+	checkpointInterval = 0;
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+
+	for (int strand = forwardStrand; strand <= reverseStrand; strand++)
+		trellises[strand] = HMMTrellis(codons[strand], numCodons, HMMSingleStrandTopology::numStates);
+}
+
+// Destructor
+// =============================================
+HMMStrandDecoder::~HMMStrandDecoder() {
+}
+
+// Public Class Methods
+// =============================================
+
+// HMMProbabilities* singleStrandProbabilities(HMMProbabilities* geneProbabilities, bool reverseStrand)
+//  Purpose:
+//		Returns new single strand probabilities (HMMSingleStrandTopology::
+//		numStates states) for the forward or the reverse
+//		complement strand taken from the 12 state geneProbabilities
+HMMProbabilities* HMMStrandDecoder::singleStrandProbabilities(HMMProbabilities* geneProbabilities, bool reverseStrand) {
+	int numStates = HMMSingleStrandTopology::numStates;
+	HMMProbabilities* probs = new HMMProbabilities(numStates);
+	const long double* emissions = geneProbabilities->emissionProbabilityTable();
+
+	for (int state = 1; state < numStates; state++) {
+		// initiation probabilities
+		probs->setInitiationProbability(state, geneProbabilities->initiationProbability(state));
+
+		// transition probabilities (top strand, renormalized without the
+		// transitions to the bottom strand)
+		long double total = 0;
+		for (int endState = 1; endState < numStates; endState++)
+			total += geneProbabilities->transitionProbability(state, endState);
+		for (int endState = 1; endState < numStates; endState++) {
+			long double probability = geneProbabilities->transitionProbability(state, endState);
+			if (probability > 0)
+				probs->setTransitionProbability(state, endState, probability / total);
+		}
+
+		// emission probabilities (the reverse strand reads the bottom strand
+		// emissions of the reverse complemented codons)
+		int geneState = reverseStrand ? HMMSingleStrandTopology::bottomStrandStates[state] : state;
+		for (int codon = 0; codon < CodonUtilities::numCodons; codon++) {
+			int strandCodon = reverseStrand ? CodonUtilities::reverseComplementCodon(codon) : codon;
+			probs->setEmissionProbability(state, strandCodon, emissions[geneState * CodonUtilities::numEmissionCodons + codon]);
+		}
+		probs->setUnknownEmissionProbability(state, geneProbabilities->unknownEmissionProbability(geneState));
+	}
+
+	return probs;
+}
+
+// Public Methods
+// =============================================
+
+// setCheckpointInterval(int interval)
+//  Purpose:
+//		Sets the viterbi checkpoint interval of both strands (see
+//		HMMTrellis::setCheckpointInterval)
+void HMMStrandDecoder::setCheckpointInterval(int interval) {
+	checkpointInterval = interval;
+}
+
+// setVectorizedViterbi(bool vectorized)
+//  Purpose:
+//		Selects the viterbi column calculation of both strands (see
+//		HMMTrellis::setVectorizedViterbi)
+void HMMStrandDecoder::setVectorizedViterbi(bool vectorized) {
+	viterbiPrecision = vectorized ? HMMViterbiKernel::doublePrecision : HMMViterbiKernel::longDoublePrecision;
+}
+
+// setViterbiPrecision(int precision)
+//  Purpose:
+//		Selects the viterbi precision of both strands (see
+//		HMMTrellis::setViterbiPrecision)
+void HMMStrandDecoder::setViterbiPrecision(int precision) {
+	viterbiPrecision = precision;
+}
+
+// decode(HMMProbabilities* geneProbabilities, vector<uint8_t>& path)
+//  Purpose:
+//		Decodes both strands with the single strand probabilities taken
+//		from geneProbabilities, reconciles the genes they call and sets
+//		path[position - 1] to the 12 state gene model state at every
+//		position.  geneProbabilities is only read.
+//  Postconditions:
+//		numConflicts - number of gene calls dropped because they overlap
+//					   higher scoring genes
+void HMMStrandDecoder::decode(HMMProbabilities* geneProbabilities, vector<uint8_t>& path) {
+	HMMProbabilities* strandProbabilities[2] = {
+		singleStrandProbabilities(geneProbabilities, false),
+		singleStrandProbabilities(geneProbabilities, true)
+	};
+
+	// Decode the strands at the same time
+	pool.run(2, [&](int strand) {
+		decodeStrand(strand, strandProbabilities[strand]);
+	});
+
+	// Gather the genes of both strands in order of their ends
+	vector<StrandGene> genes;
+	addStrandGenes(forwardStrand, strandProbabilities[forwardStrand], genes);
+	addStrandGenes(reverseStrand, strandProbabilities[reverseStrand], genes);
+	delete strandProbabilities[forwardStrand];
+	delete strandProbabilities[reverseStrand];
+	sort(genes.begin(), genes.end(), [](const StrandGene& a, const StrandGene& b) {
+		return (a.end != b.end) ? a.end < b.end : a.start < b.start;
+	});
+
+	// Reconcile overlapping genes (a gene has to start at or after the end
+	// of the previous one for the path to be legal).  bestScores[i] is the
+	// highest total score of non overlapping genes among the first i.
+	int numGenes = genes.size();
+	vector<long double> bestScores(numGenes + 1, 0);
+	vector<int> previousGenes(numGenes + 1, 0);
+	for (int i = 1; i <= numGenes; i++) {
+		const StrandGene& gene = genes[i - 1];
+		previousGenes[i] = upper_bound(genes.begin(), genes.begin() + (i - 1), gene.start,
+			[](int start, const StrandGene& other) { return start < other.end; }) - genes.begin();
+		bestScores[i] = max(bestScores[i - 1], gene.score + bestScores[previousGenes[i]]);
+	}
+
+	vector<StrandGene> keptGenes;
+	for (int i = numGenes; i > 0; ) {
+		if (bestScores[i] == bestScores[i - 1])
+			i--;
+		else {
+			keptGenes.push_back(genes[i - 1]);
+			i = previousGenes[i];
+		}
+	}
+	numConflicts = numGenes - keptGenes.size();
+
+	// Paint the genes on an intergenic path
+	path.assign(numCodons, HMMGeneTopology::initialState);
+	for (const StrandGene& gene : keptGenes)
+		paintGene(gene, path);
+
+	strandPaths[forwardStrand].clear();
+	strandPaths[reverseStrand].clear();
+}
+
+// Private Methods
+// =============================================
+
+// decodeStrand(int strand, HMMProbabilities* strandProbabilities)
+//  Purpose:
+//		Calculates the viterbi weights of strand and walks its path
+//		backward into strandPaths[strand]
+void HMMStrandDecoder::decodeStrand(int strand, HMMProbabilities* strandProbabilities) {
+	HMMTrellis& trellis = trellises[strand];
+	vector<uint8_t>& strandPath = strandPaths[strand];
+
+	topologies[strand] = HMMTopology(strandProbabilities, HMMSingleStrandTopology::numStates);
+	trellis.setCheckpointInterval(checkpointInterval);
+	trellis.setViterbiPrecision(viterbiPrecision);
+	trellis.calculateHighestWeightPaths(strandProbabilities, &topologies[strand]);
+
+	strandPath.assign(numCodons, 0);
+	trellis.checkHighestWeightPath();
+	int position = trellis.numPositions;
+	int state = trellis.highestScoringState(position);
+	while (state != 0 && position > 0) {
+		strandPath[position - 1] = state;
+		state = trellis.previousState(position, state);
+		position--;
+	}
+
+	trellis.releaseHighestWeightPaths();
+}
+
+// addStrandGenes(int strand, HMMProbabilities* strandProbabilities, vector<StrandGene>& genes)
+//  Purpose:
+//		Adds every complete gene of strandPaths[strand] to genes in
+//		forward sequence positions.  The score of a gene is the log odds of
+//		its path against staying intergenic over the same positions.
+void HMMStrandDecoder::addStrandGenes(int strand, HMMProbabilities* strandProbabilities, vector<StrandGene>& genes) {
+	const vector<uint8_t>& strandPath = strandPaths[strand];
+	const uint8_t* strandCodons = codons[strand];
+	int intergenic = HMMSingleStrandTopology::initialState;
+	long double logIntergenicTransition = strandProbabilities->logTransitionProbability(intergenic, intergenic);
+
+	int geneStart = 0;
+	long double geneScore = 0;
+	long double intergenicScore = 0;
+	for (int position = 1; position <= numCodons; position++) {
+		int state = strandPath[position - 1];
+
+		if (state == 1) {
+			geneStart = position;
+			geneScore = 0;
+			intergenicScore = 0;
+		}
+
+		if (geneStart > 0) {
+			// The transition into the position and its emission
+			int previous = strandPath[position - 2];
+			int codon = strandCodons[position - 1];
+			geneScore +=
+				strandProbabilities->logTransitionProbability(previous, state) +
+				strandProbabilities->logEmissionProbability(state, codon);
+			intergenicScore +=
+				logIntergenicTransition +
+				strandProbabilities->logEmissionProbability(intergenic, codon);
+		}
+
+		if (state == 5 && geneStart > 0) {
+			StrandGene gene;
+			if (strand == forwardStrand) {
+				gene.start = geneStart;
+				gene.end = position + 2;
+				gene.isTopStrand = true;
+			}
+			else {
+				// Base b of the reverse complement is base numCodons + 3 - b
+				gene.start = numCodons + 1 - position;
+				gene.end = numCodons + 3 - geneStart;
+				gene.isTopStrand = false;
+			}
+
+			// Leaving the gene (a log zero intergenic emission makes any
+			// gene better than staying intergenic)
+			geneScore += strandProbabilities->logTransitionProbability(5, intergenic);
+			intergenicScore += logIntergenicTransition;
+			if (MathUtilities::isNaN(intergenicScore))
+				gene.score = numeric_limits<long double>::infinity();
+			else
+				gene.score = geneScore - intergenicScore;
+
+			genes.push_back(gene);
+			geneStart = 0;
+		}
+	}
+}
+
+// paintGene(const StrandGene& gene, vector<uint8_t>& path)
+//  Purpose:
+//		Sets the 12 state gene model states of the positions of gene
+void HMMStrandDecoder::paintGene(const StrandGene& gene, vector<uint8_t>& path) {
+	for (int position = gene.start; position <= gene.end - 2; position++) {
+		if (gene.isTopStrand)
+			path[position - 1] = strandPaths[forwardStrand][position - 1];
+		else {
+			// Position p of the reverse complement is position numCodons + 1 - p
+			int strandState = strandPaths[reverseStrand][numCodons - position];
+			path[position - 1] = HMMSingleStrandTopology::bottomStrandStates[strandState];
+		}
+	}
+}
@@ -0,0 +1,157 @@
+/*
+ * HMMStrandDecoder.h
+ *
+ *	This is the header file for the HMMStrandDecoder object.
+ *  HMMStrandDecoder finds the genes of both strands of a sequence by
+ *  decoding the forward and reverse complement sequences separately with
+ *  the 7 state single strand model (HMMSingleStrandTopology, the top
+ *  strand states of HMMGeneTopology) instead of decoding the forward
+ *  sequence once with the full 12 state model.  The two strands are
+ *  decoded at the same time on two threads and every column has about
+ *  half the states of the joint model.
+ *
+ *  The single strand probabilities are taken from the 12 state gene
+ *  probabilities.  Both strands use the top strand transitions (state 6's
+ *  transitions to states 1 and 6 are renormalized).  The forward strand
+ *  uses the top strand emissions and the reverse strand the bottom strand
+ *  emissions of the reverse complemented codons, so the bottom strand
+ *  states keep being trained.
+ *
+ *  The genes found on the reverse complement are mapped back to bottom
+ *  strand genes of the forward sequence.  Each strand is decoded on its
+ *  own, so the two strands can call overlapping genes, which the joint
+ *  model never does.  Every gene is scored with the log odds of its path
+ *  against staying intergenic over the same positions and the overlapping
+ *  calls are reconciled by keeping the non overlapping genes with the
+ *  highest total score (weighted interval scheduling).  Genes the path of
+ *  either strand ends inside of are dropped.  The kept genes are then
+ *  painted onto a 12 state path (intergenic everywhere else) in the same
+ *  form as the viterbi path of the joint model, so the results (including
+ *  the top and bottom strand gene counts) are gathered from it the same
+ *  way (see HMMViterbiResults::gatherPathCounts).  The path is close to
+ *  but not the same as the viterbi path of the joint model.
+ *
+ *  Typical use would be:
+ *
+ *		HMMStrandDecoder decoder(forwardCodons, reverseCodons, numCodons)
+ *		decoder.decode(geneProbabilities, path)
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMSTRANDDECODER_H
+#define HMMSTRANDDECODER_H
+#include "HMMProbabilities.h"
+#include "HMMTopology.h"
+#include "HMMTrellis.h"
+#include "HMMThreadPool.h"
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+class HMMStrandDecoder
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMStrandDecoder(const uint8_t* forwardCodons, const uint8_t* reverseCodons, int numberOfCodons);
+
+	// Destructor
+	// =============================================
+	~HMMStrandDecoder();
+
+	// Public Class Methods
+	// =============================================
+
+	// HMMProbabilities* singleStrandProbabilities(HMMProbabilities* geneProbabilities, bool reverseStrand)
+	//  Purpose:
+	//		Returns new single strand probabilities (HMMSingleStrandTopology::
+	//		numStates states) for the forward or the reverse
+	//		complement strand taken from the 12 state geneProbabilities
+	static HMMProbabilities* singleStrandProbabilities(HMMProbabilities* geneProbabilities, bool reverseStrand);
+
+	// Public Attributes
+	// =============================================
+	int numConflicts;		// gene calls dropped by the last decode
+
+	// Public Methods
+	// =============================================
+
+	// setCheckpointInterval(int interval)
+	//  Purpose:
+	//		Sets the viterbi checkpoint interval of both strands (see
+	//		HMMTrellis::setCheckpointInterval)
+	void setCheckpointInterval(int interval);
+
+	// setVectorizedViterbi(bool vectorized)
+	//  Purpose:
+	//		Selects the viterbi column calculation of both strands (see
+	//		HMMTrellis::setVectorizedViterbi)
+	void setVectorizedViterbi(bool vectorized);
+
+	// setViterbiPrecision(int precision)
+	//  Purpose:
+	//		Selects the viterbi precision of both strands (see
+	//		HMMTrellis::setViterbiPrecision)
+	void setViterbiPrecision(int precision);
+
+	// decode(HMMProbabilities* geneProbabilities, vector<uint8_t>& path)
+	//  Purpose:
+	//		Decodes both strands with the single strand probabilities taken
+	//		from geneProbabilities, reconciles the genes they call and sets
+	//		path[position - 1] to the 12 state gene model state at every
+	//		position.  geneProbabilities is only read.
+	//  Postconditions:
+	//		numConflicts - number of gene calls dropped because they overlap
+	//					   higher scoring genes
+	void decode(HMMProbabilities* geneProbabilities, vector<uint8_t>& path);
+
+private:
+
+	// Private Attributes
+	// =============================================
+	struct StrandGene {
+		int start;			// first position in forward sequence positions
+		int end;			// last base (the end of the stop codon)
+		bool isTopStrand;
+		long double score;	// log odds against intergenic
+	};
+
+	static const int forwardStrand;
+	static const int reverseStrand;
+	const uint8_t* codons[2];
+	int numCodons;
+	HMMTrellis trellises[2];
+	HMMTopology topologies[2];
+	vector<uint8_t> strandPaths[2];		// single strand state at every position
+	HMMThreadPool pool;
+	int checkpointInterval;
+	int viterbiPrecision;
+
+	// Private Methods
+	// =============================================
+
+	// decodeStrand(int strand, HMMProbabilities* strandProbabilities)
+	//  Purpose:
+	//		Calculates the viterbi weights of strand and walks its path
+	//		backward into strandPaths[strand]
+	void decodeStrand(int strand, HMMProbabilities* strandProbabilities);
+
+	// addStrandGenes(int strand, HMMProbabilities* strandProbabilities, vector<StrandGene>& genes)
+	//  Purpose:
+	//		Adds every complete gene of strandPaths[strand] to genes in
+	//		forward sequence positions.  The score of a gene is the log odds of
+	//		its path against staying intergenic over the same positions.
+	void addStrandGenes(int strand, HMMProbabilities* strandProbabilities, vector<StrandGene>& genes);
+
+	// paintGene(const StrandGene& gene, vector<uint8_t>& path)
+	//  Purpose:
+	//		Sets the 12 state gene model states of the positions of gene
+	void paintGene(const StrandGene& gene, vector<uint8_t>& path);
+
+	HMMStrandDecoder(const HMMStrandDecoder&);
+	HMMStrandDecoder& operator=(const HMMStrandDecoder&);
+};
+
+#endif // HMMSTRANDDECODER_H
@@ -0,0 +1,187 @@
+/*
+ * HMMThreadPool.cpp
+ *
+ *	This is the cpp file for the HMMThreadPool object. HMMThreadPool is
+ *  a small work stealing thread pool used to run independent pieces of
+ *  work (e.g., decoding one sequence each) in parallel.
+ *
+ *  See HMMThreadPool.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+#include "HMMThreadPool.h"
+
+// Constuctors
+// ==============================================
+HMMThreadPool::HMMThreadPool(int numberOfThreads) {
+	numThreads = numberOfThreads;
+	if (numThreads <= 0)
+		numThreads = thread::hardware_concurrency();
+	if (numThreads <= 0)
+		numThreads = 1;
+
+	currentTask = NULL;
+	generation = 0;
+	remainingTasks = 0;
+	activeWorkers = 0;
+	stopping = false;
+
+	for (int worker = 0; worker < numThreads; worker++)
+		queues.push_back(new WorkQueue());
+
+	// A single thread pool runs its tasks on the calling thread
+	if (numThreads > 1) {
+		for (int worker = 0; worker < numThreads; worker++)
+			workers.push_back(thread(&HMMThreadPool::workerLoop, this, worker));
+	}
+}
+
+// Destructor
+// =============================================
+HMMThreadPool::~HMMThreadPool() {
+	{
+		lock_guard<mutex> lock(poolLock);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+
+	for (thread& worker : workers)
+		worker.join();
+
+	for (WorkQueue* queue : queues)
+		delete queue;
+}
+
+// Public Methods
+// =============================================
+
+// run(int numberOfTasks, const function<void(int)>& task)
+//  Purpose:
+//		Calls task(i) for every i in 0..numberOfTasks-1 on the pool's
+//		threads and waits for all of them to finish.
+void HMMThreadPool::run(int numberOfTasks, const function<void(int)>& task) {
+	if (numberOfTasks <= 0)
+		return;
+
+	// No workers, run everything here
+	if (workers.empty()) {
+		for (int i = 0; i < numberOfTasks; i++)
+			task(i);
+		return;
+	}
+
+	unique_lock<mutex> lock(poolLock);
+
+	// Deal the tasks out in contiguous blocks
+	for (int worker = 0; worker < numThreads; worker++) {
+		lock_guard<mutex> queueLock(queues[worker]->lock);
+		queues[worker]->tasks.clear();
+		int firstTask = (int) ((long long) numberOfTasks * worker / numThreads);
+		int lastTask = (int) ((long long) numberOfTasks * (worker + 1) / numThreads);
+		for (int i = firstTask; i < lastTask; i++)
+			queues[worker]->tasks.push_back(i);
+	}
+
+	currentTask = &task;
+	remainingTasks = numberOfTasks;
+	firstError = exception_ptr();
+	generation++;
+	workAvailable.notify_all();
+
+	workDone.wait(lock, [this] { return remainingTasks == 0 && activeWorkers == 0; });
+	currentTask = NULL;
+
+	if (firstError) {
+		exception_ptr error = firstError;
+		firstError = exception_ptr();
+		rethrow_exception(error);
+	}
+}
+
+// int getNumThreads()
+//  Purpose:
+//		Returns the number of worker threads
+int HMMThreadPool::getNumThreads() {
+	return numThreads;
+}
+
+// Private Methods
+// =============================================
+
+// workerLoop(int worker)
+//  Purpose:
+//		Body of every worker thread; waits for a batch of tasks and runs
+//		tasks until none are left
+void HMMThreadPool::workerLoop(int worker) {
+	int seenGeneration = 0;
+
+	while (true) {
+		{
+			unique_lock<mutex> lock(poolLock);
+			workAvailable.wait(lock, [&] { return stopping || generation != seenGeneration; });
+			if (stopping)
+				return;
+
+			seenGeneration = generation;
+			activeWorkers++;
+		}
+
+		int task;
+		while (nextTask(worker, task)) {
+			runTask(task);
+
+			lock_guard<mutex> lock(poolLock);
+			remainingTasks--;
+		}
+
+		lock_guard<mutex> lock(poolLock);
+		activeWorkers--;
+		if (remainingTasks == 0 && activeWorkers == 0)
+			workDone.notify_all();
+	}
+}
+
+// bool nextTask(int worker, int& task)
+//  Purpose:
+//		Takes the next task from the worker's own queue or steals one from
+//		another worker.  Returns false when all queues are empty.
+bool HMMThreadPool::nextTask(int worker, int& task) {
+	// Own queue first (front, in index order)
+	{
+		WorkQueue* queue = queues[worker];
+		lock_guard<mutex> lock(queue->lock);
+		if (!queue->tasks.empty()) {
+			task = queue->tasks.front();
+			queue->tasks.pop_front();
+			return true;
+		}
+	}
+
+	// Steal from the back of the other queues
+	for (int offset = 1; offset < numThreads; offset++) {
+		WorkQueue* queue = queues[(worker + offset) % numThreads];
+		lock_guard<mutex> lock(queue->lock);
+		if (!queue->tasks.empty()) {
+			task = queue->tasks.back();
+			queue->tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// runTask(int task)
+//  Purpose:
+//		Runs one task and records the first exception it throws
+void HMMThreadPool::runTask(int task) {
+	try {
+		(*currentTask)(task);
+	}
+	catch (...) {
+		lock_guard<mutex> lock(poolLock);
+		if (!firstError)
+			firstError = current_exception();
+	}
+}
@@ -0,0 +1,110 @@
+/*
+ * HMMThreadPool.h
+ *
+ *	This is the header file for the HMMThreadPool object. HMMThreadPool is
+ *  a small work stealing thread pool used to run independent pieces of
+ *  work (e.g., decoding one sequence each) in parallel.
+ *
+ *  run(numTasks, task) calls task(i) for every i in 0..numTasks-1 and
+ *  returns once all of them are done.  The task indexes are dealt out to
+ *  the workers in contiguous blocks.  Every worker takes tasks from the
+ *  front of its own queue and when it runs out steals from the back of
+ *  the other workers' queues, so long running tasks do not leave the
+ *  other workers idle.
+ *
+ *  The order the tasks run in is not defined.  Callers that need
+ *  deterministic results should have task(i) write only to slot i of
+ *  their own output and combine the slots in index order afterwards.
+ *
+ *  If a task throws, the remaining tasks are still run and the first
+ *  exception caught is rethrown from run().
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMTHREADPOOL_H
+#define HMMTHREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+using namespace std;
+
+class HMMThreadPool
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMThreadPool(int numberOfThreads);	// 0 uses one thread per core
+
+	// Destructor
+	// =============================================
+	~HMMThreadPool();
+
+	// Public Methods
+	// =============================================
+
+	// run(int numberOfTasks, const function<void(int)>& task)
+	//  Purpose:
+	//		Calls task(i) for every i in 0..numberOfTasks-1 on the pool's
+	//		threads and waits for all of them to finish.
+	void run(int numberOfTasks, const function<void(int)>& task);
+
+	// int getNumThreads()
+	//  Purpose:
+	//		Returns the number of worker threads
+	int getNumThreads();
+
+private:
+	// Private Attributes
+	// =============================================
+	struct WorkQueue {
+		mutex lock;
+		deque<int> tasks;
+	};
+
+	int numThreads;
+	vector<thread> workers;
+	vector<WorkQueue*> queues;
+
+	mutex poolLock;
+	condition_variable workAvailable;
+	condition_variable workDone;
+	const function<void(int)>* currentTask;
+	int generation;
+	int remainingTasks;
+	int activeWorkers;
+	bool stopping;
+	exception_ptr firstError;
+
+	// Private Methods
+	// =============================================
+
+	// workerLoop(int worker)
+	//  Purpose:
+	//		Body of every worker thread; waits for a batch of tasks and runs
+	//		tasks until none are left
+	void workerLoop(int worker);
+
+	// bool nextTask(int worker, int& task)
+	//  Purpose:
+	//		Takes the next task from the worker's own queue or steals one from
+	//		another worker.  Returns false when all queues are empty.
+	bool nextTask(int worker, int& task);
+
+	// runTask(int task)
+	//  Purpose:
+	//		Runs one task and records the first exception it throws
+	void runTask(int task);
+
+	// The threads are owned by the pool so it can not be copied
+	HMMThreadPool(const HMMThreadPool&);
+	HMMThreadPool& operator=(const HMMThreadPool&);
+};
+
+#endif // HMMTHREADPOOL_H
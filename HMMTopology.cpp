@@ -0,0 +1,76 @@
+/*
+ * HMMTopology.cpp
+ *
+ *	This is the cpp file for the HMMTopology object. HMMTopology is
+ *  the set of legal transitions (arcs) of a hidden markov model compiled
+ *  from the non-zero transition probabilities in an HMMProbabilities
+ *  object.  The arcs are stored in compressed sparse row (CSR) form twice:
+ *  once grouped by end state (predecessor lists) and once grouped by start
+ *  state (successor lists).  Within each list the states are in ascending
+ *  order.  The log transition probability of each arc is stored alongside
+ *  it so the recursions do not have to look it up.  State 0 is the start
+ *  state; its arcs are the initiation probabilities and are not part of
+ *  the topology.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+#include "HMMTopology.h"
+#include "MathUtilities.h"
+
+// Constuctors
+// ==============================================
+HMMTopology::HMMTopology() {
+	numStates = 0;
+}
+
+HMMTopology::HMMTopology(HMMProbabilities* probabilities, int numberOfStates) {
+	numStates = numberOfStates;
+
+	// Predecessor lists (arcs into each state)
+	predecessorOffsets.push_back(0);
+	predecessorOffsets.push_back(0);
+	for (int endState = 1; endState < numStates; endState++) {
+		for (int startState = 1; startState < numStates; startState++) {
+			long double logProbability = probabilities->logTransitionProbability(startState, endState);
+			if (MathUtilities::isNaN(logProbability))
+				continue;
+
+			predecessors.push_back(startState);
+			predecessorLogProbabilities.push_back(logProbability);
+			predecessorProbabilities.push_back(probabilities->transitionProbability(startState, endState));
+		}
+		predecessorOffsets.push_back(predecessors.size());
+	}
+
+	// Successor lists (arcs out of each state)
+	successorOffsets.push_back(0);
+	successorOffsets.push_back(0);
+	for (int startState = 1; startState < numStates; startState++) {
+		for (int endState = 1; endState < numStates; endState++) {
+			long double logProbability = probabilities->logTransitionProbability(startState, endState);
+			if (MathUtilities::isNaN(logProbability))
+				continue;
+
+			successors.push_back(endState);
+			successorLogProbabilities.push_back(logProbability);
+			successorProbabilities.push_back(probabilities->transitionProbability(startState, endState));
+		}
+		successorOffsets.push_back(successors.size());
+	}
+}
+
+// Destructor
+// =============================================
+HMMTopology::~HMMTopology() {
+}
+
+// Public Methods
+// =============================================
+
+// int numArcs()
+//  Purpose:
+//		Returns the number of legal transitions in the topology
+int HMMTopology::numArcs() {
+	return predecessors.size();
+}
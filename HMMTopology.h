@@ -0,0 +1,72 @@
+/*
+ * HMMTopology.h
+ *
+ *	This is the header file for the HMMTopology object. HMMTopology is
+ *  the set of legal transitions (arcs) of a hidden markov model compiled
+ *  from the non-zero transition probabilities in an HMMProbabilities
+ *  object.  The arcs are stored in compressed sparse row (CSR) form twice:
+ *  once grouped by end state (predecessor lists) and once grouped by start
+ *  state (successor lists).  Within each list the states are in ascending
+ *  order.  The log transition probability of each arc (and the plain
+ *  probability used by the scaled forward-backward recursions) is stored
+ *  alongside it so the recursions do not have to look it up.  State 0 is
+ *  the start state; its arcs are the initiation probabilities and are not
+ *  part of the topology.
+ *
+ *  The arcs for state s are at indexes
+ *		predecessorOffsets[s] .. predecessorOffsets[s + 1] - 1
+ *  of predecessors/predecessorLogProbabilities (and the same for the
+ *  successor arrays).
+ *
+ *  The topology is a snapshot.  It must be rebuilt whenever the
+ *  transition probabilities it was compiled from are changed.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMTOPOLOGY_H
+#define HMMTOPOLOGY_H
+#include "HMMProbabilities.h"
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+class HMMTopology
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMTopology();
+	HMMTopology(HMMProbabilities* probabilities, int numberOfStates);
+
+	// Destructor
+	// =============================================
+	~HMMTopology();
+
+	// Public Attributes
+	// =============================================
+	int numStates;
+
+	// Arcs grouped by end state
+	vector<int> predecessorOffsets;
+	vector<uint8_t> predecessors;
+	vector<long double> predecessorLogProbabilities;
+	vector<double> predecessorProbabilities;
+
+	// Arcs grouped by start state
+	vector<int> successorOffsets;
+	vector<uint8_t> successors;
+	vector<long double> successorLogProbabilities;
+	vector<double> successorProbabilities;
+
+	// Public Methods
+	// =============================================
+
+	// int numArcs()
+	//  Purpose:
+	//		Returns the number of legal transitions in the topology
+	int numArcs();
+};
+
+#endif // HMMTOPOLOGY_H
@@ -0,0 +1,1128 @@
+/*
+ * HMMTrellis.cpp
+ *
+ *	This is the cpp file for the HMMTrellis object. The HMMTrellis
+ *  holds every per-position value calculated for a hidden markov model
+ *  in flat contiguous arrays indexed by [position][state].  Position 0
+ *  is the start position (only state 0 is meaningful there) and positions
+ *  1..numPositions correspond to the trinucleotides of the sequence.  The
+ *  sequence is read as an array of codon indexes (see CodonUtilities) so
+ *  emission probabilities are looked up directly from the flat emission
+ *  table.
+ *
+ *  Transitions are never materialized.  Transition and emission
+ *  probabilities are looked up from the HMMProbabilities object passed
+ *  to each calculation, so the trellis can be recalculated in place every
+ *  time the probabilities are changed by training.
+ *
+ *  See HMMTrellis.h for a description of checkpointed viterbi decoding
+ *  and ORF pruning.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+#include "HMMTrellis.h"
+#include "MathUtilities.h"
+#include "HMMGeneTopology.h"
+#include "HMMUnrolledKernel.h"
+#include "HMMInstrumentation.h"
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+// const variable initialization
+// ==============================================
+const uint8_t HMMTrellis::noPreviousState = 0xFF;
+const int HMMTrellis::automaticCheckpointInterval = -1;
+const string HMMTrellis::noPathError = "The sequence can not be generated by the model (no viterbi path)";
+
+// Constuctors
+// ==============================================
+HMMTrellis::HMMTrellis() {
+	numStates = 0;
+	numPositions = 0;
+	codons = NULL;
+	checkpointInterval = 0;
+	segmentStart = 0;
+	segmentEnd = 0;
+	viterbiProbabilities = NULL;
+	viterbiTopology = NULL;
+	unrolledViterbi = false;
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+	stateMasks = NULL;
+	exactStateMasks = true;
+}
+
+HMMTrellis::HMMTrellis(const uint8_t* someCodons, int numberOfPositions, int numberOfStates) {
+	codons = someCodons;
+	numPositions = numberOfPositions;
+	numStates = numberOfStates;
+	checkpointInterval = 0;
+	segmentStart = 0;
+	segmentEnd = 0;
+	viterbiProbabilities = NULL;
+	viterbiTopology = NULL;
+	unrolledViterbi = false;
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+	stateMasks = NULL;
+	exactStateMasks = true;
+}
+
+// Destructor
+// =============================================
+HMMTrellis::~HMMTrellis() {
+}
+
+// Public Methods
+// =============================================
+
+// calculateHighestWeightPaths(HMMProbabilities* probabilities, HMMTopology* topology)
+//  Purpose:
+//		Calculate and store the highest weight using the viterbi algorithm
+//		for every state at every position.  Only the legal transitions in
+//		topology are considered.
+//
+//		The path weight for a state uses the formula:
+//			  previous states weight
+//			+ transmission probability
+//			+ emission Probability
+//
+//		Ties are broken in favor of the lowest numbered previous state.
+//
+//  Postconditions:
+//		highestWeights - set to highest calculated weight
+//		highestWeightPreviousStates - set to the previous state that generated
+//									  the highest calculated weight
+void HMMTrellis::calculateHighestWeightPaths(HMMProbabilities* probabilities, HMMTopology* topology) {
+	HMM_SCOPED_TIMER(viterbiTimer);
+	HMM_COUNT(positionsCounter, numPositions);
+	HMM_INSTRUMENT(countArcs(probabilities, topology));
+
+	viterbiProbabilities = probabilities;
+	viterbiTopology = topology;
+	segmentStart = 0;
+	segmentEnd = 0;
+	unrolledViterbi =
+		HMMUnrolledKernel<HMMGeneTopology>::supports(probabilities, topology) ||
+		HMMUnrolledKernel<HMMSingleStrandTopology>::supports(probabilities, topology);
+	if (viterbiPrecision != HMMViterbiKernel::longDoublePrecision)
+		viterbiKernel = HMMViterbiKernel(probabilities, topology, viterbiPrecision);
+
+	// Full trellis
+	if (checkpointInterval == 0) {
+		int numCells = (numPositions + 1) * numStates;
+		highestWeights.assign(numCells, -DBL_MAX);
+		highestWeightPreviousStates.assign(numCells, noPreviousState);
+		checkpointWeights.clear();
+		segmentWeights.clear();
+		segmentPreviousStates.clear();
+
+		// Start position
+		highestWeights[0] = 0;
+
+		for (int position = 1; position <= numPositions; position++) {
+			calculateHighestWeightColumn(
+				probabilities,
+				topology,
+				position,
+				&highestWeights[(position - 1) * numStates],
+				&highestWeights[position * numStates],
+				&highestWeightPreviousStates[position * numStates]);
+		}
+		return;
+	}
+
+	// Checkpointed trellis: keep two working columns and copy every
+	// checkpoint column out
+	highestWeights.clear();
+	highestWeightPreviousStates.clear();
+	int numCheckpoints = numPositions / checkpointInterval + 1;
+	checkpointWeights.assign(numCheckpoints * numStates, -DBL_MAX);
+	segmentWeights.assign(checkpointInterval * numStates, -DBL_MAX);
+	segmentPreviousStates.assign(checkpointInterval * numStates, noPreviousState);
+
+	vector<double> columns(2 * numStates, -DBL_MAX);
+	vector<uint8_t> previousStates(numStates);
+
+	// Start position
+	columns[0] = 0;
+	checkpointWeights[0] = 0;
+
+	for (int position = 1; position <= numPositions; position++) {
+		double* previousWeights = &columns[((position - 1) & 1) * numStates];
+		double* weights = &columns[(position & 1) * numStates];
+		fill(weights, weights + numStates, -DBL_MAX);
+
+		calculateHighestWeightColumn(probabilities, topology, position, previousWeights, weights, &previousStates[0]);
+
+		if (position % checkpointInterval == 0)
+			copy(weights, weights + numStates, &checkpointWeights[(position / checkpointInterval) * numStates]);
+	}
+}
+
+// releaseHighestWeightPaths()
+//  Purpose:
+//		Frees the memory held by the viterbi weights and previous states.
+//		The viterbi accessors can not be used until
+//		calculateHighestWeightPaths is called again.
+void HMMTrellis::releaseHighestWeightPaths() {
+	vector<double>().swap(highestWeights);
+	vector<uint8_t>().swap(highestWeightPreviousStates);
+	vector<double>().swap(checkpointWeights);
+	vector<double>().swap(segmentWeights);
+	vector<uint8_t>().swap(segmentPreviousStates);
+	segmentStart = 0;
+	segmentEnd = 0;
+	viterbiProbabilities = NULL;
+	viterbiTopology = NULL;
+}
+
+// setCheckpointInterval(int interval)
+//  Purpose:
+//		Sets the number of positions between the viterbi checkpoint columns.
+//		0 keeps the full trellis and automaticCheckpointInterval uses
+//		sqrt(numPositions).  Takes effect on the next call to
+//		calculateHighestWeightPaths.
+void HMMTrellis::setCheckpointInterval(int interval) {
+	if (interval == automaticCheckpointInterval)
+		interval = (int) ceil(sqrt((double) numPositions));
+
+	checkpointInterval = (interval > 0) ? interval : 0;
+}
+
+// setVectorizedViterbi(bool vectorized)
+//  Purpose:
+//		Selects the HMMViterbiKernel (true) or the long double reference
+//		(false, the default) viterbi column calculation.  Takes effect on the
+//		next call to calculateHighestWeightPaths.
+void HMMTrellis::setVectorizedViterbi(bool vectorized) {
+	viterbiPrecision = vectorized ? HMMViterbiKernel::doublePrecision : HMMViterbiKernel::longDoublePrecision;
+}
+
+// setViterbiPrecision(int precision)
+//  Purpose:
+//		Selects the precision of the viterbi column calculation:
+//		HMMViterbiKernel::longDoublePrecision (the reference, the default),
+//		doublePrecision or floatPrecision (both HMMViterbiKernel).  Takes
+//		effect on the next call to calculateHighestWeightPaths.
+void HMMTrellis::setViterbiPrecision(int precision) {
+	viterbiPrecision = precision;
+}
+
+// setOrfIndex(HMMOrfIndex* index)
+//  Purpose:
+//		Prunes the states index rules out from every recursion (see ORF
+//		pruning in HMMTrellis.h).  index must be built over the codons of
+//		the trellis and stay valid while it is set.  NULL (the default)
+//		calculates every state.
+void HMMTrellis::setOrfIndex(HMMOrfIndex* index) {
+	stateMasks = (index != NULL && !index->stateMasks.empty()) ? &index->stateMasks[0] : NULL;
+	exactStateMasks = (index == NULL) || index->isExact();
+}
+
+// calculateLogForwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology)
+//  Purpose:
+//		Calculate and store the log forward probabilty for the forward-backward
+//		(Baum-Welch) algorithm for every state at every position.
+//
+//  Postconditions:
+//		logForwardProbabilities - set to calculated log probabilities
+void HMMTrellis::calculateLogForwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology) {
+	HMM_SCOPED_TIMER(forwardTimer);
+	HMM_INSTRUMENT(countArcs(probabilities, topology));
+
+	logForwardProbabilities.assign((numPositions + 1) * numStates, 0);
+	vector<long double> logEmissions(numStates);
+	bool unrolled =
+		HMMUnrolledKernel<HMMGeneTopology>::supports(probabilities, topology) ||
+		HMMUnrolledKernel<HMMSingleStrandTopology>::supports(probabilities, topology);
+
+	for (int position = 1; position <= numPositions; position++) {
+		long double* previousForward = &logForwardProbabilities[(position - 1) * numStates];
+		long double* forward = &logForwardProbabilities[position * numStates];
+
+		if (unrolled && position > 1) {
+			unsigned int stateMask = (stateMasks != NULL) ? stateMasks[position] : ~0u;
+			if (numStates == HMMGeneTopology::numStates)
+				HMMUnrolledKernel<HMMGeneTopology>::logForwardColumn(probabilities, codons[position - 1], previousForward, forward, stateMask);
+			else
+				HMMUnrolledKernel<HMMSingleStrandTopology>::logForwardColumn(probabilities, codons[position - 1], previousForward, forward, stateMask);
+			continue;
+		}
+
+		calculateLogEmissionProbabilities(probabilities, position, &logEmissions[0]);
+
+		for (int state = 1; state < numStates; state++) {
+			if (isPruned(position, state)) {
+				forward[state] = std::numeric_limits<double>::quiet_NaN();
+				continue;
+			}
+
+			// Calculation for first position only
+			if (position == 1) {
+				forward[state] =
+					MathUtilities::elnprod(
+						probabilities->logInitiationProbability(state),	// Initiation prob
+						logEmissions[state]								// Emission prob
+					);
+				continue;
+			}
+
+			// Calculation for all other positions
+			long double logAlpha = std::numeric_limits<double>::quiet_NaN();
+			for (int arc = topology->predecessorOffsets[state]; arc < topology->predecessorOffsets[state + 1]; arc++) {
+				logAlpha =
+					MathUtilities::elnsum(
+						logAlpha,
+						MathUtilities::elnprod(
+							previousForward[topology->predecessors[arc]],		// prev prob
+							topology->predecessorLogProbabilities[arc]			// transition prob
+						)
+					);
+			}
+			forward[state] =
+				MathUtilities::elnprod(
+					logAlpha,
+					logEmissions[state]											// emission prob
+				);
+		}
+	}
+}
+
+// calculateLogBackwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology)
+//  Purpose:
+//		Calculate and store the log backward probabilty for the forward-backward
+//		(Baum-Welch) algorithm for every state at every position.  The last
+//		position is set to a log probability of 0.
+//
+//  Postconditions:
+//		logBackwardProbabilities - set to calculated log probabilities
+void HMMTrellis::calculateLogBackwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology) {
+	HMM_SCOPED_TIMER(backwardTimer);
+	HMM_INSTRUMENT(countArcs(probabilities, topology));
+
+	logBackwardProbabilities.assign((numPositions + 1) * numStates, 0);
+	vector<long double> nextLogEmissions(numStates);
+
+	// Walk the positions backward and calculate the probabilites
+	for (int position = numPositions - 1; position >= 1; position--) {
+		calculateLogEmissionProbabilities(probabilities, position + 1, &nextLogEmissions[0]);
+
+		long double* nextBackward = &logBackwardProbabilities[(position + 1) * numStates];
+		long double* backward = &logBackwardProbabilities[position * numStates];
+
+		for (int state = 1; state < numStates; state++) {
+			long double logBeta = std::numeric_limits<double>::quiet_NaN();
+			if (isPruned(position, state)) {
+				backward[state] = logBeta;
+				continue;
+			}
+
+			for (int arc = topology->successorOffsets[state]; arc < topology->successorOffsets[state + 1]; arc++) {
+				int next = topology->successors[arc];
+				logBeta =
+					MathUtilities::elnsum(
+						logBeta,
+						MathUtilities::elnprod(
+							topology->successorLogProbabilities[arc],				// transition prob
+							MathUtilities::elnprod(
+								nextLogEmissions[next],								// emission prob
+								nextBackward[next]									// prev prob
+							)
+						)
+					);
+			}
+			backward[state] = logBeta;
+		}
+	}
+}
+
+// calculateLogConditionalProbabilities()
+//  Purpose:
+//		Calculate and store the log conditional probability for every state
+//		at every position. This is the probabilty of being in a state at a
+//		particular position given the model.
+//	Preconditions:
+//		forward and backward probabilities have been calculated
+//  Postconditions:
+//		logConditionalProbabilities - set for all states at all positions
+void HMMTrellis::calculateLogConditionalProbabilities() {
+	logConditionalProbabilities.assign((numPositions + 1) * numStates, 0);
+
+	for (int position = 1; position <= numPositions; position++) {
+		long double* forward = &logForwardProbabilities[position * numStates];
+		long double* backward = &logBackwardProbabilities[position * numStates];
+		long double* conditional = &logConditionalProbabilities[position * numStates];
+
+		// Calculated normailzer for forwardProp*backwardProb for this position
+		//   (Sum up forwardProb*backwardProb for all states)
+		long double normalizer = std::numeric_limits<double>::quiet_NaN();
+		for (int state = 1; state < numStates; state++) {
+			conditional[state] = MathUtilities::elnprod(forward[state], backward[state]);
+			normalizer = MathUtilities::elnsum(normalizer, conditional[state]);
+		}
+
+		// Calculate the condtional probability for each state at this position
+		//	(forwardProb*backwardProp/normalizer)
+		for (int state = 1; state < numStates; state++) {
+			conditional[state] = MathUtilities::elnprod(conditional[state], -normalizer);
+		}
+	}
+}
+
+// accumulateExpectedCounts(probabilities, topology, counts)
+//  Purpose:
+//		One pass over the positions that calculates the conditional
+//		probability of every state and of every legal transition between
+//		adjacent positions and sums them (in log space) into counts (see
+//		HMMExpectedCounts).  The conditional probabilities are not stored.
+//		The log likelihood of the sequence is added to counts as well.
+//	Preconditions:
+//		forward and backward probabilities have been calculated
+//  Postconditions:
+//		counts - contains the summed log values for this sequence
+void HMMTrellis::accumulateExpectedCounts(
+	HMMProbabilities* probabilities,
+	HMMTopology* topology,
+	HMMExpectedCounts& counts) {
+	HMM_SCOPED_TIMER(expectedCountsTimer);
+
+	vector<long double> conditional(numStates);
+	vector<long double> nextLogEmissions(numStates);
+	vector<long double> transitionConditionals(topology->numArcs());
+
+	for (int position = 1; position <= numPositions; position++) {
+		long double* forward = &logForwardProbabilities[position * numStates];
+		long double* backward = &logBackwardProbabilities[position * numStates];
+
+		// Calculated normailzer for forwardProp*backwardProb for this position
+		//   (Sum up forwardProb*backwardProb for all states)
+		long double normalizer = std::numeric_limits<double>::quiet_NaN();
+		for (int state = 1; state < numStates; state++) {
+			conditional[state] = MathUtilities::elnprod(forward[state], backward[state]);
+			normalizer = MathUtilities::elnsum(normalizer, conditional[state]);
+		}
+
+		// Calculate the condtional probability for each state at this position
+		//	(forwardProb*backwardProp/normalizer) and add it to the state counts
+		int positionCodon = codons[position - 1];
+		for (int state = 1; state < numStates; state++) {
+			conditional[state] = MathUtilities::elnprod(conditional[state], -normalizer);
+
+			int emissionIndex = state * CodonUtilities::numEmissionCodons + positionCodon;
+			counts.logEmissionCounts[emissionIndex] =
+				MathUtilities::elnsum(counts.logEmissionCounts[emissionIndex], conditional[state]);
+			counts.logEmissionStateCounts[state] =
+				MathUtilities::elnsum(counts.logEmissionStateCounts[state], conditional[state]);
+
+			if (position == 1)
+				counts.logInitiationCounts[state] =
+					MathUtilities::elnsum(counts.logInitiationCounts[state], conditional[state]);
+		}
+
+		// The last position has no transitions out of it
+		if (position == numPositions)
+			break;
+
+		calculateLogEmissionProbabilities(probabilities, position + 1, &nextLogEmissions[0]);
+		long double* nextBackward = &logBackwardProbabilities[(position + 1) * numStates];
+
+		// Calculate normailzer and non-normalized log conditional prob
+		// for each transition
+		normalizer = std::numeric_limits<double>::quiet_NaN();
+		for (int state = 1; state < numStates; state++) {
+			for (int arc = topology->successorOffsets[state]; arc < topology->successorOffsets[state + 1]; arc++) {
+				int next = topology->successors[arc];
+				transitionConditionals[arc] =
+					MathUtilities::elnprod(
+						forward[state],													// forward prob
+						MathUtilities::elnprod(
+							topology->successorLogProbabilities[arc],					// transition prob
+							MathUtilities::elnprod(
+								nextLogEmissions[next],									// next emission prob
+								nextBackward[next]										// next backward prob
+							)
+						)
+					);
+				normalizer = MathUtilities::elnsum(normalizer, transitionConditionals[arc]);
+			}
+		}
+
+		// Normalize the cacluated values and add them to the sums
+		for (int state = 1; state < numStates; state++) {
+			for (int arc = topology->successorOffsets[state]; arc < topology->successorOffsets[state + 1]; arc++) {
+				int index = state * numStates + topology->successors[arc];
+				counts.logTransitionCounts[index] =
+					MathUtilities::elnsum(
+						counts.logTransitionCounts[index],
+						MathUtilities::elnprod(transitionConditionals[arc], -normalizer)
+					);
+			}
+			counts.logStateCounts[state] = MathUtilities::elnsum(counts.logStateCounts[state], conditional[state]);
+		}
+	}
+
+	counts.numSequences++;
+	counts.logLikelihood += logLikelihood();
+}
+
+// calculateScaledForwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology)
+//  Purpose:
+//		Calculate and store the scaled forward probability of every state at
+//		every position.  Throws a runtime_error if the sequence can not be
+//		generated by the model (a column sums to zero).
+//
+//  Postconditions:
+//		scaledForwardProbabilities - set to the normalized forward probabilities
+//		scaleFactors - set to the sum of each column before normalization
+void HMMTrellis::calculateScaledForwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology) {
+	HMM_SCOPED_TIMER(forwardTimer);
+	HMM_INSTRUMENT(countArcs(probabilities, topology));
+
+	scaledForwardProbabilities.assign((numPositions + 1) * numStates, 0);
+	scaleFactors.assign(numPositions + 1, 1.0);
+	vector<double> emissions(numStates);
+
+	for (int position = 1; position <= numPositions; position++) {
+		calculateEmissionProbabilities(probabilities, position, &emissions[0]);
+
+		double* previousForward = &scaledForwardProbabilities[(position - 1) * numStates];
+		double* forward = &scaledForwardProbabilities[position * numStates];
+
+		double scale = 0;
+		for (int state = 1; state < numStates; state++) {
+			if (isPruned(position, state))
+				continue;
+
+			double alpha = 0;
+
+			// The first position can only be entered from the start state
+			if (position == 1) {
+				alpha = probabilities->initiationProbability(state);
+			}
+			else {
+				for (int arc = topology->predecessorOffsets[state]; arc < topology->predecessorOffsets[state + 1]; arc++) {
+					alpha += previousForward[topology->predecessors[arc]] * topology->predecessorProbabilities[arc];
+				}
+			}
+
+			forward[state] = alpha * emissions[state];
+			scale += forward[state];
+		}
+
+		if (scale <= 0)
+			throw runtime_error("Sequence can not be generated by the model");
+
+		// Normalize the column
+		double inverseScale = 1.0 / scale;
+		for (int state = 1; state < numStates; state++) {
+			forward[state] *= inverseScale;
+		}
+		scaleFactors[position] = scale;
+	}
+}
+
+// calculateScaledBackwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology)
+//  Purpose:
+//		Calculate and store the scaled backward probability of every state at
+//		every position.  The last position is set to 1.
+//	Preconditions:
+//		scaled forward probabilities have been calculated
+//  Postconditions:
+//		scaledBackwardProbabilities - set to calculated probabilities
+void HMMTrellis::calculateScaledBackwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology) {
+	HMM_SCOPED_TIMER(backwardTimer);
+	HMM_INSTRUMENT(countArcs(probabilities, topology));
+
+	scaledBackwardProbabilities.assign((numPositions + 1) * numStates, 0);
+	vector<double> nextEmissions(numStates);
+
+	if (numPositions > 0)
+		fill(scaledBackwardProbabilities.begin() + numPositions * numStates, scaledBackwardProbabilities.end(), 1.0);
+
+	// Walk the positions backward and calculate the probabilites
+	for (int position = numPositions - 1; position >= 1; position--) {
+		calculateEmissionProbabilities(probabilities, position + 1, &nextEmissions[0]);
+
+		double* nextBackward = &scaledBackwardProbabilities[(position + 1) * numStates];
+		double* backward = &scaledBackwardProbabilities[position * numStates];
+		double inverseScale = 1.0 / scaleFactors[position + 1];
+
+		for (int state = 1; state < numStates; state++) {
+			if (isPruned(position, state))
+				continue;
+
+			double beta = 0;
+			for (int arc = topology->successorOffsets[state]; arc < topology->successorOffsets[state + 1]; arc++) {
+				int next = topology->successors[arc];
+				beta += topology->successorProbabilities[arc] * nextEmissions[next] * nextBackward[next];
+			}
+			backward[state] = beta * inverseScale;
+		}
+	}
+}
+
+// accumulateScaledExpectedCounts(probabilities, topology, counts)
+//  Purpose:
+//		Same as accumulateExpectedCounts using the scaled forward and
+//		backward probabilities.  The counts are summed in double and
+//		added to counts (which are kept in log space) at the end.
+//	Preconditions:
+//		scaled forward and backward probabilities have been calculated
+//  Postconditions:
+//		counts - contains the summed log values for this sequence
+void HMMTrellis::accumulateScaledExpectedCounts(
+	HMMProbabilities* probabilities,
+	HMMTopology* topology,
+	HMMExpectedCounts& counts) {
+	HMM_SCOPED_TIMER(expectedCountsTimer);
+
+	int numEmissionCells = numStates * CodonUtilities::numEmissionCodons;
+	vector<double> initiationCounts(numStates, 0);
+	vector<double> stateCounts(numStates, 0);
+	vector<double> transitionCounts(numStates * numStates, 0);
+	vector<double> emissionCounts(numEmissionCells, 0);
+	vector<double> emissionStateCounts(numStates, 0);
+
+	vector<double> conditional(numStates);
+	vector<double> nextEmissions(numStates);
+	vector<double> transitionConditionals(topology->numArcs());
+
+	for (int position = 1; position <= numPositions; position++) {
+		double* forward = &scaledForwardProbabilities[position * numStates];
+		double* backward = &scaledBackwardProbabilities[position * numStates];
+
+		// Conditional probability of each state (forwardProb*backwardProb,
+		// normalized to remove rounding drift)
+		double normalizer = 0;
+		for (int state = 1; state < numStates; state++) {
+			conditional[state] = forward[state] * backward[state];
+			normalizer += conditional[state];
+		}
+
+		double inverseNormalizer = (normalizer > 0) ? 1.0 / normalizer : 0;
+		int positionCodon = codons[position - 1];
+		for (int state = 1; state < numStates; state++) {
+			conditional[state] *= inverseNormalizer;
+			emissionCounts[state * CodonUtilities::numEmissionCodons + positionCodon] += conditional[state];
+			emissionStateCounts[state] += conditional[state];
+
+			if (position == 1)
+				initiationCounts[state] += conditional[state];
+		}
+
+		// The last position has no transitions out of it
+		if (position == numPositions)
+			break;
+
+		calculateEmissionProbabilities(probabilities, position + 1, &nextEmissions[0]);
+		double* nextBackward = &scaledBackwardProbabilities[(position + 1) * numStates];
+
+		// Non-normalized conditional probability of each transition
+		normalizer = 0;
+		for (int state = 1; state < numStates; state++) {
+			for (int arc = topology->successorOffsets[state]; arc < topology->successorOffsets[state + 1]; arc++) {
+				int next = topology->successors[arc];
+				transitionConditionals[arc] =
+					forward[state] * topology->successorProbabilities[arc] * nextEmissions[next] * nextBackward[next];
+				normalizer += transitionConditionals[arc];
+			}
+		}
+
+		// Normalize the cacluated values and add them to the sums
+		inverseNormalizer = (normalizer > 0) ? 1.0 / normalizer : 0;
+		for (int state = 1; state < numStates; state++) {
+			for (int arc = topology->successorOffsets[state]; arc < topology->successorOffsets[state + 1]; arc++) {
+				transitionCounts[state * numStates + topology->successors[arc]] += transitionConditionals[arc] * inverseNormalizer;
+			}
+			stateCounts[state] += conditional[state];
+		}
+	}
+
+	// Add the counts to the log space accumulator
+	for (int state = 0; state < numStates; state++) {
+		counts.logInitiationCounts[state] =
+			MathUtilities::elnsum(counts.logInitiationCounts[state], MathUtilities::eln(initiationCounts[state]));
+		counts.logStateCounts[state] =
+			MathUtilities::elnsum(counts.logStateCounts[state], MathUtilities::eln(stateCounts[state]));
+		counts.logEmissionStateCounts[state] =
+			MathUtilities::elnsum(counts.logEmissionStateCounts[state], MathUtilities::eln(emissionStateCounts[state]));
+	}
+	for (int i = 0; i < numStates * numStates; i++) {
+		counts.logTransitionCounts[i] =
+			MathUtilities::elnsum(counts.logTransitionCounts[i], MathUtilities::eln(transitionCounts[i]));
+	}
+	for (int i = 0; i < numEmissionCells; i++) {
+		counts.logEmissionCounts[i] =
+			MathUtilities::elnsum(counts.logEmissionCounts[i], MathUtilities::eln(emissionCounts[i]));
+	}
+
+	counts.numSequences++;
+	counts.logLikelihood += scaledLogLikelihood();
+}
+
+// accumulatePosteriorGenes(probabilities, topology, results)
+//  Purpose:
+//		One log space backward pass fused with the posterior decoding: the
+//		backward column of a position is kept only until the one before it
+//		has been calculated, and the posterior probability of every state
+//		at every position is reduced into results as soon as it is known
+//		(see HMMPosteriorResults).  Neither the backward nor the
+//		conditional probabilities of all positions are stored.  The log
+//		likelihood of the sequence is set in results as well.
+//	Preconditions:
+//		log forward probabilities have been calculated
+//  Postconditions:
+//		results - contains the genes and their posterior sums
+void HMMTrellis::accumulatePosteriorGenes(
+	HMMProbabilities* probabilities,
+	HMMTopology* topology,
+	HMMPosteriorResults& results) {
+	HMM_SCOPED_TIMER(backwardTimer);
+	HMM_INSTRUMENT(countArcs(probabilities, topology));
+
+	// The backward column of the position and of the one after it
+	vector<long double> backward(numStates, 0);
+	vector<long double> nextBackward(numStates, 0);
+	vector<long double> nextLogEmissions(numStates);
+	vector<long double> conditional(numStates);
+	vector<double> posteriors(numStates, 0);
+
+	// Walk the positions backward, the last position has a log backward
+	// probability of 0
+	for (int position = numPositions; position >= 1; position--) {
+		if (position < numPositions) {
+			calculateLogEmissionProbabilities(probabilities, position + 1, &nextLogEmissions[0]);
+			backward.swap(nextBackward);
+
+			for (int state = 1; state < numStates; state++) {
+				long double logBeta = std::numeric_limits<double>::quiet_NaN();
+				if (isPruned(position, state)) {
+					backward[state] = logBeta;
+					continue;
+				}
+
+				for (int arc = topology->successorOffsets[state]; arc < topology->successorOffsets[state + 1]; arc++) {
+					int next = topology->successors[arc];
+					logBeta =
+						MathUtilities::elnsum(
+							logBeta,
+							MathUtilities::elnprod(
+								topology->successorLogProbabilities[arc],				// transition prob
+								MathUtilities::elnprod(
+									nextLogEmissions[next],								// emission prob
+									nextBackward[next]									// prev prob
+								)
+							)
+						);
+				}
+				backward[state] = logBeta;
+			}
+		}
+
+		// Posterior of each state at this position
+		//	(forwardProb*backwardProp/normalizer)
+		long double* forward = &logForwardProbabilities[position * numStates];
+		long double normalizer = std::numeric_limits<double>::quiet_NaN();
+		for (int state = 1; state < numStates; state++) {
+			conditional[state] = MathUtilities::elnprod(forward[state], backward[state]);
+			normalizer = MathUtilities::elnsum(normalizer, conditional[state]);
+		}
+		for (int state = 1; state < numStates; state++) {
+			posteriors[state] = MathUtilities::eexp(MathUtilities::elnprod(conditional[state], -normalizer));
+		}
+
+		results.addPosteriorColumn(position, &posteriors[0]);
+	}
+
+	results.endColumns();
+	results.logLikelihood = logLikelihood();
+}
+
+// accumulateScaledPosteriorGenes(probabilities, topology, results)
+//  Purpose:
+//		Same as accumulatePosteriorGenes using the scaled forward and
+//		backward probabilities
+//	Preconditions:
+//		scaled forward probabilities have been calculated
+//  Postconditions:
+//		results - contains the genes and their posterior sums
+void HMMTrellis::accumulateScaledPosteriorGenes(
+	HMMProbabilities* probabilities,
+	HMMTopology* topology,
+	HMMPosteriorResults& results) {
+	HMM_SCOPED_TIMER(backwardTimer);
+	HMM_INSTRUMENT(countArcs(probabilities, topology));
+
+	// The backward column of the position and of the one after it
+	vector<double> backward(numStates, 1.0);
+	vector<double> nextBackward(numStates, 1.0);
+	vector<double> nextEmissions(numStates);
+	vector<double> posteriors(numStates, 0);
+
+	// Walk the positions backward, the last position is set to 1
+	for (int position = numPositions; position >= 1; position--) {
+		if (position < numPositions) {
+			calculateEmissionProbabilities(probabilities, position + 1, &nextEmissions[0]);
+			backward.swap(nextBackward);
+			double inverseScale = 1.0 / scaleFactors[position + 1];
+
+			for (int state = 1; state < numStates; state++) {
+				double beta = 0;
+				if (isPruned(position, state)) {
+					backward[state] = beta;
+					continue;
+				}
+
+				for (int arc = topology->successorOffsets[state]; arc < topology->successorOffsets[state + 1]; arc++) {
+					int next = topology->successors[arc];
+					beta += topology->successorProbabilities[arc] * nextEmissions[next] * nextBackward[next];
+				}
+				backward[state] = beta * inverseScale;
+			}
+		}
+
+		// Posterior of each state at this position (forwardProb*backwardProb,
+		// normalized to remove rounding drift)
+		double* forward = &scaledForwardProbabilities[position * numStates];
+		double normalizer = 0;
+		for (int state = 1; state < numStates; state++) {
+			posteriors[state] = forward[state] * backward[state];
+			normalizer += posteriors[state];
+		}
+
+		double inverseNormalizer = (normalizer > 0) ? 1.0 / normalizer : 0;
+		for (int state = 1; state < numStates; state++) {
+			posteriors[state] *= inverseNormalizer;
+		}
+
+		results.addPosteriorColumn(position, &posteriors[0]);
+	}
+
+	results.endColumns();
+	results.logLikelihood = scaledLogLikelihood();
+}
+
+// releaseForwardBackwardProbabilities()
+//  Purpose:
+//		Frees the memory held by the forward, backward and conditional
+//		probabilities (log space and scaled)
+void HMMTrellis::releaseForwardBackwardProbabilities() {
+	vector<long double>().swap(logForwardProbabilities);
+	vector<long double>().swap(logBackwardProbabilities);
+	vector<long double>().swap(logConditionalProbabilities);
+	vector<double>().swap(scaledForwardProbabilities);
+	vector<double>().swap(scaledBackwardProbabilities);
+	vector<double>().swap(scaleFactors);
+}
+
+// int highestScoringState(int position)
+//  Purpose:
+//		Returns the state with the highest weight at position.
+int HMMTrellis::highestScoringState(int position) {
+	if (position == 0)
+		return 0;
+
+	const double* weights = weightColumn(position);
+	int highestScorer = 1;
+	for (int state = 2; state < numStates; state++) {
+		if (weights[state] > weights[highestScorer])
+			highestScorer = state;
+	}
+
+	return highestScorer;
+}
+
+// double highestWeight(int position, int state)
+//  Purpose:
+//		Returns the viterbi weight for state at position
+double HMMTrellis::highestWeight(int position, int state) {
+	return weightColumn(position)[state];
+}
+
+// int previousState(int position, int state)
+//  Purpose:
+//		Returns the state at position - 1 on the highest weight path
+//		into state at position
+int HMMTrellis::previousState(int position, int state) {
+	return previousStateColumn(position)[state];
+}
+
+// checkHighestWeightPath()
+//  Purpose:
+//		Throws a runtime_error (noPathError) if no state of the last
+//		position can be reached, i.e., the probabilities can not generate
+//		the sequence and there is no path to walk back
+//  Preconditions:
+//		the viterbi weights have been calculated
+void HMMTrellis::checkHighestWeightPath() {
+	if (numPositions == 0)
+		return;
+
+	// Unreachable states keep -DBL_MAX (-infinity in the kernels)
+	if (!(highestWeight(numPositions, highestScoringState(numPositions)) > -DBL_MAX))
+		throw runtime_error(noPathError);
+}
+
+// int codon(int position)
+//  Purpose:
+//		Returns the codon index emitted at position
+int HMMTrellis::codon(int position) {
+	return codons[position - 1];
+}
+
+// string residue(int position)
+//  Purpose:
+//		Returns the trinucleotide emitted at position
+string HMMTrellis::residue(int position) {
+	return CodonUtilities::codonString(codons[position - 1]);
+}
+
+// double logLikelihood()
+//  Purpose:
+//		Returns the log (base 2) likelihood of the sequence calculated from
+//		the forward probabilities of the last position
+double HMMTrellis::logLikelihood() {
+	double logLikelihood = std::numeric_limits<double>::quiet_NaN();
+
+	long double* forward = &logForwardProbabilities[numPositions * numStates];
+	for (int state = 1; state < numStates; state++) {
+		logLikelihood = MathUtilities::elnsum(logLikelihood, forward[state]);
+	}
+
+	return logLikelihood / log(2);
+}
+
+// double scaledLogLikelihood()
+//  Purpose:
+//		Returns the log (base 2) likelihood of the sequence calculated from
+//		the scale factors of the scaled forward probabilities
+double HMMTrellis::scaledLogLikelihood() {
+	double logLikelihood = 0;
+	for (int position = 1; position <= numPositions; position++) {
+		logLikelihood += log(scaleFactors[position]);
+	}
+
+	return logLikelihood / log(2);
+}
+
+// Private Methods
+// =============================================
+
+// calculateLogEmissionProbabilities(probabilities, position, logEmissions)
+//  Purpose:
+//		Populates logEmissions with the log emission probability of every
+//		state for the codon at position
+void HMMTrellis::calculateLogEmissionProbabilities(HMMProbabilities* probabilities, int position, long double logEmissions[]) {
+	const long double* logEmissionTable = probabilities->logEmissionProbabilityTable();
+	int positionCodon = codons[position - 1];
+	for (int state = 1; state < numStates; state++) {
+		logEmissions[state] = logEmissionTable[state * CodonUtilities::numEmissionCodons + positionCodon];
+	}
+
+	// An exact index only rules out states that are never reached, whose
+	// emissions are multiplied by zero anyway
+	if (stateMasks != NULL && !exactStateMasks) {
+		for (int state = 1; state < numStates; state++) {
+			if (isPruned(position, state))
+				logEmissions[state] = std::numeric_limits<double>::quiet_NaN();
+		}
+	}
+}
+
+// calculateEmissionProbabilities(probabilities, position, emissions)
+//  Purpose:
+//		Populates emissions with the emission probability of every state
+//		for the codon at position
+void HMMTrellis::calculateEmissionProbabilities(HMMProbabilities* probabilities, int position, double emissions[]) {
+	const long double* emissionTable = probabilities->emissionProbabilityTable();
+	int positionCodon = codons[position - 1];
+	for (int state = 1; state < numStates; state++) {
+		emissions[state] = emissionTable[state * CodonUtilities::numEmissionCodons + positionCodon];
+	}
+
+	// An exact index only rules out states that are never reached, whose
+	// emissions are multiplied by zero anyway
+	if (stateMasks != NULL && !exactStateMasks) {
+		for (int state = 1; state < numStates; state++) {
+			if (isPruned(position, state))
+				emissions[state] = 0;
+		}
+	}
+}
+
+// bool isPruned(int position, int state)
+//  Purpose:
+//		Returns true if the ORF index rules out state at position
+bool HMMTrellis::isPruned(int position, int state) {
+	return stateMasks != NULL && !(stateMasks[position] & (1 << state));
+}
+
+// countArcs(probabilities, topology)
+//  Purpose:
+//		Adds the arcs one pass over the positions evaluates, and those of
+//		them into a state that can not emit the codon at the position, to
+//		the arcs_evaluated and nan_pruned_arcs counters of
+//		HMMInstrumentation (see HMMInstrumentation.h)
+void HMMTrellis::countArcs(HMMProbabilities* probabilities, HMMTopology* topology) {
+	// Pruned arcs of every codon: the predecessors of the states with a
+	// zero emission probability for it
+	const long double* emissionTable = probabilities->emissionProbabilityTable();
+	vector<long> prunedCodonArcs(CodonUtilities::numEmissionCodons, 0);
+	for (int codon = 0; codon < CodonUtilities::numEmissionCodons; codon++) {
+		for (int state = 1; state < numStates; state++) {
+			if (!(emissionTable[state * CodonUtilities::numEmissionCodons + codon] > 0))
+				prunedCodonArcs[codon] += topology->predecessorOffsets[state + 1] - topology->predecessorOffsets[state];
+		}
+	}
+
+	long prunedArcs = 0;
+	for (int position = 1; position <= numPositions; position++)
+		prunedArcs += prunedCodonArcs[codons[position - 1]];
+
+	HMMInstrumentation::addCount(HMMInstrumentation::arcsEvaluatedCounter, (long) numPositions * topology->numArcs());
+	HMMInstrumentation::addCount(HMMInstrumentation::nanPrunedArcsCounter, prunedArcs);
+}
+
+// calculateHighestWeightColumn(probabilities, topology, position, previousWeights, weights, previousStates)
+//  Purpose:
+//		Calculates the viterbi weight and previous state of every state at
+//		position from the weights at position - 1
+//	Preconditions:
+//		weights is initialized to -DBL_MAX and previousStates to
+//		noPreviousState
+void HMMTrellis::calculateHighestWeightColumn(
+	HMMProbabilities* probabilities,
+	HMMTopology* topology,
+	int position,
+	const double* previousWeights,
+	double* weights,
+	uint8_t* previousStates) {
+
+	// The first position is entered from the start state (initiation
+	// probabilities), so the kernels only handle positions after it
+	if (viterbiPrecision != HMMViterbiKernel::longDoublePrecision && position > 1) {
+		viterbiKernel.calculateColumn(previousWeights, codons[position - 1], weights, previousStates);
+
+		// An exact index only rules out states the kernel leaves unreachable
+		if (!exactStateMasks) {
+			for (int state = 1; state < numStates; state++) {
+				if (isPruned(position, state)) {
+					weights[state] = -DBL_MAX;
+					previousStates[state] = noPreviousState;
+				}
+			}
+		}
+		return;
+	}
+
+	if (unrolledViterbi && position > 1) {
+		unsigned int stateMask = (stateMasks != NULL) ? stateMasks[position] : ~0u;
+		fill(previousStates, previousStates + numStates, noPreviousState);
+		if (numStates == HMMGeneTopology::numStates)
+			HMMUnrolledKernel<HMMGeneTopology>::viterbiColumn(probabilities, codons[position - 1], previousWeights, weights, previousStates, stateMask);
+		else
+			HMMUnrolledKernel<HMMSingleStrandTopology>::viterbiColumn(probabilities, codons[position - 1], previousWeights, weights, previousStates, stateMask);
+		return;
+	}
+
+	long double logEmissions[256];
+	calculateLogEmissionProbabilities(probabilities, position, logEmissions);
+
+	for (int state = 1; state < numStates; state++) {
+		previousStates[state] = noPreviousState;
+		if (isPruned(position, state))
+			continue;
+
+		// The first position can only be entered from the start state
+		if (position == 1) {
+			long double score =
+				MathUtilities::elnprod(
+					probabilities->logInitiationProbability(state),	// initiation probability
+					logEmissions[state]								// emission probablity
+				);
+			if (!MathUtilities::isNaN(score)) {
+				weights[state] = score;
+				previousStates[state] = 0;
+			}
+			continue;
+		}
+
+		// Iterate through the legal incoming transitions to find the highest score
+		for (int arc = topology->predecessorOffsets[state]; arc < topology->predecessorOffsets[state + 1]; arc++) {
+			int previous = topology->predecessors[arc];
+
+			// calculate the score
+			long double score =
+				MathUtilities::elnprod(
+					previousWeights[previous],						// previous states weight
+					MathUtilities::elnprod(
+						topology->predecessorLogProbabilities[arc],		// transition probability
+						logEmissions[state]								// emission probablity
+					)
+				);
+
+			// Replace the highest weight info if this path has the highest score
+			if (!MathUtilities::isNaN(score) && (score > weights[state])) {
+				weights[state] = score;
+				previousStates[state] = previous;
+			}
+		}
+	}
+}
+
+// loadSegment(int position)
+//  Purpose:
+//		Recalculates the checkpoint segment holding position (checkpointed
+//		mode only)
+void HMMTrellis::loadSegment(int position) {
+	int checkpoint = (position - 1) / checkpointInterval;
+	segmentStart = checkpoint * checkpointInterval + 1;
+	segmentEnd = min(segmentStart + checkpointInterval - 1, numPositions);
+
+	fill(segmentWeights.begin(), segmentWeights.end(), -DBL_MAX);
+
+	const double* previousWeights = &checkpointWeights[checkpoint * numStates];
+	for (int segmentPosition = segmentStart; segmentPosition <= segmentEnd; segmentPosition++) {
+		int offset = (segmentPosition - segmentStart) * numStates;
+		calculateHighestWeightColumn(
+			viterbiProbabilities,
+			viterbiTopology,
+			segmentPosition,
+			previousWeights,
+			&segmentWeights[offset],
+			&segmentPreviousStates[offset]);
+		previousWeights = &segmentWeights[offset];
+	}
+}
+
+// const double* weightColumn(int position)
+//  Purpose:
+//		Returns the viterbi weights of all states at position
+const double* HMMTrellis::weightColumn(int position) {
+	if (checkpointInterval == 0)
+		return &highestWeights[position * numStates];
+
+	if (position % checkpointInterval == 0)
+		return &checkpointWeights[(position / checkpointInterval) * numStates];
+
+	if (position < segmentStart || position > segmentEnd || segmentStart == 0)
+		loadSegment(position);
+
+	return &segmentWeights[(position - segmentStart) * numStates];
+}
+
+// const uint8_t* previousStateColumn(int position)
+//  Purpose:
+//		Returns the viterbi previous states of all states at position
+const uint8_t* HMMTrellis::previousStateColumn(int position) {
+	if (checkpointInterval == 0)
+		return &highestWeightPreviousStates[position * numStates];
+
+	if (position < segmentStart || position > segmentEnd || segmentStart == 0)
+		loadSegment(position);
+
+	return &segmentPreviousStates[(position - segmentStart) * numStates];
+}
@@ -0,0 +1,444 @@
+/*
+ * HMMTrellis.h
+ *
+ *	This is the header file for the HMMTrellis object. The HMMTrellis
+ *  holds every per-position value calculated for a hidden markov model
+ *  in flat contiguous arrays indexed by [position][state].  Position 0
+ *  is the start position (only state 0 is meaningful there) and positions
+ *  1..numPositions correspond to the trinucleotides of the sequence.  The
+ *  sequence is read as an array of codon indexes (see CodonUtilities) so
+ *  emission probabilities are looked up directly from the flat emission
+ *  table.
+ *
+ *  Transitions are never materialized.  Transition and emission
+ *  probabilities are looked up from the HMMProbabilities object passed
+ *  to each calculation, so the trellis can be recalculated in place every
+ *  time the probabilities are changed by training.
+ *
+ *  Scaled forward-backward:
+ *	  In addition to the log space forward and backward probabilities
+ *    (long double, every step through MathUtilities::elnsum) the trellis
+ *    can calculate scaled forward and backward probabilities in plain
+ *    double arithmetic (Rabiner).  Each forward column is normalized to
+ *    sum to one and its scale factor is kept; the backward column at a
+ *    position is divided by the scale factor of the next position.  The
+ *    log likelihood is the sum of the logs of the scale factors.
+ *
+ *  Posterior decoding:
+ *	  accumulatePosteriorGenes (and its scaled version) calculates the
+ *    backward probabilities one column at a time after the forward pass and
+ *    reduces the posterior probabilities into per gene sums as it goes (see
+ *    HMMPosteriorResults), so only the forward probabilities are stored.
+ *
+ *  Checkpointed viterbi decoding:
+ *	  By default the viterbi weights and previous states are kept for every
+ *    position (O(numPositions * numStates) memory).  When a checkpoint
+ *    interval K is set only the weight columns at positions 0, K, 2K, ...
+ *    are kept.  The segment of K positions following a checkpoint is
+ *    recalculated from it the first time a weight or previous state in
+ *    that segment is requested, so walking the path backward (or the
+ *    scores forward) recalculates every segment once.  Memory is
+ *    O((numPositions / K + K) * numStates), which is O(sqrt(numPositions))
+ *    for the automatic interval.  The recalculated columns are bit for bit
+ *    the same as the full trellis so the path is identical.
+ *
+ *  Unrolled kernels:
+ *	  When the topology is (a subset of) the 12 state gene model or its
+ *    single strand model the viterbi and log forward columns after the
+ *    first are calculated by HMMUnrolledKernel<HMMGeneTopology> (or
+ *    HMMUnrolledKernel<HMMSingleStrandTopology>), which is fully unrolled
+ *    at compile time and gives bit for bit the same results.  Other models
+ *    use the generic loops over the topology.
+ *
+ *  Vectorized viterbi decoding:
+ *	  When enabled the viterbi columns after the first are calculated by an
+ *    HMMViterbiKernel (double or float precision, AVX2/NEON when
+ *    available) instead of the long double loop over the topology.  It
+ *    works with both the full and the checkpointed trellis.  The weights
+ *    are stored as double in either precision.
+ *
+ *  ORF pruning:
+ *	  When an HMMOrfIndex is set (see setOrfIndex) every recursion skips the
+ *    states its state mask rules out at a position: their viterbi weight
+ *    stays -DBL_MAX and their forward and backward probabilities zero, and
+ *    their emission probability is taken as zero by the passes that read
+ *    the probabilities of the next position.  The vectorized viterbi
+ *    kernels calculate every state of a column at once, so they are only
+ *    masked afterwards, and only when the index rules out more than the
+ *    unreachable states (a minimum ORF length).  An exact index leaves
+ *    every result the same.
+ *
+ *  Important Attributes:
+ *		highestWeights - the highest weight determined by the viterbi path
+ *		highestWeightPreviousStates - the state at the previous position that
+ *									  gave the highest weight viterbi path
+ *									  (noPreviousState if not reachable)
+ *		logForwardProbabilities - forward probabilities (Baum-Welch)
+ *		logBackwardProbabilities - backward probabilities (Baum-Welch)
+ *		logConditionalProbabilities - probability of being in a state at a
+ *									  position given the model (Baum-Welch)
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMTRELLIS_H
+#define HMMTRELLIS_H
+#include "HMMProbabilities.h"
+#include "HMMTopology.h"
+#include "HMMExpectedCounts.h"
+#include "HMMPosteriorResults.h"
+#include "HMMViterbiKernel.h"
+#include "HMMOrfIndex.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+class HMMTrellis
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMTrellis();
+	HMMTrellis(const uint8_t* someCodons, int numberOfPositions, int numberOfStates);
+
+	// Destructor
+	// =============================================
+	~HMMTrellis();
+
+	// Public Class Attributes
+	// =============================================
+	static const uint8_t noPreviousState;
+	static const int automaticCheckpointInterval;	// sqrt(numPositions)
+	static const string noPathError;				// see checkHighestWeightPath
+
+	// Public Attributes
+	// =============================================
+	int numStates;
+	int numPositions;
+	vector<double> highestWeights;
+	vector<uint8_t> highestWeightPreviousStates;
+	vector<long double> logForwardProbabilities;
+	vector<long double> logBackwardProbabilities;
+	vector<long double> logConditionalProbabilities;
+	vector<double> scaledForwardProbabilities;
+	vector<double> scaledBackwardProbabilities;
+	vector<double> scaleFactors;
+
+	// Public Methods
+	// =============================================
+
+	// setCheckpointInterval(int interval)
+	//  Purpose:
+	//		Sets the number of positions between the viterbi checkpoint columns.
+	//		0 keeps the full trellis and automaticCheckpointInterval uses
+	//		sqrt(numPositions).  Takes effect on the next call to
+	//		calculateHighestWeightPaths.
+	void setCheckpointInterval(int interval);
+
+	// setVectorizedViterbi(bool vectorized)
+	//  Purpose:
+	//		Selects the HMMViterbiKernel (true) or the long double reference
+	//		(false, the default) viterbi column calculation.  Takes effect on the
+	//		next call to calculateHighestWeightPaths.
+	void setVectorizedViterbi(bool vectorized);
+
+	// setViterbiPrecision(int precision)
+	//  Purpose:
+	//		Selects the precision of the viterbi column calculation:
+	//		HMMViterbiKernel::longDoublePrecision (the reference, the default),
+	//		doublePrecision or floatPrecision (both HMMViterbiKernel).  Takes
+	//		effect on the next call to calculateHighestWeightPaths.
+	void setViterbiPrecision(int precision);
+
+	// setOrfIndex(HMMOrfIndex* index)
+	//  Purpose:
+	//		Prunes the states index rules out from every recursion (see ORF
+	//		pruning above).  index must be built over the codons of the
+	//		trellis and stay valid while it is set.  NULL (the default)
+	//		calculates every state.
+	void setOrfIndex(HMMOrfIndex* index);
+
+	// calculateHighestWeightPaths(HMMProbabilities* probabilities, HMMTopology* topology)
+	//  Purpose:
+	//		Calculate and store the highest weight using the viterbi algorithm
+	//		for every state at every position.  Only the legal transitions in
+	//		topology are considered.
+	//
+	//		The path weight for a state uses the formula:
+	//			  previous states weight
+	//			+ transmission probability
+	//			+ emission Probability
+	//
+	//		Ties are broken in favor of the lowest numbered previous state.
+	//
+	//		In checkpointed mode probabilities and topology are used again to
+	//		recalculate segments, so they must not be changed or deleted while
+	//		the viterbi results are being read.
+	//
+	//  Postconditions:
+	//		highestWeights - set to highest calculated weight
+	//		highestWeightPreviousStates - set to the previous state that generated
+	//									  the highest calculated weight
+	//		(in checkpointed mode only the checkpoint columns are set)
+	void calculateHighestWeightPaths(HMMProbabilities* probabilities, HMMTopology* topology);
+
+	// releaseHighestWeightPaths()
+	//  Purpose:
+	//		Frees the memory held by the viterbi weights and previous states.
+	//		The viterbi accessors can not be used until
+	//		calculateHighestWeightPaths is called again.
+	void releaseHighestWeightPaths();
+
+	// calculateLogForwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology)
+	//  Purpose:
+	//		Calculate and store the log forward probabilty for the forward-backward
+	//		(Baum-Welch) algorithm for every state at every position.
+	//
+	//  Postconditions:
+	//		logForwardProbabilities - set to calculated log probabilities
+	void calculateLogForwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology);
+
+	// calculateLogBackwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology)
+	//  Purpose:
+	//		Calculate and store the log backward probabilty for the forward-backward
+	//		(Baum-Welch) algorithm for every state at every position.  The last
+	//		position is set to a log probability of 0.
+	//
+	//  Postconditions:
+	//		logBackwardProbabilities - set to calculated log probabilities
+	void calculateLogBackwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology);
+
+	// calculateLogConditionalProbabilities()
+	//  Purpose:
+	//		Calculate and store the log conditional probability for every state
+	//		at every position. This is the probabilty of being in a state at a
+	//		particular position given the model.
+	//	Preconditions:
+	//		forward and backward probabilities have been calculated
+	//  Postconditions:
+	//		logConditionalProbabilities - set for all states at all positions
+	void calculateLogConditionalProbabilities();
+
+	// accumulateExpectedCounts(probabilities, topology, counts)
+	//  Purpose:
+	//		One pass over the positions that calculates the conditional
+	//		probability of every state and of every legal transition between
+	//		adjacent positions and sums them (in log space) into counts (see
+	//		HMMExpectedCounts).  The conditional probabilities are not stored.
+	//		The log likelihood of the sequence is added to counts as well.
+	//	Preconditions:
+	//		forward and backward probabilities have been calculated
+	//  Postconditions:
+	//		counts - contains the summed log values for this sequence
+	void accumulateExpectedCounts(
+		HMMProbabilities* probabilities,
+		HMMTopology* topology,
+		HMMExpectedCounts& counts);
+
+	// calculateScaledForwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology)
+	//  Purpose:
+	//		Calculate and store the scaled forward probability of every state at
+	//		every position.  Throws a runtime_error if the sequence can not be
+	//		generated by the model (a column sums to zero).
+	//
+	//  Postconditions:
+	//		scaledForwardProbabilities - set to the normalized forward probabilities
+	//		scaleFactors - set to the sum of each column before normalization
+	void calculateScaledForwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology);
+
+	// calculateScaledBackwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology)
+	//  Purpose:
+	//		Calculate and store the scaled backward probability of every state at
+	//		every position.  The last position is set to 1.
+	//	Preconditions:
+	//		scaled forward probabilities have been calculated
+	//  Postconditions:
+	//		scaledBackwardProbabilities - set to calculated probabilities
+	void calculateScaledBackwardProbabilities(HMMProbabilities* probabilities, HMMTopology* topology);
+
+	// accumulateScaledExpectedCounts(probabilities, topology, counts)
+	//  Purpose:
+	//		Same as accumulateExpectedCounts using the scaled forward and
+	//		backward probabilities.  The counts are summed in double and
+	//		added to counts (which are kept in log space) at the end.
+	//	Preconditions:
+	//		scaled forward and backward probabilities have been calculated
+	//  Postconditions:
+	//		counts - contains the summed log values for this sequence
+	void accumulateScaledExpectedCounts(
+		HMMProbabilities* probabilities,
+		HMMTopology* topology,
+		HMMExpectedCounts& counts);
+
+	// accumulatePosteriorGenes(probabilities, topology, results)
+	//  Purpose:
+	//		One log space backward pass fused with the posterior decoding: the
+	//		backward column of a position is kept only until the one before it
+	//		has been calculated, and the posterior probability of every state
+	//		at every position is reduced into results as soon as it is known
+	//		(see HMMPosteriorResults).  Neither the backward nor the
+	//		conditional probabilities of all positions are stored.  The log
+	//		likelihood of the sequence is set in results as well.
+	//	Preconditions:
+	//		log forward probabilities have been calculated
+	//  Postconditions:
+	//		results - contains the genes and their posterior sums
+	void accumulatePosteriorGenes(
+		HMMProbabilities* probabilities,
+		HMMTopology* topology,
+		HMMPosteriorResults& results);
+
+	// accumulateScaledPosteriorGenes(probabilities, topology, results)
+	//  Purpose:
+	//		Same as accumulatePosteriorGenes using the scaled forward and
+	//		backward probabilities
+	//	Preconditions:
+	//		scaled forward probabilities have been calculated
+	//  Postconditions:
+	//		results - contains the genes and their posterior sums
+	void accumulateScaledPosteriorGenes(
+		HMMProbabilities* probabilities,
+		HMMTopology* topology,
+		HMMPosteriorResults& results);
+
+	// releaseForwardBackwardProbabilities()
+	//  Purpose:
+	//		Frees the memory held by the forward, backward and conditional
+	//		probabilities (log space and scaled)
+	void releaseForwardBackwardProbabilities();
+
+	// int highestScoringState(int position)
+	//  Purpose:
+	//		Returns the state with the highest weight at position.
+	int highestScoringState(int position);
+
+	// double highestWeight(int position, int state)
+	//  Purpose:
+	//		Returns the viterbi weight for state at position
+	double highestWeight(int position, int state);
+
+	// int previousState(int position, int state)
+	//  Purpose:
+	//		Returns the state at position - 1 on the highest weight path
+	//		into state at position
+	int previousState(int position, int state);
+
+	// checkHighestWeightPath()
+	//  Purpose:
+	//		Throws a runtime_error (noPathError) if no state of the last
+	//		position can be reached, i.e., the probabilities can not generate
+	//		the sequence and there is no path to walk back
+	//  Preconditions:
+	//		the viterbi weights have been calculated
+	void checkHighestWeightPath();
+
+	// int codon(int position)
+	//  Purpose:
+	//		Returns the codon index emitted at position
+	int codon(int position);
+
+	// string residue(int position)
+	//  Purpose:
+	//		Returns the trinucleotide emitted at position
+	string residue(int position);
+
+	// double logLikelihood()
+	//  Purpose:
+	//		Returns the log (base 2) likelihood of the sequence calculated from
+	//		the forward probabilities of the last position
+	double logLikelihood();
+
+	// double scaledLogLikelihood()
+	//  Purpose:
+	//		Returns the log (base 2) likelihood of the sequence calculated from
+	//		the scale factors of the scaled forward probabilities
+	double scaledLogLikelihood();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	const uint8_t* codons;
+
+	// Checkpointed viterbi decoding
+	int checkpointInterval;				// 0 when the full trellis is kept
+	vector<double> checkpointWeights;	// weight column at every checkpoint
+	vector<double> segmentWeights;		// recalculated segment
+	vector<uint8_t> segmentPreviousStates;
+	int segmentStart;					// first position of the segment (0 if none)
+	int segmentEnd;
+	HMMProbabilities* viterbiProbabilities;
+	HMMTopology* viterbiTopology;
+
+	// Unrolled and vectorized viterbi decoding
+	bool unrolledViterbi;
+	int viterbiPrecision;
+	HMMViterbiKernel viterbiKernel;
+
+	// ORF pruning
+	const uint16_t* stateMasks;			// [position], NULL when every state is calculated
+	bool exactStateMasks;
+
+	// Private Methods
+	// =============================================
+
+	// calculateHighestWeightColumn(probabilities, topology, position, previousWeights, weights, previousStates)
+	//  Purpose:
+	//		Calculates the viterbi weight and previous state of every state at
+	//		position from the weights at position - 1
+	//	Preconditions:
+	//		weights is initialized to -DBL_MAX and previousStates to
+	//		noPreviousState
+	void calculateHighestWeightColumn(
+		HMMProbabilities* probabilities,
+		HMMTopology* topology,
+		int position,
+		const double* previousWeights,
+		double* weights,
+		uint8_t* previousStates);
+
+	// loadSegment(int position)
+	//  Purpose:
+	//		Recalculates the checkpoint segment holding position (checkpointed
+	//		mode only)
+	void loadSegment(int position);
+
+	// const double* weightColumn(int position)
+	//  Purpose:
+	//		Returns the viterbi weights of all states at position
+	const double* weightColumn(int position);
+
+	// const uint8_t* previousStateColumn(int position)
+	//  Purpose:
+	//		Returns the viterbi previous states of all states at position
+	const uint8_t* previousStateColumn(int position);
+
+	// calculateLogEmissionProbabilities(probabilities, position, logEmissions)
+	//  Purpose:
+	//		Populates logEmissions with the log emission probability of every
+	//		state for the codon at position (NaN for the states ruled out)
+	void calculateLogEmissionProbabilities(HMMProbabilities* probabilities, int position, long double logEmissions[]);
+
+	// calculateEmissionProbabilities(probabilities, position, emissions)
+	//  Purpose:
+	//		Populates emissions with the emission probability of every state
+	//		for the codon at position (0 for the states ruled out)
+	void calculateEmissionProbabilities(HMMProbabilities* probabilities, int position, double emissions[]);
+
+	// bool isPruned(int position, int state)
+	//  Purpose:
+	//		Returns true if the ORF index rules out state at position
+	bool isPruned(int position, int state);
+
+	// countArcs(probabilities, topology)
+	//  Purpose:
+	//		Adds the arcs one pass over the positions evaluates, and those of
+	//		them into a state that can not emit the codon at the position, to
+	//		the arcs_evaluated and nan_pruned_arcs counters of
+	//		HMMInstrumentation (see HMMInstrumentation.h)
+	void countArcs(HMMProbabilities* probabilities, HMMTopology* topology);
+};
+
+#endif // HMMTRELLIS_H
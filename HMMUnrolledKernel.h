@@ -0,0 +1,235 @@
+/*
+ * HMMUnrolledKernel.h
+ *
+ *	This is the header file for the HMMUnrolledKernel template.
+ *  HMMUnrolledKernel<Topology> is the per-position viterbi and log forward
+ *  update of HMMTrellis generated at compile time for a constexpr topology
+ *  description (see HMMGeneTopology).  The loops over the states and over
+ *  each state's predecessors are template recursions on Topology's
+ *  numStates and predecessor lists, so every state, predecessor and table
+ *  offset is a constant and the column is straight line code.
+ *
+ *  The arithmetic (long double, through MathUtilities) and the order of
+ *  the arcs are the same as the generic HMMTrellis loops over an
+ *  HMMTopology, so the results are bit for bit the same.  The transition
+ *  probabilities are read from the HMMProbabilities tables, so a topology
+ *  compiled from the probabilities may be any subset of Topology's arcs
+ *  (a missing arc has a log probability of NaN and is skipped); supports
+ *  checks this.  Any other model uses the generic loops.
+ *
+ *  The columns take a state mask (see HMMOrfIndex): a state whose bit is
+ *  not set is skipped, its weight is left as it is and its log forward
+ *  probability is NaN.
+ *
+ *  Template only, so everything is defined in this header.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMUNROLLEDKERNEL_H
+#define HMMUNROLLEDKERNEL_H
+#include "HMMProbabilities.h"
+#include "HMMTopology.h"
+#include "CodonUtilities.h"
+#include "MathUtilities.h"
+#include <limits>
+#include <stdint.h>
+using namespace std;
+
+// HMMUnrolledArcs<Topology, State, Arc>
+//  Purpose:
+//		The arcs into State from its Arc'th predecessor on
+template <class Topology, int State, int Arc = 0, bool Done = (Arc >= Topology::numPredecessors[State])>
+struct HMMUnrolledArcs
+{
+	static const int previous = Topology::predecessors[State][Arc];
+	static const int transitionIndex = previous * Topology::numStates + State;
+
+	// highestWeight(logTransitions, logEmission, previousWeights, weight, previousState)
+	//  Purpose:
+	//		Replaces weight and previousState with the highest weight path
+	//		into State through these arcs
+	static inline void highestWeight(
+		const long double* logTransitions,
+		long double logEmission,
+		const double* previousWeights,
+		double& weight,
+		uint8_t& previousState) {
+
+		long double score =
+			MathUtilities::elnprod(
+				previousWeights[previous],						// previous states weight
+				MathUtilities::elnprod(
+					logTransitions[transitionIndex],			// transition probability
+					logEmission									// emission probablity
+				)
+			);
+
+		if (!MathUtilities::isNaN(score) && (score > weight)) {
+			weight = score;
+			previousState = previous;
+		}
+
+		HMMUnrolledArcs<Topology, State, Arc + 1>::highestWeight(logTransitions, logEmission, previousWeights, weight, previousState);
+	}
+
+	// long double logAlpha(logTransitions, previousForward, logAlpha)
+	//  Purpose:
+	//		Returns logAlpha plus the forward probability into State through
+	//		these arcs
+	static inline long double logAlpha(
+		const long double* logTransitions,
+		const long double* previousForward,
+		long double logAlpha) {
+
+		logAlpha =
+			MathUtilities::elnsum(
+				logAlpha,
+				MathUtilities::elnprod(
+					previousForward[previous],					// prev prob
+					logTransitions[transitionIndex]				// transition prob
+				)
+			);
+
+		return HMMUnrolledArcs<Topology, State, Arc + 1>::logAlpha(logTransitions, previousForward, logAlpha);
+	}
+};
+
+template <class Topology, int State, int Arc>
+struct HMMUnrolledArcs<Topology, State, Arc, true>
+{
+	static inline void highestWeight(const long double*, long double, const double*, double&, uint8_t&) {
+	}
+
+	static inline long double logAlpha(const long double*, const long double*, long double logAlpha) {
+		return logAlpha;
+	}
+};
+
+// HMMUnrolledStates<Topology, State>
+//  Purpose:
+//		States State .. Topology::numStates - 1
+template <class Topology, int State = 1, bool Done = (State >= Topology::numStates)>
+struct HMMUnrolledStates
+{
+	static inline void viterbiColumn(
+		const long double* logTransitions,
+		const long double* logEmissions,
+		const double* previousWeights,
+		double* weights,
+		uint8_t* previousStates,
+		unsigned int stateMask) {
+
+		if (stateMask & (1u << State)) {
+			HMMUnrolledArcs<Topology, State>::highestWeight(
+				logTransitions,
+				logEmissions[State * CodonUtilities::numEmissionCodons],
+				previousWeights,
+				weights[State],
+				previousStates[State]);
+		}
+
+		HMMUnrolledStates<Topology, State + 1>::viterbiColumn(logTransitions, logEmissions, previousWeights, weights, previousStates, stateMask);
+	}
+
+	static inline void logForwardColumn(
+		const long double* logTransitions,
+		const long double* logEmissions,
+		const long double* previousForward,
+		long double* forward,
+		unsigned int stateMask) {
+
+		if (stateMask & (1u << State)) {
+			forward[State] =
+				MathUtilities::elnprod(
+					HMMUnrolledArcs<Topology, State>::logAlpha(logTransitions, previousForward, numeric_limits<double>::quiet_NaN()),
+					logEmissions[State * CodonUtilities::numEmissionCodons]		// emission prob
+				);
+		}
+		else {
+			forward[State] = numeric_limits<double>::quiet_NaN();
+		}
+
+		HMMUnrolledStates<Topology, State + 1>::logForwardColumn(logTransitions, logEmissions, previousForward, forward, stateMask);
+	}
+};
+
+template <class Topology, int State>
+struct HMMUnrolledStates<Topology, State, true>
+{
+	static inline void viterbiColumn(const long double*, const long double*, const double*, double*, uint8_t*, unsigned int) {
+	}
+
+	static inline void logForwardColumn(const long double*, const long double*, const long double*, long double*, unsigned int) {
+	}
+};
+
+template <class Topology>
+class HMMUnrolledKernel
+{
+public:
+	// bool supports(HMMProbabilities* probabilities, HMMTopology* topology)
+	//  Purpose:
+	//		Returns true if the model has Topology's number of states and every
+	//		arc of topology is one of Topology's arcs
+	static bool supports(HMMProbabilities* probabilities, HMMTopology* topology) {
+		if (topology->numStates != Topology::numStates || probabilities->getNumStates() != Topology::numStates)
+			return false;
+
+		for (int state = 1; state < topology->numStates; state++) {
+			for (int arc = topology->predecessorOffsets[state]; arc < topology->predecessorOffsets[state + 1]; arc++) {
+				if (!Topology::isArc(topology->predecessors[arc], state))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// viterbiColumn(probabilities, codon, previousWeights, weights, previousStates, stateMask)
+	//  Purpose:
+	//		Calculates the viterbi weight and previous state of every state in
+	//		stateMask for a position (after the first) emitting codon from the
+	//		weights of the previous position
+	//	Preconditions:
+	//		weights is initialized to -DBL_MAX and previousStates to
+	//		HMMTrellis::noPreviousState
+	static void viterbiColumn(
+		HMMProbabilities* probabilities,
+		int codon,
+		const double* previousWeights,
+		double* weights,
+		uint8_t* previousStates,
+		unsigned int stateMask = ~0u) {
+
+		HMMUnrolledStates<Topology>::viterbiColumn(
+			probabilities->logTransitionProbabilityTable(),
+			probabilities->logEmissionProbabilityTable() + codon,
+			previousWeights,
+			weights,
+			previousStates,
+			stateMask);
+	}
+
+	// logForwardColumn(probabilities, codon, previousForward, forward, stateMask)
+	//  Purpose:
+	//		Calculates the log forward probability of every state in
+	//		stateMask for a position (after the first) emitting codon from the
+	//		forward probabilities of the previous position
+	static void logForwardColumn(
+		HMMProbabilities* probabilities,
+		int codon,
+		const long double* previousForward,
+		long double* forward,
+		unsigned int stateMask = ~0u) {
+
+		HMMUnrolledStates<Topology>::logForwardColumn(
+			probabilities->logTransitionProbabilityTable(),
+			probabilities->logEmissionProbabilityTable() + codon,
+			previousForward,
+			forward,
+			stateMask);
+	}
+};
+
+#endif // HMMUNROLLEDKERNEL_H
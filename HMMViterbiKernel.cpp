@@ -0,0 +1,473 @@
+/*
+ * HMMViterbiKernel.cpp
+ *
+ *	This is the cpp file for the HMMViterbiKernel object.
+ *  HMMViterbiKernel is a vectorized version of the per-position viterbi
+ *  update in HMMTrellis.
+ *
+ *  See HMMViterbiKernel.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+#include "HMMViterbiKernel.h"
+#include "HMMTrellis.h"
+#include "CodonUtilities.h"
+#include "MathUtilities.h"
+#include <cfloat>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HMM_VITERBI_KERNEL_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define HMM_VITERBI_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+
+// const variable initialization
+// ==============================================
+const int HMMViterbiKernel::scalarInstructionSet = 0;
+const int HMMViterbiKernel::avx2InstructionSet = 1;
+const int HMMViterbiKernel::neonInstructionSet = 2;
+const int HMMViterbiKernel::vectorWidth = 4;
+const int HMMViterbiKernel::floatVectorWidth = 8;
+const int HMMViterbiKernel::longDoublePrecision = 0;
+const int HMMViterbiKernel::doublePrecision = 1;
+const int HMMViterbiKernel::floatPrecision = 2;
+
+// Constuctors
+// ==============================================
+HMMViterbiKernel::HMMViterbiKernel() {
+	numStates = 0;
+	paddedStates = 0;
+	maxPredecessors = 0;
+	instructionSet = scalarInstructionSet;
+	precision = doublePrecision;
+}
+
+HMMViterbiKernel::HMMViterbiKernel(HMMProbabilities* probabilities, HMMTopology* topology, int aPrecision) {
+	double minusInfinity = -numeric_limits<double>::infinity();
+
+	precision = aPrecision;
+	int width = (precision == floatPrecision) ? floatVectorWidth : vectorWidth;
+	numStates = topology->numStates;
+	paddedStates = ((numStates + width - 1) / width) * width;
+	instructionSet = bestInstructionSet();
+
+	maxPredecessors = 0;
+	for (int state = 1; state < numStates; state++)
+		maxPredecessors = max(maxPredecessors, topology->predecessorOffsets[state + 1] - topology->predecessorOffsets[state]);
+
+	// Emissions (codon major, log zero is -infinity)
+	const long double* logEmissions = probabilities->logEmissionProbabilityTable();
+	emissions.assign(CodonUtilities::numEmissionCodons * paddedStates, minusInfinity);
+	for (int codon = 0; codon < CodonUtilities::numEmissionCodons; codon++) {
+		for (int state = 1; state < numStates; state++) {
+			long double logEmission = logEmissions[state * CodonUtilities::numEmissionCodons + codon];
+			if (!MathUtilities::isNaN(logEmission))
+				emissions[codon * paddedStates + state] = (double) logEmission;
+		}
+	}
+
+	// Incoming transitions (missing ones point at state 0 with a log
+	// probability of -infinity)
+	transitions.assign(maxPredecessors * paddedStates, minusInfinity);
+	predecessorIndexes.assign(maxPredecessors * paddedStates, 0);
+	predecessorStates.assign(maxPredecessors * paddedStates, 0);
+	for (int state = 1; state < numStates; state++) {
+		int first = topology->predecessorOffsets[state];
+		for (int arc = first; arc < topology->predecessorOffsets[state + 1]; arc++) {
+			int index = (arc - first) * paddedStates + state;
+			transitions[index] = (double) topology->predecessorLogProbabilities[arc];
+			predecessorIndexes[index] = topology->predecessors[arc];
+			predecessorStates[index] = topology->predecessors[arc];
+		}
+	}
+
+	previousColumn.assign(paddedStates, minusInfinity);
+	bestWeights.assign(paddedStates, minusInfinity);
+	bestStates.assign(paddedStates, HMMTrellis::noPreviousState);
+
+	// Float copies, rounded from the long double tables
+	if (precision == floatPrecision) {
+		float floatMinusInfinity = -numeric_limits<float>::infinity();
+
+		floatEmissions.assign(emissions.size(), floatMinusInfinity);
+		for (int codon = 0; codon < CodonUtilities::numEmissionCodons; codon++) {
+			for (int state = 1; state < numStates; state++) {
+				long double logEmission = logEmissions[state * CodonUtilities::numEmissionCodons + codon];
+				if (!MathUtilities::isNaN(logEmission))
+					floatEmissions[codon * paddedStates + state] = (float) logEmission;
+			}
+		}
+
+		floatTransitions.assign(transitions.size(), floatMinusInfinity);
+		floatPredecessorStates.assign(predecessorStates.size(), 0);
+		for (int state = 1; state < numStates; state++) {
+			int first = topology->predecessorOffsets[state];
+			for (int arc = first; arc < topology->predecessorOffsets[state + 1]; arc++) {
+				int index = (arc - first) * paddedStates + state;
+				floatTransitions[index] = (float) topology->predecessorLogProbabilities[arc];
+				floatPredecessorStates[index] = topology->predecessors[arc];
+			}
+		}
+
+		floatPreviousColumn.assign(paddedStates, floatMinusInfinity);
+		floatBestWeights.assign(paddedStates, floatMinusInfinity);
+		floatBestStates.assign(paddedStates, HMMTrellis::noPreviousState);
+	}
+}
+
+// Destructor
+// =============================================
+HMMViterbiKernel::~HMMViterbiKernel() {
+}
+
+// Public Class Methods
+// =============================================
+
+// int bestInstructionSet()
+//  Purpose:
+//		Returns the fastest instruction set supported by this processor
+int HMMViterbiKernel::bestInstructionSet() {
+#if defined(HMM_VITERBI_KERNEL_AVX2)
+	if (__builtin_cpu_supports("avx2"))
+		return avx2InstructionSet;
+#endif
+#if defined(HMM_VITERBI_KERNEL_NEON)
+	return neonInstructionSet;
+#endif
+	return scalarInstructionSet;
+}
+
+// string instructionSetName(int instructionSet)
+//  Purpose:
+//		Returns the name of instructionSet ("scalar", "avx2" or "neon")
+string HMMViterbiKernel::instructionSetName(int instructionSet) {
+	if (instructionSet == avx2InstructionSet)
+		return "avx2";
+	if (instructionSet == neonInstructionSet)
+		return "neon";
+	return "scalar";
+}
+
+// int parsePrecision(string name)
+//  Purpose:
+//		Returns the precision named name ("long", "double" or "float").
+//		Throws an invalid_argument exception for any other name.
+int HMMViterbiKernel::parsePrecision(string name) {
+	if (name == "long")
+		return longDoublePrecision;
+	if (name == "double")
+		return doublePrecision;
+	if (name == "float")
+		return floatPrecision;
+
+	throw invalid_argument("Unknown viterbi precision: " + name);
+}
+
+// string precisionName(int precision)
+//  Purpose:
+//		Returns the name of precision ("long", "double" or "float")
+string HMMViterbiKernel::precisionName(int precision) {
+	if (precision == doublePrecision)
+		return "double";
+	if (precision == floatPrecision)
+		return "float";
+	return "long";
+}
+
+// Public Methods
+// =============================================
+
+// calculateColumn(const double* previousWeights, int codon, double* weights, uint8_t* previousStates)
+//  Purpose:
+//		Calculates the viterbi weight and previous state of every state for
+//		a position emitting codon from the weights of the previous position.
+//		previousWeights and weights use the HMMTrellis convention (numStates
+//		values, -DBL_MAX for unreachable states), unreachable states are
+//		given HMMTrellis::noPreviousState.
+void HMMViterbiKernel::calculateColumn(const double* previousWeights, int codon, double* weights, uint8_t* previousStates) {
+	double minusInfinity = -numeric_limits<double>::infinity();
+
+	if (precision == floatPrecision) {
+		calculateFloatColumn(previousWeights, codon, weights, previousStates);
+		return;
+	}
+
+	// Unreachable states are -infinity inside the kernel
+	for (int state = 0; state < numStates; state++)
+		previousColumn[state] = (previousWeights[state] == -DBL_MAX) ? minusInfinity : previousWeights[state];
+
+	if (instructionSet == avx2InstructionSet)
+		calculateBestAVX2(codon);
+	else if (instructionSet == neonInstructionSet)
+		calculateBestNEON(codon);
+	else
+		calculateBestScalar(codon);
+
+	weights[0] = -DBL_MAX;
+	previousStates[0] = HMMTrellis::noPreviousState;
+	for (int state = 1; state < numStates; state++) {
+		if (bestWeights[state] == minusInfinity) {
+			weights[state] = -DBL_MAX;
+			previousStates[state] = HMMTrellis::noPreviousState;
+		}
+		else {
+			weights[state] = bestWeights[state];
+			previousStates[state] = (uint8_t) bestStates[state];
+		}
+	}
+}
+
+// Private Methods
+// =============================================
+
+// calculateBestScalar(int codon)
+//  Purpose:
+//		Fills bestWeights and bestStates for codon from previousColumn
+void HMMViterbiKernel::calculateBestScalar(int codon) {
+	const double* emission = &emissions[codon * paddedStates];
+
+	for (int state = 0; state < paddedStates; state++) {
+		double best = -numeric_limits<double>::infinity();
+		double bestState = HMMTrellis::noPreviousState;
+
+		for (int k = 0; k < maxPredecessors; k++) {
+			int index = k * paddedStates + state;
+			double score = previousColumn[predecessorIndexes[index]] + (transitions[index] + emission[state]);
+			bool higher = score > best;
+			best = higher ? score : best;
+			bestState = higher ? predecessorStates[index] : bestState;
+		}
+
+		bestWeights[state] = best;
+		bestStates[state] = bestState;
+	}
+}
+
+// calculateBestAVX2(int codon)
+//  Purpose:
+//		Fills bestWeights and bestStates for codon from previousColumn
+//		(four states per instruction)
+#if defined(HMM_VITERBI_KERNEL_AVX2)
+__attribute__((target("avx2")))
+void HMMViterbiKernel::calculateBestAVX2(int codon) {
+	const double* emission = &emissions[codon * paddedStates];
+	const double* previous = &previousColumn[0];
+
+	for (int state = 0; state < paddedStates; state += vectorWidth) {
+		__m256d emissionVector = _mm256_loadu_pd(emission + state);
+		__m256d best = _mm256_set1_pd(-numeric_limits<double>::infinity());
+		__m256d bestState = _mm256_set1_pd(HMMTrellis::noPreviousState);
+		__m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+		for (int k = 0; k < maxPredecessors; k++) {
+			int index = k * paddedStates + state;
+			__m128i predecessor = _mm_loadu_si128((const __m128i*) &predecessorIndexes[index]);
+			__m256d score =
+				_mm256_add_pd(
+					_mm256_mask_i32gather_pd(best, previous, predecessor, allLanes, 8),
+					_mm256_add_pd(_mm256_loadu_pd(&transitions[index]), emissionVector)
+				);
+			__m256d higher = _mm256_cmp_pd(score, best, _CMP_GT_OQ);
+			best = _mm256_blendv_pd(best, score, higher);
+			bestState = _mm256_blendv_pd(bestState, _mm256_loadu_pd(&predecessorStates[index]), higher);
+		}
+
+		_mm256_storeu_pd(&bestWeights[state], best);
+		_mm256_storeu_pd(&bestStates[state], bestState);
+	}
+}
+#else
+void HMMViterbiKernel::calculateBestAVX2(int codon) {
+	calculateBestScalar(codon);
+}
+#endif
+
+// calculateBestNEON(int codon)
+//  Purpose:
+//		Fills bestWeights and bestStates for codon from previousColumn
+//		(two states per instruction)
+#if defined(HMM_VITERBI_KERNEL_NEON)
+void HMMViterbiKernel::calculateBestNEON(int codon) {
+	const double* emission = &emissions[codon * paddedStates];
+
+	for (int state = 0; state < paddedStates; state += 2) {
+		float64x2_t emissionVector = vld1q_f64(emission + state);
+		float64x2_t best = vdupq_n_f64(-numeric_limits<double>::infinity());
+		float64x2_t bestState = vdupq_n_f64(HMMTrellis::noPreviousState);
+
+		for (int k = 0; k < maxPredecessors; k++) {
+			int index = k * paddedStates + state;
+			double gathered[2] = {
+				previousColumn[predecessorIndexes[index]],
+				previousColumn[predecessorIndexes[index + 1]]
+			};
+			float64x2_t score =
+				vaddq_f64(
+					vld1q_f64(gathered),
+					vaddq_f64(vld1q_f64(&transitions[index]), emissionVector)
+				);
+			uint64x2_t higher = vcgtq_f64(score, best);
+			best = vbslq_f64(higher, score, best);
+			bestState = vbslq_f64(higher, vld1q_f64(&predecessorStates[index]), bestState);
+		}
+
+		vst1q_f64(&bestWeights[state], best);
+		vst1q_f64(&bestStates[state], bestState);
+	}
+}
+#else
+void HMMViterbiKernel::calculateBestNEON(int codon) {
+	calculateBestScalar(codon);
+}
+#endif
+
+// calculateFloatColumn(const double* previousWeights, int codon, double* weights, uint8_t* previousStates)
+//  Purpose:
+//		calculateColumn for floatPrecision
+void HMMViterbiKernel::calculateFloatColumn(const double* previousWeights, int codon, double* weights, uint8_t* previousStates) {
+	float minusInfinity = -numeric_limits<float>::infinity();
+
+	// The column is calculated relative to the highest previous weight
+	double offset = -DBL_MAX;
+	for (int state = 0; state < numStates; state++)
+		offset = max(offset, previousWeights[state]);
+
+	for (int state = 0; state < numStates; state++) {
+		if (previousWeights[state] == -DBL_MAX)
+			floatPreviousColumn[state] = minusInfinity;
+		else
+			floatPreviousColumn[state] = (float) (previousWeights[state] - offset);
+	}
+
+	if (instructionSet == avx2InstructionSet)
+		calculateFloatBestAVX2(codon);
+	else if (instructionSet == neonInstructionSet)
+		calculateFloatBestNEON(codon);
+	else
+		calculateFloatBestScalar(codon);
+
+	weights[0] = -DBL_MAX;
+	previousStates[0] = HMMTrellis::noPreviousState;
+	for (int state = 1; state < numStates; state++) {
+		if (floatBestWeights[state] == minusInfinity) {
+			weights[state] = -DBL_MAX;
+			previousStates[state] = HMMTrellis::noPreviousState;
+		}
+		else {
+			weights[state] = offset + (double) floatBestWeights[state];
+			previousStates[state] = (uint8_t) floatBestStates[state];
+		}
+	}
+}
+
+// calculateFloatBestScalar(int codon)
+//  Purpose:
+//		Fills floatBestWeights and floatBestStates for codon from
+//		floatPreviousColumn
+void HMMViterbiKernel::calculateFloatBestScalar(int codon) {
+	const float* emission = &floatEmissions[codon * paddedStates];
+
+	for (int state = 0; state < paddedStates; state++) {
+		float best = -numeric_limits<float>::infinity();
+		float bestState = HMMTrellis::noPreviousState;
+
+		for (int k = 0; k < maxPredecessors; k++) {
+			int index = k * paddedStates + state;
+			float score = floatPreviousColumn[predecessorIndexes[index]] + (floatTransitions[index] + emission[state]);
+			bool higher = score > best;
+			best = higher ? score : best;
+			bestState = higher ? floatPredecessorStates[index] : bestState;
+		}
+
+		floatBestWeights[state] = best;
+		floatBestStates[state] = bestState;
+	}
+}
+
+// calculateFloatBestAVX2(int codon)
+//  Purpose:
+//		Fills floatBestWeights and floatBestStates for codon from
+//		floatPreviousColumn (eight states per instruction)
+#if defined(HMM_VITERBI_KERNEL_AVX2)
+__attribute__((target("avx2")))
+void HMMViterbiKernel::calculateFloatBestAVX2(int codon) {
+	const float* emission = &floatEmissions[codon * paddedStates];
+	const float* previous = &floatPreviousColumn[0];
+
+	for (int state = 0; state < paddedStates; state += floatVectorWidth) {
+		__m256 emissionVector = _mm256_loadu_ps(emission + state);
+		__m256 best = _mm256_set1_ps(-numeric_limits<float>::infinity());
+		__m256 bestState = _mm256_set1_ps(HMMTrellis::noPreviousState);
+		__m256 allLanes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (int k = 0; k < maxPredecessors; k++) {
+			int index = k * paddedStates + state;
+			__m256i predecessor = _mm256_loadu_si256((const __m256i*) &predecessorIndexes[index]);
+			__m256 score =
+				_mm256_add_ps(
+					_mm256_mask_i32gather_ps(best, previous, predecessor, allLanes, 4),
+					_mm256_add_ps(_mm256_loadu_ps(&floatTransitions[index]), emissionVector)
+				);
+			__m256 higher = _mm256_cmp_ps(score, best, _CMP_GT_OQ);
+			best = _mm256_blendv_ps(best, score, higher);
+			bestState = _mm256_blendv_ps(bestState, _mm256_loadu_ps(&floatPredecessorStates[index]), higher);
+		}
+
+		_mm256_storeu_ps(&floatBestWeights[state], best);
+		_mm256_storeu_ps(&floatBestStates[state], bestState);
+	}
+}
+#else
+void HMMViterbiKernel::calculateFloatBestAVX2(int codon) {
+	calculateFloatBestScalar(codon);
+}
+#endif
+
+// calculateFloatBestNEON(int codon)
+//  Purpose:
+//		Fills floatBestWeights and floatBestStates for codon from
+//		floatPreviousColumn (four states per instruction)
+#if defined(HMM_VITERBI_KERNEL_NEON)
+void HMMViterbiKernel::calculateFloatBestNEON(int codon) {
+	const float* emission = &floatEmissions[codon * paddedStates];
+
+	for (int state = 0; state < paddedStates; state += 4) {
+		float32x4_t emissionVector = vld1q_f32(emission + state);
+		float32x4_t best = vdupq_n_f32(-numeric_limits<float>::infinity());
+		float32x4_t bestState = vdupq_n_f32(HMMTrellis::noPreviousState);
+
+		for (int k = 0; k < maxPredecessors; k++) {
+			int index = k * paddedStates + state;
+			float gathered[4] = {
+				floatPreviousColumn[predecessorIndexes[index]],
+				floatPreviousColumn[predecessorIndexes[index + 1]],
+				floatPreviousColumn[predecessorIndexes[index + 2]],
+				floatPreviousColumn[predecessorIndexes[index + 3]]
+			};
+			float32x4_t score =
+				vaddq_f32(
+					vld1q_f32(gathered),
+					vaddq_f32(vld1q_f32(&floatTransitions[index]), emissionVector)
+				);
+			uint32x4_t higher = vcgtq_f32(score, best);
+			best = vbslq_f32(higher, score, best);
+			bestState = vbslq_f32(higher, vld1q_f32(&floatPredecessorStates[index]), bestState);
+		}
+
+		vst1q_f32(&floatBestWeights[state], best);
+		vst1q_f32(&floatBestStates[state], bestState);
+	}
+}
+#else
+void HMMViterbiKernel::calculateFloatBestNEON(int codon) {
+	calculateFloatBestScalar(codon);
+}
+#endif
@@ -0,0 +1,182 @@
+/*
+ * HMMViterbiKernel.h
+ *
+ *	This is the header file for the HMMViterbiKernel object.
+ *  HMMViterbiKernel is a vectorized version of the per-position viterbi
+ *  update in HMMTrellis.  It is compiled from an HMMProbabilities and
+ *  HMMTopology snapshot into small dense tables:
+ *
+ *		emissions[codon * paddedStates + state] - log emission probability
+ *			(codon major so one codon's emissions are one contiguous load)
+ *		transitions[k * paddedStates + state] - log probability of the k'th
+ *			incoming transition of state
+ *		predecessorIndexes[k * paddedStates + state] - the k'th predecessor
+ *			of state
+ *
+ *  The states are padded to a multiple of the vector width and every
+ *  state is given the same number of incoming transitions (the largest
+ *  in the topology).  Missing transitions, padding states, state 0 and log
+ *  zero emissions are -infinity instead of the NaN used by MathUtilities,
+ *  so the column update is branch free:
+ *
+ *		weight[state] = max over k of
+ *			previous[predecessor k] + (transition k + emission)
+ *
+ *  The k are in ascending predecessor order and only a strictly greater
+ *  candidate replaces the best, so ties go to the lowest numbered previous
+ *  state.
+ *
+ *  The instruction set is chosen at runtime: AVX2 on x86 processors that
+ *  support it, NEON on 64 bit ARM, otherwise a scalar version of the same
+ *  algorithm.
+ *
+ *  Precision:
+ *	  The tables are built for the precision passed to the constructor.
+ *    doublePrecision works in double (four states per AVX2 instruction).
+ *    floatPrecision keeps float copies of the tables and works in float
+ *    (eight states per AVX2 instruction, half the table traffic).  Log
+ *    scores are only added and compared, so no scaling is needed, but a
+ *    float can not hold the absolute path weight of a long sequence to
+ *    a useful resolution.  Each float column is calculated relative to
+ *    the highest weight of the previous column and that offset is added
+ *    back in double, so the resolution does not depend on the position.
+ *    Float weights are rounded differently than the long double
+ *    reference, so paths that score within the rounding error of each
+ *    other may be traded (see HiddenMarkovModel::crossCheckViterbiPrecision).
+ *
+ *  The double kernel works in double rather than the long double used
+ *  by HMMTrellis.  The weights come out the same, but HMMTrellis compares
+ *  each long double score against the best weight already rounded to
+ *  double, so on an exact tie it can pick a higher numbered previous state
+ *  and the two paths can differ between tied genes (see
+ *  HiddenMarkovModel::crossCheckVectorizedViterbi).
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMVITERBIKERNEL_H
+#define HMMVITERBIKERNEL_H
+#include "HMMProbabilities.h"
+#include "HMMTopology.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+class HMMViterbiKernel
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMViterbiKernel();
+	HMMViterbiKernel(HMMProbabilities* probabilities, HMMTopology* topology, int aPrecision);
+
+	// Destructor
+	// =============================================
+	~HMMViterbiKernel();
+
+	// Public Class Attributes
+	// =============================================
+	static const int scalarInstructionSet;
+	static const int avx2InstructionSet;
+	static const int neonInstructionSet;
+	static const int vectorWidth;		// states are padded to a multiple of this
+	static const int floatVectorWidth;	// (or this for floatPrecision)
+	static const int longDoublePrecision;	// the HMMTrellis reference (no kernel)
+	static const int doublePrecision;
+	static const int floatPrecision;
+
+	// Public Class Methods
+	// =============================================
+
+	// int bestInstructionSet()
+	//  Purpose:
+	//		Returns the fastest instruction set supported by this processor
+	static int bestInstructionSet();
+
+	// string instructionSetName(int instructionSet)
+	//  Purpose:
+	//		Returns the name of instructionSet ("scalar", "avx2" or "neon")
+	static string instructionSetName(int instructionSet);
+
+	// int parsePrecision(string name)
+	//  Purpose:
+	//		Returns the precision named name ("long", "double" or "float").
+	//		Throws an invalid_argument exception for any other name.
+	static int parsePrecision(string name);
+
+	// string precisionName(int precision)
+	//  Purpose:
+	//		Returns the name of precision ("long", "double" or "float")
+	static string precisionName(int precision);
+
+	// Public Attributes
+	// =============================================
+	int numStates;
+	int paddedStates;
+	int maxPredecessors;
+	int instructionSet;
+	int precision;
+
+	// Public Methods
+	// =============================================
+
+	// calculateColumn(const double* previousWeights, int codon, double* weights, uint8_t* previousStates)
+	//  Purpose:
+	//		Calculates the viterbi weight and previous state of every state for
+	//		a position emitting codon from the weights of the previous position.
+	//		previousWeights and weights use the HMMTrellis convention (numStates
+	//		values, -DBL_MAX for unreachable states), unreachable states are
+	//		given HMMTrellis::noPreviousState.
+	void calculateColumn(const double* previousWeights, int codon, double* weights, uint8_t* previousStates);
+
+private:
+
+	// Private Attributes
+	// =============================================
+	vector<double> emissions;
+	vector<double> transitions;
+	vector<int32_t> predecessorIndexes;
+	vector<double> predecessorStates;	// predecessorIndexes as doubles (for blending)
+	vector<double> previousColumn;		// padded -infinity convention work space
+	vector<double> bestWeights;
+	vector<double> bestStates;
+
+	// Float copies (floatPrecision only)
+	vector<float> floatEmissions;
+	vector<float> floatTransitions;
+	vector<float> floatPredecessorStates;
+	vector<float> floatPreviousColumn;
+	vector<float> floatBestWeights;
+	vector<float> floatBestStates;
+
+	// Private Methods
+	// =============================================
+
+	// calculateBestScalar(int codon)
+	// calculateBestAVX2(int codon)
+	// calculateBestNEON(int codon)
+	//  Purpose:
+	//		Fills bestWeights and bestStates for codon from previousColumn
+	void calculateBestScalar(int codon);
+	void calculateBestAVX2(int codon);
+	void calculateBestNEON(int codon);
+
+	// calculateFloatColumn(const double* previousWeights, int codon, double* weights, uint8_t* previousStates)
+	//  Purpose:
+	//		calculateColumn for floatPrecision
+	void calculateFloatColumn(const double* previousWeights, int codon, double* weights, uint8_t* previousStates);
+
+	// calculateFloatBestScalar(int codon)
+	// calculateFloatBestAVX2(int codon)
+	// calculateFloatBestNEON(int codon)
+	//  Purpose:
+	//		Fills floatBestWeights and floatBestStates for codon from
+	//		floatPreviousColumn
+	void calculateFloatBestScalar(int codon);
+	void calculateFloatBestAVX2(int codon);
+	void calculateFloatBestNEON(int codon);
+};
+
+#endif // HMMVITERBIKERNEL_H
@@ -11,11 +11,16 @@
  *		segmentCounts - how many segments (i.e., continuos occurencee of
  *						one state) of each state occurs
  *		segments - collection of start and stop values for each segment
+ *		emissionCounts - how many times a state emits each codon, flat
+ *						 [state * CodonUtilities::numEmissionCodons + codon]
  *		transitionCounts - counts for how many time states transition (both
  *						   from one state to another and from one state to 
- *						   the stame state)
+ *						   the stame state), flat [beginState * numStates + endState]
  *		probabilities - the probabilites that are calculated from the above 
- *						results
+ *						results (NULL until calculateProbabilities is called,
+ *						so the results of a single sequence never build any)
+ *		elapsedSeconds, pathChanges, probabilityChange - convergence
+ *						statistics of the iteration (see hasConverged)
  *
  *	resultsWithoutSegments() - returns a string of all results except segments
  *	allResults() - returns a string of all results (including segements)
@@ -25,41 +30,48 @@
  */
 #include "HMMViterbiResults.h"
 #include "StringUtilities.h"
+#include "CodonUtilities.h"
+#include "HMMInstrumentation.h"
 #include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
 
 // Constuctors
 // ==============================================
 HMMViterbiResults::HMMViterbiResults() {
+	probabilities = NULL;
+	pathFollowingState = -1;
+	pathGene = NULL;
+	pathFirstGene = 0;
 }
 
 HMMViterbiResults::HMMViterbiResults(int anIteration, int numberOfStates) {
 
 	iteration = anIteration;
 	numStates = numberOfStates;
-	probabilities = new HMMProbabilities(numStates);
+	probabilities = NULL;
+	pathFollowingState = -1;
+	pathGene = NULL;
+	pathFirstGene = 0;
 
+	// initialize convergence statistics
+	elapsedSeconds = 0;
+	pathChanges = -1;
+	probabilityChange = -1;
 
 	// initialize counts vectors
 	topStrandGeneCount = 0;
 	bottomStrandGeneCount = 0;
-	for (int i = 0; i < numStates; i++) {
-		stateCounts.push_back(0);
-		transitionCounts.push_back(vector<int>());
-		for (int j = 0; j < numStates; j++) {
-			transitionCounts[i].push_back(0);
-		}
-		if (i > 0) {
-			for (pair<string, int> mapPair : probabilities->emissionResidueMap) {
-				string& residue = mapPair.first;
-				emissionCounts[i][residue] = 0;
-			}
-		}
-	}
+	stateCounts.assign(numStates, 0);
+	transitionCounts.assign(numStates * numStates, 0);
+	emissionCounts.assign(numStates * CodonUtilities::numEmissionCodons, 0);
 }
 
 // Destructor
 // =============================================
 HMMViterbiResults::~HMMViterbiResults(){
+	delete probabilities;
 }
 
 // Public Methods
@@ -123,37 +135,224 @@ string HMMViterbiResults::allResults() {
 //		this object as well as the probabilites from the previous
 //		iteration of the viterbi training.
 //
-//		For now, only the transistion probabilties are being recalculated
-//		from the data in this object.  The initaition and emission
-//		probabilties are being held steady and are set to the values
-//		from the previous iteration
+//		The emission and transition probabilties are recalculated from the
+//		data in this object.  The initaition probabilities and the emission
+//		probabilities of the unknown codon are being held steady and are
+//		set to the values from the previous iteration
 //	Postconditions:
 //		probabilites - will be populated
 void HMMViterbiResults::calculateProbabilities(HMMProbabilities* previousProbs) {
+	HMM_SCOPED_TIMER(reestimationTimer);
+
+	if (probabilities == NULL)
+		probabilities = new HMMProbabilities(numStates);
+	long double* initiation = probabilities->initiationProbabilityValues();
+	long double* emission = probabilities->emissionProbabilityValues();
+	long double* transition = probabilities->transitionProbabilityValues();
 
 	// initiation probabilties - Use initation from previous probabilites
 	for (int state = 1; state < numStates; state++) {
-		probabilities->setInitiationProbability(state, previousProbs->initiationProbability(state));
+		initiation[state] = previousProbs->initiationProbability(state);
 	}
 
 	// emission probabilities
 	for (int state = 1; state < numStates; state++) {
-		for (pair<string, int> mapPair : probabilities->emissionResidueMap) {
-			string& residue = mapPair.first;
-			long double newProbability = 
-				emissionCounts.at(state).at(residue) / (double) stateCounts[state];
-			probabilities->setEmissionProbability(state, residue, newProbability);
+		int first = state * CodonUtilities::numEmissionCodons;
+		for (int codon = 0; codon < CodonUtilities::numCodons; codon++) {
+			emission[first + codon] = emissionCounts[first + codon] / (double) stateCounts[state];
 		}
+		emission[first + CodonUtilities::unknownCodon] = previousProbs->unknownEmissionProbability(state);
 	}
 
 	// transition probabilites
 	for (int firstState = 1; firstState < numStates; firstState++) {
 		for (int secondState = 1; secondState < numStates; secondState++) {
-			long double newProbability =
-				transitionCounts[firstState][secondState] / (double) stateCounts[firstState];
-			probabilities->setTransitionProbability(firstState, secondState, newProbability);
+			transition[firstState * numStates + secondState] =
+				transitionCounts[firstState * numStates + secondState] / (double) stateCounts[firstState];
 		}
 	}
+	probabilities->calculateLogProbabilities();
+
+	probabilityChange = probabilities->maximumDifference(previousProbs);
+}
+
+// addCounts(HMMViterbiResults* otherResults)
+//  Purpose:
+//		Adds the state, gene, emission and transition counts of otherResults
+//		to the counts in this object.  Used to reduce the results of several
+//		sequences into one set of counts before calculateProbabilities is
+//		called.  The genes themselves are not copied as their positions are
+//		relative to their own sequence.
+void HMMViterbiResults::addCounts(HMMViterbiResults* otherResults) {
+	if (otherResults->pathChanges >= 0)
+		pathChanges = max(pathChanges, 0) + otherResults->pathChanges;
+
+	topStrandGeneCount += otherResults->topStrandGeneCount;
+	bottomStrandGeneCount += otherResults->bottomStrandGeneCount;
+
+	for (int i = 0; i < numStates; i++)
+		stateCounts[i] += otherResults->stateCounts[i];
+
+	for (unsigned int i = 0; i < transitionCounts.size(); i++)
+		transitionCounts[i] += otherResults->transitionCounts[i];
+
+	for (unsigned int i = 0; i < emissionCounts.size(); i++)
+		emissionCounts[i] += otherResults->emissionCounts[i];
+}
+
+// gatherPathCounts(const vector<uint8_t>& path, const uint8_t* codons)
+//  Purpose:
+//		Walks the viterbi path (path[position - 1] is the state at position,
+//		codons[position - 1] the codon it emits) backward and gathers the
+//		results (see addPathPosition and endPath).
+void HMMViterbiResults::gatherPathCounts(const vector<uint8_t>& path, const uint8_t* codons) {
+	for (int position = path.size(); position >= 1 && path[position - 1] != 0; position--)
+		addPathPosition(position, path[position - 1], codons[position - 1]);
+	endPath();
+}
+
+// addPathPosition(int position, int state, uint8_t codon)
+//  Purpose:
+//		Adds one position of a viterbi path to the counts as the path is
+//		walked backward.  Results gathered include the following:
+//			state counts - how many times a state occurs in the path
+//			emission counts - how many times a state emits each codon
+//			genes - start and end of every gene (a top strand gene runs from
+//					a state 1 to a state 5, a bottom strand gene from a
+//					state 11 to a state 7)
+//			transition counts - counts for how many time states transition (both
+//								from one state to another and from one state to 
+//							    the stame state)
+//		Throws an out_of_range exception (in endPath) if the path ends
+//		inside of a gene.
+void HMMViterbiResults::addPathPosition(int position, int state, uint8_t codon) {
+	if (pathFollowingState < 0)
+		pathFirstGene = genes.size();
+
+	// Update number of occurrences for a state
+	stateCounts[state]++;
+
+	// Update emission count for state (unknown codons are not counted)
+	if (codon != CodonUtilities::unknownCodon)
+		emissionCounts[state * CodonUtilities::numEmissionCodons + codon]++;
+
+	// Update segment info
+	if (pathGene == NULL) {
+		// We are walking the path backward so
+		// Check for top strand stop codon or bottom strand star codon
+		if (state == 5 || state == 7) {
+			// Create a new gene
+			pathGene = geneArena.create<Gene>();
+			pathGene->end = position + 2;
+
+			if (state == 5) {
+				pathGene->isTopStrand = true;
+				topStrandGeneCount++;
+			}
+			else {
+				pathGene->isTopStrand = false;
+				bottomStrandGeneCount++;
+			}
+		}
+	}
+	else {  // Currently inside of a gene
+		// Check for top strand start codon or bottom strand stop codon
+		if ((pathGene->isTopStrand && state == 1)
+			|| (!pathGene->isTopStrand &&  state == 11)) {
+
+			// Add gene to genes collection
+			pathGene->start = position;
+			genes.push_back(pathGene);
+			pathGene = NULL;
+		}
+	}
+
+	// Update transition counts
+	if (pathFollowingState >= 0) {
+		transitionCounts[state * numStates + pathFollowingState]++;
+	}
+
+	// Set up variables for next position
+	pathFollowingState = state;
+}
+
+// endPath()
+//  Purpose:
+//		Finishes the path added with addPathPosition.  Throws an
+//		out_of_range exception if the path ends inside of a gene.
+//  Postconditions:
+//		genes - in increasing order
+void HMMViterbiResults::endPath() {
+	bool insideGene = pathGene != NULL;
+	pathFollowingState = -1;
+	pathGene = NULL;
+
+	// The genes were found walking the path backward
+	reverse(genes.begin() + pathFirstGene, genes.end());
+	pathFirstGene = genes.size();
+
+	if (insideGene) {
+		throw out_of_range("Sequence should not end inside of a gene!");
+	}
+}
+
+// bool hasConverged(long double probabilityThreshold, int pathChangeThreshold)
+//  Purpose:
+//		Returns true if probabilityChange is at most probabilityThreshold or
+//		pathChanges is at most pathChangeThreshold.  A negative threshold
+//		is not checked.  No path changes means the probabilities calculated
+//		from this iteration are the ones it was decoded with, so every
+//		further iteration would give the same results.
+bool HMMViterbiResults::hasConverged(long double probabilityThreshold, int pathChangeThreshold) {
+	if (probabilityThreshold >= 0 && probabilityChange >= 0 && probabilityChange <= probabilityThreshold)
+		return true;
+
+	if (pathChangeThreshold >= 0 && pathChanges >= 0 && pathChanges <= pathChangeThreshold)
+		return true;
+
+	return false;
+}
+
+// bool sameGenes(HMMViterbiResults* otherResults, int firstPosition, int lastPosition)
+//  Purpose:
+//		Returns true if this and otherResults (gathered from the same
+//		sequence) have the same genes among the ones overlapping positions
+//		firstPosition..lastPosition
+bool HMMViterbiResults::sameGenes(HMMViterbiResults* otherResults, int firstPosition, int lastPosition) {
+	vector<Gene*>* geneLists[2] = { &genes, &otherResults->genes };
+	vector<tuple<int, int, bool>> overlappingGenes[2];
+
+	for (int list = 0; list < 2; list++) {
+		for (Gene* gene : *geneLists[list]) {
+			if (gene->end >= firstPosition && gene->start <= lastPosition)
+				overlappingGenes[list].push_back(make_tuple(gene->start, gene->end, gene->isTopStrand));
+		}
+		sort(overlappingGenes[list].begin(), overlappingGenes[list].end());
+	}
+
+	return overlappingGenes[0] == overlappingGenes[1];
+}
+
+// string convergenceResultsString()
+//  Purpose:
+//		Returns a string representing the convergence statistics
+//
+//		format:
+//			<result type="convergence">
+//				iteration=<<iteration>>,seconds=<<elapsedSeconds>>,
+//				path_changes=<<pathChanges>>,
+//				probability_change=<<probabilityChange>>
+//			</result>
+string HMMViterbiResults::convergenceResultsString() {
+	stringstream ss;
+
+	ss
+		<< "iteration=" << iteration << ","
+		<< "seconds=" << elapsedSeconds << ","
+		<< "path_changes=" << pathChanges << ","
+		<< "probability_change=" << (double) probabilityChange;
+
+	return StringUtilities::xmlResult("convergence", ss.str());
 }
 
 // Private Methods
@@ -213,6 +412,9 @@ string HMMViterbiResults::geneHistogramResultsString() {
 //			<<emissionProbabilitesResultsString>>
 //			...
 string HMMViterbiResults::probabilitiesResultsString() {
+	if (probabilities == NULL)
+		return "";
+
 	return probabilities->probabilitiesResultsString();
 }
 
@@ -229,9 +431,7 @@ string HMMViterbiResults::geneResultsString() {
 	
 	int counter = 0;
 
-	vector<Gene*>::reverse_iterator rit;
-	for (rit = genes.rbegin(); rit!= genes.rend(); rit++) {
-		Gene* gene = *rit;
+	for (Gene* gene : genes) {
 		ss 
 			<< "("
 			<< gene->start
@@ -262,9 +462,7 @@ string HMMViterbiResults::shortGeneResultsString() {
 	
 	int counter = 0;
 
-	vector<Gene*>::reverse_iterator rit;
-	for (rit = genes.rbegin(); rit!= genes.rend(); rit++) {
-		Gene* gene = *rit;
+	for (Gene* gene : genes) {
 		ss 
 			<< "("
 			<< gene->start
@@ -302,7 +500,7 @@ string HMMViterbiResults::transitionCountsResultsString() {
 			ss
 				<< i + 1 << j + 1
 				<< "="
-				<< transitionCounts[i][j];
+				<< transitionCounts[i * numStates + j];
 
 			if ( i < numStates - 1 || j < numStates - 1)
 			   ss << ",";
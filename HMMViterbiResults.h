@@ -11,11 +11,20 @@
  *		segmentCounts - how many segments (i.e., continuos occurencee of
  *						one state) of each state occurs
  *		segments - collection of start and stop values for each segment
+ *		emissionCounts - how many times a state emits each codon, flat
+ *						 [state * CodonUtilities::numEmissionCodons + codon]
  *		transitionCounts - counts for how many time states transition (both
  *						   from one state to another and from one state to 
- *						   the stame state)
+ *						   the stame state), flat [beginState * numStates + endState]
  *		probabilities - the probabilites that are calculated from the above 
- *						results
+ *						results (NULL until calculateProbabilities is called,
+ *						so the results of a single sequence never build any)
+ *		elapsedSeconds, pathChanges, probabilityChange - convergence
+ *						statistics of the iteration (see hasConverged)
+ *
+ *  The genes are allocated from an arena owned by the results (see
+ *  HMMArena) and are all released with it.  The results own their
+ *  probabilities, so they can not be copied.
  *
  *	resultsWithoutSegments() - returns a string of all results except segments
  *	allResults() - returns a string of all results (including segements)
@@ -27,9 +36,10 @@
 #ifndef HMMVITERBIRESULTS_H
 #define HMMVITERBIRESULTS_H
 #include "HMMProbabilities.h"
-#include <map>
+#include "HMMArena.h"
 #include <vector>
 #include <string>
+#include <stdint.h>
 using namespace std;
 
 class HMMViterbiResults
@@ -57,10 +67,17 @@ public:
 	vector<int> stateCounts;
 	int topStrandGeneCount;
 	int bottomStrandGeneCount;
-	vector<Gene*> genes;
-	map<int, map<string, int>> emissionCounts;
-	vector<vector<int>> transitionCounts;
-	HMMProbabilities* probabilities;
+	vector<Gene*> genes;			// in increasing order, allocated from geneArena
+	vector<int> emissionCounts;		// [state * CodonUtilities::numEmissionCodons + codon]
+	vector<int> transitionCounts;	// [beginState * numStates + endState]
+	HMMProbabilities* probabilities;	// owned, NULL until calculated
+
+	// Convergence statistics
+	double elapsedSeconds;			// time to decode and gather the iteration
+	int pathChanges;				// positions whose state changed since the
+									// last iteration (-1 if unknown)
+	long double probabilityChange;	// largest change of any probability from
+									// the last iteration (-1 if unknown)
 
 	// Public Methods
 	// =============================================
@@ -96,16 +113,95 @@ public:
 	//		this object as well as the probabilites from the previous
 	//		iteration of the viterbi training.
 	//
-	//		For now, only the transistion probabilties are being recalculated
-	//		from the data in this object.  The initaition and emission
-	//		probabilties are being held steady and are set to the values
-	//		from the previous iteration
+	//		The emission and transition probabilties are recalculated from the
+	//		data in this object.  The initaition probabilities and the emission
+	//		probabilities of the unknown codon are being held steady and are
+	//		set to the values from the previous iteration.  The tables are
+	//		updated in place and their logs recalculated in one pass.
 	//	Postconditions:
 	//		probabilites - will be populated
 	void calculateProbabilities(HMMProbabilities* previousProbs);
 
+	// addCounts(HMMViterbiResults* otherResults)
+	//  Purpose:
+	//		Adds the state, gene, emission and transition counts of otherResults
+	//		to the counts in this object.  Used to reduce the results of several
+	//		sequences into one set of counts before calculateProbabilities is
+	//		called.  The genes themselves are not copied as their positions are
+	//		relative to their own sequence.
+	void addCounts(HMMViterbiResults* otherResults);
+
+	// gatherPathCounts(const vector<uint8_t>& path, const uint8_t* codons)
+	//  Purpose:
+	//		Walks the viterbi path (path[position - 1] is the state at position,
+	//		codons[position - 1] the codon it emits) backward and gathers the
+	//		state, emission and transition counts and the genes (see
+	//		addPathPosition and endPath).
+	void gatherPathCounts(const vector<uint8_t>& path, const uint8_t* codons);
+
+	// addPathPosition(int position, int state, uint8_t codon)
+	//  Purpose:
+	//		Adds one position of a viterbi path to the counts as the path is
+	//		walked backward (e.g., straight from the traceback, so the path
+	//		does not have to be stored).  Positions are added from the last to
+	//		the first.
+	void addPathPosition(int position, int state, uint8_t codon);
+
+	// endPath()
+	//  Purpose:
+	//		Finishes the path added with addPathPosition.  Throws an
+	//		out_of_range exception if the path ends inside of a gene.
+	//  Postconditions:
+	//		genes - in increasing order
+	void endPath();
+
+	// bool hasConverged(long double probabilityThreshold, int pathChangeThreshold)
+	//  Purpose:
+	//		Returns true if probabilityChange is at most probabilityThreshold or
+	//		pathChanges is at most pathChangeThreshold.  A negative threshold
+	//		is not checked.  No path changes means the probabilities calculated
+	//		from this iteration are the ones it was decoded with, so every
+	//		further iteration would give the same results.
+	bool hasConverged(long double probabilityThreshold, int pathChangeThreshold);
+
+	// bool sameGenes(HMMViterbiResults* otherResults, int firstPosition, int lastPosition)
+	//  Purpose:
+	//		Returns true if this and otherResults (gathered from the same
+	//		sequence) have the same genes among the ones overlapping positions
+	//		firstPosition..lastPosition
+	bool sameGenes(HMMViterbiResults* otherResults, int firstPosition, int lastPosition);
+
+	// string convergenceResultsString()
+	//  Purpose:
+	//		Returns a string representing the convergence statistics
+	//
+	//		format:
+	//			<result type="convergence">
+	//				iteration=<<iteration>>,seconds=<<elapsedSeconds>>,
+	//				path_changes=<<pathChanges>>,
+	//				probability_change=<<probabilityChange>>
+	//			</result>
+	string convergenceResultsString();
+
+	// string geneResultsString()
+	//  Purpose:
+	//		Returns a string representing the genes
+	//
+	//		format:
+	//			<result type="genes">
+	//				(gene1start, gene1end, strand),(gene2start, gene2end, strand),...
+	//			</result>
+	string geneResultsString();
+
 private:
 
+	// Private Attributes
+	// =============================================
+	HMMArena geneArena;
+	int pathFollowingState;		// state after the last position added (-1 if none)
+	Gene* pathGene;				// gene the last position added is inside of
+	unsigned int pathFirstGene;	// first of the genes of the path being added
+
 	// Private Methods
 	// =============================================
 
@@ -119,15 +215,15 @@ private:
 	//			</result>
 	string stateHistogramResultsString();
 
-// string geneHistogramResultsString()
-//  Purpose:
-//		Returns a string representing the gene histogram
-//
-//		format:
-//			<result type="segment_histogram">
-//				<<strand>>=<<gene count>>,
-//			</result>
-string geneHistogramResultsString();
+	// string geneHistogramResultsString()
+	//  Purpose:
+	//		Returns a string representing the gene histogram
+	//
+	//		format:
+	//			<result type="segment_histogram">
+	//				<<strand>>=<<gene count>>,
+	//			</result>
+	string geneHistogramResultsString();
 
 	// string probabilitiesResultsString()
 	//  Purpose:
@@ -142,15 +238,6 @@ string geneHistogramResultsString();
 	//			...
 	string probabilitiesResultsString();
 
-	// string geneResultsString()
-	//  Purpose:
-	//		Returns a string representing the genes
-	//
-	//		format:
-	//			<result type="genes">
-	//				(gene1start, gene1end, strand),(gene2start, gene2end, strand),...
-	//			</result>
-	string geneResultsString();
 	string shortGeneResultsString();
 
 
@@ -205,6 +292,8 @@ string geneHistogramResultsString();
 	//			</result>
 	string transitionCountsResultsString();
 
+	HMMViterbiResults(const HMMViterbiResults&);
+	HMMViterbiResults& operator=(const HMMViterbiResults&);
 };
 
 #endif // HMMVITERBIRESULTS_H
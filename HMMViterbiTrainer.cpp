@@ -0,0 +1,286 @@
+/*
+ * HMMViterbiTrainer.cpp
+ *
+ *	This is the cpp file for the HMMViterbiTrainer object.
+ *  HMMViterbiTrainer trains one set of probabilities with viterbi training
+ *  across a collection of sequences (e.g., every record of a multi-record
+ *  Fasta file or hundreds of genomes).
+ *
+ *  See HMMViterbiTrainer.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMViterbiTrainer.h"
+#include "HMMGeneTopology.h"
+#include "StringUtilities.h"
+#include <sstream>
+#include <chrono>
+#include <utility>
+
+// const variable initialization
+// ==============================================
+const int HMMViterbiTrainer::numStates = HMMGeneTopology::numStates;
+
+// Constuctors
+// ==============================================
+HMMViterbiTrainer::HMMViterbiTrainer(int numberOfThreads)
+	: pool(numberOfThreads) {
+	ownedProbabilities = HMMProbabilities::initialProbabilities();
+	probabilities = ownedProbabilities;
+	checkpointInterval = 0;
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+	twoStrandViterbi = false;
+	orfPruning = true;
+	orfMinimumLength = 0;
+}
+
+// Destructor
+// =============================================
+HMMViterbiTrainer::~HMMViterbiTrainer() {
+	for (HiddenMarkovModel* model : models)
+		delete model;
+	delete ownedProbabilities;
+}
+
+// Public Methods
+// =============================================
+
+// addSequence(FastaFile* aFastaFile)
+//  Purpose:
+//		Adds the sequence of aFastaFile to the training set, named by the
+//		first word of its header (see FastaFile::getSequenceName)
+void HMMViterbiTrainer::addSequence(FastaFile* aFastaFile) {
+	HiddenMarkovModel* model = new HiddenMarkovModel(aFastaFile);
+	model->setViterbiCheckpointInterval(checkpointInterval);
+	model->setViterbiPrecision(viterbiPrecision);
+	model->setTwoStrandViterbi(twoStrandViterbi);
+	model->setOrfPruning(orfPruning, orfMinimumLength);
+	models.push_back(model);
+	sequenceNames.push_back(aFastaFile->getSequenceName());
+}
+
+// addSequence(string name, const uint8_t* someCodons, int numberOfCodons)
+//  Purpose:
+//		Adds an already encoded sequence (e.g., from a GenomeCache) to the
+//		training set
+void HMMViterbiTrainer::addSequence(string name, const uint8_t* someCodons, int numberOfCodons) {
+	HiddenMarkovModel* model = new HiddenMarkovModel(someCodons, numberOfCodons);
+	model->setViterbiCheckpointInterval(checkpointInterval);
+	model->setViterbiPrecision(viterbiPrecision);
+	model->setTwoStrandViterbi(twoStrandViterbi);
+	model->setOrfPruning(orfPruning, orfMinimumLength);
+	models.push_back(model);
+	sequenceNames.push_back(name);
+}
+
+// setViterbiCheckpointInterval(int interval)
+//  Purpose:
+//		Sets the viterbi checkpoint interval of every sequence's model (see
+//		HiddenMarkovModel::setViterbiCheckpointInterval)
+void HMMViterbiTrainer::setViterbiCheckpointInterval(int interval) {
+	checkpointInterval = interval;
+	for (HiddenMarkovModel* model : models)
+		model->setViterbiCheckpointInterval(interval);
+}
+
+// setVectorizedViterbi(bool vectorized)
+//  Purpose:
+//		Selects the viterbi column calculation of every sequence's model (see
+//		HiddenMarkovModel::setVectorizedViterbi)
+void HMMViterbiTrainer::setVectorizedViterbi(bool vectorized) {
+	setViterbiPrecision(vectorized ? HMMViterbiKernel::doublePrecision : HMMViterbiKernel::longDoublePrecision);
+}
+
+// setViterbiPrecision(int precision)
+//  Purpose:
+//		Selects the viterbi precision of every sequence's model (see
+//		HiddenMarkovModel::setViterbiPrecision)
+void HMMViterbiTrainer::setViterbiPrecision(int precision) {
+	viterbiPrecision = precision;
+	for (HiddenMarkovModel* model : models)
+		model->setViterbiPrecision(precision);
+}
+
+// setTwoStrandViterbi(bool twoStrand)
+//  Purpose:
+//		Selects the decoding of every sequence's model (see
+//		HiddenMarkovModel::setTwoStrandViterbi)
+void HMMViterbiTrainer::setTwoStrandViterbi(bool twoStrand) {
+	twoStrandViterbi = twoStrand;
+	for (HiddenMarkovModel* model : models)
+		model->setTwoStrandViterbi(twoStrand);
+}
+
+// setOrfPruning(bool prune, int minimumOrfLength)
+//  Purpose:
+//		Selects the ORF pruning of every sequence's model (see
+//		HiddenMarkovModel::setOrfPruning)
+void HMMViterbiTrainer::setOrfPruning(bool prune, int minimumOrfLength) {
+	orfPruning = prune;
+	orfMinimumLength = minimumOrfLength;
+	for (HiddenMarkovModel* model : models)
+		model->setOrfPruning(prune, minimumOrfLength);
+}
+
+// viterbiTraining(int numIterations)
+//  Purpose:
+//		Perform viterbi training across all of the sequences for the
+//		number of iterations specified.
+//
+//		Each iteration consists of the following steps
+//			1. Decode every sequence in parallel and gather the counts
+//			   along its viterbi path
+//			2. Add the counts of all sequences together (in sequence order)
+//			3. Calculate the probabilities for the next iteration from the
+//			   combined counts
+//
+//  Postconditions:
+//		viterbiResults - contains combined results from each iteration
+//		sequenceResults - contains each sequence's results from the last
+//						  iteration
+//		probabilities - set to the probabilities calculated in the last
+//						iteration
+void HMMViterbiTrainer::viterbiTraining(int numIterations) {
+	viterbiTraining(numIterations, -1, -1);
+}
+
+// int viterbiTraining(int maxIterations, long double probabilityThreshold, int pathChangeThreshold)
+//  Purpose:
+//		Perform viterbi training across all of the sequences until it
+//		converges or maxIterations iterations have been run and return the
+//		number of iterations run (see HiddenMarkovModel::viterbiTraining).
+//		The path changes of the combined results are summed over the
+//		sequences and elapsedSeconds is the wall clock time of the
+//		iteration.
+int HMMViterbiTrainer::viterbiTraining(int maxIterations, long double probabilityThreshold, int pathChangeThreshold) {
+	int numSequences = models.size();
+	int firstIteration = viterbiResults.size() + 1;
+	int iterationsRun = 0;
+
+	for (int iteration = firstIteration; iteration < firstIteration + maxIterations; iteration++) {
+		chrono::steady_clock::time_point iterationStart = chrono::steady_clock::now();
+
+		// Only the last iteration's per sequence results are kept (each
+		// model releases its previous results when it decodes)
+		sequenceResults.assign(numSequences, NULL);
+
+		// Decode every sequence.  Each task only writes its own slot.
+		HMMProbabilities* iterationProbabilities = probabilities;
+		pool.run(numSequences, [&](int sequence) {
+			sequenceResults[sequence] = models[sequence]->viterbiIteration(iterationProbabilities, iteration);
+		});
+
+		// Reduce the counts in sequence order
+		HMMViterbiResults* combinedResults = resultsArena.create<HMMViterbiResults>(iteration, numStates);
+		for (HMMViterbiResults* results : sequenceResults)
+			combinedResults->addCounts(results);
+
+		combinedResults->calculateProbabilities(probabilities);
+		combinedResults->elapsedSeconds =
+			chrono::duration<double>(chrono::steady_clock::now() - iterationStart).count();
+		viterbiResults.push_back(combinedResults);
+		iterationsRun++;
+
+		// Reset the probabilities to the viterbi calculated ones for the next
+		// iteration
+		probabilities = combinedResults->probabilities;
+
+		if (combinedResults->hasConverged(probabilityThreshold, pathChangeThreshold))
+			break;
+	}
+
+	return iterationsRun;
+}
+
+// string viterbiResultsString()
+//  Purpose:
+//		Returns a string representing the results for each iteration in
+//		the viterbi training followed by the genes of every sequence.
+//
+//		format:
+//			<viterbiResultsIteration1.resultsWithoutGenes()>
+//			...
+//			<viterbiResultsIterationLast.resultsWithoutGenes()>
+//			<result type="sequence" name="<<sequence name>>">
+//				<<sequenceResults.geneResultsString()>>
+//			</result>
+//			...
+//  Preconditions:
+//		viterbiTraining has been run
+string HMMViterbiTrainer::viterbiResultsString() {
+	stringstream ss;
+
+	for (HMMViterbiResults* results : viterbiResults)
+		ss << results->resultsWithoutGenes();
+
+	for (unsigned int sequence = 0; sequence < sequenceResults.size(); sequence++) {
+		ss << "    <result type=\"sequence\" name=\"" << sequenceNames[sequence] << "\">\n";
+		ss << sequenceResults[sequence]->geneResultsString();
+		ss << "    </result>\n";
+	}
+
+	return ss.str();
+}
+
+// string convergenceResultsString()
+//  Purpose:
+//		Returns a string with the timing and convergence statistics of
+//		each iteration of the combined results (see
+//		HMMViterbiResults::convergenceResultsString)
+//  Preconditions:
+//		viterbiTraining has been run
+string HMMViterbiTrainer::convergenceResultsString() {
+	stringstream ss;
+
+	for (HMMViterbiResults* results : viterbiResults)
+		ss << results->convergenceResultsString();
+
+	return ss.str();
+}
+
+// writeGenes(HMMGeneWriter& writer)
+//  Purpose:
+//		Streams the genes every sequence had in the last iteration to
+//		writer in sequence order
+//  Preconditions:
+//		viterbiTraining has been run
+void HMMViterbiTrainer::writeGenes(HMMGeneWriter& writer) {
+	for (unsigned int sequence = 0; sequence < sequenceResults.size(); sequence++) {
+		writer.beginSequence(sequenceNames[sequence], "");
+		writer.writeGenes(sequenceResults[sequence]);
+		writer.endSequence();
+	}
+}
+
+// releaseResults()
+//  Purpose:
+//		Releases the combined results of every iteration and the results
+//		of every sequence in one step.  The trained probabilities are
+//		kept, so training can go on from them (the iterations are numbered
+//		from 1 again).
+//  Postconditions:
+//		viterbiResults, sequenceResults - empty
+//		probabilities - moved into the trainer when they were the
+//						probabilities of released results
+void HMMViterbiTrainer::releaseResults() {
+	for (HMMViterbiResults* results : viterbiResults) {
+		if (probabilities == results->probabilities) {
+			*ownedProbabilities = std::move(*probabilities);
+			probabilities = ownedProbabilities;
+		}
+	}
+
+	viterbiResults.clear();
+	sequenceResults.clear();
+	resultsArena.release();
+	for (HiddenMarkovModel* model : models)
+		model->releaseResults();
+}
+
+// Public Accessors
+// =============================================
+int HMMViterbiTrainer::getNumSequences() {
+	return models.size();
+}
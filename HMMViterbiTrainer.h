@@ -0,0 +1,218 @@
+/*
+ * HMMViterbiTrainer.h
+ *
+ *	This is the header file for the HMMViterbiTrainer object.
+ *  HMMViterbiTrainer trains one set of probabilities with viterbi training
+ *  across a collection of sequences (e.g., every record of a multi-record
+ *  Fasta file or hundreds of genomes).
+ *
+ *  Each iteration decodes every sequence in parallel on a work stealing
+ *  thread pool (see HMMThreadPool) using the same probabilities.  The
+ *  counts along each sequence's viterbi path are then added together in
+ *  sequence order into one HMMViterbiResults object and the probabilities
+ *  for the next iteration are calculated from the combined counts.  The
+ *  counts are integers and are combined in a fixed order, so the results
+ *  are the same for any number of threads.  Training on a single sequence
+ *  gives the same results as HiddenMarkovModel::viterbiTraining.
+ *
+ *  Typical use would be:
+ *
+ *		HMMViterbiTrainer trainer(numThreads)
+ *		trainer.addSequence(fastaFile1)
+ *		trainer.addSequence(fastaFile2)
+ *		...
+ *		trainer.viterbiTraining(numIterations)
+ *		trainer.viterbiResultsString()
+ *
+ *  Important Attributes:
+ *		probabilities - the probabilities used for the next iteration
+ *		viterbiResults - the combined results from each iteration
+ *		sequenceResults - the results (genes and counts) of each sequence
+ *						  from the last iteration (owned by its model)
+ *
+ *  The combined results are allocated from an arena (see HMMArena) and
+ *  every model releases its sequence's results when the next iteration
+ *  decodes it, so no results are freed one at a time.  releaseResults()
+ *  releases all of them in one step between training runs.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMVITERBITRAINER_H
+#define HMMVITERBITRAINER_H
+#include "FastaFile.h"
+#include "HiddenMarkovModel.h"
+#include "HMMProbabilities.h"
+#include "HMMViterbiResults.h"
+#include "HMMThreadPool.h"
+#include "HMMArena.h"
+#include "HMMGeneWriter.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+class HMMViterbiTrainer
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMViterbiTrainer(int numberOfThreads);		// 0 uses one thread per core
+
+	// Destructor
+	// =============================================
+	~HMMViterbiTrainer();
+
+	// Public Attributes
+	// =============================================
+	HMMProbabilities* probabilities;
+	vector<HMMViterbiResults*> viterbiResults;
+	vector<HMMViterbiResults*> sequenceResults;
+
+	// Public Methods
+	// =============================================
+
+	// addSequence(FastaFile* aFastaFile)
+	//  Purpose:
+	//		Adds the sequence of aFastaFile to the training set, named by the
+	//		first word of its header (see FastaFile::getSequenceName)
+	void addSequence(FastaFile* aFastaFile);
+
+	// addSequence(string name, const uint8_t* someCodons, int numberOfCodons)
+	//  Purpose:
+	//		Adds an already encoded sequence (e.g., from a GenomeCache) to the
+	//		training set
+	void addSequence(string name, const uint8_t* someCodons, int numberOfCodons);
+
+	// setViterbiCheckpointInterval(int interval)
+	//  Purpose:
+	//		Sets the viterbi checkpoint interval of every sequence's model (see
+	//		HiddenMarkovModel::setViterbiCheckpointInterval)
+	void setViterbiCheckpointInterval(int interval);
+
+	// setVectorizedViterbi(bool vectorized)
+	//  Purpose:
+	//		Selects the viterbi column calculation of every sequence's model (see
+	//		HiddenMarkovModel::setVectorizedViterbi)
+	void setVectorizedViterbi(bool vectorized);
+
+	// setViterbiPrecision(int precision)
+	//  Purpose:
+	//		Selects the viterbi precision of every sequence's model (see
+	//		HiddenMarkovModel::setViterbiPrecision)
+	void setViterbiPrecision(int precision);
+
+	// setTwoStrandViterbi(bool twoStrand)
+	//  Purpose:
+	//		Selects the decoding of every sequence's model (see
+	//		HiddenMarkovModel::setTwoStrandViterbi)
+	void setTwoStrandViterbi(bool twoStrand);
+
+	// setOrfPruning(bool prune, int minimumOrfLength)
+	//  Purpose:
+	//		Selects the ORF pruning of every sequence's model (see
+	//		HiddenMarkovModel::setOrfPruning)
+	void setOrfPruning(bool prune, int minimumOrfLength);
+
+	// viterbiTraining(int numIterations)
+	//  Purpose:
+	//		Perform viterbi training across all of the sequences for the
+	//		number of iterations specified.
+	//
+	//		Each iteration consists of the following steps
+	//			1. Decode every sequence in parallel and gather the counts
+	//			   along its viterbi path
+	//			2. Add the counts of all sequences together (in sequence order)
+	//			3. Calculate the probabilities for the next iteration from the
+	//			   combined counts
+	//
+	//  Postconditions:
+	//		viterbiResults - contains combined results from each iteration
+	//		sequenceResults - contains each sequence's results from the last
+	//						  iteration
+	//		probabilities - set to the probabilities calculated in the last
+	//						iteration
+	void viterbiTraining(int numIterations);
+
+	// int viterbiTraining(int maxIterations, long double probabilityThreshold, int pathChangeThreshold)
+	//  Purpose:
+	//		Perform viterbi training across all of the sequences until it
+	//		converges or maxIterations iterations have been run and return the
+	//		number of iterations run (see HiddenMarkovModel::viterbiTraining).
+	//		The path changes of the combined results are summed over the
+	//		sequences and elapsedSeconds is the wall clock time of the
+	//		iteration.
+	int viterbiTraining(int maxIterations, long double probabilityThreshold, int pathChangeThreshold);
+
+	// string viterbiResultsString()
+	//  Purpose:
+	//		Returns a string representing the results for each iteration in
+	//		the viterbi training followed by the genes of every sequence.
+	//
+	//		format:
+	//			<viterbiResultsIteration1.resultsWithoutGenes()>
+	//			...
+	//			<viterbiResultsIterationLast.resultsWithoutGenes()>
+	//			<result type="sequence" name="<<sequence name>>">
+	//				<<sequenceResults.geneResultsString()>>
+	//			</result>
+	//			...
+	//  Preconditions:
+	//		viterbiTraining has been run
+	string viterbiResultsString();
+
+	// string convergenceResultsString()
+	//  Purpose:
+	//		Returns a string with the timing and convergence statistics of
+	//		each iteration of the combined results (see
+	//		HMMViterbiResults::convergenceResultsString)
+	//  Preconditions:
+	//		viterbiTraining has been run
+	string convergenceResultsString();
+
+	// writeGenes(HMMGeneWriter& writer)
+	//  Purpose:
+	//		Streams the genes every sequence had in the last iteration to
+	//		writer in sequence order
+	//  Preconditions:
+	//		viterbiTraining has been run
+	void writeGenes(HMMGeneWriter& writer);
+
+	// releaseResults()
+	//  Purpose:
+	//		Releases the combined results of every iteration and the results
+	//		of every sequence in one step.  The trained probabilities are
+	//		kept, so training can go on from them (the iterations are numbered
+	//		from 1 again).
+	//  Postconditions:
+	//		viterbiResults, sequenceResults - empty
+	//		probabilities - moved into the trainer when they were the
+	//						probabilities of released results
+	void releaseResults();
+
+	// Public Accessors
+	// =============================================
+	int getNumSequences();
+
+private:
+
+	// Private Attributes
+	// =============================================
+	static const int numStates;
+	HMMThreadPool pool;
+	vector<HiddenMarkovModel*> models;
+	vector<string> sequenceNames;
+	int checkpointInterval;
+	int viterbiPrecision;
+	bool twoStrandViterbi;
+	bool orfPruning;
+	int orfMinimumLength;
+	HMMProbabilities* ownedProbabilities;	// initial (or kept) probabilities
+	HMMArena resultsArena;				// viterbiResults
+
+	HMMViterbiTrainer(const HMMViterbiTrainer&);
+	HMMViterbiTrainer& operator=(const HMMViterbiTrainer&);
+};
+
+#endif // HMMVITERBITRAINER_H
@@ -0,0 +1,240 @@
+/*
+ * HMMWindowDecoder.cpp
+ *
+ *	This is the cpp file for the HMMWindowDecoder object.
+ *  HMMWindowDecoder decodes one long sequence by splitting it into
+ *  overlapping windows that are decoded independently in parallel.
+ *
+ *  See HMMWindowDecoder.h for details.
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#include "HMMWindowDecoder.h"
+#include "HMMTrellis.h"
+#include <algorithm>
+#include <cmath>
+
+// Constuctors
+// ==============================================
+HMMWindowDecoder::HMMWindowDecoder(
+	const uint8_t* someCodons,
+	int numberOfCodons,
+	int aWindowLength,
+	int anOverlap,
+	int numberOfThreads)
+	: pool(numberOfThreads) {
+
+	codons = someCodons;
+	numCodons = numberOfCodons;
+	windowLength = max(aWindowLength, 2);
+	overlap = max(0, min(anOverlap, windowLength / 2));
+	numMergedWindows = 0;
+	checkpointInterval = 0;
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+}
+
+// Destructor
+// =============================================
+HMMWindowDecoder::~HMMWindowDecoder() {
+}
+
+// Public Class Methods
+// =============================================
+
+// HMMProbabilities* stationaryStartProbabilities(HMMProbabilities* someProbabilities)
+//  Purpose:
+//		Returns a new copy of someProbabilities whose initiation
+//		probabilities are the stationary distribution of its transition
+//		probabilities
+HMMProbabilities* HMMWindowDecoder::stationaryStartProbabilities(HMMProbabilities* someProbabilities) {
+	int numStates = someProbabilities->getNumStates();
+
+	// Power iteration from the uniform distribution.  The codon states
+	// form a cycle, so the lazy chain (stay put half the time) is iterated
+	// instead; it has the same stationary distribution but converges.
+	// The distribution only has to be close, the paths converge anyway.
+	vector<long double> transitions(numStates * numStates);
+	for (int beginState = 0; beginState < numStates; beginState++) {
+		for (int endState = 0; endState < numStates; endState++)
+			transitions[beginState * numStates + endState] = someProbabilities->transitionProbability(beginState, endState) / 2;
+	}
+
+	vector<long double> distribution(numStates, 1 / (long double) (numStates - 1));
+	vector<long double> nextDistribution(numStates);
+	distribution[0] = 0;
+	for (int iteration = 0; iteration < 10000; iteration++) {
+		for (int state = 0; state < numStates; state++)
+			nextDistribution[state] = distribution[state] / 2;
+		for (int beginState = 1; beginState < numStates; beginState++) {
+			for (int endState = 1; endState < numStates; endState++)
+				nextDistribution[endState] += distribution[beginState] * transitions[beginState * numStates + endState];
+		}
+
+		long double change = 0;
+		for (int state = 0; state < numStates; state++)
+			change = max(change, fabs(nextDistribution[state] - distribution[state]));
+		distribution.swap(nextDistribution);
+		if (change < 1e-12)
+			break;
+	}
+
+	HMMProbabilities* probs = new HMMProbabilities();
+	probs->copyFrom(someProbabilities);
+	for (int state = 0; state < numStates; state++)
+		probs->setInitiationProbability(state, distribution[state]);
+
+	return probs;
+}
+
+// Public Methods
+// =============================================
+
+// setCheckpointInterval(int interval)
+//  Purpose:
+//		Sets the viterbi checkpoint interval of every window (see
+//		HMMTrellis::setCheckpointInterval)
+void HMMWindowDecoder::setCheckpointInterval(int interval) {
+	checkpointInterval = interval;
+}
+
+// setVectorizedViterbi(bool vectorized)
+//  Purpose:
+//		Selects the viterbi column calculation of every window (see
+//		HMMTrellis::setVectorizedViterbi)
+void HMMWindowDecoder::setVectorizedViterbi(bool vectorized) {
+	viterbiPrecision = vectorized ? HMMViterbiKernel::doublePrecision : HMMViterbiKernel::longDoublePrecision;
+}
+
+// setViterbiPrecision(int precision)
+//  Purpose:
+//		Selects the viterbi precision of every window (see
+//		HMMTrellis::setViterbiPrecision)
+void HMMWindowDecoder::setViterbiPrecision(int precision) {
+	viterbiPrecision = precision;
+}
+
+// decode(HMMProbabilities* probabilities, vector<uint8_t>& path)
+//  Purpose:
+//		Decodes the windows in parallel with probabilities, stitches their
+//		paths and sets path[position - 1] to the state at every position.
+//		probabilities is only read.
+//  Postconditions:
+//		stitchPositions - set to the position every window was stitched at
+//		numMergedWindows - set to the number of windows merged
+void HMMWindowDecoder::decode(HMMProbabilities* probabilities, vector<uint8_t>& path) {
+	HMMProbabilities* startProbabilities = stationaryStartProbabilities(probabilities);
+	HMMTopology topology(probabilities, probabilities->getNumStates());
+
+	// Split the sequence into windows
+	vector<Window> windows;
+	for (int start = 1; start <= numCodons; start += windowLength) {
+		Window window;
+		window.start = start;
+		window.end = min(start + windowLength - 1, numCodons);
+		setDecodeRange(window);
+		windows.push_back(window);
+	}
+
+	numMergedWindows = 0;
+	stitchPositions.clear();
+	while (true) {
+		// Decode the windows that have not been decoded yet
+		vector<int> pending;
+		for (unsigned int i = 0; i < windows.size(); i++) {
+			if (windows[i].path.empty())
+				pending.push_back(i);
+		}
+		pool.run(pending.size(), [&](int task) {
+			Window& window = windows[pending[task]];
+			decodeWindow(window, (window.decodeStart == 1) ? probabilities : startProbabilities, &topology);
+		});
+
+		// Find the stitches, merging the windows whose paths do not meet
+		// (right to left so the indexes of the windows still to check stay
+		// the same)
+		vector<int> stitches(windows.size() > 0 ? windows.size() - 1 : 0);
+		bool merged = false;
+		for (int i = (int) windows.size() - 2; i >= 0; i--) {
+			stitches[i] = stitchPosition(windows[i], windows[i + 1]);
+			if (stitches[i] < 0) {
+				windows[i].end = windows[i + 1].end;
+				setDecodeRange(windows[i]);
+				windows[i].path.clear();
+				windows.erase(windows.begin() + i + 1);
+				numMergedWindows++;
+				merged = true;
+			}
+		}
+
+		if (!merged) {
+			stitchPositions = stitches;
+			break;
+		}
+	}
+
+	// Stitch the paths together
+	path.assign(numCodons, 0);
+	for (unsigned int i = 0; i < windows.size(); i++) {
+		int first = (i == 0) ? 1 : stitchPositions[i - 1] + 1;
+		int last = (i + 1 == windows.size()) ? numCodons : stitchPositions[i];
+		for (int position = first; position <= last; position++)
+			path[position - 1] = windows[i].path[position - windows[i].decodeStart];
+	}
+
+	delete startProbabilities;
+}
+
+// Private Methods
+// =============================================
+
+// decodeWindow(Window& window, HMMProbabilities* probabilities, HMMTopology* topology)
+//  Purpose:
+//		Calculates the viterbi weights of the positions of window and
+//		walks its path backward into window.path
+void HMMWindowDecoder::decodeWindow(Window& window, HMMProbabilities* probabilities, HMMTopology* topology) {
+	int numPositions = window.decodeEnd - window.decodeStart + 1;
+	HMMTrellis trellis(codons + window.decodeStart - 1, numPositions, topology->numStates);
+	trellis.setCheckpointInterval(checkpointInterval);
+	trellis.setViterbiPrecision(viterbiPrecision);
+	trellis.calculateHighestWeightPaths(probabilities, topology);
+
+	window.path.assign(numPositions, 0);
+	trellis.checkHighestWeightPath();
+	int position = numPositions;
+	int state = trellis.highestScoringState(position);
+	while (state != 0 && position > 0) {
+		window.path[position - 1] = state;
+		state = trellis.previousState(position, state);
+		position--;
+	}
+}
+
+// int stitchPosition(const Window& left, const Window& right)
+//  Purpose:
+//		Returns the position in the overlap of left and right closest to
+//		the end of left's core at which their paths are in the same state
+//		or -1 if there is none
+int HMMWindowDecoder::stitchPosition(const Window& left, const Window& right) {
+	for (int distance = 0; distance <= overlap; distance++) {
+		// Just before and just after the core boundary
+		int candidates[2] = { left.end - distance, right.start + distance };
+		for (int position : candidates) {
+			if (position >= right.decodeStart && position <= left.decodeEnd &&
+				position >= left.start && position < right.end &&
+				left.path[position - left.decodeStart] == right.path[position - right.decodeStart])
+				return position;
+		}
+	}
+
+	return -1;
+}
+
+// setDecodeRange(Window& window)
+//  Purpose:
+//		Sets the positions window is decoded over from its core
+void HMMWindowDecoder::setDecodeRange(Window& window) {
+	window.decodeStart = max(1, window.start - overlap);
+	window.decodeEnd = min(numCodons, window.end + overlap);
+}
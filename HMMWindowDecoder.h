@@ -0,0 +1,154 @@
+/*
+ * HMMWindowDecoder.h
+ *
+ *	This is the header file for the HMMWindowDecoder object.
+ *  HMMWindowDecoder decodes one long sequence with the 12 state gene model
+ *  by splitting it into overlapping windows that are decoded independently
+ *  on a thread pool (see HMMThreadPool), so a single chromosome can use
+ *  every core.
+ *
+ *  The sequence is split into core windows of windowLength positions and
+ *  every window is decoded overlap positions past both ends of its core.
+ *  The first window starts from the model's initiation probabilities, the
+ *  others from the stationary distribution of the transition
+ *  probabilities (the model could be in any state where they start).
+ *
+ *  Viterbi paths started from different places converge: once two paths
+ *  are in the same state at the same position they stay together until
+ *  one of them is affected by its window's end.  Adjacent windows are
+ *  stitched at the position in their overlap closest to the core boundary
+ *  at which their paths are in the same state (the left window's path is
+ *  used up to and including that position, the right window's after it),
+ *  so the stitched path is always a legal path.  When the paths do not
+ *  meet anywhere in the overlap the two windows are merged into one and
+ *  decoded again, so the results never depend on an unconverged stitch.
+ *  With an overlap much longer than a gene the path is the same as the
+ *  serial viterbi path except (rarely) near a stitch; see
+ *  HiddenMarkovModel::crossCheckWindowedViterbi.
+ *
+ *  Typical use would be:
+ *
+ *		HMMWindowDecoder decoder(codons, numCodons, windowLength, overlap, numThreads)
+ *		decoder.decode(probabilities, path)
+ *
+ *  Created on: 10-14-26
+ *      Author: tomkolar
+ */
+
+#ifndef HMMWINDOWDECODER_H
+#define HMMWINDOWDECODER_H
+#include "HMMProbabilities.h"
+#include "HMMTopology.h"
+#include "HMMThreadPool.h"
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+class HMMWindowDecoder
+{
+public:
+	// Constuctors
+	// ==============================================
+	HMMWindowDecoder(
+		const uint8_t* someCodons,
+		int numberOfCodons,
+		int aWindowLength,
+		int anOverlap,					// at most half of aWindowLength
+		int numberOfThreads);			// 0 uses one thread per core
+
+	// Destructor
+	// =============================================
+	~HMMWindowDecoder();
+
+	// Public Class Methods
+	// =============================================
+
+	// HMMProbabilities* stationaryStartProbabilities(HMMProbabilities* someProbabilities)
+	//  Purpose:
+	//		Returns a new copy of someProbabilities whose initiation
+	//		probabilities are the stationary distribution of its transition
+	//		probabilities
+	static HMMProbabilities* stationaryStartProbabilities(HMMProbabilities* someProbabilities);
+
+	// Public Attributes
+	// =============================================
+	int windowLength;
+	int overlap;
+	vector<int> stitchPositions;	// last position taken from each window but the last
+	int numMergedWindows;			// windows merged by the last decode (paths did not meet)
+
+	// Public Methods
+	// =============================================
+
+	// setCheckpointInterval(int interval)
+	//  Purpose:
+	//		Sets the viterbi checkpoint interval of every window (see
+	//		HMMTrellis::setCheckpointInterval)
+	void setCheckpointInterval(int interval);
+
+	// setVectorizedViterbi(bool vectorized)
+	//  Purpose:
+	//		Selects the viterbi column calculation of every window (see
+	//		HMMTrellis::setVectorizedViterbi)
+	void setVectorizedViterbi(bool vectorized);
+
+	// setViterbiPrecision(int precision)
+	//  Purpose:
+	//		Selects the viterbi precision of every window (see
+	//		HMMTrellis::setViterbiPrecision)
+	void setViterbiPrecision(int precision);
+
+	// decode(HMMProbabilities* probabilities, vector<uint8_t>& path)
+	//  Purpose:
+	//		Decodes the windows in parallel with probabilities, stitches their
+	//		paths and sets path[position - 1] to the state at every position.
+	//		probabilities is only read.
+	//  Postconditions:
+	//		stitchPositions - set to the position every window was stitched at
+	//		numMergedWindows - set to the number of windows merged
+	void decode(HMMProbabilities* probabilities, vector<uint8_t>& path);
+
+private:
+
+	// Private Attributes
+	// =============================================
+	struct Window {
+		int start;				// core of the window
+		int end;
+		int decodeStart;		// core plus the overlap
+		int decodeEnd;
+		vector<uint8_t> path;	// path[position - decodeStart] (empty until decoded)
+	};
+
+	const uint8_t* codons;
+	int numCodons;
+	HMMThreadPool pool;
+	int checkpointInterval;
+	int viterbiPrecision;
+
+	// Private Methods
+	// =============================================
+
+	// decodeWindow(Window& window, HMMProbabilities* probabilities, HMMTopology* topology)
+	//  Purpose:
+	//		Calculates the viterbi weights of the positions of window and
+	//		walks its path backward into window.path
+	void decodeWindow(Window& window, HMMProbabilities* probabilities, HMMTopology* topology);
+
+	// int stitchPosition(const Window& left, const Window& right)
+	//  Purpose:
+	//		Returns the position in the overlap of left and right closest to
+	//		the end of left's core at which their paths are in the same state
+	//		or -1 if there is none
+	int stitchPosition(const Window& left, const Window& right);
+
+	// setDecodeRange(Window& window)
+	//  Purpose:
+	//		Sets the positions window is decoded over from its core
+	void setDecodeRange(Window& window);
+
+	HMMWindowDecoder(const HMMWindowDecoder&);
+	HMMWindowDecoder& operator=(const HMMWindowDecoder&);
+};
+
+#endif // HMMWINDOWDECODER_H
@@ -3,32 +3,31 @@
  *
  *	This is the cpp file for the HiddenMarkovModel object. 
  *  HiddenMarkovModel is the main object representing a hidden
- *  markov model.  At the moment it is hard coded to support
- *  two states.  However, it can easily be modified to support
- *  more states (see details at bottom of this header comment).
+ *  markov model.  It decodes the 12 state gene model described by
+ *  HMMGeneTopology, but the tables it works on are sized at runtime so
+ *  other models are supported as well (see details at bottom of this
+ *  header comment).
  *
- *	The model attribute holds the generated hidden markov model.
- *  Essentially the model is a vector of HMMPosition objects. A
- *  HMMPosition object is basically a collection of HMMNodes (one for
- *  each state in the HMM).  The nodes know there position, state,
- *  and residue and contain collections of HHMTransitions that come
- *  in to the node and out from the node. Emission probabilites can be 
- *  determined from the state/residue information.  Transition probabilites
- *  are determined by the start/stop node states for an HMMTransition
- *  object.
+ *	The trellis attribute holds the generated hidden markov model.
+ *  Essentially the trellis is a set of flat arrays indexed by position
+ *  and state (see HMMTrellis).  Each position corresponds to a
+ *  trinucleotide of the sequence and holds the viterbi weight, the
+ *  previous state on the viterbi path, and the forward/backward
+ *  probabilities for every state.  Transitions are not stored, the
+ *  transition and emission probabilites are looked up from the
+ *  probabilities attribute when the trellis is calculated.
  *
  *	The probabilitites attribute holds the inititation, emission and
  *  transition probabilties that are used when finding a path through
- *  the model.  HMMNodes will access the probabilites to determine their
- *  emission probabilities.  HMMTransitions will access the probabilties
- *  to determine their initiation/transition probabilties.
+ *  the model.
  *
  *  Viterbi training is currently the only implmented method for creating
  *  a path.  Typical use would be:
  *
  *		HiddenMarkovModel(aFastaFile)
  *			- instantate the object with the fasta file to build the
- *			  model from
+ *			  model from (or HiddenMarkovModel(codons, numCodons) with an
+ *			  already encoded sequence such as one from a GenomeCache)
  *
  *		viterbiTraining(numIterations)
  *			- run viterbi training to generate the model and then train
@@ -48,49 +47,84 @@
  *			- returns a string of the state for every position in the 
  *			  viterbi path
  *
+ *  Two strand decoding:
+ *	  setTwoStrandViterbi(true) decodes the forward and reverse complement
+ *    sequences at the same time with the smaller single strand model and
+ *    reconciles the genes of the two strands instead of decoding the
+ *    forward sequence with the 12 state model (see HMMStrandDecoder).  The
+ *    results are gathered from the reconciled path in the same form, but
+ *    the path is not the viterbi path of the 12 state model and
+ *    allScoresResultsString is not available.
+ *
+ *  Windowed decoding:
+ *	  setWindowedViterbi(windowLength, overlap, numThreads) decodes one long
+ *    sequence as overlapping windows in parallel and stitches their paths
+ *    where they meet inside the overlaps (see HMMWindowDecoder).
+ *    crossCheckWindowedViterbi reports the window boundaries at which the
+ *    gene calls differ from the serial decode.  Two strand decoding takes
+ *    precedence when both are set.
+ *
  *  Reconfiguration for more states:
- *	  The ultimate fix would be to take in the number of states
- *    as a parameter.  There is already a numStates variable that
- *    exists and is hardcoded to 2, but this could be set to the
- *    passed in parameter.  The main issue is with the HMMProbabilites
- *    object as it contains several arrays that have sizes the same
- *    size as the number of states.  These would need to be initialized
- *    to have the correct size, or perhaps changed to vectors (as it
- *    is easier to initialize vectors to a particular size).
+ *	  HMMProbabilities, HMMTopology and HMMTrellis are sized at runtime,
+ *    so a model with a different number of states only needs its own
+ *    probabilities.  numStates is taken from HMMGeneTopology, the
+ *    constexpr description of the 12 state gene model.  The trellis uses
+ *    kernels unrolled at compile time for that topology (see
+ *    HMMUnrolledKernel) and the generic loops over the topology for any
+ *    other model.
  *
  *  Created on: 2-13-13
  *      Author: tomkolar
  */
 
 #include "HiddenMarkovModel.h"
-#include "HMMTransition.h"
 #include "HMMProbabilities.h"
+#include "HMMGeneTopology.h"
 #include "MathUtilities.h"
+#include "HMMInstrumentation.h"
 #include <sstream>
 #include <cmath>
 #include <cfloat>
 #include <iostream>
 #include <limits>
 #include <stdexcept> 
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <utility>
 
 // const variable initialization
 // ==============================================
-const int HiddenMarkovModel::numStates = 12;
+const int HiddenMarkovModel::numStates = HMMGeneTopology::numStates;
 
 // Constuctors
 // ==============================================
 HiddenMarkovModel::HiddenMarkovModel() {
+	initialize();
 }
 
 HiddenMarkovModel::HiddenMarkovModel(FastaFile* aFastaFile) {
+	initialize();
 	fastaFile = aFastaFile;
-	modelBuilt = false;
-	probabilities = HMMProbabilities::initialProbabilities();
+	ownedProbabilities = HMMProbabilities::initialProbabilities();
+	probabilities = ownedProbabilities;
+}
+
+HiddenMarkovModel::HiddenMarkovModel(const uint8_t* someCodons, int numberOfCodons) {
+	initialize();
+	sequenceCodons = someCodons;
+	numCodons = numberOfCodons;
+	ownedProbabilities = HMMProbabilities::initialProbabilities();
+	probabilities = ownedProbabilities;
 }
 
 // Destructor
 // =============================================
 HiddenMarkovModel::~HiddenMarkovModel() {
+	delete strandDecoder;
+	delete windowDecoder;
+	delete ownedProbabilities;
 }
 
 // Public Methods
@@ -114,19 +148,51 @@ HiddenMarkovModel::~HiddenMarkovModel() {
 //						reflect calculated probabilities from the viterbi
 //						results
 void HiddenMarkovModel::viterbiTraining(int numIterations) {
+	viterbiTraining(numIterations, -1, -1);
+}
+
+// int viterbiTraining(int maxIterations, long double probabilityThreshold, int pathChangeThreshold)
+//  Purpose: 
+//		Perform viterbi training until it converges or maxIterations
+//		iterations have been run and return the number of iterations run.
+//		Training has converged when no probability changed by more than
+//		probabilityThreshold or at most pathChangeThreshold positions of
+//		the viterbi path changed since the last iteration (see
+//		HMMViterbiResults::hasConverged, a negative threshold is not
+//		checked).  With a pathChangeThreshold of 0 training stops at the
+//		fixed point, so the results are the same as running all of the
+//		iterations.
+//
+//  Postconditions:
+//		viterbiResults - contains results (including the timing and
+//						 convergence statistics) from each iteration run
+//		probabilities - set to the probabilities of the last iteration
+int HiddenMarkovModel::viterbiTraining(int maxIterations, long double probabilityThreshold, int pathChangeThreshold) {
+	int iterationsRun = 0;
+
+	for (int iteration = 1; iteration <= maxIterations; iteration++) {
+		chrono::steady_clock::time_point iterationStart = chrono::steady_clock::now();
 
-	for (int iteration = 1; iteration <= numIterations; iteration++) {
 		// Build the model and calculate the weights
-		buildAndCalculateModel(false);
+		buildViterbiDecoder();
 
 		// Gather the viterbi reuslts
-		HMMViterbiResults* aViterbiResults = gatherViterbiResults(iteration);
+		HMMViterbiResults* aViterbiResults = resultsArena.create<HMMViterbiResults>(iteration, numStates);
+		gatherViterbiResults(aViterbiResults);
+		aViterbiResults->elapsedSeconds =
+			chrono::duration<double>(chrono::steady_clock::now() - iterationStart).count();
 		viterbiResults.push_back(aViterbiResults);
+		iterationsRun++;
 
 		// Reset the probabilities to the viterbi calculated ones for the next
 		// iteration
 		probabilities = aViterbiResults->probabilities;
+
+		if (aViterbiResults->hasConverged(probabilityThreshold, pathChangeThreshold))
+			break;
 	}
+
+	return iterationsRun;
 }
 
 // baumWelchTraining()
@@ -142,18 +208,16 @@ void HiddenMarkovModel::baumWelchTraining() {
 	int iterationCounter = 0;
 	double previousLogLikelihood = 0;
 	while (!trainingDone) {
-		// Build the model and calculate the forward/backward probabilites
-		buildAndCalculateModel(true);
-		calculateLogBackwardProbabilities();
-		calculateLogConditionalProbabilities();
+		// Build the model and gather the expected counts
+		HMMExpectedCounts* counts = baumWelchExpectation(probabilities);
 
-		// Calculate the new transition/emission probabilties
-		calculateBaumWelchEmissionProbabilities();
-		calculateBaumWelchInitiationProbabilities();
-		calculateBaumWelchTransitionProbabilities();
+		// Calculate the new initiation/transition probabilties (emission
+		// probabilities are held steady)
+		counts->updateProbabilities(probabilities, false);
 
 		// Calcualte likelihood and check if done
-		double currentLogLikelihood = model.back()->logLikelihood();
+		double currentLogLikelihood = counts->logLikelihood;
+		delete counts;
 		if (abs(previousLogLikelihood - currentLogLikelihood) < 0.1)
 			trainingDone = true;
 
@@ -169,6 +233,399 @@ void HiddenMarkovModel::baumWelchTraining() {
 	cout << baumWelchResultsString(iterationCounter, previousLogLikelihood);
 }
 
+// HMMExpectedCounts* baumWelchExpectation(HMMProbabilities* someProbabilities)
+//  Purpose: 
+//		The expectation step of Baum-Welch training.  Calculates the forward
+//		and backward probabilities of the sequence with someProbabilities
+//		and returns the expected counts (see HMMExpectedCounts).
+//		someProbabilities is only read, so one probabilities object can be
+//		shared by models running on different threads.  The forward and
+//		backward probabilities are released once the counts are gathered.
+//
+//  Postconditions:
+//		probabilities - set to someProbabilities
+HMMExpectedCounts* HiddenMarkovModel::baumWelchExpectation(HMMProbabilities* someProbabilities) {
+	probabilities = someProbabilities;
+
+	buildAndCalculateModel(true);
+
+	HMMExpectedCounts* counts = new HMMExpectedCounts(numStates);
+	if (scaledForwardBackward) {
+		trellis.calculateScaledBackwardProbabilities(probabilities, &topology);
+		trellis.accumulateScaledExpectedCounts(probabilities, &topology, *counts);
+	}
+	else {
+		trellis.calculateLogBackwardProbabilities(probabilities, &topology);
+		trellis.accumulateExpectedCounts(probabilities, &topology, *counts);
+	}
+	trellis.releaseForwardBackwardProbabilities();
+	addCollapsedRunCounts(counts);
+
+	return counts;
+}
+
+// setScaledForwardBackward(bool scaled)
+//  Purpose: 
+//		Selects the numeric backend of the forward-backward calculations.
+//		false (the default) uses log space long double arithmetic, true
+//		uses scaled double arithmetic (see HMMTrellis).
+void HiddenMarkovModel::setScaledForwardBackward(bool scaled) {
+	scaledForwardBackward = scaled;
+}
+
+// double crossCheckForwardBackward()
+//  Purpose: 
+//		Runs the expectation step with both forward-backward backends using
+//		the current probabilities and returns the largest relative
+//		difference between their expected counts and log likelihoods (see
+//		HMMExpectedCounts::maximumRelativeDifference).
+double HiddenMarkovModel::crossCheckForwardBackward() {
+	bool scaled = scaledForwardBackward;
+
+	scaledForwardBackward = false;
+	HMMExpectedCounts* logSpaceCounts = baumWelchExpectation(probabilities);
+	scaledForwardBackward = true;
+	HMMExpectedCounts* scaledCounts = baumWelchExpectation(probabilities);
+	scaledForwardBackward = scaled;
+
+	double difference = logSpaceCounts->maximumRelativeDifference(scaledCounts);
+
+	delete logSpaceCounts;
+	delete scaledCounts;
+	return difference;
+}
+
+// HMMPosteriorResults* posteriorDecoding(bool posteriorGenes)
+//  Purpose:
+//		Decodes the sequence with the current probabilities and returns the
+//		genes together with their posterior confidence (see
+//		HMMPosteriorResults).  One forward and one backward pass are made
+//		(log space or scaled, see setScaledForwardBackward) and only the
+//		forward probabilities are stored.  posteriorGenes false calls the
+//		genes of the viterbi path (decoded first, as set up for viterbi
+//		training), true calls the posterior-max genes without decoding the
+//		viterbi path.  The caller owns the returned results.
+HMMPosteriorResults* HiddenMarkovModel::posteriorDecoding(bool posteriorGenes) {
+	HMMPosteriorResults* results = new HMMPosteriorResults(numStates, posteriorGenes);
+
+	// The viterbi genes whose confidence is calculated
+	if (!posteriorGenes) {
+		HMMViterbiResults* viterbiResults = viterbiIteration(probabilities, 0);
+		for (HMMViterbiResults::Gene* gene : viterbiResults->genes) {
+			results->addGene(
+				positionMap.collapsedPosition(gene->start),
+				positionMap.collapsedPosition(gene->end - 2) + 2,
+				gene->isTopStrand);
+		}
+		iterationArena.release();
+	}
+
+	buildAndCalculateModel(true);
+	if (scaledForwardBackward)
+		trellis.accumulateScaledPosteriorGenes(probabilities, &topology, *results);
+	else
+		trellis.accumulatePosteriorGenes(probabilities, &topology, *results);
+	trellis.releaseForwardBackwardProbabilities();
+
+	// The genes never hold a collapsed run (see HMMPositionMap)
+	for (HMMPosteriorResults::Gene& gene : results->genes) {
+		gene.start = positionMap.sequencePosition(gene.start);
+		gene.end = positionMap.sequencePosition(gene.end - 2) + 2;
+	}
+	results->logLikelihood += collapsedRunLogLikelihood();
+
+	return results;
+}
+
+// HMMViterbiResults* viterbiIteration(HMMProbabilities* someProbabilities, int iteration)
+//  Purpose: 
+//		Decodes the sequence with someProbabilities and returns the counts
+//		gathered along the viterbi path.  Unlike viterbiTraining the
+//		probabilities of the results are not calculated, so the counts of
+//		several models can be added together first (see HMMViterbiTrainer).
+//		someProbabilities is only read, so one probabilities object can be
+//		shared by models decoding on different threads.  The viterbi
+//		columns are released once the results have been gathered.  The
+//		results are owned by the model and stay valid until the next call
+//		(or releaseResults), which releases them in one step.  A
+//		runtime_error is thrown if someProbabilities can not generate the
+//		sequence.
+//
+//  Postconditions:
+//		probabilities - set to someProbabilities
+HMMViterbiResults* HiddenMarkovModel::viterbiIteration(HMMProbabilities* someProbabilities, int iteration) {
+	probabilities = someProbabilities;
+	chrono::steady_clock::time_point iterationStart = chrono::steady_clock::now();
+
+	iterationArena.release();
+	buildViterbiDecoder();
+	HMMViterbiResults* results = iterationArena.create<HMMViterbiResults>(iteration, numStates);
+	gatherViterbiCounts(results);
+	trellis.releaseHighestWeightPaths();
+	results->elapsedSeconds =
+		chrono::duration<double>(chrono::steady_clock::now() - iterationStart).count();
+
+	return results;
+}
+
+// setViterbiCheckpointInterval(int interval)
+//  Purpose:
+//		Keep only every interval'th viterbi column and recalculate the
+//		positions between them while the path is walked (see HMMTrellis).
+//		0 (the default) keeps the full trellis and
+//		HMMTrellis::automaticCheckpointInterval uses sqrt(sequence length).
+//		The results are the same in either mode.
+void HiddenMarkovModel::setViterbiCheckpointInterval(int interval) {
+	viterbiCheckpointInterval = interval;
+}
+
+// setVectorizedViterbi(bool vectorized)
+//  Purpose:
+//		Selects the viterbi column calculation.  false (the default) uses
+//		the long double reference, true uses the vectorized double
+//		precision HMMViterbiKernel (see HMMTrellis).
+void HiddenMarkovModel::setVectorizedViterbi(bool vectorized) {
+	viterbiPrecision = vectorized ? HMMViterbiKernel::doublePrecision : HMMViterbiKernel::longDoublePrecision;
+}
+
+// int crossCheckVectorizedViterbi()
+//  Purpose:
+//		Decodes the sequence with both viterbi column calculations using
+//		the current probabilities and returns the number of positions at
+//		which their viterbi paths differ.
+int HiddenMarkovModel::crossCheckVectorizedViterbi() {
+	int precision = viterbiPrecision;
+	vector<uint8_t> referencePath;
+	vector<uint8_t> vectorizedPath;
+
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+	buildAndCalculateModel(false);
+	viterbiPath(referencePath);
+
+	viterbiPrecision = HMMViterbiKernel::doublePrecision;
+	buildAndCalculateModel(false);
+	viterbiPath(vectorizedPath);
+
+	viterbiPrecision = precision;
+	trellis.releaseHighestWeightPaths();
+
+	int differences = 0;
+	for (unsigned int i = 0; i < referencePath.size(); i++) {
+		if (referencePath[i] != vectorizedPath[i])
+			differences++;
+	}
+
+	return differences;
+}
+
+// setViterbiPrecision(int precision)
+//  Purpose:
+//		Selects the precision of the viterbi column calculation:
+//		HMMViterbiKernel::longDoublePrecision (the reference, the
+//		default), doublePrecision (the same as setVectorizedViterbi(true))
+//		or floatPrecision (see HMMViterbiKernel).
+void HiddenMarkovModel::setViterbiPrecision(int precision) {
+	viterbiPrecision = precision;
+}
+
+// string crossCheckViterbiPrecision(int precision)
+//  Purpose:
+//		Decodes the sequence with the long double reference and with
+//		precision using the current probabilities and returns the genes
+//		called by only one of the two decodes.
+//
+//		format:
+//			<result type="precision_check" precision="<<precision name>>" genes="<<reference genes>>" differences="<<differences>>">
+//				(<<start>>,<<end>>,<<strand>>,<<long|precision name>>),...
+//			</result>
+string HiddenMarkovModel::crossCheckViterbiPrecision(int precision) {
+	int savedPrecision = viterbiPrecision;
+	vector<uint8_t> paths[2];
+
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+	buildAndCalculateModel(false);
+	viterbiPath(paths[0]);
+
+	viterbiPrecision = precision;
+	buildAndCalculateModel(false);
+	viterbiPath(paths[1]);
+
+	viterbiPrecision = savedPrecision;
+	trellis.releaseHighestWeightPaths();
+
+	// Genes of each decode as (start, end, isTopStrand) in increasing order
+	vector<tuple<int, int, bool>> genes[2];
+	for (int decode = 0; decode < 2; decode++) {
+		HMMViterbiResults results(0, numStates);
+		gatherPathCounts(&results, paths[decode]);
+		for (HMMViterbiResults::Gene* gene : results.genes)
+			genes[decode].push_back(make_tuple(gene->start, gene->end, gene->isTopStrand));
+		sort(genes[decode].begin(), genes[decode].end());
+	}
+
+	string decodeNames[2] = {
+		HMMViterbiKernel::precisionName(HMMViterbiKernel::longDoublePrecision),
+		HMMViterbiKernel::precisionName(precision)
+	};
+
+	stringstream differences;
+	int numDifferences = 0;
+	for (int decode = 0; decode < 2; decode++) {
+		vector<tuple<int, int, bool>> onlyInDecode;
+		set_difference(
+			genes[decode].begin(), genes[decode].end(),
+			genes[1 - decode].begin(), genes[1 - decode].end(),
+			back_inserter(onlyInDecode));
+
+		for (tuple<int, int, bool>& gene : onlyInDecode) {
+			differences
+				<< "(" << get<0>(gene) << "," << get<1>(gene) << ","
+				<< (get<2>(gene) ? "top" : "bottom") << ","
+				<< decodeNames[decode] << "),";
+			numDifferences++;
+		}
+	}
+
+	stringstream ss;
+	ss << "    <result type=\"precision_check\" precision=\"" << decodeNames[1]
+		<< "\" genes=\"" << genes[0].size()
+		<< "\" differences=\"" << numDifferences << "\">\n";
+	if (numDifferences > 0)
+		ss << "      " << differences.str() << "\n";
+	ss << "    </result>\n";
+
+	return ss.str();
+}
+
+// setTwoStrandViterbi(bool twoStrand)
+//  Purpose:
+//		Selects the viterbi decoding.  false (the default) decodes the
+//		forward sequence with the 12 state gene model, true decodes both
+//		strands separately on two threads with the single strand model
+//		and reconciles their genes (see HMMStrandDecoder).
+void HiddenMarkovModel::setTwoStrandViterbi(bool twoStrand) {
+	twoStrandViterbi = twoStrand;
+}
+
+// setWindowedViterbi(int windowLength, int overlap, int numberOfThreads)
+//  Purpose:
+//		Decode the sequence as windows of windowLength positions, each
+//		extended by overlap positions on both sides, on numberOfThreads
+//		threads (0 uses one thread per core) and stitch their paths (see
+//		HMMWindowDecoder).  A windowLength of 0 (the default) decodes the
+//		whole sequence at once.
+void HiddenMarkovModel::setWindowedViterbi(int windowLength, int overlap, int numberOfThreads) {
+	viterbiWindowLength = windowLength;
+	viterbiWindowOverlap = overlap;
+	viterbiWindowThreads = numberOfThreads;
+
+	// The decoder is rebuilt with the new windows when it is next used
+	delete windowDecoder;
+	windowDecoder = NULL;
+}
+
+// vector<int> crossCheckWindowedViterbi()
+//  Purpose:
+//		Decodes the sequence both serially and in windows using the
+//		current probabilities and returns the stitch positions of the
+//		window boundaries near which (within the overlap) the two decodes
+//		call different genes.
+//  Preconditions:
+//		setWindowedViterbi has been called with a windowLength above 0
+vector<int> HiddenMarkovModel::crossCheckWindowedViterbi() {
+	vector<int> disagreeingBoundaries;
+	vector<uint8_t> serialPath;
+	vector<uint8_t> windowedPath;
+
+	buildAndCalculateModel(false);
+	viterbiPath(serialPath);
+	trellis.releaseHighestWeightPaths();
+
+	buildWindowDecoder();
+	windowDecoder->decode(probabilities, windowedPath);
+
+	HMMViterbiResults serialResults(0, numStates);
+	HMMViterbiResults windowedResults(0, numStates);
+	gatherPathCounts(&serialResults, serialPath);
+	gatherPathCounts(&windowedResults, windowedPath);
+
+	int overlap = windowDecoder->overlap;
+	for (int boundary : windowDecoder->stitchPositions) {
+		if (!serialResults.sameGenes(
+				&windowedResults,
+				positionMap.sequencePosition(boundary - overlap),
+				positionMap.sequencePosition(boundary + overlap)))
+			disagreeingBoundaries.push_back(positionMap.sequencePosition(boundary));
+	}
+
+	return disagreeingBoundaries;
+}
+
+// setMinimumCollapsedRun(int minimumRunLength)
+//  Purpose:
+//		Collapse every run of at least minimumRunLength unknown codons (N
+//		runs and other ambiguity codes) into a single position that stays
+//		in the intergenic state, so the trellis is never expanded across
+//		the gap (see HMMPositionMap).  Positions, genes and paths are
+//		still reported in sequence positions.  0 keeps every position.
+//		The default is HMMPositionMap::defaultMinimumRunLength.  Takes
+//		effect when the sequence is first decoded.
+void HiddenMarkovModel::setMinimumCollapsedRun(int minimumRunLength) {
+	minimumCollapsedRun = minimumRunLength;
+}
+
+// setOrfPruning(bool prune, int minimumOrfLength)
+//  Purpose:
+//		Selects whether viterbi and forward-backward skip the coding states
+//		of the positions outside of every open reading frame (see
+//		HMMOrfIndex, rebuilt from the probabilities every time the model is
+//		calculated).  With a minimumOrfLength of 0 only unreachable states
+//		are skipped and the results are the same; a minimumOrfLength above
+//		0 (in bases) rules out the reading frames shorter than it as well.
+//		The default is exact pruning (true, 0).  Models other than the 12
+//		state gene model are never pruned.
+void HiddenMarkovModel::setOrfPruning(bool prune, int minimumOrfLength) {
+	orfPruning = prune;
+	orfMinimumLength = minimumOrfLength;
+}
+
+// setKeepViterbiPath(bool keep)
+//  Purpose:
+//		Selects whether the path of every viterbi iteration is kept.  true
+//		(the default) keeps one state per position, which is needed for
+//		the path changes of the results and pathStatesResultsString
+//		after two strand or windowed decoding.  false gathers the results
+//		straight from the traceback without storing the path, so a single
+//		decode (e.g., HMMAnnotationServer) allocates nothing per position
+//		besides the trellis.
+void HiddenMarkovModel::setKeepViterbiPath(bool keep) {
+	keepViterbiPath = keep;
+	if (!keep)
+		vector<uint8_t>().swap(lastViterbiPath);
+}
+
+// releaseResults()
+//  Purpose:
+//		Releases the results of every viterbi training iteration and the
+//		last viterbiIteration in one step (see HMMArena).  The trained
+//		probabilities are kept, so training can go on from them.
+//  Postconditions:
+//		viterbiResults - empty
+//		probabilities - moved into the model when they were the
+//						probabilities of released results
+void HiddenMarkovModel::releaseResults() {
+	for (HMMViterbiResults* results : viterbiResults) {
+		if (probabilities == results->probabilities) {
+			*ownedProbabilities = std::move(*probabilities);
+			probabilities = ownedProbabilities;
+		}
+	}
+
+	viterbiResults.clear();
+	resultsArena.release();
+	iterationArena.release();
+}
+
 string HiddenMarkovModel::baumWelchResultsString(int iterations, double logLikelihood) {
 	stringstream ss;
 
@@ -206,18 +663,25 @@ string HiddenMarkovModel::baumWelchResultsString(int iterations, double logLikel
 //			  Node: (<node1State>,<node1Weight>)
 //			  Node: (<node2State>,<node2Weight>)
 //			  ...
+//
+//		A collapsed run of unknown codons is listed once, at the first
+//		sequence position of the run (see setMinimumCollapsedRun).
 //  Preconditions:
-//		viterbiTraining has been run
+//		viterbiTraining has been run (without two strand decoding)
 string HiddenMarkovModel::allScoresResultsString() {
 	stringstream ss;
 
-	for (HMMPosition* aPosition : model) {
-		ss << "Position: " << aPosition->id << "\n";
-		for (HMMNode* node : aPosition->nodes) {
+	for (int position = 0; position <= trellis.numPositions; position++) {
+		ss << "Position: " << positionMap.sequencePosition(position) << "\n";
+
+		// The start position only has the start state
+		int firstState = (position == 0) ? 0 : 1;
+		int lastState = (position == 0) ? 0 : numStates - 1;
+		for (int state = firstState; state <= lastState; state++) {
 			ss << "  Node: ("
-			   <<  node->state
+			   <<  state
 			   << ", "
-			   << node->highestWeight
+			   << trellis.highestWeight(position, state)
 			   << ")\n";
 		}
 	}
@@ -225,10 +689,42 @@ string HiddenMarkovModel::allScoresResultsString() {
 	return ss.str();
 }
 
+// writeScores(HMMGeneWriter& writer)
+//  Purpose:
+//		Streams the score (weight) of each state in each position of the
+//		viterbi path to writer (see allScoresResultsString) without
+//		building the output in memory
+//  Preconditions:
+//		viterbiTraining has been run (without two strand or windowed
+//		decoding)
+void HiddenMarkovModel::writeScores(HMMGeneWriter& writer) {
+	vector<double> weights(numStates);
+
+	for (int position = 0; position <= trellis.numPositions; position++) {
+		int lastState = (position == 0) ? 0 : numStates - 1;
+		for (int state = 0; state <= lastState; state++)
+			weights[state] = trellis.highestWeight(position, state);
+		writer.writeScores(positionMap.sequencePosition(position), &weights[0], numStates);
+	}
+}
+
+// writeGenes(HMMGeneWriter& writer, const string& sequenceName)
+//  Purpose:
+//		Streams the genes of the last viterbi training iteration to writer
+//		as the records of sequenceName
+//  Preconditions:
+//		viterbiTraining has been run
+void HiddenMarkovModel::writeGenes(HMMGeneWriter& writer, const string& sequenceName) {
+	writer.beginSequence(sequenceName, "");
+	writer.writeGenes(viterbiResults.back());
+	writer.endSequence();
+}
+
 // string pathStatesResultsString()
 //  Purpose:
 //		Returns a string representing the state for each position in the
-//		viterbi path.
+//		viterbi path.  Every state is written as its decimal number (10
+//		and 11 as "10" and "11") in every decoding mode.
 //
 //		format:
 //			<position1State><position2State> ... <positionNstate>
@@ -237,15 +733,26 @@ string HiddenMarkovModel::allScoresResultsString() {
 string HiddenMarkovModel::pathStatesResultsString() {
 	stringstream ss;
 
-	HMMPosition* lastPosition = model.back();
-	HMMNode* aNode = lastPosition->highestScoringNode();
-	while (aNode->state != 0) {
-		ss << aNode->state;
-		aNode = aNode->highestWeightPreviousNode;
+	// The kept path is used when there is one (two strand and windowed
+	// decoding have no trellis to walk), otherwise the trellis is walked
+	vector<uint8_t> trellisPath;
+	if (lastViterbiPath.empty())
+		viterbiPath(trellisPath);
+	const vector<uint8_t>& path = lastViterbiPath.empty() ? trellisPath : lastViterbiPath;
+
+	// Positions before the start of the path are left out
+	for (unsigned int i = 0; i < path.size(); i++) {
+		int state = path[i];
+		if (state == 0)
+			continue;
+
+		// A collapsed run stays in its state for every position of the run
+		int length = (positionMap.numRuns() > 0) ? positionMap.positionLength(i + 1) : 1;
+		for (int repeat = 0; repeat < length; repeat++)
+			ss << state;
 	}
 
-	string reversePath = ss.str();
-	return string(reversePath.rbegin(), reversePath.rend());
+	return ss.str();
 }
 
 // string viterbiResultsString()
@@ -276,325 +783,205 @@ string HiddenMarkovModel::viterbiResultsString() {
 	return ss.str();
 }
 
+// string convergenceResultsString()
+//  Purpose:
+//		Returns a string with the timing and convergence statistics of
+//		each iteration of the viterbi training (see
+//		HMMViterbiResults::convergenceResultsString)
+//  Preconditions:
+//		viterbiTraining has been run
+string HiddenMarkovModel::convergenceResultsString() {
+	stringstream ss;
+
+	for (HMMViterbiResults* results : viterbiResults)
+		ss << results->convergenceResultsString();
+
+	return ss.str();
+}
+
 // Private Methods
 // =============================================
 
+// initialize()
+//  Purpose: 
+//		Sets every attribute to its default (no sequence, no probabilities
+//		and the default decoding options) for the constructors
+void HiddenMarkovModel::initialize() {
+	probabilities = NULL;
+	fastaFile = NULL;
+	minimumCollapsedRun = HMMPositionMap::defaultMinimumRunLength;
+	sequenceCollapsed = false;
+	orfPruning = true;
+	orfMinimumLength = 0;
+	sequenceCodons = NULL;
+	numCodons = 0;
+	modelBuilt = false;
+	viterbiCheckpointInterval = 0;
+	scaledForwardBackward = false;
+	viterbiPrecision = HMMViterbiKernel::longDoublePrecision;
+	keepViterbiPath = true;
+	twoStrandViterbi = false;
+	strandDecoder = NULL;
+	viterbiWindowLength = 0;
+	viterbiWindowOverlap = 0;
+	viterbiWindowThreads = 0;
+	windowDecoder = NULL;
+	ownedProbabilities = NULL;
+}
+
 // buildAndCalculateModel(bool calculateForward)
 //  Purpose: 
 //		Build the hidden markov model (if not already built) and calculate
-//		the viterbi weight or the forward probability for each node.
+//		the viterbi weight or the forward probability (log space or scaled)
+//		for each state at each position.
 //
 //		If the model has already been built, then this method will simply
-//		(re)calcuate the viterbi weight or forward probability for each node. 
+//		(re)calcuate the viterbi weight or forward probability in place. 
 //		The expectation is that the probabilities have been set to new values
 //		and we are recalculating the weights using these new probabilities.
+//		The topology is recompiled from the probabilities on every call so
+//		only the currently legal transitions are visited.
 //
-//		Model Building Steps:
-//			1. Create Start Node
-//			2. Iterate through the sequence from the fasta file and do the
-//			   following:
-//				a. create a HMMPosition object with one node for each state
-//				b. create HMMTransitions for this position
-//				c. calculate the viterbi weight or forwared probability for each
-//				   node in the position
-//				d. add the position to the model attribute
+//		When the model was created from a fastaFile the sequence is encoded
+//		into codon indexes the first time the model is built.  Otherwise the
+//		codons passed to the constructor are used as they are.
 //
 //  Postconditions:
-//		model - contains HMMPosition objects for every position in the
-//				sequence from the fastaFile
+//		trellis - contains a position for every trinucleotide in the
+//				  sequence
 void HiddenMarkovModel::buildAndCalculateModel(bool calculateForward) {
-
-	if (modelBuilt) {
-		// Model already built so just recalculate the weights using
-		// the newly set probabilities
-		for (HMMPosition* aPosition : model) {
-			if (calculateForward)
-				aPosition->calculateLogForwardProbability();
-			else
-				calculateHighestWeightPath(aPosition);
-		}
-	}
-	else {
-		string& sequence = fastaFile->getSequence();
-
-		// Create Start Position
-		HMMPosition* startPosition = new HMMPosition();
-		model.push_back(startPosition);
-
-		// Iterate through the sequence and create model on the fly
-		HMMPosition* previousPosition = startPosition;
-		int seqLength = sequence.length();
-		for (int seqPos = 0; seqPos <= seqLength -3; seqPos++) {
-			// Create a Position object with one node for each state
-			HMMPosition* aPosition = new HMMPosition(seqPos + 1, sequence.substr(seqPos, 3), numStates, this);
-
-			// Create the incoming transitions for the curent position
-			createTransitionsFor(aPosition, previousPosition);
-
-			// Calculate forward probability or highest weight path
-			if (calculateForward)
-				aPosition->calculateLogForwardProbability();
-			else
-				calculateHighestWeightPath(aPosition);
-
-			// Add position to the model
-			model.push_back(aPosition);
-
-			// Set previous positon to current position so that next iteration cancreate
-			// transitions correctly.
-			previousPosition = aPosition;
+	{
+		HMM_SCOPED_TIMER(modelBuildTimer);
+
+		if (!modelBuilt) {
+			// Encode the sequence once so the recursions can index the
+			// emission tables directly
+			encodeSequence();
+			trellis = HMMTrellis(sequenceCodons, numCodons, numStates);
+			modelBuilt = true;
 		}
 
-		modelBuilt = true;
-	}
-}
+		// Compile the legal transitions for the current probabilities
+		topology = HMMTopology(probabilities, numStates);
 
-// calculateLogBackwaredPorbabilities()
-//  Purpose: 
-//		Calculate and store the log backwared probability for all the nodes
-//		in the model.
-//
-//  Postconditions:
-//		model.nodes.logBackwardProbabilty will be set for all nodes
-void HiddenMarkovModel::calculateLogBackwardProbabilities() {
-	int numPositions = model.size();
-
-	// Set the backward probabilty on the last position equal to 0
-	HMMPosition* lastPosition = model[numPositions - 1];
-	for (HMMNode* node : lastPosition->nodes) {
-		node->logBackwardProbability = 0.0;
+		// Index the open reading frames for the current stop codons
+		if (orfPruning && orfIndex.build(probabilities, &topology, sequenceCodons, numCodons, orfMinimumLength)) {
+			trellis.setOrfIndex(&orfIndex);
+			HMM_COUNT(orfPrunedCellsCounter, orfIndex.numPrunedCells);
+		}
+		else
+			trellis.setOrfIndex(NULL);
 	}
 
-	// Walk the positions backward and calculate the probabilites
-	for (int positionId = numPositions - 2; positionId >= 1; positionId--) {
-		HMMPosition* position = model[positionId];
-		position->calculateLogBackwardProbability();
+	// Calculate forward probability or highest weight path
+	if (calculateForward && scaledForwardBackward)
+		trellis.calculateScaledForwardProbabilities(probabilities, &topology);
+	else if (calculateForward)
+		trellis.calculateLogForwardProbabilities(probabilities, &topology);
+	else {
+		trellis.setCheckpointInterval(viterbiCheckpointInterval);
+		trellis.setViterbiPrecision(viterbiPrecision);
+		trellis.calculateHighestWeightPaths(probabilities, &topology);
 	}
 }
 
-// calculateLogConditionalProbabilities()
+// buildStrandDecoder()
 //  Purpose: 
-//		Calculate and store the log conditional probability for all the nodes
-//		in the model.  This is the probabilty of being in a state at a particular
-//		position given the model.
-//
+//		Creates the strand decoder (if not already created) the first
+//		time the model is decoded with two strand decoding.  When the
+//		model was created from a fastaFile both fastaFile's sequence and
+//		its reverse complement are encoded into codon indexes.  Otherwise
+//		the reverse complement codons are taken from the codons passed
+//		to the constructor (or from the collapsed codons when runs of
+//		unknown codons were collapsed).
 //  Postconditions:
-//		model.nodes.logConditionalProbabilty will be set for all nodes
-void HiddenMarkovModel::calculateLogConditionalProbabilities() {
-
-	int numPositions = model.size();
-	for (HMMPosition* position : model) {
-		// Skip start node
-		if (position->id == 0)
-			continue;
-
-		// Node Probabilities (Gamma)
-		position->calculateNodeLogConditionalProbabilities();
-
-		// Transition Probabilites (Epsilon)
-		if (position->id != numPositions)  // calculate for all but last node
-			position->calculateTransitionLogConditionalProbabilities();
-	}
-}
-
-void HiddenMarkovModel::calculateBaumWelchEmissionProbabilities() {
-/*
-	// Create and initialize vectors to track the numerator and denominator
-	// calculating the probabilities
-	vector<map<char, long double>> numerators;
-	vector<long double> denominators;
-	for (int i = 0; i < numStates; i++) {
-
-		map<char, long double> numeratorMap;
-		numeratorMap['A'] = std::numeric_limits<double>::quiet_NaN();
-		numeratorMap['C'] = std::numeric_limits<double>::quiet_NaN();
-		numeratorMap['G'] = std::numeric_limits<double>::quiet_NaN();
-		numeratorMap['T'] = std::numeric_limits<double>::quiet_NaN();
-		numerators.push_back(numeratorMap);
-		denominators.push_back(std::numeric_limits<double>::quiet_NaN());
-	}
+//		strandDecoder - ready to decode the sequence
+void HiddenMarkovModel::buildStrandDecoder() {
 
-	// Iterate through the positions and populate the numerators and 
-	// denominators
-	for (HMMPosition* position : model) {
-		// Do not calculate for start nodes
-		if (position->id == 0)
-			continue;
-
-		for (HMMNode* node : position->nodes) {
-			// Set numerator for the nodes state and residue
-			numerators[node->state].at(node->residue) = 
-				MathUtilities::elnsum(
-					numerators[node->state].at(node->residue),
-					node->logConditionalProbability
-				);
-
-			// Set denominator for the nodes state
-			denominators[node->state] =
-				MathUtilities::elnsum(
-					denominators[node->state],
-					node->logConditionalProbability
-				);
-		}
-	}
+	if (strandDecoder == NULL) {
+		encodeSequence();
+		if (fastaFile != NULL && positionMap.numRuns() == 0)
+			CodonUtilities::encodeSequence(fastaFile->getReverseComplement(), reverseCodons);
+		else
+			CodonUtilities::reverseComplementCodons(sequenceCodons, numCodons, reverseCodons);
 
-	// Reset the emission probabilities from the calculated numerators
-	// and denominators
-	for (int state = 0; state < numStates; state++) {
-		for (pair<const char, long double> mapPair : numerators[0]) {
-			char residue = mapPair.first;
-			long double newEmissionProbability = 
-				MathUtilities::eexp(
-					MathUtilities::elnprod(
-						numerators[state].at(residue),
-						-denominators[state]
-					)
-				);
-			probabilities->setEmissionProbability(state, residue, newEmissionProbability);
-		}
+		strandDecoder = new HMMStrandDecoder(
+			sequenceCodons,
+			reverseCodons.empty() ? NULL : &reverseCodons[0],
+			numCodons);
 	}
-*/
-}
 
-void HiddenMarkovModel::calculateBaumWelchInitiationProbabilities(){
-	HMMPosition* firstPosition = model[1];
-	for (HMMNode* node : firstPosition->nodes) {
-		long double newInitiationProbability = MathUtilities::eexp(node->logConditionalProbability);
-		probabilities->setInitiationProbability(node->state, newInitiationProbability);
-	}
+	strandDecoder->setCheckpointInterval(viterbiCheckpointInterval);
+	strandDecoder->setViterbiPrecision(viterbiPrecision);
 }
 
-void HiddenMarkovModel::calculateBaumWelchTransitionProbabilities() {
-
-	// Create and initialize arrays to track the numerator and denominator
-	// calculating the probabilities
-	long double numerators[numStates][numStates];
-	long double denominators[numStates][numStates];
-	for (int i = 0; i < numStates; i++) {
-		for (int j = 0; j < numStates; j++) {
-			numerators[i][j] = std::numeric_limits<double>::quiet_NaN();
-			denominators[i][j] = std::numeric_limits<double>::quiet_NaN();
-		}
-	}
-
-	// Iterate through the positions and populate the numerators and 
-	// denominators
-	int numPositions = model.size();
-	for (HMMPosition* position : model) {
-		// Do not calculate for start nodes or last node
-		if (position->id == 0 || position->id == numPositions)
-			continue;
-		
-		for (HMMNode* node : position->nodes) {
-			for (HMMTransition* outTransition : node->outTransitions) {
-				int startState = outTransition->startNode->state;
-				int endState = outTransition->endNode->state;
-				numerators[startState][endState] =
-					MathUtilities::elnsum(
-						numerators[startState][endState],
-						outTransition->logConditionalProbability
-					);
-				denominators[startState][endState] =
-					MathUtilities::elnsum(
-						denominators[startState][endState],
-						node->logConditionalProbability
-					);
-			}
-		}
+// buildWindowDecoder()
+//  Purpose: 
+//		Creates the window decoder (if not already created) the first
+//		time the model is decoded in windows.
+//  Postconditions:
+//		windowDecoder - ready to decode the sequence
+void HiddenMarkovModel::buildWindowDecoder() {
+
+	if (windowDecoder == NULL) {
+		encodeSequence();
+		windowDecoder = new HMMWindowDecoder(
+			sequenceCodons,
+			numCodons,
+			viterbiWindowLength,
+			viterbiWindowOverlap,
+			viterbiWindowThreads);
 	}
 
-	// Reset the transition probabilities
-	for (int i = 0; i < numStates; i++) {
-		for (int j = 0; j < numStates; j++) {
-			long double newTransitionProbability =
-				MathUtilities::eexp(
-					MathUtilities::elnprod(
-						numerators[i][j],
-						-denominators[i][j]
-					)
-				);
-
-			probabilities->setTransitionProbability(i,j, newTransitionProbability);
-		}
-	}
+	windowDecoder->setCheckpointInterval(viterbiCheckpointInterval);
+	windowDecoder->setViterbiPrecision(viterbiPrecision);
 }
 
-// createTransitionsFor(HMMPosition* currentPosition, HMMPosition* previousPosition)
+// buildViterbiDecoder()
 //  Purpose: 
-//		Create HMMTransitions from the previousPosition to the currentPosition.
-//		Transition objects wlill be created for each node in the previousPostion
-//		to each node in the currentPosition
-//  Postconditions:
-//		currentPosition.inTransitions
-//			- contains transitions from each node in the previous position
-//		previousPosition.outTransitions
-//			- contains transitions to each node in the current position
-void HiddenMarkovModel::createTransitionsFor(HMMPosition* currentPosition, HMMPosition* previousPosition) {
-	// Create inTransitions for the  current position nodes
-	for (HMMNode* currentPositionNode : currentPosition->nodes) {
-		// Create one transition for each node from the previous position
-		// to this node in the current position
-		for (HMMNode* previousPositionNode : previousPosition->nodes) {
-			// Create the transition
-			HMMTransition* aTransition = new HMMTransition(previousPositionNode, currentPositionNode, this);
-
-			// Add to the transitions collections on nodes
-			currentPositionNode->addInTransition(aTransition);
-			previousPositionNode->addOutTransition(aTransition);
-		}
-	}
+//		Gets ready to decode the viterbi path with the current
+//		probabilities: builds the strand or window decoder or builds the
+//		model and calculates its viterbi weights.
+void HiddenMarkovModel::buildViterbiDecoder() {
+	if (twoStrandViterbi)
+		buildStrandDecoder();
+	else if (viterbiWindowLength > 0)
+		buildWindowDecoder();
+	else
+		buildAndCalculateModel(false);
 }
 
-// calculateHighestWeightPath(HMMPosition* currentPosition)
+// encodeSequence()
 //  Purpose: 
-//		Calculate and store the highest weight using the viterbi algorithm
-//		(the incoming path with the highest weight).
-//
-//		Highest Weight is determined seperately for each node.  Highest wieght
-//		for a particular node is determined by itetarting through each of the 
-//		incoming transitions taking the one with the highest weight.  The path
-//		weight uses the formula:
-//			  previous nodes weight
-//			+ transmission probability
-//			+ emission Probability
-//
+//		When the model was created from a fastaFile encodes its sequence
+//		into codon indexes (if not already encoded).  Otherwise the codons
+//		passed to the constructor are used as they are.  The runs of at
+//		least minimumCollapsedRun unknown codons are then collapsed into
+//		one position each (see HMMPositionMap).
 //  Postconditions:
-//		currentPosition.highestWeight - set to highest calculated weight
-//		currentPosition.highestWeightPreviousNode
-//			- set to the previous node that generated the highest calculated weight
-void HiddenMarkovModel::calculateHighestWeightPath(HMMPosition* aPosition) {
-	// Calculate hwp for each node
-	for (HMMNode* positionNode : aPosition->nodes) {
-		// initialize highest weight to negative infinity (except start node)
-		if (positionNode->id != 0)
-			positionNode->highestWeight = -DBL_MAX;
-
-		// Iterater through each of the incoming transitions to find
-		// the highest score
-		for (HMMTransition* transition : positionNode->inTransitions) {
-			// calculate the score
-			long double score = 
-				MathUtilities::elnprod(
-					transition->startNode->highestWeight,  // previous nodes weight
-					MathUtilities::elnprod(
-						transition->logProbability(),          // transition probability 
-						positionNode->logEmissionProbability() // emission probablity
-					)
-				);
-
-			// Replace the highest weight info if this path has the highest score
-			if (!MathUtilities::isNaN(score) && (score > positionNode->highestWeight)) {
-				positionNode->highestWeight = score;
-				positionNode->highestWeightPreviousNode = transition->startNode;
-			}
+//		sequenceCodons, numCodons - set to the encoded (collapsed) sequence
+//		positionMap - maps the collapsed positions to the sequence
+void HiddenMarkovModel::encodeSequence() {
+	if (fastaFile != NULL && sequenceCodons == NULL) {
+		CodonUtilities::encodeSequence(fastaFile->getSequence(), codons);
+		sequenceCodons = codons.empty() ? NULL : &codons[0];
+		numCodons = codons.size();
+	}
+
+	if (!sequenceCollapsed) {
+		positionMap.collapse(sequenceCodons, numCodons, minimumCollapsedRun, collapsedCodons);
+		if (positionMap.numRuns() > 0) {
+			sequenceCodons = &collapsedCodons[0];
+			numCodons = collapsedCodons.size();
 		}
+		sequenceCollapsed = true;
 	}
 }
-	
-// HMMViterbiResults* gatherViterbiResults(int iteration);
+
+// gatherViterbiResults(HMMViterbiResults* results);
 //  Purpose: 
-//		Creates, populates, and return a HMMViterbiResults object containing
-//		the results for the most recent iteration in the viterbi training.
+//		Populates results with the results for the most recent iteration
+//		in the viterbi training.
 //
 //		Results are gathered by walking the viterbi path backward.  Results
 //		gathered include the following:
@@ -609,85 +996,215 @@ void HiddenMarkovModel::calculateHighestWeightPath(HMMPosition* aPosition) {
 //		After the results are gathered, the probabitlites will be recalculated
 //		using the gathered information.
 //
+//  Preconditions:
+//		trellis.highestWeights and trellis.highestWeightPreviousStates have
+//		been calculated
+void HiddenMarkovModel::gatherViterbiResults(HMMViterbiResults* results) {
+	gatherViterbiCounts(results);
+
+	// Calculate the probabilities
+	results->calculateProbabilities(probabilities);
+}
+
+// gatherViterbiCounts(HMMViterbiResults* results);
+//  Purpose: 
+//		Walks the viterbi path (or the reconciled path of two strand
+//		decoding or the stitched path of windowed decoding) backward and
+//		gathers the counts and genes into results (see gatherViterbiResults) without
+//		calculating the probabilities.  The number of positions whose
+//		state changed since the last call is set in the results as well.
+//		The viterbi path is walked straight from the traceback, so the
+//		path is only stored when it is kept (see setKeepViterbiPath).
 //  Postconditions:
-//		currentPosition.highestWeight - set to highest calculated weight
-//		currentPosition.highestWeightPreviousNode
-//			- set to the previous node that generated the highest calculated weight
-HMMViterbiResults* HiddenMarkovModel::gatherViterbiResults(int iteration) {
-	HMMViterbiResults* results = new HMMViterbiResults(iteration, numStates);
-
-	// Find the end of the highest scoring path
-	HMMPosition* lastPosition = model.back();
-	HMMNode* aNode = lastPosition->highestScoringNode();
-
-	// Walk the path backward and gather the data
-	int previousState = -1; 
-	HMMViterbiResults::Gene* currentGene;
-	bool currentlyIntergenic = true;
-
-	while (aNode->state != 0) {
-		int currentState = aNode->state;
-		
-		// Update number of occurrences for a state
-		results->stateCounts[currentState]++;
-
-		// Update emission count for state
-		results->emissionCounts.at(currentState).at(aNode->residue)++;
-
-		// Update segment info
-		if (currentlyIntergenic) {
-			// We are walking the path backward so
-			// Check for top strand stop codon or bottom strand star codon
-			if (currentState == 5 || currentState == 7) {
-				// Now intra geneic
-				currentlyIntergenic = false;
-
-				// Create a new gene
-				currentGene = new HMMViterbiResults::Gene();
-				currentGene->end = aNode->id + 2;
-
-				if (currentState == 5) {
-					currentGene->isTopStrand = true;
-					results->topStrandGeneCount++;
-				}
-				else {
-					currentGene->isTopStrand = false;
-					results->bottomStrandGeneCount++;
-				}
-			}
-		}
-		else {  // Currently inside of a gene
-			// Check for top strand start codon or bottom strand stop codon
-			if ((currentGene->isTopStrand && currentState == 1)
-				|| (!currentGene->isTopStrand &&  currentState == 11)) {
-
-				// Now inter geneic
-				currentlyIntergenic = true;
-
-				// Add gene to genes collection
-				currentGene->start = aNode->id;
-				results->genes.push_back(currentGene);
-				currentGene = NULL;
-			}
+//		lastViterbiPath - set to the path (if it is kept)
+void HiddenMarkovModel::gatherViterbiCounts(HMMViterbiResults* results) {
+	HMM_SCOPED_TIMER(tracebackTimer);
+
+	if (!twoStrandViterbi && viterbiWindowLength == 0) {
+		gatherTracebackCounts(results);
+		return;
+	}
+
+	if (twoStrandViterbi)
+		strandDecoder->decode(probabilities, decodedPath);
+	else
+		windowDecoder->decode(probabilities, decodedPath);
+	gatherPathCounts(results, decodedPath);
+	if (keepViterbiPath)
+		countPathChanges(results, decodedPath);
+}
+
+// gatherTracebackCounts(HMMViterbiResults* results)
+//  Purpose: 
+//		Walks the viterbi traceback backward and adds every position to
+//		results while counting the positions whose state differs from
+//		lastViterbiPath; lastViterbiPath is updated in place
+//		(throws a runtime_error if there is no path, see
+//		HMMTrellis::checkHighestWeightPath)
+//  Preconditions:
+//		the viterbi weights have been calculated
+void HiddenMarkovModel::gatherTracebackCounts(HMMViterbiResults* results) {
+	trellis.checkHighestWeightPath();
+
+	int numPositions = trellis.numPositions;
+	bool comparePath = keepViterbiPath && (int) lastViterbiPath.size() == numPositions;
+	if (keepViterbiPath && !comparePath)
+		lastViterbiPath.assign(numPositions, 0);
+	int pathChanges = 0;
+
+	int position = numPositions;
+	int state = trellis.highestScoringState(position);
+	while (state != 0 && position > 0) {
+		addPathPosition(results, position, state);
+		if (keepViterbiPath) {
+			if (lastViterbiPath[position - 1] != state)
+				pathChanges++;
+			lastViterbiPath[position - 1] = state;
 		}
+		state = trellis.previousState(position, state);
+		position--;
+	}
+
+	// Positions before the start of the path
+	for (; keepViterbiPath && position > 0; position--) {
+		if (lastViterbiPath[position - 1] != 0)
+			pathChanges++;
+		lastViterbiPath[position - 1] = 0;
+	}
 
-		// Update transition counts
-		if (previousState >= 0) {
-			results->transitionCounts[currentState][previousState]++;
+	results->endPath();
+	if (comparePath)
+		results->pathChanges = pathChanges;
+}
+
+// countPathChanges(HMMViterbiResults* results, vector<uint8_t>& path)
+//  Purpose: 
+//		Sets results->pathChanges to the number of positions whose state
+//		changed since the last iteration (if there was one)
+//  Postconditions:
+//		lastViterbiPath - set to path (path is set to the previous path)
+void HiddenMarkovModel::countPathChanges(HMMViterbiResults* results, vector<uint8_t>& path) {
+	if (lastViterbiPath.size() == path.size()) {
+		results->pathChanges = 0;
+		for (unsigned int i = 0; i < path.size(); i++) {
+			if (path[i] != lastViterbiPath[i])
+				results->pathChanges++;
 		}
+	}
+	// The buffers are swapped so neither is allocated again
+	lastViterbiPath.swap(path);
+}
+
+// addPathPosition(HMMViterbiResults* results, int position, int state)
+//  Purpose: 
+//		Adds one position of the (collapsed) path to results as the
+//		path is walked backward (see HMMViterbiResults::addPathPosition).
+//		A collapsed run adds every position of the run in state.
+void HiddenMarkovModel::addPathPosition(HMMViterbiResults* results, int position, int state) {
+	uint8_t codon = sequenceCodons[position - 1];
+	if (positionMap.numRuns() == 0) {
+		results->addPathPosition(position, state, codon);
+		return;
+	}
+
+	int sequencePosition = positionMap.sequencePosition(position);
+	for (int offset = positionMap.positionLength(position) - 1; offset >= 0; offset--)
+		results->addPathPosition(sequencePosition + offset, state, codon);
+}
+
+// gatherPathCounts(HMMViterbiResults* results, const vector<uint8_t>& path)
+//  Purpose: 
+//		Walks path (path[position - 1] is the state at each collapsed
+//		position) backward and gathers its counts and genes into results
+//		(see addPathPosition)
+void HiddenMarkovModel::gatherPathCounts(HMMViterbiResults* results, const vector<uint8_t>& path) {
+	for (int position = path.size(); position > 0 && path[position - 1] != 0; position--)
+		addPathPosition(results, position, path[position - 1]);
+
+	results->endPath();
+}
 
-		// Set up variables for next iteration
-		previousState = currentState;
-		aNode = aNode->highestWeightPreviousNode;
+// addCollapsedRunCounts(HMMExpectedCounts* counts)
+//  Purpose: 
+//		Adds the expected counts of the positions a collapsed run stands
+//		for besides its collapsed position to counts: each stays in the
+//		states that emit the unknown codon (in proportion to their
+//		emission probability, only the intergenic state in the gene
+//		model) with a self transition to the next position.  The log
+//		likelihood of those positions is added as well.
+void HiddenMarkovModel::addCollapsedRunCounts(HMMExpectedCounts* counts) {
+	if (positionMap.numRuns() == 0)
+		return;
+
+	// Share of every state in the positions of a run
+	long double totalEmission = 0;
+	for (int state = 1; state < numStates; state++)
+		totalEmission += probabilities->unknownEmissionProbability(state);
+
+	long double repeats = 0;
+	for (int length : positionMap.runLengths)
+		repeats += length - 1;
+
+	for (int state = 1; state < numStates && totalEmission > 0; state++) {
+		long double share = probabilities->unknownEmissionProbability(state) / totalEmission;
+		if (!(share > 0))
+			continue;
+
+		long double logCount = MathUtilities::eln(repeats * share);
+		int emissionIndex = state * CodonUtilities::numEmissionCodons + CodonUtilities::unknownCodon;
+		counts->logStateCounts[state] = MathUtilities::elnsum(counts->logStateCounts[state], logCount);
+		counts->logTransitionCounts[state * numStates + state] =
+			MathUtilities::elnsum(counts->logTransitionCounts[state * numStates + state], logCount);
+		counts->logEmissionCounts[emissionIndex] = MathUtilities::elnsum(counts->logEmissionCounts[emissionIndex], logCount);
+		counts->logEmissionStateCounts[state] = MathUtilities::elnsum(counts->logEmissionStateCounts[state], logCount);
 	}
 
-	if (!currentlyIntergenic) {
-		throw out_of_range("Sequence should not end inside of a gene!");
+	counts->logLikelihood += collapsedRunLogLikelihood();
+}
+
+// double collapsedRunLogLikelihood()
+//  Purpose: 
+//		Returns the log (base 2) likelihood of the positions the collapsed
+//		runs stand for besides their collapsed positions (see
+//		addCollapsedRunCounts)
+double HiddenMarkovModel::collapsedRunLogLikelihood() {
+	if (positionMap.numRuns() == 0)
+		return 0;
+
+	long double totalEmission = 0;
+	long double stepProbability = 0;	// of one more position of a run
+	for (int state = 1; state < numStates; state++) {
+		long double emission = probabilities->unknownEmissionProbability(state);
+		totalEmission += emission;
+		stepProbability += emission * probabilities->transitionProbability(state, state) * emission;
 	}
+	if (!(totalEmission > 0) || !(stepProbability > 0))
+		return 0;
 
-	// Calculate the probabilities
-	results->calculateProbabilities(probabilities);
+	long double repeats = 0;
+	for (int length : positionMap.runLengths)
+		repeats += length - 1;
 
-	// Return the results
-	return results;
+	return repeats * log(stepProbability / totalEmission) / log(2);
+}
+
+// viterbiPath(vector<uint8_t>& path)
+//  Purpose: 
+//		Walks the viterbi path backward and sets path[position - 1] to the
+//		state at every position
+//		(throws a runtime_error if there is no path, see
+//		HMMTrellis::checkHighestWeightPath)
+//  Preconditions:
+//		the viterbi weights have been calculated
+void HiddenMarkovModel::viterbiPath(vector<uint8_t>& path) {
+	path.assign(trellis.numPositions, 0);
+
+	trellis.checkHighestWeightPath();
+	int position = trellis.numPositions;
+	int state = trellis.highestScoringState(position);
+	while (state != 0 && position > 0) {
+		path[position - 1] = state;
+		state = trellis.previousState(position, state);
+		position--;
+	}
 }
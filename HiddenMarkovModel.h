@@ -3,32 +3,31 @@
  *
  *	This is the header file for the HiddenMarkovModel object. 
  *  HiddenMarkovModel is the main object representing a hidden
- *  markov model.  At the moment it is hard coded to support
- *  two states.  However, it can easily be modified to support
- *  more states (see details at bottom of this header comment).
+ *  markov model.  It decodes the 12 state gene model described by
+ *  HMMGeneTopology, but the tables it works on are sized at runtime so
+ *  other models are supported as well (see details at bottom of this
+ *  header comment).
  *
- *	The model attribute holds the generated hidden markov model.
- *  Essentially the model is a vector of HMMPosition objects. A
- *  HMMPosition object is basically a collection of HMMNodes (one for
- *  each state in the HMM).  The nodes know there position, state,
- *  and residue and contain collections of HHMTransitions that come
- *  in to the node and out from the node. Emission probabilites can be 
- *  determined from the state/residue information.  Transition probabilites
- *  are determined by the start/stop node states for an HMMTransition
- *  object.
+ *	The trellis attribute holds the generated hidden markov model.
+ *  Essentially the trellis is a set of flat arrays indexed by position
+ *  and state (see HMMTrellis).  Each position corresponds to a
+ *  trinucleotide of the sequence and holds the viterbi weight, the
+ *  previous state on the viterbi path, and the forward/backward
+ *  probabilities for every state.  Transitions are not stored, the
+ *  transition and emission probabilites are looked up from the
+ *  probabilities attribute when the trellis is calculated.
  *
  *	The probabilitites attribute holds the inititation, emission and
  *  transition probabilties that are used when finding a path through
- *  the model.  HMMNodes will access the probabilites to determine their
- *  emission probabilities.  HMMTransitions will access the probabilties
- *  to determine their initiation/transition probabilties.
+ *  the model.
  *
  *  Viterbi training is currently the only implmented method for creating
  *  a path.  Typical use would be:
  *
  *		HiddenMarkovModel(aFastaFile)
  *			- instantate the object with the fasta file to build the
- *			  model from
+ *			  model from (or HiddenMarkovModel(codons, numCodons) with an
+ *			  already encoded sequence such as one from a GenomeCache)
  *
  *		viterbiTraining(numIterations)
  *			- run viterbi training to generate the model and then train
@@ -48,15 +47,50 @@
  *			- returns a string of the state for every position in the 
  *			  viterbi path
  *
+ *  Posterior decoding:
+ *	  posteriorDecoding returns the viterbi (or posterior-max) genes with
+ *    the mean posterior probability of each gene from one forward and one
+ *    backward pass (see HMMPosteriorResults).
+ *
+ *  Two strand decoding:
+ *	  setTwoStrandViterbi(true) decodes the forward and reverse complement
+ *    sequences at the same time with the smaller single strand model and
+ *    reconciles the genes of the two strands instead of decoding the
+ *    forward sequence with the 12 state model (see HMMStrandDecoder).  The
+ *    results are gathered from the reconciled path in the same form, but
+ *    the path is not the viterbi path of the 12 state model and
+ *    allScoresResultsString is not available.
+ *
+ *  Windowed decoding:
+ *	  setWindowedViterbi(windowLength, overlap, numThreads) decodes one long
+ *    sequence as overlapping windows in parallel and stitches their paths
+ *    where they meet inside the overlaps (see HMMWindowDecoder).
+ *    crossCheckWindowedViterbi reports the window boundaries at which the
+ *    gene calls differ from the serial decode.  Two strand decoding takes
+ *    precedence when both are set.
+ *
+ *  Unknown codon runs:
+ *	  Runs of at least HMMPositionMap::defaultMinimumRunLength unknown
+ *    codons (e.g., the N runs of draft assemblies) are collapsed into one
+ *    intergenic position each before the trellis is built (see
+ *    setMinimumCollapsedRun and HMMPositionMap).  Everything is reported in
+ *    sequence positions.
+ *
+ *  ORF pruning:
+ *	  By default the open reading frames of the sequence are indexed before
+ *    every calculation and the coding states of the positions no gene can
+ *    reach are skipped (see setOrfPruning and HMMOrfIndex), which leaves
+ *    the results the same.  A minimum ORF length also skips the reading
+ *    frames shorter than it.
+ *
  *  Reconfiguration for more states:
- *	  The ultimate fix would be to take in the number of states
- *    as a parameter.  There is already a numStates variable that
- *    exists and is hardcoded to 2, but this could be set to the
- *    passed in parameter.  The main issue is with the HMMProbabilites
- *    object as it contains several arrays that have sizes the same
- *    size as the number of states.  These would need to be initialized
- *    to have the correct size, or perhaps changed to vectors (as it
- *    is easier to initialize vectors to a particular size).
+ *	  HMMProbabilities, HMMTopology and HMMTrellis are sized at runtime,
+ *    so a model with a different number of states only needs its own
+ *    probabilities.  numStates is taken from HMMGeneTopology, the
+ *    constexpr description of the 12 state gene model.  The trellis uses
+ *    kernels unrolled at compile time for that topology (see
+ *    HMMUnrolledKernel) and the generic loops over the topology for any
+ *    other model.
  *
  *  Created on: 2-13-13
  *      Author: tomkolar
@@ -65,9 +99,17 @@
 #ifndef HIDDENMARKOVMODEL_H
 #define HIDDENMARKOVMODEL_H
 #include "FastaFile.h"
-#include "HMMPosition.h"
+#include "HMMTrellis.h"
 #include "HMMProbabilities.h"
 #include "HMMViterbiResults.h"
+#include "HMMExpectedCounts.h"
+#include "HMMPosteriorResults.h"
+#include "HMMPositionMap.h"
+#include "HMMOrfIndex.h"
+#include "HMMStrandDecoder.h"
+#include "HMMWindowDecoder.h"
+#include "HMMArena.h"
+#include "HMMGeneWriter.h"
 #include <vector>
 #include <map>
 using namespace std;
@@ -79,6 +121,7 @@ public:
 	// ==============================================
 	HiddenMarkovModel();
 	HiddenMarkovModel(FastaFile* aFastaFile);
+	HiddenMarkovModel(const uint8_t* someCodons, int numberOfCodons);  // e.g. from a GenomeCache
 
 	// Destructor
 	// =============================================
@@ -111,6 +154,24 @@ public:
 	//						results
 	void viterbiTraining(int numIterations);
 
+	// int viterbiTraining(int maxIterations, long double probabilityThreshold, int pathChangeThreshold)
+	//  Purpose: 
+	//		Perform viterbi training until it converges or maxIterations
+	//		iterations have been run and return the number of iterations run.
+	//		Training has converged when no probability changed by more than
+	//		probabilityThreshold or at most pathChangeThreshold positions of
+	//		the viterbi path changed since the last iteration (see
+	//		HMMViterbiResults::hasConverged, a negative threshold is not
+	//		checked).  With a pathChangeThreshold of 0 training stops at the
+	//		fixed point, so the results are the same as running all of the
+	//		iterations.
+	//
+	//  Postconditions:
+	//		viterbiResults - contains results (including the timing and
+	//						 convergence statistics) from each iteration run
+	//		probabilities - set to the probabilities of the last iteration
+	int viterbiTraining(int maxIterations, long double probabilityThreshold, int pathChangeThreshold);
+
 	// baumWelchTraining()
 	//  Purpose: 
 	//		Use the Baum-Welch (forward-backward) algorithm to estimate
@@ -121,6 +182,179 @@ public:
 	//			   for each node
 	void baumWelchTraining();
 
+	// HMMExpectedCounts* baumWelchExpectation(HMMProbabilities* someProbabilities)
+	//  Purpose: 
+	//		The expectation step of Baum-Welch training.  Calculates the forward
+	//		and backward probabilities of the sequence with someProbabilities
+	//		and returns the expected counts (see HMMExpectedCounts).
+	//		someProbabilities is only read, so one probabilities object can be
+	//		shared by models running on different threads.  The forward and
+	//		backward probabilities are released once the counts are gathered.
+	//
+	//  Postconditions:
+	//		probabilities - set to someProbabilities
+	HMMExpectedCounts* baumWelchExpectation(HMMProbabilities* someProbabilities);
+
+	// setScaledForwardBackward(bool scaled)
+	//  Purpose: 
+	//		Selects the numeric backend of the forward-backward calculations.
+	//		false (the default) uses log space long double arithmetic, true
+	//		uses scaled double arithmetic (see HMMTrellis).
+	void setScaledForwardBackward(bool scaled);
+
+	// double crossCheckForwardBackward()
+	//  Purpose: 
+	//		Runs the expectation step with both forward-backward backends using
+	//		the current probabilities and returns the largest relative
+	//		difference between their expected counts and log likelihoods (see
+	//		HMMExpectedCounts::maximumRelativeDifference).
+	double crossCheckForwardBackward();
+
+	// HMMPosteriorResults* posteriorDecoding(bool posteriorGenes)
+	//  Purpose:
+	//		Decodes the sequence with the current probabilities and returns the
+	//		genes together with their posterior confidence (see
+	//		HMMPosteriorResults).  One forward and one backward pass are made
+	//		(log space or scaled, see setScaledForwardBackward) and only the
+	//		forward probabilities are stored.  posteriorGenes false calls the
+	//		genes of the viterbi path (decoded first, as set up for viterbi
+	//		training), true calls the posterior-max genes without decoding the
+	//		viterbi path.  The caller owns the returned results.
+	HMMPosteriorResults* posteriorDecoding(bool posteriorGenes);
+
+	// HMMViterbiResults* viterbiIteration(HMMProbabilities* someProbabilities, int iteration)
+	//  Purpose: 
+	//		Decodes the sequence with someProbabilities and returns the counts
+	//		gathered along the viterbi path.  Unlike viterbiTraining the
+	//		probabilities of the results are not calculated, so the counts of
+	//		several models can be added together first (see HMMViterbiTrainer).
+	//		someProbabilities is only read, so one probabilities object can be
+	//		shared by models decoding on different threads.  The viterbi
+	//		columns are released once the results have been gathered.  The
+	//		results are owned by the model and stay valid until the next call
+	//		(or releaseResults), which releases them in one step.  A
+	//		runtime_error is thrown if someProbabilities can not generate the
+	//		sequence.
+	//
+	//  Postconditions:
+	//		probabilities - set to someProbabilities
+	HMMViterbiResults* viterbiIteration(HMMProbabilities* someProbabilities, int iteration);
+
+	// setViterbiCheckpointInterval(int interval)
+	//  Purpose:
+	//		Keep only every interval'th viterbi column and recalculate the
+	//		positions between them while the path is walked (see HMMTrellis).
+	//		0 (the default) keeps the full trellis and
+	//		HMMTrellis::automaticCheckpointInterval uses sqrt(sequence length).
+	//		The results are the same in either mode.
+	void setViterbiCheckpointInterval(int interval);
+
+	// setVectorizedViterbi(bool vectorized)
+	//  Purpose:
+	//		Selects the viterbi column calculation.  false (the default) uses
+	//		the long double reference, true uses the vectorized double
+	//		precision HMMViterbiKernel (see HMMTrellis).
+	void setVectorizedViterbi(bool vectorized);
+
+	// int crossCheckVectorizedViterbi()
+	//  Purpose:
+	//		Decodes the sequence with both viterbi column calculations using
+	//		the current probabilities and returns the number of positions at
+	//		which their viterbi paths differ.
+	int crossCheckVectorizedViterbi();
+
+	// setViterbiPrecision(int precision)
+	//  Purpose:
+	//		Selects the precision of the viterbi column calculation:
+	//		HMMViterbiKernel::longDoublePrecision (the reference, the
+	//		default), doublePrecision (the same as setVectorizedViterbi(true))
+	//		or floatPrecision (see HMMViterbiKernel).
+	void setViterbiPrecision(int precision);
+
+	// string crossCheckViterbiPrecision(int precision)
+	//  Purpose:
+	//		Decodes the sequence with the long double reference and with
+	//		precision using the current probabilities and returns the genes
+	//		called by only one of the two decodes.
+	//
+	//		format:
+	//			<result type="precision_check" precision="<<precision name>>" genes="<<reference genes>>" differences="<<differences>>">
+	//				(<<start>>,<<end>>,<<strand>>,<<long|precision name>>),...
+	//			</result>
+	string crossCheckViterbiPrecision(int precision);
+
+	// setTwoStrandViterbi(bool twoStrand)
+	//  Purpose:
+	//		Selects the viterbi decoding.  false (the default) decodes the
+	//		forward sequence with the 12 state gene model, true decodes both
+	//		strands separately on two threads with the single strand model
+	//		and reconciles their genes (see HMMStrandDecoder).
+	void setTwoStrandViterbi(bool twoStrand);
+
+	// setWindowedViterbi(int windowLength, int overlap, int numberOfThreads)
+	//  Purpose:
+	//		Decode the sequence as windows of windowLength positions, each
+	//		extended by overlap positions on both sides, on numberOfThreads
+	//		threads (0 uses one thread per core) and stitch their paths (see
+	//		HMMWindowDecoder).  A windowLength of 0 (the default) decodes the
+	//		whole sequence at once.
+	void setWindowedViterbi(int windowLength, int overlap, int numberOfThreads);
+
+	// vector<int> crossCheckWindowedViterbi()
+	//  Purpose:
+	//		Decodes the sequence both serially and in windows using the
+	//		current probabilities and returns the stitch positions of the
+	//		window boundaries near which (within the overlap) the two decodes
+	//		call different genes.
+	//  Preconditions:
+	//		setWindowedViterbi has been called with a windowLength above 0
+	vector<int> crossCheckWindowedViterbi();
+
+	// setMinimumCollapsedRun(int minimumRunLength)
+	//  Purpose:
+	//		Collapse every run of at least minimumRunLength unknown codons (N
+	//		runs and other ambiguity codes) into a single position that stays
+	//		in the intergenic state, so the trellis is never expanded across
+	//		the gap (see HMMPositionMap).  Positions, genes and paths are
+	//		still reported in sequence positions.  0 keeps every position.
+	//		The default is HMMPositionMap::defaultMinimumRunLength.  Takes
+	//		effect when the sequence is first decoded.
+	void setMinimumCollapsedRun(int minimumRunLength);
+
+	// setOrfPruning(bool prune, int minimumOrfLength)
+	//  Purpose:
+	//		Selects whether viterbi and forward-backward skip the coding states
+	//		of the positions outside of every open reading frame (see
+	//		HMMOrfIndex, rebuilt from the probabilities every time the model is
+	//		calculated).  With a minimumOrfLength of 0 only unreachable states
+	//		are skipped and the results are the same; a minimumOrfLength above
+	//		0 (in bases) rules out the reading frames shorter than it as well.
+	//		The default is exact pruning (true, 0).  Models other than the 12
+	//		state gene model are never pruned.
+	void setOrfPruning(bool prune, int minimumOrfLength);
+
+	// setKeepViterbiPath(bool keep)
+	//  Purpose:
+	//		Selects whether the path of every viterbi iteration is kept.  true
+	//		(the default) keeps one state per position, which is needed for
+	//		the path changes of the results and pathStatesResultsString
+	//		after two strand or windowed decoding.  false gathers the results
+	//		straight from the traceback without storing the path, so a single
+	//		decode (e.g., HMMAnnotationServer) allocates nothing per position
+	//		besides the trellis.
+	void setKeepViterbiPath(bool keep);
+
+	// releaseResults()
+	//  Purpose:
+	//		Releases the results of every viterbi training iteration and the
+	//		last viterbiIteration in one step (see HMMArena).  The trained
+	//		probabilities are kept, so training can go on from them.
+	//  Postconditions:
+	//		viterbiResults - empty
+	//		probabilities - moved into the model when they were the
+	//						probabilities of released results
+	void releaseResults();
+
 	// string allScoresResultsString()
 	//  Purpose:
 	//		Returns a string representing the score (weight) from each node
@@ -131,14 +365,36 @@ public:
 	//			  Node: (<node1State>,<node1Weight>)
 	//			  Node: (<node2State>,<node2Weight>)
 	//			  ...
+	//
+	//		A collapsed run of unknown codons is listed once, at the first
+	//		sequence position of the run (see setMinimumCollapsedRun).
 	//  Preconditions:
-	//		viterbiTraining has been run
+	//		viterbiTraining has been run (without two strand decoding)
 	string allScoresResultsString();
 
+	// writeScores(HMMGeneWriter& writer)
+	//  Purpose:
+	//		Streams the score (weight) of each state in each position of the
+	//		viterbi path to writer (see allScoresResultsString) without
+	//		building the output in memory
+	//  Preconditions:
+	//		viterbiTraining has been run (without two strand or windowed
+	//		decoding)
+	void writeScores(HMMGeneWriter& writer);
+
+	// writeGenes(HMMGeneWriter& writer, const string& sequenceName)
+	//  Purpose:
+	//		Streams the genes of the last viterbi training iteration to writer
+	//		as the records of sequenceName
+	//  Preconditions:
+	//		viterbiTraining has been run
+	void writeGenes(HMMGeneWriter& writer, const string& sequenceName);
+
 	// string pathStatesResultsString()
 	//  Purpose:
 	//		Returns a string representing the state for each position in the
-	//		viterbi path.
+	//		viterbi path.  Every state is written as its decimal number (10
+	//		and 11 as "10" and "11") in every decoding mode.
 	//
 	//		format:
 	//			<position1State><position2State> ... <positionNstate>
@@ -162,97 +418,122 @@ public:
 	//		viterbiTraining has been run
 	string viterbiResultsString();
 
+	// string convergenceResultsString()
+	//  Purpose:
+	//		Returns a string with the timing and convergence statistics of
+	//		each iteration of the viterbi training (see
+	//		HMMViterbiResults::convergenceResultsString)
+	//  Preconditions:
+	//		viterbiTraining has been run
+	string convergenceResultsString();
+
 private:
 
 	// Private Attributes
 	// =============================================
 	static const int numStates;
 	FastaFile* fastaFile;
-	vector<HMMPosition*> model;
+	vector<uint8_t> codons;			// encoded from fastaFile
+	vector<uint8_t> collapsedCodons;	// with the unknown codon runs collapsed
+	HMMPositionMap positionMap;			// collapsed positions to the sequence
+	int minimumCollapsedRun;
+	bool sequenceCollapsed;
+	bool orfPruning;
+	int orfMinimumLength;			// bases, 0 for exact pruning
+	HMMOrfIndex orfIndex;			// open reading frames (ORF pruning)
+	const uint8_t* sequenceCodons;	// codons the trellis is built over
+	int numCodons;
+	HMMTrellis trellis;
+	HMMTopology topology;
 	bool modelBuilt;
+	int viterbiCheckpointInterval;
+	bool scaledForwardBackward;
+	int viterbiPrecision;
+	bool keepViterbiPath;
+	vector<uint8_t> lastViterbiPath;	// path of the last iteration (path changes)
+	vector<uint8_t> decodedPath;		// path of two strand or windowed decoding
+	bool twoStrandViterbi;
+	vector<uint8_t> reverseCodons;		// encoded from the reverse complement
+	HMMStrandDecoder* strandDecoder;	// created on first two strand decode
+	int viterbiWindowLength;			// 0 when the sequence is decoded at once
+	int viterbiWindowOverlap;
+	int viterbiWindowThreads;
+	HMMWindowDecoder* windowDecoder;	// created on first windowed decode
+	HMMProbabilities* ownedProbabilities;	// initial (or kept) probabilities
+	HMMArena resultsArena;				// viterbiResults
+	HMMArena iterationArena;			// results of the last viterbiIteration
 
 	// Private Methods
 	// =============================================
 
+	// initialize()
+	//  Purpose: 
+	//		Sets every attribute to its default (no sequence, no probabilities
+	//		and the default decoding options) for the constructors
+	void initialize();
+
 	// buildAndCalculateModel(bool calculateForward)
 	//  Purpose: 
 	//		Build the hidden markov model (if not already built) and calculate
-	//		the viterbi weight or the forward probability for each node.
+	//		the viterbi weight or the forward probability (log space or scaled)
+	//		for each state at each position.
 	//
 	//		If the model has already been built, then this method will simply
-	//		(re)calcuate the viterbi weight or forward probability for each node. 
+	//		(re)calcuate the viterbi weight or forward probability in place. 
 	//		The expectation is that the probabilities have been set to new values
 	//		and we are recalculating the weights using these new probabilities.
+	//		The topology is recompiled from the probabilities on every call so
+	//		only the currently legal transitions are visited.
 	//
-	//		Model Building Steps:
-	//			1. Create Start Node
-	//			2. Iterate through the sequence from the fasta file and do the
-	//			   following:
-	//				a. create a HMMPosition object with one node for each state
-	//				b. create HMMTransitions for this position
-	//				c. calculate the viterbi weight or forwared probability for each
-	//				   node in the position
-	//				d. add the position to the model attribute
+	//		When the model was created from a fastaFile the sequence is encoded
+	//		into codon indexes the first time the model is built.  Otherwise the
+	//		codons passed to the constructor are used as they are.
 	//
 	//  Postconditions:
-	//		model - contains HMMPosition objects for every position in the
-	//				sequence from the fastaFile
+	//		trellis - contains a position for every trinucleotide in the
+	//				  sequence
 	void buildAndCalculateModel(bool calculateForward);
 
-	// createTransitionsFor(HMMPosition* currentPosition, HMMPosition* previousPosition)
+	// buildStrandDecoder()
 	//  Purpose: 
-	//		Create HMMTransitions from the previousPosition to the currentPosition.
-	//		Transition objects wlill be created for each node in the previousPostion
-	//		to each node in the currentPosition
+	//		Creates the strand decoder (if not already created) the first
+	//		time the model is decoded with two strand decoding.  When the
+	//		model was created from a fastaFile both fastaFile's sequence and
+	//		its reverse complement are encoded into codon indexes.  Otherwise
+	//		the reverse complement codons are taken from the codons passed
+	//		to the constructor.
 	//  Postconditions:
-	//		currentPosition.inTransitions
-	//			- contains transitions from each node in the previous position
-	//		previousPosition.outTransitions
-	//			- contains transitions to each node in the current position
-	void createTransitionsFor(HMMPosition* currentPosition, HMMPosition* previousPosition);
+	//		strandDecoder - ready to decode the sequence
+	void buildStrandDecoder();
 
-	// calculateHighestWeightPath(HMMPosition* currentPosition)
+	// buildWindowDecoder()
 	//  Purpose: 
-	//		Calculate and store the highest weight using the viterbi algorithm
-	//		(the incoming path with the highest weight).
-	//
-	//		Highest Weight is determined seperately for each node.  Highest wieght
-	//		for a particular node is determined by itetarting through each of the 
-	//		incoming transitions taking the one with the highest weight.  The path
-	//		weight uses the formula:
-	//			  previous nodes weight
-	//			+ transmission probability
-	//			+ emission Probability
-	//
+	//		Creates the window decoder (if not already created) the first
+	//		time the model is decoded in windows.
 	//  Postconditions:
-	//		currentPosition.highestWeight - set to highest calculated weight
-	//		currentPosition.highestWeightPreviousNode
-	//			- set to the previous node that generated the highest calculated weight
-	void calculateHighestWeightPath(HMMPosition* currentPosition);
+	//		windowDecoder - ready to decode the sequence
+	void buildWindowDecoder();
 
-	// calculateLogBackwaredPorbabilities()
+	// buildViterbiDecoder()
 	//  Purpose: 
-	//		Calculate and store the log backwared probability for all the nodes
-	//		in the model.
-	//
-	//  Postconditions:
-	//		model.nodes.logBackwardProbabilty will be set for all nodes
-	void calculateLogBackwardProbabilities();
+	//		Gets ready to decode the viterbi path with the current
+	//		probabilities: builds the strand or window decoder or builds the
+	//		model and calculates its viterbi weights.
+	void buildViterbiDecoder();
 
-	// calculateLogConditionalProbabilities()
+	// encodeSequence()
 	//  Purpose: 
-	//		Calculate and store the log conditional probability for all the nodes
-	//		in the model.  This is the probabilty of being in a state at a particular
-	//		position given the model.
-	//
+	//		When the model was created from a fastaFile encodes its sequence
+	//		into codon indexes (if not already encoded).  Otherwise the codons
+	//		passed to the constructor are used as they are.
 	//  Postconditions:
-	//		model.nodes.logConditionalProbabilty will be set for all nodes
-	void calculateLogConditionalProbabilities();
+	//		sequenceCodons, numCodons - set to the encoded sequence
+	void encodeSequence();
 
-	// HMMViterbiResults* gatherViterbiResults(int iteration);
+	// gatherViterbiResults(HMMViterbiResults* results);
 	//  Purpose: 
-	//		Creates, populates, and return a HMMViterbiResults object containing
-	//		the results for the most recent iteration in the viterbi training.
+	//		Populates results with the results for the most recent iteration
+	//		in the viterbi training.
 	//
 	//		Results are gathered by walking the viterbi path backward.  Results
 	//		gathered include the following:
@@ -267,18 +548,88 @@ private:
 	//		After the results are gathered, the probabitlites will be recalculated
 	//		using the gathered information.
 	//
+	//  Preconditions:
+	//		trellis.highestWeights and trellis.highestWeightPreviousStates have
+	//		been calculated
+	void gatherViterbiResults(HMMViterbiResults* results);
+
+	// gatherViterbiCounts(HMMViterbiResults* results);
+	//  Purpose: 
+	//		Walks the viterbi path (or the reconciled path of two strand
+	//		decoding or the stitched path of windowed decoding) backward and
+	//		gathers the counts and genes into results (see gatherViterbiResults) without
+	//		calculating the probabilities.  The number of positions whose
+	//		state changed since the last call is set in the results as well.
+	//		The viterbi path is walked straight from the traceback, so the
+	//		path is only stored when it is kept (see setKeepViterbiPath).
 	//  Postconditions:
-	//		currentPosition.highestWeight - set to highest calculated weight
-	//		currentPosition.highestWeightPreviousNode
-	//			- set to the previous node that generated the highest calculated weight
-	HMMViterbiResults* gatherViterbiResults(int iteration);
-
-	void calculateBaumWelchEmissionProbabilities();
-	void calculateBaumWelchTransitionProbabilities();
-	void calculateBaumWelchInitiationProbabilities();
-	double calculateLogLikelihood();
+	//		lastViterbiPath - set to the path (if it is kept)
+	void gatherViterbiCounts(HMMViterbiResults* results);
+
+	// gatherTracebackCounts(HMMViterbiResults* results)
+	//  Purpose: 
+	//		Walks the viterbi traceback backward and adds every position to
+	//		results while counting the positions whose state differs from
+	//		lastViterbiPath; lastViterbiPath is updated in place
+	//		(throws a runtime_error if there is no path, see
+	//		HMMTrellis::checkHighestWeightPath)
+	//  Preconditions:
+	//		the viterbi weights have been calculated
+	void gatherTracebackCounts(HMMViterbiResults* results);
+
+	// viterbiPath(vector<uint8_t>& path)
+	//  Purpose: 
+	//		Walks the viterbi path backward and sets path[position - 1] to the
+	//		state at every position
+	//		(throws a runtime_error if there is no path, see
+	//		HMMTrellis::checkHighestWeightPath)
+	//  Preconditions:
+	//		the viterbi weights have been calculated
+	void viterbiPath(vector<uint8_t>& path);
+
+	// countPathChanges(HMMViterbiResults* results, vector<uint8_t>& path)
+	//  Purpose: 
+	//		Sets results->pathChanges to the number of positions whose state
+	//		changed since the last iteration (if there was one)
+	//  Postconditions:
+	//		lastViterbiPath - set to path (path is set to the previous path)
+	void countPathChanges(HMMViterbiResults* results, vector<uint8_t>& path);
+
+	// addPathPosition(HMMViterbiResults* results, int position, int state)
+	//  Purpose: 
+	//		Adds one position of the (collapsed) path to results as the
+	//		path is walked backward (see HMMViterbiResults::addPathPosition).
+	//		A collapsed run adds every position of the run in state.
+	void addPathPosition(HMMViterbiResults* results, int position, int state);
+
+	// gatherPathCounts(HMMViterbiResults* results, const vector<uint8_t>& path)
+	//  Purpose: 
+	//		Walks path (path[position - 1] is the state at each collapsed
+	//		position) backward and gathers its counts and genes into results
+	//		(see addPathPosition)
+	void gatherPathCounts(HMMViterbiResults* results, const vector<uint8_t>& path);
+
+	// addCollapsedRunCounts(HMMExpectedCounts* counts)
+	//  Purpose: 
+	//		Adds the expected counts of the positions a collapsed run stands
+	//		for besides its collapsed position to counts: each stays in the
+	//		states that emit the unknown codon (in proportion to their
+	//		emission probability, only the intergenic state in the gene
+	//		model) with a self transition to the next position.  The log
+	//		likelihood of those positions is added as well.
+	void addCollapsedRunCounts(HMMExpectedCounts* counts);
+
+	// double collapsedRunLogLikelihood()
+	//  Purpose: 
+	//		Returns the log (base 2) likelihood of the positions the collapsed
+	//		runs stand for besides their collapsed positions (see
+	//		addCollapsedRunCounts)
+	double collapsedRunLogLikelihood();
+
 	string baumWelchResultsString(int iterations, double logLikelihood);
 
+	HiddenMarkovModel(const HiddenMarkovModel&);
+	HiddenMarkovModel& operator=(const HiddenMarkovModel&);
 
 };
 
@@ -15,7 +15,7 @@
  */
 
 #ifndef MATHUTILITITES_H
-#define STRINGUTMATHUTILITITES_HILITIES_H_
+#define MATHUTILITITES_H
 
 using namespace std;
 
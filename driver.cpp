@@ -3,50 +3,636 @@
  *
  *	This is the driver file for creating an a hidden markov model from
  *  a fastafile.  Viterbi training is then exectued to try and locate
- *  GC rich portions of the sequence.
+ *  the genes of the sequence.
  *
  *	Typical use:
- *		hmm fastaFile numIterations
+ *		hmm fastaFile ... numIterations [probabilitiesFile] [-cache cacheFile] [-training viterbi|baumwelch] [-converge threshold] [-threads n] [-format xml|gff3|bed] [-minimumOrf bases] [-precision long|double|float] [-validate] [-confidence viterbi|posterior] [-metrics json|prometheus]
+ *
+ *		Every record of every fastaFile is trained on (several records are
+ *		trained together by HMMViterbiTrainer or HMMBaumWelchTrainer, even
+ *		on one thread).  The trained probabilities are saved to
+ *		probabilitiesFile when one is given (see HMMProbabilities::save).
+ *		-cache reads the records from the 2-bit cacheFile (see GenomeCache)
+ *		instead of parsing the single fastaFile, writing cacheFile from
+ *		fastaFile first if it does not exist yet (bases other than A, C, G
+ *		and T are read back as N).
+ *		-training selects viterbi training for numIterations iterations
+ *		(the default) or Baum-Welch training until the likelihood
+ *		converges.  -converge stops viterbi training early once no
+ *		probability changed by more than threshold or the viterbi path no
+ *		longer changes (numIterations is then the most iterations run, see
+ *		HiddenMarkovModel::viterbiTraining) and reports the convergence
+ *		statistics of every iteration (to stderr with -format gff3 or bed).
+ *		-threads other than 1
+ *		trains with HMMViterbiTrainer or HMMBaumWelchTrainer on n threads (0
+ *		uses one thread per core).  -format gff3 or bed writes only the genes
+ *		of the last viterbi iteration in that format (see HMMGeneWriter).
+ *		-minimumOrf rules out the genes whose open reading frame is shorter
+ *		than that many bases (see HMMOrfIndex).  -precision selects the
+ *		viterbi precision (see HMMViterbiKernel) and -validate reports the
+ *		genes that decoding the trained model at that precision (float if
+ *		none is given) calls differently than the long double reference
+ *		(see HiddenMarkovModel::crossCheckViterbiPrecision).  -confidence
+ *		reports the posterior confidence of the genes of the trained model,
+ *		called by the viterbi path or by posterior-max decoding (see
+ *		HiddenMarkovModel::posteriorDecoding).  -metrics writes the phase
+ *		timers, counters and memory use of the run to stderr (see
+ *		HMMInstrumentation, the timers and counters are only collected when
+ *		built with -DHMM_INSTRUMENTATION).
+ *
+ *  Annotation server (see HMMAnnotationServer):
+ *		hmm serve [-socket path] [-threads n] [-batch n] [-iterations n] [-format xml|gff3|bed] [-precision long|double|float] [-batched maxBases] name=modelFile ...
+ *
+ *		Loads one model per name=modelFile argument once at start up (a
+ *		saved probabilities file, or a Fasta file that is trained on) and
+ *		then annotates the Fasta records read from stdin (writing the gene
+ *		calls to stdout in the format given, see HMMGeneWriter) or from every
+ *		connection to the unix domain socket at path.  -batched decodes the
+ *		records of at most maxBases bases of a batch together in SIMD lanes
+ *		(see HMMBatchDecoder), so it wants a -batch of many records.  It
+ *		decodes in double precision only, so it needs -precision double.
+ *
+ *  Batch annotation (see HMMAnnotationPipeline):
+ *		hmm annotate [-threads n] [-iterations n] [-format xml|gff3|bed] [-precision long|double|float] [-queueBases size] [-queueRecords n] name=modelFile ... fastaFile ...
+ *
+ *		Loads the models as serve does and annotates every record of the
+ *		Fasta files, reading, decoding (on n threads) and writing the gene
+ *		calls to stdout at the same time.  At most -queueBases bases and
+ *		-queueRecords records are held between reading and writing.
+ *
+ *  Model scoring (see HMMForwardScorer):
+ *		hmm score [-iterations n] fastaFile name=modelFile ...
+ *
+ *		Loads the models as serve does and writes the log (base 2)
+ *		likelihood of every record of fastaFile under every model and the
+ *		name of the best one, streaming each record once without decoding it:
+ *			<result type="score" name="<<first word of the header>>" best="<<model name>>">
+ *				<<model name>>=<<log likelihood>>,...
+ *			</result>
+ *
+ *  Benchmark (see HMMBenchmark):
+ *		hmm benchmark [-sizes 10k,100k,1M] [-repetitions n] [-seed n] [-precision long|double|float] [-checkpoint n|auto] [-maxForwardBackward size] [-output file]
+ *
+ *		Times the decoding and training phases on sequences of every size
+ *		sampled from the initial probabilities and writes one line of JSON
+ *		per phase to stdout (or file).
  *
  *  Created on: 2-15-13
  *      Author: tomkolar
  */
 #include "FastaFile.h"
+#include "FastaReader.h"
+#include "GenomeCache.h"
 #include "HiddenMarkovModel.h"
+#include "HMMViterbiTrainer.h"
+#include "HMMBaumWelchTrainer.h"
+#include "HMMAnnotationServer.h"
+#include "HMMAnnotationPipeline.h"
+#include "HMMBenchmark.h"
+#include "HMMForwardScorer.h"
+#include "HMMInstrumentation.h"
 #include <string>
+#include <vector>
 #include <sstream>
 #include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
 using namespace std;
 
+// bool isCount(const string& argument)
+//  Purpose:
+//		Returns true if argument is a non negative whole number (the
+//		iterations that end the fasta files of the main command)
+bool isCount(const string& argument) {
+	return !argument.empty() && argument.find_first_not_of("0123456789") == string::npos;
+}
+
+// readFastaRecords(const vector<string>& fileNames, vector<FastaFile*>& fastaFiles)
+//  Purpose:
+//		Reads every record of the fasta files fileNames into a FastaFile of
+//		its own.  Throws a runtime_error if a file can not be opened or has
+//		no records.
+//  Postconditions:
+//		fastaFiles - the records read (owned by the caller, also when an
+//					 error is thrown)
+void readFastaRecords(const vector<string>& fileNames, vector<FastaFile*>& fastaFiles) {
+	HMM_SCOPED_TIMER(fastaLoadTimer);
+
+	for (const string& fileName : fileNames) {
+		FastaReader reader(fileName);
+		string header;
+		string sequence;
+		unsigned int numRecords = fastaFiles.size();
+		while (reader.nextRecord(header, sequence))
+			fastaFiles.push_back(new FastaFile(fileName, header, sequence));
+		if (fastaFiles.size() == numRecords)
+			throw runtime_error("No records in fasta file: " + fileName);
+	}
+}
+
+// readCacheRecords(const string& cacheFileName, const string& fastaFileName, vector<FastaFile*>& fastaFiles)
+//  Purpose:
+//		Reads every record of the genome cache cacheFileName into a FastaFile
+//		named fastaFileName.  The cache is written from the fasta file
+//		fastaFileName first if it does not exist.  Throws a runtime_error if
+//		either file can not be opened or the cache has no records.
+//  Postconditions:
+//		fastaFiles - the records read (owned by the caller, also when an
+//					 error is thrown)
+void readCacheRecords(const string& cacheFileName, const string& fastaFileName, vector<FastaFile*>& fastaFiles) {
+	HMM_SCOPED_TIMER(fastaLoadTimer);
+
+	if (access(cacheFileName.c_str(), F_OK) != 0) {
+		FastaReader reader(fastaFileName);
+		GenomeCache::create(cacheFileName, reader, false);
+		cerr << "Genome cache " << cacheFileName << " written from " << fastaFileName << "\n";
+	}
+
+	GenomeCache cache(cacheFileName);
+	if (cache.getNumRecords() == 0)
+		throw runtime_error("No records in genome cache: " + cacheFileName);
+	for (int record = 0; record < cache.getNumRecords(); record++) {
+		string sequence;
+		cache.decodeSequence(record, sequence);
+		fastaFiles.push_back(new FastaFile(fastaFileName, cache.getRecordName(record), sequence));
+	}
+}
+
+HMMProbabilities* loadModel(const string& name, const string& fileName, int iterations, int threads) {
+	if (HMMProbabilities::isProbabilitiesFile(fileName)) {
+		cerr << "Model " << name << " loaded from " << fileName << "\n";
+		return HMMProbabilities::load(fileName);
+	}
+
+	FastaFile fastaFile(fileName);
+	HMMViterbiTrainer trainer(threads);
+	trainer.addSequence(&fastaFile);
+	trainer.viterbiTraining(iterations);
+	HMMProbabilities* probabilities = new HMMProbabilities();
+	probabilities->copyFrom(trainer.probabilities);
+	cerr << "Model " << name << " trained from " << fileName << "\n";
+
+	return probabilities;
+}
+
+int serve(int argc, char *argv[]) {
+	string socketPath;
+	int threads = 0;
+	int batchSize = 0;
+	int iterations = 10;
+	HMMGeneWriter::Format format = HMMGeneWriter::xmlFormat;
+	int precision = HMMViterbiKernel::longDoublePrecision;
+	long maxBatchedBases = 0;
+	vector<string> modelArguments;
+
+	for (int i = 2; i < argc; i++) {
+		string argument = argv[i];
+		if (argument == "-socket" && i + 1 < argc)
+			socketPath = argv[++i];
+		else if (argument == "-threads" && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (argument == "-batch" && i + 1 < argc)
+			batchSize = atoi(argv[++i]);
+		else if (argument == "-iterations" && i + 1 < argc)
+			iterations = atoi(argv[++i]);
+		else if (argument == "-format" && i + 1 < argc)
+			format = HMMGeneWriter::parseFormat(argv[++i]);
+		else if (argument == "-precision" && i + 1 < argc)
+			precision = HMMViterbiKernel::parsePrecision(argv[++i]);
+		else if (argument == "-batched" && i + 1 < argc)
+			maxBatchedBases = atol(argv[++i]);
+		else if (argument.find('=') != string::npos)
+			modelArguments.push_back(argument);
+		else {
+			cerr << "Unknown argument: " << argument << "\n";
+			return -1;
+		}
+	}
+
+	if (modelArguments.empty()) {
+		cerr << "usage: hmm serve [-socket path] [-threads n] [-batch n] [-iterations n] [-format xml|gff3|bed] [-precision long|double|float] [-batched maxBases] name=modelFile ...\n";
+		return -1;
+	}
+
+	if (maxBatchedBases > 0 && precision != HMMViterbiKernel::doublePrecision) {
+		cerr << "-batched decodes in double precision only, use it with -precision double\n";
+		return -1;
+	}
+
+	// Load (or train) every model once
+	HMMAnnotationServer server(threads, batchSize);
+	server.outputFormat = format;
+	server.viterbiPrecision = precision;
+	server.maxBatchedBases = (maxBatchedBases > 0) ? maxBatchedBases : 0;
+	for (string& modelArgument : modelArguments) {
+		string name = modelArgument.substr(0, modelArgument.find('='));
+		string fileName = modelArgument.substr(modelArgument.find('=') + 1);
+
+		HMMProbabilities* probabilities = loadModel(name, fileName, iterations, threads);
+		server.addModel(name, probabilities);
+		delete probabilities;
+	}
+
+	if (socketPath.empty())
+		server.serve(stdin, STDOUT_FILENO);
+	else
+		server.serveSocket(socketPath);
+
+	return 0;
+}
+
+int annotate(int argc, char *argv[]) {
+	int threads = 0;
+	int iterations = 10;
+	long maxQueuedBases = 0;
+	int maxQueuedRecords = 0;
+	HMMGeneWriter::Format format = HMMGeneWriter::xmlFormat;
+	int precision = HMMViterbiKernel::longDoublePrecision;
+	vector<string> modelArguments;
+	vector<string> fileNames;
+
+	for (int i = 2; i < argc; i++) {
+		string argument = argv[i];
+		if (argument == "-threads" && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (argument == "-iterations" && i + 1 < argc)
+			iterations = atoi(argv[++i]);
+		else if (argument == "-format" && i + 1 < argc)
+			format = HMMGeneWriter::parseFormat(argv[++i]);
+		else if (argument == "-precision" && i + 1 < argc)
+			precision = HMMViterbiKernel::parsePrecision(argv[++i]);
+		else if (argument == "-queueBases" && i + 1 < argc)
+			maxQueuedBases = HMMBenchmark::parseSize(argv[++i]);
+		else if (argument == "-queueRecords" && i + 1 < argc)
+			maxQueuedRecords = atoi(argv[++i]);
+		else if (argument.find('=') != string::npos)
+			modelArguments.push_back(argument);
+		else if (argument[0] != '-')
+			fileNames.push_back(argument);
+		else {
+			cerr << "Unknown argument: " << argument << "\n";
+			return -1;
+		}
+	}
+
+	if (modelArguments.empty() || fileNames.empty()) {
+		cerr << "usage: hmm annotate [-threads n] [-iterations n] [-format xml|gff3|bed] [-precision long|double|float] [-queueBases size] [-queueRecords n] name=modelFile ... fastaFile ...\n";
+		return -1;
+	}
+
+	// Load (or train) every model once
+	HMMAnnotationPipeline pipeline(threads);
+	pipeline.outputFormat = format;
+	pipeline.viterbiPrecision = precision;
+	if (maxQueuedBases > 0)
+		pipeline.maxQueuedBases = maxQueuedBases;
+	if (maxQueuedRecords > 0)
+		pipeline.maxQueuedRecords = maxQueuedRecords;
+	for (string& modelArgument : modelArguments) {
+		string name = modelArgument.substr(0, modelArgument.find('='));
+		string fileName = modelArgument.substr(modelArgument.find('=') + 1);
+
+		HMMProbabilities* probabilities = loadModel(name, fileName, iterations, threads);
+		pipeline.addModel(name, probabilities);
+		delete probabilities;
+	}
+
+	pipeline.run(fileNames, STDOUT_FILENO);
+	cerr << "Annotated " << pipeline.numRecords << " records (reader waited " << pipeline.numReaderWaits
+		<< " times, writer waited " << pipeline.numWriterWaits << " times)\n";
+
+	return 0;
+}
+
+int score(int argc, char *argv[]) {
+	int iterations = 10;
+	string fastaFileName;
+	vector<string> modelArguments;
+
+	for (int i = 2; i < argc; i++) {
+		string argument = argv[i];
+		if (argument == "-iterations" && i + 1 < argc)
+			iterations = atoi(argv[++i]);
+		else if (argument.find('=') != string::npos)
+			modelArguments.push_back(argument);
+		else if (fastaFileName.empty() && argument[0] != '-')
+			fastaFileName = argument;
+		else {
+			cerr << "Unknown argument: " << argument << "\n";
+			return -1;
+		}
+	}
+
+	if (fastaFileName.empty() || modelArguments.empty()) {
+		cerr << "usage: hmm score [-iterations n] fastaFile name=modelFile ...\n";
+		return -1;
+	}
+
+	// Load (or train) every model once
+	HMMForwardScorer scorer;
+	vector<string> modelNames;
+	for (string& modelArgument : modelArguments) {
+		string name = modelArgument.substr(0, modelArgument.find('='));
+		string fileName = modelArgument.substr(modelArgument.find('=') + 1);
+
+		HMMProbabilities* probabilities = loadModel(name, fileName, iterations, 0);
+		scorer.addModel(probabilities);
+		modelNames.push_back(name);
+		delete probabilities;
+	}
+
+	FastaReader reader(fastaFileName);
+	string header;
+	while (scorer.scoreNextRecord(reader, header)) {
+		stringstream ss;
+		ss << fixed << setprecision(3);
+		ss << "    <result type=\"score\" name=\"" << header.substr(0, header.find_first_of(" \t"))
+			<< "\" best=\"" << modelNames[scorer.bestModel()] << "\">";
+		for (int model = 0; model < scorer.getNumModels(); model++) {
+			ss << modelNames[model] << "=" << scorer.logLikelihood(model);
+			if (model < scorer.getNumModels() - 1)
+				ss << ",";
+		}
+		ss << "</result>\n";
+		cout << ss.str();
+	}
+
+	return 0;
+}
+
+int benchmark(int argc, char *argv[]) {
+	HMMBenchmark benchmark;
+	string outputFileName;
+
+	for (int i = 2; i < argc; i++) {
+		string argument = argv[i];
+		if (argument == "-sizes" && i + 1 < argc)
+			benchmark.sizes = HMMBenchmark::parseSizes(argv[++i]);
+		else if (argument == "-repetitions" && i + 1 < argc)
+			benchmark.repetitions = atoi(argv[++i]);
+		else if (argument == "-seed" && i + 1 < argc)
+			benchmark.seed = strtoul(argv[++i], NULL, 10);
+		else if (argument == "-precision" && i + 1 < argc)
+			benchmark.viterbiPrecision = HMMViterbiKernel::parsePrecision(argv[++i]);
+		else if (argument == "-checkpoint" && i + 1 < argc) {
+			string interval = argv[++i];
+			benchmark.checkpointInterval = (interval == "auto") ? HMMTrellis::automaticCheckpointInterval : atoi(interval.c_str());
+		}
+		else if (argument == "-maxForwardBackward" && i + 1 < argc)
+			benchmark.maxForwardBackwardBases = HMMBenchmark::parseSize(argv[++i]);
+		else if (argument == "-output" && i + 1 < argc)
+			outputFileName = argv[++i];
+		else {
+			cerr << "Unknown argument: " << argument << "\n";
+			cerr << "usage: hmm benchmark [-sizes 10k,100k,1M] [-repetitions n] [-seed n] [-precision long|double|float] [-checkpoint n|auto] [-maxForwardBackward size] [-output file]\n";
+			return -1;
+		}
+	}
+
+	if (outputFileName.empty()) {
+		benchmark.run(cout);
+		return 0;
+	}
+
+	ofstream output(outputFileName.c_str());
+	if (!output)
+		throw runtime_error("Unable to create output file: " + outputFileName);
+	benchmark.run(output);
+
+	return 0;
+}
+
 int main( int argc, char *argv[] ) {
-/*
+	if (argc >= 2 && (string(argv[1]) == "serve" || string(argv[1]) == "annotate" || string(argv[1]) == "score" || string(argv[1]) == "benchmark")) {
+		try {
+			if (string(argv[1]) == "serve")
+				return serve(argc, argv);
+			if (string(argv[1]) == "annotate")
+				return annotate(argc, argv);
+			if (string(argv[1]) == "score")
+				return score(argc, argv);
+			return benchmark(argc, argv);
+		}
+		catch (exception& e) {
+			cerr << e.what() << "\n";
+			return -1;
+		}
+	}
+
+	// Separate the options from the positional arguments
+	vector<string> arguments;
+	int precision = HMMViterbiKernel::longDoublePrecision;
+	bool validate = false;
+	string metrics;
+	string confidence;
+	string training = "viterbi";
+	string cacheFileName;
+	long double convergenceThreshold = -1;		// negative trains every iteration
+	int threads = 1;
+	int minimumOrf = 0;
+	HMMGeneWriter::Format format = HMMGeneWriter::xmlFormat;
+	try {
+		for (int i = 1; i < argc; i++) {
+			string argument = argv[i];
+			if (argument == "-precision" && i + 1 < argc)
+				precision = HMMViterbiKernel::parsePrecision(argv[++i]);
+			else if (argument == "-validate")
+				validate = true;
+			else if (argument == "-confidence" && i + 1 < argc) {
+				confidence = argv[++i];
+				if (confidence != "viterbi" && confidence != "posterior")
+					throw invalid_argument("Unknown confidence decoding: " + confidence);
+			}
+			else if (argument == "-metrics" && i + 1 < argc) {
+				metrics = argv[++i];
+				if (metrics != "json" && metrics != "prometheus")
+					throw invalid_argument("Unknown metrics format: " + metrics);
+			}
+			else if (argument == "-training" && i + 1 < argc) {
+				training = argv[++i];
+				if (training != "viterbi" && training != "baumwelch")
+					throw invalid_argument("Unknown training: " + training);
+			}
+			else if (argument == "-converge" && i + 1 < argc) {
+				char* end;
+				convergenceThreshold = strtold(argv[++i], &end);
+				if (*end != '\0' || end == argv[i] || convergenceThreshold < 0)
+					throw invalid_argument("Invalid convergence threshold: " + string(argv[i]));
+			}
+			else if (argument == "-cache" && i + 1 < argc)
+				cacheFileName = argv[++i];
+			else if (argument == "-threads" && i + 1 < argc)
+				threads = atoi(argv[++i]);
+			else if (argument == "-format" && i + 1 < argc)
+				format = HMMGeneWriter::parseFormat(argv[++i]);
+			else if (argument == "-minimumOrf" && i + 1 < argc)
+				minimumOrf = atoi(argv[++i]);
+			else
+				arguments.push_back(argument);
+		}
+
+		if (training == "baumwelch" && (validate || !confidence.empty() || format != HMMGeneWriter::xmlFormat || convergenceThreshold >= 0))
+			throw invalid_argument("-validate, -confidence, -format and -converge need viterbi training");
+		if (threads != 1 && (validate || !confidence.empty()))
+			throw invalid_argument("-validate and -confidence decode a single model and can not be used with -threads");
+	}
+	catch (exception& e) {
+		cerr << e.what() << "\n";
+		return -1;
+	}
+
     // Check that file name and iterations were entered as arguments
-    if (argc < 3) {
+    if (arguments.size() < 2) {
             cout << "Invalid # of arguments\n";
-            cout << "usage: hmm fastaFile iterations\n";
+            cout << "usage: hmm fastaFile ... iterations [probabilitiesFile] [-cache cacheFile] [-training viterbi|baumwelch] [-converge threshold] [-threads n] [-format xml|gff3|bed] [-minimumOrf bases] [-precision long|double|float] [-validate] [-confidence viterbi|posterior] [-metrics json|prometheus]\n";
+            cout << "       hmm serve [-socket path] [-threads n] [-batch n] [-iterations n] [-format xml|gff3|bed] [-precision long|double|float] [-batched maxBases] name=modelFile ...\n";
+            cout << "       hmm annotate [-threads n] [-iterations n] [-format xml|gff3|bed] [-precision long|double|float] [-queueBases size] [-queueRecords n] name=modelFile ... fastaFile ...\n";
+            cout << "       hmm score [-iterations n] fastaFile name=modelFile ...\n";
+            cout << "       hmm benchmark [-sizes 10k,100k,1M] [-repetitions n] [-seed n] [-precision long|double|float] [-checkpoint n|auto] [-maxForwardBackward size] [-output file]\n";
             return -1;
     }
 
-    cout << "Starting\n";
+    // Get Parameters (every argument before the iterations is a fasta file)
+	unsigned int iterationsArgument = 1;
+	while (iterationsArgument < arguments.size() && !isCount(arguments[iterationsArgument]))
+		iterationsArgument++;
+	if (iterationsArgument >= arguments.size()) {
+		cerr << "The number of iterations is missing\n";
+		return -1;
+	}
+	vector<string> fastaFileNames(arguments.begin(), arguments.begin() + iterationsArgument);
+    int iterations = atoi(arguments[iterationsArgument].c_str());
+	string probabilitiesFileName = (iterationsArgument + 1 < arguments.size()) ? arguments[iterationsArgument + 1] : "";
+
+	// Create a fasta file object for every record
+	vector<FastaFile*> fastaFiles;
+	try {
+		if (cacheFileName.empty())
+			readFastaRecords(fastaFileNames, fastaFiles);
+		else if (fastaFileNames.size() == 1)
+			readCacheRecords(cacheFileName, fastaFileNames[0], fastaFiles);
+		else
+			throw invalid_argument("-cache reads a single fasta file");
+		if (fastaFiles.size() > 1 && (validate || !confidence.empty()))
+			throw invalid_argument("-validate and -confidence decode a single model and can not be used with multi-record input");
+	}
+	catch (exception& e) {
+		cerr << e.what() << "\n";
+		for (FastaFile* fastaFile : fastaFiles)
+			delete fastaFile;
+		return -1;
+	}
+	FastaFile* fastaFile = fastaFiles[0];
+
+	if (format == HMMGeneWriter::xmlFormat) {
+		for (FastaFile* record : fastaFiles)
+			cout << record->firstLineResultString();
+	}
+
+	HMMProbabilities* trainedProbabilities = NULL;
+	HiddenMarkovModel* hmm = NULL;
+	HMMViterbiTrainer* viterbiTrainer = NULL;
+	HMMBaumWelchTrainer* baumWelchTrainer = NULL;
+
+	// Several records are trained together by a trainer, even on one thread
+	bool multipleSequences = (threads != 1 || fastaFiles.size() > 1);
+	if (training == "baumwelch" && multipleSequences) {
+		// Baum-Welch trains until the likelihood converges
+		baumWelchTrainer = new HMMBaumWelchTrainer(threads);
+		baumWelchTrainer->setOrfPruning(true, minimumOrf);
+		for (FastaFile* record : fastaFiles)
+			baumWelchTrainer->addSequence(record);
+		baumWelchTrainer->baumWelchTraining();
+		cout << baumWelchTrainer->baumWelchResultsString();
+		trainedProbabilities = baumWelchTrainer->probabilities;
+	}
+	else if (training == "baumwelch") {
+		hmm = new HiddenMarkovModel(fastaFile);
+		hmm->setOrfPruning(true, minimumOrf);
+		hmm->baumWelchTraining();
+		trainedProbabilities = hmm->probabilities;
+	}
+	else if (multipleSequences) {
+		viterbiTrainer = new HMMViterbiTrainer(threads);
+		viterbiTrainer->setViterbiPrecision(precision);
+		viterbiTrainer->setOrfPruning(true, minimumOrf);
+		for (FastaFile* record : fastaFiles)
+			viterbiTrainer->addSequence(record);
+		if (convergenceThreshold >= 0)
+			viterbiTrainer->viterbiTraining(iterations, convergenceThreshold, 0);
+		else
+			viterbiTrainer->viterbiTraining(iterations);
+		if (format == HMMGeneWriter::xmlFormat)
+			cout << viterbiTrainer->viterbiResultsString();
+		else {
+			cout.flush();
+			HMMGeneWriter writer(STDOUT_FILENO, format);
+			viterbiTrainer->writeGenes(writer);
+			writer.flush();
+		}
+		if (convergenceThreshold >= 0)
+			(format == HMMGeneWriter::xmlFormat ? cout : cerr) << viterbiTrainer->convergenceResultsString();
+		trainedProbabilities = viterbiTrainer->probabilities;
+	}
+	else {
+		// Create the Hidden Markov Model
+		hmm = new HiddenMarkovModel(fastaFile);
+		hmm->setViterbiPrecision(precision);
+		hmm->setOrfPruning(true, minimumOrf);
+		if (convergenceThreshold >= 0)
+			hmm->viterbiTraining(iterations, convergenceThreshold, 0);
+		else
+			hmm->viterbiTraining(iterations);
+
+		if (format == HMMGeneWriter::xmlFormat)
+			cout << hmm->viterbiResultsString();
+		else {
+			cout.flush();
+			HMMGeneWriter writer(STDOUT_FILENO, format);
+			hmm->writeGenes(writer, fastaFile->getSequenceName());
+			writer.flush();
+		}
+		if (convergenceThreshold >= 0)
+			(format == HMMGeneWriter::xmlFormat ? cout : cerr) << hmm->convergenceResultsString();
+		trainedProbabilities = hmm->probabilities;
 
-    // Get Parameters
-    string fastaFileName = argv[1];
-    int iterations = atoi(argv[2]);
-*/
-	// Set Fasta File names
-	string fastaFileName = "c:/Users/kolart/Documents/Genome540/Assignment6/shigella_short.fna";
-	int iterations = 1;
+		if (validate) {
+			if (precision == HMMViterbiKernel::longDoublePrecision)
+				precision = HMMViterbiKernel::floatPrecision;
+			cout << hmm->crossCheckViterbiPrecision(precision);
+		}
 
-	// Create the fasta file object
-	FastaFile* fastaFile = new FastaFile(fastaFileName);
-	cout << "Fasta's done\n";
+		if (!confidence.empty()) {
+			HMMPosteriorResults* posteriorResults = hmm->posteriorDecoding(confidence == "posterior");
+			cout << posteriorResults->resultsString();
+			delete posteriorResults;
+		}
+	}
 
-	cout << fastaFile->firstLineResultString();
+	int status = 0;
+	if (!probabilitiesFileName.empty()) {
+		try {
+			trainedProbabilities->save(probabilitiesFileName);
+		}
+		catch (exception& e) {
+			cerr << e.what() << "\n";
+			status = -1;
+		}
+	}
 
-	// Create the Hidden Markov Model
-	HiddenMarkovModel hmm(fastaFile);
-	hmm.viterbiTraining(iterations);
+	if (metrics == "json")
+		cerr << HMMInstrumentation::jsonResultsString();
+	else if (metrics == "prometheus")
+		cerr << HMMInstrumentation::prometheusResultsString();
 
-	cout << hmm.viterbiResultsString();
-	cout << "Fred";
+	delete hmm;
+	delete viterbiTrainer;
+	delete baumWelchTrainer;
+	for (FastaFile* record : fastaFiles)
+		delete record;
+	return status;
 }